@@ -0,0 +1,168 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+/*
+ * Counts heap allocations made while recording and submitting a frame. After a few warm-up frames (pools, fences and
+ * vectors reaching their steady-state size) recording should not allocate at all. Runs headless and exits with
+ * EXIT_FAILURE if it does.
+ */
+
+#include <g_app.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<uint64_t> g_allocations = 0;
+
+void* operator new(std::size_t size){
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void* operator new[](std::size_t size){ return operator new(size); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+struct Vertex {
+    float x, y;
+    float r, g, b;
+};
+
+constexpr uint32_t WARMUP_FRAMES = 16;
+constexpr uint32_t MEASURED_FRAMES = 1000;
+constexpr uint32_t DRAWS_PER_FRAME = 256;
+
+int main(){
+    auto renderer = g_app::VulkanRendererInit()
+            .set_app_name("Allocation Benchmark")
+            .set_engine_name("g_app")
+            .set_headless(800, 600)
+            .init();
+
+    Vertex vertices[] = {
+            Vertex{ 0.0f, -0.05f, 1.0f, 0.0f, 0.0f},
+            Vertex{ 0.05f, 0.05f, 0.0f, 1.0f, 0.0f},
+            Vertex{-0.05f, 0.05f, 0.0f, 0.0f, 1.0f},
+    };
+
+    auto vertex_buffer = g_app::BufferInit<Vertex>()
+            .set_label("Vertex Buffer")
+            .set_usage(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            .set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU)
+            .set_size(3)
+            .set_data(vertices)
+            .init(renderer);
+
+    auto pipeline = g_app::GraphicsPipelineInit()
+            .add_push_constant_range({VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(float)*2})
+            .add_vertex_binding(g_app::VertexBindingBuilder(sizeof(Vertex))
+                .add_vertex_attribute(VK_FORMAT_R32G32_SFLOAT,    0)
+                .add_vertex_attribute(VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, r))
+                .build()
+            ).attach_shader_module(g_app::ShaderModuleInit()
+                .set_label("Vertex Shader")
+                .set_src_from_file("../examples/triangle/shader.vert.spv")
+                .set_stage(VK_SHADER_STAGE_VERTEX_BIT)
+                .init(renderer)
+            ).attach_shader_module(g_app::ShaderModuleInit()
+                .set_label("Fragment Shader")
+                .set_src_from_file("../examples/triangle/shader.frag.spv")
+                .set_stage(VK_SHADER_STAGE_FRAGMENT_BIT)
+                .init(renderer)
+            ).set_render_pass(renderer.default_render_pass())
+            .init(renderer);
+
+    g_app::PerFrame command_buffers(renderer, [&](uint32_t){ return g_app::CommandBuffer(renderer); });
+
+    uint64_t recording_allocations = 0;
+    uint64_t frame_allocations = 0;
+    g_app::BindStats stats = {};
+
+    for(uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++){
+        bool measured = frame >= WARMUP_FRAMES;
+        uint64_t frame_start = g_allocations.load(std::memory_order_relaxed);
+
+        if(!renderer.acquire_next_swapchain_image()) continue;
+
+        uint64_t recording_start = g_allocations.load(std::memory_order_relaxed);
+        auto& cmd = command_buffers.current();
+        cmd.begin().begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f);
+
+        for(uint32_t i = 0; i < DRAWS_PER_FRAME; i++){
+            float offset[] = {
+                static_cast<float>(i % 16) / 8.0f - 0.9375f,
+                static_cast<float>(i / 16) / 8.0f - 0.9375f,
+            };
+
+            // Pipeline and vertex buffer are rebound for every draw, only the first binds reach Vulkan
+            cmd.bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
+               .bind_vertex_buffer(vertex_buffer)
+               .cmd([&, i](g_app::CommandBuffer& cmd){
+                   cmd.push_constants(pipeline, VK_SHADER_STAGE_VERTEX_BIT, offset)
+                      .draw(3, 1, 0, i);
+               });
+        }
+
+        cmd.end_render_pass()
+           .submit(g_app::Queue::GRAPHICS,
+                   {{renderer.current_image_available_semaphore(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}},
+                   {{renderer.current_render_finished_semaphore()}},
+                   renderer.current_in_flight_fence());
+        uint64_t recording_end = g_allocations.load(std::memory_order_relaxed);
+
+        renderer.present();
+
+        if(measured){
+            recording_allocations += recording_end - recording_start;
+            frame_allocations += g_allocations.load(std::memory_order_relaxed) - frame_start;
+            stats = cmd.bind_stats();
+        }
+    }
+
+    renderer.device_wait_idle();
+
+    spdlog::info("{} frames, {} draws per frame", MEASURED_FRAMES, DRAWS_PER_FRAME);
+    spdlog::info("  allocations while recording: {} ({:.3f} per frame)",
+                 recording_allocations, static_cast<double>(recording_allocations) / MEASURED_FRAMES);
+    spdlog::info("  allocations per frame including acquire/present: {:.3f}",
+                 static_cast<double>(frame_allocations) / MEASURED_FRAMES);
+    spdlog::info("  last frame binds: pipeline {}/{} skipped, vertex buffer {}/{} skipped, push constants {}/{} skipped",
+                 stats.skipped_pipeline_binds, stats.pipeline_binds + stats.skipped_pipeline_binds,
+                 stats.skipped_vertex_buffer_binds, stats.vertex_buffer_binds + stats.skipped_vertex_buffer_binds,
+                 stats.skipped_push_constants, stats.push_constants + stats.skipped_push_constants);
+
+    if(recording_allocations != 0){
+        spdlog::error("Frame recording allocated on the heap!");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -34,40 +34,26 @@ int main(){
 
     auto descriptor_pool = DescriptorPoolInit()
             .set_label("Descriptor Pool")
-            .set_max_sets(VulkanRenderer::MAX_FRAMES_IN_FLIGHT)
-            .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VulkanRenderer::MAX_FRAMES_IN_FLIGHT)
+            .set_max_sets(1)
+            .add_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
             .init(app.renderer());
 
     auto descriptor_set_layout = DescriptorSetLayoutInit()
             .set_label("Set Layout")
-            .add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
+            .add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1,
                          VK_SHADER_STAGE_VERTEX_BIT)
             .init(app.renderer());
 
-    std::vector<Buffer<TransformData>> uniform_buffers = {};
-    uniform_buffers.reserve(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
-
-    for(uint32_t i = 0; i < VulkanRenderer::MAX_FRAMES_IN_FLIGHT; i++){
-        uniform_buffers.push_back(BufferInit<TransformData>()
-                                          .set_label(std::format("Uniform Buffer {}", i))
-                                          .set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU)
-                                          .set_size(1)
-                                          .set_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
-                                          .init(app.renderer())
-        );
-    }
-
-    auto descriptor_sets = descriptor_pool.allocate_sets(
-            {VulkanRenderer::MAX_FRAMES_IN_FLIGHT, descriptor_set_layout}
-    );
-
-    auto set_writer = DescriptorWriter();
-    uint32_t i = 0;
-    for(const auto& set : descriptor_sets){
-        set_writer.write_buffer(set, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniform_buffers[i]);
-        i++;
-    }
-    set_writer.commit_writes(app.renderer());
+    // Every frame's transform is carved out of one buffer and selected with a dynamic offset
+    auto uniforms = UniformAllocatorInit()
+            .set_label("Uniforms")
+            .set_size_per_frame(64 * 1024)
+            .init(app.renderer());
+
+    auto descriptor_set = descriptor_pool.allocate_set(descriptor_set_layout);
+    DescriptorWriter()
+            .write_buffer(descriptor_set, 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, uniforms.buffer(), 0, sizeof(TransformData))
+            .commit_writes(app.renderer());
 
     const uint32_t vertex_count = 8;
     glm::vec3 cube_color_a = {0.4f, 1.0f, 0.2f};
@@ -107,27 +93,12 @@ int main(){
             .set_size(index_count)
             .init(app.renderer());
 
-    CommandBuffer(app.renderer())
-            .begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT)
-            .copy_buffer(
-                    BufferInit<Vertex>()
-                            .set_label("Vertex Staging Buffer")
-                            .set_usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
-                            .set_memory_usage(VMA_MEMORY_USAGE_CPU_ONLY)
-                            .set_size(vertex_count)
-                            .set_data(vertices)
-                            .init(app.renderer()),
-                    vertex_buffer)
-            .copy_buffer(
-                    BufferInit<uint32_t>()
-                            .set_label("Index Staging Buffer")
-                            .set_usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
-                            .set_memory_usage(VMA_MEMORY_USAGE_CPU_ONLY)
-                            .set_size(index_count)
-                            .set_data(indices)
-                            .init(app.renderer()),
-                    index_buffer)
-            .submit(Queue::TRANSFER);
+    // Both copies go out in one transfer submission
+    app.renderer().uploads()
+            .upload_buffer(vertex_buffer, vertices)
+            .upload_buffer(index_buffer, indices)
+            .flush()
+            .wait();
 
     RasterizationInfo rasterization_info = {};
     rasterization_info.cull_mode = VK_CULL_MODE_BACK_BIT;
@@ -155,10 +126,28 @@ int main(){
             .set_pipeline_cache(pipeline_cache)
             .init(app.renderer());
 
-    CommandBuffer cmd[VulkanRenderer::MAX_FRAMES_IN_FLIGHT];
-    for(auto & c : cmd){
-        c = CommandBuffer(app.renderer());
-    }
+    auto profiler = GpuProfilerInit()
+            .set_label("Cube Profiler")
+            .init(app.renderer());
+
+    PerFrame cmd(app.renderer(), [&](uint32_t){ return CommandBuffer(app.renderer()); });
+    PerFrame imgui_cmd(app.renderer(), [&](uint32_t){
+        return CommandBuffer(app.renderer(), VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+    });
+
+    // Only the transform changes between frames, so the cube's commands are recorded once per image and frame slot
+    // and re-recorded only when the swapchain is recreated or something they bind is destroyed or rewritten
+    auto cube_cmd = CachedCommandBufferInit()
+            .set_label("Cube Commands")
+            .set_record_function([&](CommandBuffer& cmd, uint32_t, uint32_t frame){
+                cmd.bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
+                        .bind_vertex_buffer(vertex_buffer)
+                        .bind_index_buffer(index_buffer, VK_INDEX_TYPE_UINT32)
+                        .bind_descriptor_sets(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                              {descriptor_set}, {uniforms.frame_offset(frame)}
+                        ).draw_indexed(index_count, 1);
+            })
+            .init(app.renderer());
 
 
     glm::vec3 position = {0.0f, 0.0f, -10.0f};
@@ -180,7 +169,9 @@ int main(){
         ImGui::SliderFloat("rz", &rotation.z, -20.0f, 20.0f);
 
         ImGui::SliderFloat("Scale", &scale, 0.1f, 10.0f);
+        ImGui::Text("Cube recorded %u times", cube_cmd.record_count());
         ImGui::End();
+        profiler.draw_imgui();
         ImGui::Render();
 
         auto window_extent = app.window().extent();
@@ -194,24 +185,28 @@ int main(){
         model = glm::scale(model, {scale, scale, scale});
         transform.model = model;
 
-        // Upload uniform data
-        auto data = uniform_buffers[app.renderer().current_frame()].map();
-        *data = transform;
-        uniform_buffers[app.renderer().current_frame()].unmap();
-
         if(!app.renderer().acquire_next_swapchain_image()) return;
 
-        cmd[app.renderer().current_frame()]
+        // Upload uniform data, the first push of a frame lands where the cached commands expect it
+        auto transform_slice = uniforms.push(transform);
+        assert(transform_slice.offset == uniforms.frame_offset(app.renderer().current_frame()));
+
+        auto& primary = cmd.current()
                 .begin()
-                .begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f)
-                .bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
-                .bind_vertex_buffer(vertex_buffer)
-                .bind_index_buffer(index_buffer, VK_INDEX_TYPE_UINT32)
-                .bind_descriptor_sets(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                      {descriptor_sets[app.renderer().current_frame()]}
-                ).draw_indexed(index_count, 1)
+                .begin_profiling(profiler)
+                .begin_zone("Frame")
+                .begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+
+        // ImGui changes every frame, it gets its own secondary since the render pass only takes secondaries
+        auto& imgui = imgui_cmd.current()
+                .begin_secondary(primary.inheritance())
                 .draw_imgui()
+                .end();
+
+        cube_cmd.execute(primary)
+                .execute_commands(std::span(&imgui, 1))
                 .end_render_pass()
+                .end_zone()
 
                 .end()
                 .submit(g_app::Queue::GRAPHICS, {
@@ -0,0 +1,152 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+/*
+ * Records a scene of meshes submitted in scene order, alternating between an opaque and a blended pipeline, through a
+ * DrawList and reports how many binds sorting saved and how many draws were merged. Runs headless.
+ */
+
+#include <g_app.hpp>
+
+#include <array>
+#include <chrono>
+#include <format>
+
+struct Vertex {
+    float x, y;
+    float r, g, b;
+};
+
+constexpr uint32_t WARMUP_FRAMES = 16;
+constexpr uint32_t MEASURED_FRAMES = 200;
+constexpr uint32_t OBJECTS = 1024;
+constexpr uint32_t MESHES = 3;
+
+static g_app::Pipeline create_pipeline(const g_app::VulkanRenderer& renderer, const std::string& label, bool blended){
+    return g_app::GraphicsPipelineInit()
+            .set_label(label)
+            .set_blend_info((blended) ? g_app::BlendInfoBuilder().enable_blending().build()
+                                      : g_app::BlendInfoBuilder().disable_blending().build())
+            .add_push_constant_range({VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(float)*2})
+            .add_vertex_binding(g_app::VertexBindingBuilder(sizeof(Vertex))
+                .add_vertex_attribute(VK_FORMAT_R32G32_SFLOAT,    0)
+                .add_vertex_attribute(VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, r))
+                .build()
+            ).attach_shader_module(g_app::ShaderModuleInit()
+                .set_label("Vertex Shader")
+                .set_src_from_file("../examples/triangle/shader.vert.spv")
+                .set_stage(VK_SHADER_STAGE_VERTEX_BIT)
+                .init(renderer)
+            ).attach_shader_module(g_app::ShaderModuleInit()
+                .set_label("Fragment Shader")
+                .set_src_from_file("../examples/triangle/shader.frag.spv")
+                .set_stage(VK_SHADER_STAGE_FRAGMENT_BIT)
+                .init(renderer)
+            ).set_render_pass(renderer.default_render_pass())
+            .init(renderer);
+}
+
+int main(){
+    auto renderer = g_app::VulkanRendererInit()
+            .set_app_name("Draw List")
+            .set_engine_name("g_app")
+            .set_headless(800, 600)
+            .init();
+
+    // Triangles of different sizes, each in its own buffer like separately loaded meshes
+    std::array<g_app::Buffer<Vertex>, MESHES> meshes = {};
+    for(uint32_t i = 0; i < MESHES; i++){
+        float size = 0.02f * static_cast<float>(i + 1);
+        Vertex vertices[] = {
+                Vertex{ 0.0f, -size, 1.0f, 0.0f, 0.0f},
+                Vertex{ size,  size, 0.0f, 1.0f, 0.0f},
+                Vertex{-size,  size, 0.0f, 0.0f, 1.0f},
+        };
+        meshes[i] = g_app::BufferInit<Vertex>()
+                .set_label(std::format("Mesh {}", i))
+                .set_usage(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+                .set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU)
+                .set_size(3)
+                .set_data(vertices)
+                .init(renderer);
+    }
+
+    auto opaque = create_pipeline(renderer, "Opaque Pipeline", false);
+    auto blended = create_pipeline(renderer, "Blended Pipeline", true);
+
+    auto draw_list = g_app::DrawListInit()
+            .set_label("Scene")
+            .set_multi_draw_capacity(OBJECTS)
+            .enable_bind_stats()
+            .init(renderer);
+
+    g_app::PerFrame command_buffers(renderer, [&](uint32_t){ return g_app::CommandBuffer(renderer); });
+
+    double record_ms = 0.0;
+    for(uint32_t frame = 0; frame < WARMUP_FRAMES + MEASURED_FRAMES; frame++){
+        if(!renderer.acquire_next_swapchain_image()) continue;
+
+        auto& cmd = command_buffers.current();
+        cmd.begin().begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f);
+
+        auto start = std::chrono::steady_clock::now();
+        draw_list.clear();
+        for(uint32_t i = 0; i < OBJECTS; i++){
+            // Scene order interleaves pipelines and meshes, objects on the same row share their push constants
+            float offset[] = {0.0f, static_cast<float>(i / 32) / 16.0f - 0.96875f};
+            bool is_blended = i % 4 == 0;
+            draw_list.add(g_app::DrawPacketBuilder((is_blended) ? blended : opaque)
+                    .add_vertex_buffer(meshes[(i * 7) % MESHES])
+                    .set_push_constants(VK_SHADER_STAGE_VERTEX_BIT, offset)
+                    .draw(3, 1, 0, i % 32)
+                    .set_layer((is_blended) ? 1 : 0)
+                    .build());
+        }
+        draw_list.record(cmd);
+        auto end = std::chrono::steady_clock::now();
+        if(frame >= WARMUP_FRAMES) record_ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+        cmd.end_render_pass()
+           .submit(g_app::Queue::GRAPHICS,
+                   {{renderer.current_image_available_semaphore(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}},
+                   {{renderer.current_render_finished_semaphore()}},
+                   renderer.current_in_flight_fence());
+        renderer.present();
+    }
+
+    renderer.device_wait_idle();
+
+    const auto& stats = draw_list.stats();
+    spdlog::info("{} frames, {} packets per frame", MEASURED_FRAMES, stats.packets);
+    spdlog::info("  binds: {} in scene order, {} sorted", stats.unsorted_binds, stats.sorted_binds);
+    spdlog::info("  draw calls: {} ({} instanced merges, {} multi-draw merges)",
+                 stats.draw_calls, stats.instanced_merges, stats.multi_draw_merges);
+    spdlog::info("  building and recording the list: {:.3f} ms per frame", record_ms / MEASURED_FRAMES);
+    return EXIT_SUCCESS;
+}
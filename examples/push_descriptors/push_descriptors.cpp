@@ -41,18 +41,14 @@ int main(){
             .set_flags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR)
             .init(app.renderer());
 
-    std::vector<Buffer<TransformData>> uniform_buffers = {};
-    uniform_buffers.reserve(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
-
-    for(uint32_t i = 0; i < VulkanRenderer::MAX_FRAMES_IN_FLIGHT; i++){
-        uniform_buffers.push_back(BufferInit<TransformData>()
-                                          .set_label(std::format("Uniform Buffer {}", i))
-                                          .set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU)
-                                          .set_size(1)
-                                          .set_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
-                                          .init(app.renderer())
-        );
-    }
+    PerFrame uniform_buffers(app.renderer(), [&](uint32_t i){
+        return BufferInit<TransformData>()
+                .set_label(std::format("Uniform Buffer {}", i))
+                .set_persistently_mapped()
+                .set_size(1)
+                .set_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+                .init(app.renderer());
+    });
 
     const uint32_t vertex_count = 8;
     glm::vec3 cube_color_a = {0.4f, 1.0f, 0.2f};
@@ -92,27 +88,12 @@ int main(){
             .set_size(index_count)
             .init(app.renderer());
 
-    CommandBuffer(app.renderer())
-            .begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT)
-            .copy_buffer(
-                    BufferInit<Vertex>()
-                            .set_label("Vertex Staging Buffer")
-                            .set_usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
-                            .set_memory_usage(VMA_MEMORY_USAGE_CPU_ONLY)
-                            .set_size(vertex_count)
-                            .set_data(vertices)
-                            .init(app.renderer()),
-                    vertex_buffer)
-            .copy_buffer(
-                    BufferInit<uint32_t>()
-                            .set_label("Index Staging Buffer")
-                            .set_usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
-                            .set_memory_usage(VMA_MEMORY_USAGE_CPU_ONLY)
-                            .set_size(index_count)
-                            .set_data(indices)
-                            .init(app.renderer()),
-                    index_buffer)
-            .submit(Queue::TRANSFER);
+    // Both copies go out in one transfer submission
+    app.renderer().uploads()
+            .upload_buffer(vertex_buffer, vertices)
+            .upload_buffer(index_buffer, indices)
+            .flush()
+            .wait();
 
     RasterizationInfo rasterization_info = {};
     rasterization_info.cull_mode = VK_CULL_MODE_BACK_BIT;
@@ -140,10 +121,7 @@ int main(){
             .set_pipeline_cache(pipeline_cache)
             .init(app.renderer());
 
-    CommandBuffer cmd[VulkanRenderer::MAX_FRAMES_IN_FLIGHT];
-    for(auto & c : cmd){
-        c = CommandBuffer(app.renderer());
-    }
+    PerFrame cmd(app.renderer(), [&](uint32_t){ return CommandBuffer(app.renderer()); });
 
 
     glm::vec3 position = {0.0f, 0.0f, -10.0f};
@@ -178,17 +156,15 @@ int main(){
         model = glm::scale(model, {scale, scale, scale});
         transform.model = model;
 
+        if(!app.renderer().acquire_next_swapchain_image()) return;
+
         // Upload uniform data
-        auto data = uniform_buffers[app.renderer().current_frame()].map();
-        *data = transform;
-        uniform_buffers[app.renderer().current_frame()].unmap();
+        uniform_buffers->write(transform);
 
-        if(!app.renderer().acquire_next_swapchain_image()) return;  
-        
         auto writer = DescriptorWriter()
-            .write_buffer(DescriptorSet(), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniform_buffers[app.renderer().current_frame()]);
+            .write_buffer(DescriptorSet(), 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, uniform_buffers.current());
 
-        cmd[app.renderer().current_frame()]
+        cmd.current()
                 .begin()
                 .begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f)
                 .bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
@@ -14,9 +14,11 @@ class RenderTexture {
 public:
     static constexpr uint32_t WIDTH = 800;
     static constexpr uint32_t HEIGHT = 600;
+    static constexpr VkFormat FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
     const std::string CACHE_PATH = "../examples/render_texture/render_texture.cache";
 
-    RenderTexture(const VulkanRenderer& renderer){
+    /* draw_scene records what ends up in the texture, the graph begins and ends rendering into it. */
+    RenderTexture(const VulkanRenderer& renderer, std::function<void(CommandBuffer&)>&& draw_scene){
         const Vertex vertices[] = {
                 Vertex{-1.0f, -1.0f, 0.0f, 0.0f }, // Top Left
                 Vertex{ 1.0f, -1.0f, 1.0f, 0.0f }, // Top Right
@@ -45,14 +47,13 @@ public:
                 .init(renderer);
 
         m_desc_pool = DescriptorPoolInit()
-                .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VulkanRenderer::MAX_FRAMES_IN_FLIGHT)
-                .set_max_sets(VulkanRenderer::MAX_FRAMES_IN_FLIGHT)
+                .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1)
+                .set_max_sets(1)
                 .set_label("RenderTexture::m_desc_pool")
                 .init(renderer);
 
         m_desc_layout = DescriptorSetLayoutInit()
-                .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                             VulkanRenderer::MAX_FRAMES_IN_FLIGHT, VK_SHADER_STAGE_FRAGMENT_BIT)
+                .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
                 .init(renderer);
 
         m_pipeline_cache = PipelineCache::load(renderer, CACHE_PATH);
@@ -76,91 +77,54 @@ public:
                 )
                 .add_descriptor_set_layout(m_desc_layout)
                 .set_pipeline_cache(m_pipeline_cache)
-                .set_render_pass(renderer.default_render_pass())
+                .set_rendering_formats({renderer.chosen_swapchain_format()}, renderer.chosen_depth_format())
                 .set_label("RenderTexture::m_pipeline")
                 .init(renderer);
 
-        m_sets = m_desc_pool.allocate_sets({VulkanRenderer::MAX_FRAMES_IN_FLIGHT, m_desc_layout});
-        m_color_attachments.resize(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
-        m_color_attachment_views.resize(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
-        m_framebuffers.resize(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
-
-        m_render_pass = RenderPassInit()
-                .add_attachment_description(AttachmentDescriptionBuilder()
-                    .set_format(VK_FORMAT_B8G8R8A8_UNORM)
-                    .set_sample_count(VK_SAMPLE_COUNT_1_BIT)
-                    .set_load_and_store_op(
-                        VK_ATTACHMENT_LOAD_OP_CLEAR,
-                        VK_ATTACHMENT_STORE_OP_STORE)
-                    .set_stencil_load_and_store_op(VK_ATTACHMENT_LOAD_OP_DONT_CARE, VK_ATTACHMENT_STORE_OP_DONT_CARE)
-                    .set_initial_and_final_image_layout(
-                        VK_IMAGE_LAYOUT_UNDEFINED,
-                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL)
-                    .build())
-                .add_subpass_description(SubpassDescriptionBuilder()
-                    .set_pipeline_bind_point(VK_PIPELINE_BIND_POINT_GRAPHICS)
-                    .add_color_attachment({0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL})
-                    .build())
+        // The texture is a transient of the graph, which also begins and ends rendering into it. The frames in flight
+        // share it, the graph's barriers order each frame's writes after the previous frame's reads.
+        m_graph = RenderGraphInit()
+                .set_label("RenderTexture::m_graph")
                 .init(renderer);
+        m_texture = m_graph.create_image("texture", {{WIDTH, HEIGHT}, FORMAT});
+
+        m_graph.add_pass("scene", std::move(draw_scene))
+               .add_color_attachment(m_texture, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, {0.2f, 0.2f, 0.2f, 1.0f});
+        // The swapchain image isn't part of the graph, so this pass begins rendering into it itself
+        m_graph.add_pass("draw_texture", [this](CommandBuffer& cmd){
+                    cmd.begin_default_rendering(.0, .0, .0, 1.);
+                    draw_texture(cmd);
+                    cmd.end_rendering();
+               })
+               .read(m_texture, ResourceUsage::FRAGMENT_SHADER_READ)
+               .set_side_effects();
+        m_graph.compile();
 
         m_sampler = SamplerInit().init(renderer);
-
-        auto set_writer = DescriptorWriter();
-        for(uint32_t i = 0; i < VulkanRenderer::MAX_FRAMES_IN_FLIGHT; i++) {
-            m_color_attachments[i] = ImageInit()
-                    .set_image_type(VK_IMAGE_TYPE_2D)
-                    .set_usage(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
-                    .set_format(VK_FORMAT_B8G8R8A8_UNORM)
-                    .set_extent(WIDTH, HEIGHT)
-                    .set_memory_usage(VMA_MEMORY_USAGE_GPU_ONLY)
-                    .set_label("RenderTexture::m_color_attachment")
-                    .init(renderer);
-
-            m_color_attachment_views[i] = ImageViewInit()
-                    .set_image(m_color_attachments[i])
-                    .set_type(VK_IMAGE_VIEW_TYPE_2D)
-                    .set_aspect_mask(VK_IMAGE_ASPECT_COLOR_BIT)
-                    .set_label("RenderTexture::m_color_attachment_view")
-                    .init(renderer);
-
-            m_framebuffers[i] = FramebufferInit()
-                    .set_extent(WIDTH, HEIGHT)
-                    .attach_image_view(m_color_attachment_views[i])
-                    .set_render_pass(m_render_pass)
-                    .set_label("RenderTexture::m_framebuffer")
-                    .init(renderer);
-
-            set_writer.write_image(m_sets[i], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
-                                   m_color_attachment_views[i], m_sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-        }
-        set_writer.commit_writes(renderer);
+        m_set = m_desc_pool.allocate_set(m_desc_layout);
+        DescriptorWriter()
+            .write_image(m_set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                         m_graph.view(m_texture), m_sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+            .commit_writes(renderer);
     }
 
     ~RenderTexture(){
         m_pipeline_cache.serialize(CACHE_PATH);
     }
 
-    RenderPass render_pass() const { return m_render_pass; }
-
-    void begin_render_pass(CommandBuffer& cmd, uint32_t current_frame){
-        VkClearValue clear;
-        clear.color = {0.2, 0.2, 0.2, 1.0};
-
-        cmd.begin_render_pass(
-            m_render_pass, m_framebuffers[current_frame],
-            {clear}, {WIDTH, HEIGHT}
-        );
+    void render(CommandBuffer& cmd){
+        m_graph.execute(cmd);
     }
-
-    void draw_texture(CommandBuffer& cmd, uint32_t current_frame){
+private:
+    void draw_texture(CommandBuffer& cmd){
         cmd
         .bind_pipeline(m_pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
         .bind_vertex_buffer(m_vertex_buffer)
         .bind_index_buffer(m_index_buffer, VK_INDEX_TYPE_UINT32)
-        .bind_descriptor_sets(m_pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS, {m_sets[current_frame]})
+        .bind_descriptor_sets(m_pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS, {m_set})
         .draw_indexed(6, 1);
     }
-private:
+
     Buffer<Vertex>   m_vertex_buffer;
     Buffer<uint32_t> m_index_buffer;
 
@@ -170,13 +134,11 @@ private:
     DescriptorPool m_desc_pool;
     DescriptorSetLayout m_desc_layout;
 
-    std::vector<DescriptorSet> m_sets;
-    std::vector<Image> m_color_attachments;
-    std::vector<ImageView> m_color_attachment_views;
-    std::vector<Framebuffer> m_framebuffers;
+    DescriptorSet m_set;
     Sampler m_sampler;
 
-    RenderPass m_render_pass;
+    RenderGraph m_graph;
+    RenderGraphImage m_texture;
 };
 
 int main(){
@@ -186,11 +148,10 @@ int main(){
             .set_resizable(false)
             .use_primary_monitor()
             .configure_vulkan_renderer([=](VulkanRendererInit& init){
-                init.set_enabled_layers({"VK_LAYER_KHRONOS_validation"});
+                init.set_enabled_layers({"VK_LAYER_KHRONOS_validation"})
+                    .enable_dynamic_rendering();
             }).init();
 
-    auto render_texture = RenderTexture(app.renderer());
-
     Vertex vertices[] = {
             Vertex{ 0.0f, -0.5f}, // Top
             Vertex{ 0.5f,  0.5f}, // Right
@@ -220,14 +181,19 @@ int main(){
            .set_src_from_file("../examples/render_texture/shader.frag.spv")
            .set_stage(VK_SHADER_STAGE_FRAGMENT_BIT)
            .init(app.renderer())
-        ).set_render_pass(render_texture.render_pass())
+        ).set_rendering_formats({RenderTexture::FORMAT})
         .set_pipeline_cache(pipeline_cache)
         .init(app.renderer());
 
-    g_app::CommandBuffer command_buffers[g_app::VulkanRenderer::MAX_FRAMES_IN_FLIGHT] = {};
-    for(auto & command_buffer : command_buffers){
-        command_buffer = g_app::CommandBuffer(app.renderer());
-    }
+    // Draw to render_texture
+    auto render_texture = RenderTexture(app.renderer(), [&](CommandBuffer& cmd){
+        cmd
+        .bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
+        .bind_vertex_buffer(vertex_buffer)
+        .draw(3, 1);
+    });
+
+    g_app::PerFrame command_buffers(app.renderer(), [&](uint32_t){ return g_app::CommandBuffer(app.renderer()); });
 
     app.main_loop([&](const std::vector<Event>& events, const Time& time){
         for(const auto& event : events){
@@ -242,26 +208,10 @@ int main(){
 
         if(!app.renderer().acquire_next_swapchain_image()) return;
 
-        command_buffers[app.renderer().current_frame()]
+        command_buffers.current()
                 .begin()
-                /* begin_render_pass(...) */ .cmd([&](CommandBuffer& cmd){
-                    render_texture.begin_render_pass(cmd, app.renderer().current_frame());
-                })
-                // Draw to render_texture
-                .bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
-                .bind_vertex_buffer(vertex_buffer)
-                .draw(3, 1)
-
-                .end_render_pass()
-
-                .begin_default_render_pass(.0, .0, .0, 1.)
-                // Draw to screen
-                .cmd([&](CommandBuffer& cmd){
-                    render_texture.draw_texture(cmd, app.renderer().current_frame());
-                })
-
-                .end_render_pass()
-
+                // Draws the triangle into the texture and the texture to the screen
+                .cmd([&](CommandBuffer& cmd){ render_texture.render(cmd); })
                 .end()
                 .submit(g_app::Queue::GRAPHICS, {
                         {app.renderer().current_image_available_semaphore()},
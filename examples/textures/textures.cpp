@@ -71,7 +71,7 @@ int main(){
                 .set_data(indices)
                 .init(app.renderer()),
             index_buffer)
-        .submit(g_app::Queue::TRANSFER);
+        .submit_blocking(g_app::Queue::TRANSFER);
 
     auto [tex_image, tex_view] = g_app::TextureInit()
         .set_label("GruvWin Texture")
@@ -84,7 +84,7 @@ int main(){
 
     auto desc_pool = g_app::DescriptorPoolInit()
             .set_label("Descriptor Pool")
-            .set_max_sets(g_app::VulkanRenderer::MAX_FRAMES_IN_FLIGHT)
+            .set_max_sets(app.renderer().frames_in_flight())
             .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2)
             .init(app.renderer());
 
@@ -93,7 +93,7 @@ int main(){
             .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
             .init(app.renderer());
 
-    auto desc_sets = desc_pool.allocate_sets({g_app::VulkanRenderer::MAX_FRAMES_IN_FLIGHT, desc_layout});
+    auto desc_sets = desc_pool.allocate_sets(std::vector(app.renderer().frames_in_flight(), desc_layout));
 
     auto pipeline = g_app::GraphicsPipelineInit()
             .add_descriptor_set_layout(desc_layout)
@@ -114,16 +114,12 @@ int main(){
             ).set_render_pass(app.renderer().default_render_pass())
             .init(app.renderer());
 
-    g_app::CommandBuffer command_buffers[g_app::VulkanRenderer::MAX_FRAMES_IN_FLIGHT] = {};
+    g_app::PerFrame command_buffers(app.renderer(), [&](uint32_t){ return g_app::CommandBuffer(app.renderer()); });
     {
         auto writer = g_app::DescriptorWriter();
-        uint32_t i = 0;
-        for (auto &command_buffer: command_buffers) {
-            command_buffer = g_app::CommandBuffer(app.renderer());
-            writer.write_image(desc_sets[i], 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        for (const auto& set : desc_sets) {
+            writer.write_image(set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
                                tex_view, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-
-            i++;
         }
         writer.commit_writes(app.renderer());
     }
@@ -0,0 +1,268 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+/*
+ * Replays a trace written by CommandCapture headlessly and reports CPU recording, CPU submit and GPU time per
+ * submission, so g_app builds can be compared against the same command stream. Traces missing part of the captured
+ * work (unsupported pipelines, skipped commands) are refused, their timings wouldn't measure the application.
+ *   trace_replay <trace> [iterations]   replays the trace, 100 iterations by default
+ *   trace_replay --record <trace>       captures a few frames of a grid of textured quads into <trace>
+ */
+
+#include <g_app.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <numeric>
+#include <string>
+
+struct Vertex {
+    float x, y;
+    float u, v;
+};
+
+constexpr uint32_t RECORDED_FRAMES = 4;
+constexpr uint32_t GRID_SIZE = 16;
+constexpr uint32_t TEXTURE_SIZE = 64;
+constexpr uint32_t WARMUP_ITERATIONS = 8;
+constexpr uint32_t DEFAULT_ITERATIONS = 100;
+
+static int record(const std::string& path){
+    auto renderer = g_app::VulkanRendererInit()
+            .set_app_name("Trace Replay")
+            .set_engine_name("g_app")
+            .set_headless(800, 600)
+            .enable_command_capture()
+            .init();
+
+    // One quad per grid cell, drawn with its own vertex offset
+    std::vector<Vertex> vertices = {};
+    float cell = 2.0f / GRID_SIZE;
+    for(uint32_t i = 0; i < GRID_SIZE * GRID_SIZE; i++){
+        float x = static_cast<float>(i % GRID_SIZE) * cell - 1.0f;
+        float y = static_cast<float>(i / GRID_SIZE) * cell - 1.0f;
+        float size = cell * 0.8f;
+        vertices.push_back({x,        y,        0.0f, 0.0f});
+        vertices.push_back({x + size, y,        1.0f, 0.0f});
+        vertices.push_back({x + size, y + size, 1.0f, 1.0f});
+        vertices.push_back({x,        y + size, 0.0f, 1.0f});
+    }
+    uint32_t indices[] = {0, 1, 3, 1, 2, 3};
+
+    auto vertex_buffer = g_app::BufferInit<Vertex>()
+            .set_label("Vertex Buffer")
+            .set_usage(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            .set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU)
+            .set_size(vertices.size())
+            .set_data(vertices.data())
+            .init(renderer);
+
+    auto index_buffer = g_app::BufferInit<uint32_t>()
+            .set_label("Index Buffer")
+            .set_usage(VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+            .set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU)
+            .set_size(6)
+            .set_data(indices)
+            .init(renderer);
+
+    // A checkerboard, uploaded before capturing and read back by CommandCapture::save()
+    std::vector<uint32_t> pixels(TEXTURE_SIZE * TEXTURE_SIZE);
+    for(uint32_t i = 0; i < pixels.size(); i++){
+        bool dark = ((i % TEXTURE_SIZE) / 8 + (i / TEXTURE_SIZE) / 8) % 2 == 0;
+        pixels[i] = (dark) ? 0xff303030 : 0xffe0c080;
+    }
+    auto texture = g_app::ImageInit()
+            .set_label("Checkerboard")
+            .set_extent(TEXTURE_SIZE, TEXTURE_SIZE)
+            .set_format(VK_FORMAT_R8G8B8A8_UNORM)
+            .set_usage(VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+            .init(renderer);
+    renderer.uploads().upload_image(texture, pixels.data(), sizeof(uint32_t)).flush().wait();
+
+    auto texture_view = g_app::ImageViewInit()
+            .set_label("Checkerboard View")
+            .set_image(texture)
+            .init(renderer);
+
+    auto sampler = g_app::SamplerInit()
+            .set_filter(VK_FILTER_NEAREST, VK_FILTER_NEAREST)
+            .init(renderer);
+
+    auto desc_layout = g_app::DescriptorSetLayoutInit()
+            .set_label("Texture Layout")
+            .add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT)
+            .init(renderer);
+
+    auto desc_pool = g_app::DescriptorPoolInit()
+            .set_label("Descriptor Pool")
+            .set_max_sets(renderer.frames_in_flight())
+            .add_pool_size(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, renderer.frames_in_flight())
+            .init(renderer);
+
+    auto desc_sets = desc_pool.allocate_sets(std::vector(renderer.frames_in_flight(), desc_layout));
+    {
+        auto writer = g_app::DescriptorWriter();
+        for(const auto& set : desc_sets){
+            writer.write_image(set, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                               texture_view, sampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        writer.commit_writes(renderer);
+    }
+
+    auto pipeline = g_app::GraphicsPipelineInit()
+            .set_label("Textured Quad Pipeline")
+            .add_descriptor_set_layout(desc_layout)
+            .add_vertex_binding(g_app::VertexBindingBuilder(sizeof(Vertex))
+                .add_vertex_attribute(VK_FORMAT_R32G32_SFLOAT, 0)
+                .add_vertex_attribute(VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, u))
+                .build()
+            ).attach_shader_module(g_app::ShaderModuleInit()
+                .set_label("Vertex Shader")
+                .set_src_from_file("../examples/textures/shader.vert.spv")
+                .set_stage(VK_SHADER_STAGE_VERTEX_BIT)
+                .init(renderer)
+            ).attach_shader_module(g_app::ShaderModuleInit()
+                .set_label("Fragment Shader")
+                .set_src_from_file("../examples/textures/shader.frag.spv")
+                .set_stage(VK_SHADER_STAGE_FRAGMENT_BIT)
+                .init(renderer)
+            ).set_render_pass(renderer.default_render_pass())
+            .init(renderer);
+
+    auto capture = g_app::CommandCaptureInit()
+            .set_label("Textured Quad Grid")
+            .init(renderer);
+
+    g_app::PerFrame command_buffers(renderer, [&](uint32_t){ return g_app::CommandBuffer(renderer); });
+
+    for(uint32_t frame = 0; frame < RECORDED_FRAMES; frame++){
+        if(!renderer.acquire_next_swapchain_image()) continue;
+
+        auto& cmd = command_buffers.current();
+        cmd.begin_capture(capture)
+           .begin()
+           .begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f);
+
+        // Rebinding every draw like a naive renderer would, the binds the command buffer elides are replayed the same way
+        for(uint32_t i = 0; i < GRID_SIZE * GRID_SIZE; i++){
+            cmd.bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS)
+               .bind_descriptor_sets(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS, {desc_sets[renderer.current_frame()]})
+               .bind_vertex_buffer(vertex_buffer)
+               .bind_index_buffer(index_buffer, VK_INDEX_TYPE_UINT32)
+               .draw_indexed(6, 1, 0, static_cast<int32_t>(i * 4), 0);
+        }
+
+        cmd.end_render_pass()
+           .submit(g_app::Queue::GRAPHICS,
+                   {{renderer.current_image_available_semaphore(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}},
+                   {{renderer.current_render_finished_semaphore()}},
+                   renderer.current_in_flight_fence());
+        cmd.end_capture();
+
+        renderer.present();
+    }
+
+    renderer.device_wait_idle();
+
+    auto stats = capture.stats();
+    spdlog::info("Captured {} submissions, {} buffers ({} unreadable), {} images, {} samplers, {} descriptor sets "
+                 "({} unsupported), {} pipelines ({} unsupported), {} skipped commands",
+                 stats.submissions, stats.buffers, stats.unreadable_buffers, stats.images, stats.samplers,
+                 stats.descriptor_sets, stats.unsupported_descriptor_sets,
+                 stats.pipelines, stats.unsupported_pipelines, stats.skipped_commands);
+    if(stats.unsupported_pipelines > 0 || stats.skipped_commands > 0){
+        spdlog::warn("The trace is incomplete and will be refused by replay");
+    }
+    if(!capture.save(path)) return EXIT_FAILURE;
+
+    spdlog::info("Saved {}", path);
+    return EXIT_SUCCESS;
+}
+
+static void report(const char* name, std::vector<double> samples){
+    if(samples.empty()) return;
+
+    std::sort(samples.begin(), samples.end());
+    double mean = std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    spdlog::info("  {:<10} min {:.3f} ms, median {:.3f} ms, mean {:.3f} ms, max {:.3f} ms",
+                 name, samples.front(), samples[samples.size() / 2], mean, samples.back());
+}
+
+static int replay(const std::string& path, uint32_t iterations){
+    auto trace = g_app::CommandTrace::load(path);
+    if(!trace.is_complete()){
+        spdlog::error("{} is incomplete: {} of {} pipelines unsupported{}, replay timings would be meaningless",
+                      path, trace.unsupported_pipeline_count(), trace.pipeline_count(),
+                      (trace.has_skipped_commands()) ? " and commands skipped while capturing" : "");
+        return EXIT_FAILURE;
+    }
+
+    auto renderer_init = g_app::VulkanRendererInit()
+            .set_app_name("Trace Replay")
+            .set_engine_name("g_app")
+            .set_headless(trace.extent().width, trace.extent().height);
+    if(trace.uses_dynamic_rendering()) renderer_init.enable_dynamic_rendering();
+    if(trace.uses_draw_indirect_count()) renderer_init.enable_draw_indirect_count();
+    auto renderer = renderer_init.init();
+
+    auto replay = g_app::CommandReplayInit()
+            .set_label(path)
+            .set_trace(trace)
+            .init(renderer);
+
+    // Lets pools and fences reach their steady state before measuring
+    replay.run(WARMUP_ITERATIONS);
+    auto timings = replay.run(iterations);
+    if(timings.skipped_commands > 0){
+        spdlog::error("{}: {} commands couldn't be replayed, refusing to report timings", path, timings.skipped_commands);
+        return EXIT_FAILURE;
+    }
+
+    spdlog::info("{}: {} submissions, {} buffers, {} images, {} descriptor sets, {} iterations", path,
+                 trace.submission_count(), trace.buffer_count(), trace.image_count(), trace.descriptor_set_count(), iterations);
+    report("cpu record", timings.cpu_record_ms);
+    report("cpu submit", timings.cpu_submit_ms);
+    report("gpu", timings.gpu_ms);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char** argv){
+    if(argc == 3 && std::string(argv[1]) == "--record") return record(argv[2]);
+    if(argc == 2 || argc == 3){
+        uint32_t iterations = (argc == 3) ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : DEFAULT_ITERATIONS;
+        if(iterations == 0){
+            spdlog::error("Iterations must be a positive number, got {}", argv[2]);
+            return EXIT_FAILURE;
+        }
+        return replay(argv[1], iterations);
+    }
+
+    spdlog::error("Usage: {} <trace> [iterations] | --record <trace>", argv[0]);
+    return EXIT_FAILURE;
+}
@@ -63,7 +63,7 @@ int main(){
                 .set_data(vertices)
                 .init(app.renderer()),
             vertex_buffer
-        ).submit(g_app::Queue::TRANSFER);
+        ).submit_blocking(g_app::Queue::TRANSFER);
 
     auto pipeline = g_app::GraphicsPipelineInit()
             .add_push_constant_range({VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(float)*2})
@@ -84,10 +84,7 @@ int main(){
             ).set_render_pass(app.renderer().default_render_pass())
             .init(app.renderer());
 
-    g_app::CommandBuffer command_buffers[g_app::VulkanRenderer::MAX_FRAMES_IN_FLIGHT] = {};
-    for(auto & command_buffer : command_buffers){
-        command_buffer = g_app::CommandBuffer(app.renderer());
-    }
+    g_app::PerFrame command_buffers(app.renderer(), [&](uint32_t){ return g_app::CommandBuffer(app.renderer()); });
 
     float offset[] = {0.0f, 0.0f};
     float dir[] = {1.0f, -1.0f};
@@ -102,7 +99,7 @@ int main(){
 
         if(!app.renderer().acquire_next_swapchain_image()) return;
 
-        command_buffers[app.renderer().current_frame()]
+        command_buffers.current()
                 .begin()
 
                 .begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f)
@@ -0,0 +1,126 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_IX86)
+#include <emmintrin.h>
+#define G_APP_CPU_RELAX() _mm_pause()
+#else
+#define G_APP_CPU_RELAX() std::this_thread::yield()
+#endif
+
+namespace g_app {
+    struct FramePacingStats {
+        double target_ms = 0.0;       // 0 when unlimited
+        double last_frame_ms = 0.0;
+        double average_frame_ms = 0.0; // Exponential moving average
+        double jitter_ms = 0.0;        // Moving average of |frame time - target| (or of the average when unlimited)
+        double max_jitter_ms = 0.0;
+    };
+
+    /*
+     * Holds frames to a target frame time. Most of the wait is a regular sleep, the last stretch is spun on so the
+     * deadline is hit with sub-millisecond accuracy. How early to stop sleeping adapts to the OS's measured sleep overshoot.
+     */
+    class FramePacer {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /* 0 disables pacing. */
+        void set_target_fps(uint32_t fps){
+            m_fps = fps;
+            m_target = (fps > 0) ? std::chrono::nanoseconds(1'000'000'000ll / fps) : std::chrono::nanoseconds(0);
+            m_deadline = {};
+        }
+        uint32_t target_fps() const { return m_fps; }
+
+        /* Call once per frame, blocks until the frame's deadline. */
+        void wait(){
+            auto now = Clock::now();
+
+            if(m_target.count() > 0){
+                m_deadline = (m_deadline == Clock::time_point{}) ? now + m_target : m_deadline + m_target;
+                // Don't try to catch up after a hitch, that would just produce a burst of short frames
+                if(m_deadline < now) m_deadline = now;
+
+                auto sleep_for = (m_deadline - now) - m_spin_threshold;
+                if(sleep_for > std::chrono::nanoseconds(0)){
+                    auto before = Clock::now();
+                    std::this_thread::sleep_for(sleep_for);
+                    auto overshoot = (Clock::now() - before) - sleep_for;
+                    update_spin_threshold(std::chrono::duration_cast<std::chrono::nanoseconds>(overshoot));
+                }
+                while(Clock::now() < m_deadline) G_APP_CPU_RELAX();
+
+                now = Clock::now();
+            }
+
+            if(m_last != Clock::time_point{}) record(now - m_last);
+            m_last = now;
+        }
+
+        const FramePacingStats& stats() const { return m_stats; }
+        void reset_max_jitter() { m_stats.max_jitter_ms = 0.0; }
+    private:
+        uint32_t m_fps = 0;
+        std::chrono::nanoseconds m_target = std::chrono::nanoseconds(0);
+        std::chrono::nanoseconds m_spin_threshold = std::chrono::microseconds(1500);
+        double m_overshoot_ns = 1'000'000.0;
+        Clock::time_point m_deadline = {};
+        Clock::time_point m_last = {};
+        FramePacingStats m_stats = {};
+
+        void update_spin_threshold(std::chrono::nanoseconds overshoot){
+            m_overshoot_ns = m_overshoot_ns * 0.9 + static_cast<double>(std::max<int64_t>(overshoot.count(), 0)) * 0.1;
+            auto threshold = static_cast<int64_t>(m_overshoot_ns * 2.0);
+            m_spin_threshold = std::chrono::nanoseconds(std::clamp<int64_t>(threshold, 250'000, 4'000'000));
+        }
+
+        void record(Clock::duration frame_time){
+            double ms = std::chrono::duration<double, std::milli>(frame_time).count();
+            double target_ms = std::chrono::duration<double, std::milli>(m_target).count();
+
+            m_stats.target_ms = target_ms;
+            m_stats.last_frame_ms = ms;
+            m_stats.average_frame_ms = (m_stats.average_frame_ms == 0.0) ? ms : m_stats.average_frame_ms * 0.95 + ms * 0.05;
+
+            double jitter = std::abs(ms - ((target_ms > 0.0) ? target_ms : m_stats.average_frame_ms));
+            m_stats.jitter_ms = m_stats.jitter_ms * 0.95 + jitter * 0.05;
+            m_stats.max_jitter_ms = std::max(m_stats.max_jitter_ms, jitter);
+        }
+    };
+}
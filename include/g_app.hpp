@@ -44,6 +44,7 @@
 
 #include "types.hpp"
 #include "window.hpp"
+#include "trace.hpp"
 #include "vkgfx/all.hpp"
 
 namespace g_app {
@@ -87,17 +88,22 @@ namespace g_app {
             std::function<Monitor(std::vector<Monitor>)> choose_monitor;
             std::string icon_path; // TODO
             uint32_t sample_count = 1;
+            std::string trace_path; // Empty when tracing is disabled
+            uint32_t unfocused_frame_rate_limit = 0; // Leave 0 to keep the renderer's limit
 
             VulkanRendererInit renderer_init = {};
         };
 
         explicit App(const Config& config);
+        void update_frame_rate_limit();
 
         friend class AppInit;
 
         Window         m_window;
         Time           m_time;
         VulkanRenderer m_renderer;
+        uint32_t       m_unfocused_frame_rate_limit = 0;
+        bool           m_focused = true;
     };
 
     class AppInit {
@@ -153,6 +159,23 @@ namespace g_app {
             return *this;
         }
 
+        /*
+         * Enables CPU tracing (see trace.hpp) and writes a Chrome trace JSON to 'path' when the program exits.
+         * The main loop, swapchain acquire/present, fence waits and submits are traced out of the box,
+         * add G_APP_TRACE_SCOPE("name") to your own code for more detail.
+         */
+        AppInit& enable_tracing(const std::string& path = "g_app_trace.json"){
+            m_config.trace_path = path;
+            return *this;
+        }
+
+        /* Frame rate limit applied while the window isn't focused, e.g. 30. The renderer's own limit is restored on focus,
+         * including one set while unfocused, see VulkanRenderer::set_frame_rate_override(). */
+        AppInit& set_unfocused_frame_rate_limit(uint32_t limit){
+            m_config.unfocused_frame_rate_limit = limit;
+            return *this;
+        }
+
         /* Used to configure the vulkan renderer. VulkanRendererInit& is edited through a function pointer. */
         AppInit& configure_vulkan_renderer(const std::function<void(VulkanRendererInit&)>& f){
             if(f) f(m_config.renderer_init);
@@ -0,0 +1,86 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <chrono>
+#include <atomic>
+
+namespace g_app::trace {
+    /*
+     * Lightweight CPU instrumentation. Each thread writes completed zones into its own fixed size ring buffer,
+     * so recording is a clock read and a store with no locks or allocations. Old zones are overwritten once a ring fills up.
+     * Tracing is disabled by default, when disabled a zone costs a single relaxed atomic load.
+     */
+
+    inline std::atomic<bool> g_enabled = false;
+
+    inline uint64_t now_ns(){
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count()
+        );
+    }
+
+    inline bool is_enabled() { return g_enabled.load(std::memory_order_relaxed); }
+    inline void set_enabled(bool enabled) { g_enabled.store(enabled, std::memory_order_relaxed); }
+
+    /* Records a completed zone on the calling thread. 'name' must outlive the trace, i.e. a string literal. */
+    void record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+    /*
+     * Writes every zone still held by the thread rings as Chrome trace JSON (chrome://tracing, Perfetto). Recording is
+     * paused while the rings are read, zones ending during the dump are dropped.
+     */
+    bool dump_chrome_json(const std::string& path);
+
+    /* Enables tracing and writes the trace to 'path' when the program exits. */
+    void dump_at_exit(const std::string& path);
+
+    class Scope {
+    public:
+        explicit Scope(const char* name): m_name{name}, m_begin{is_enabled() ? now_ns() : 0} {}
+        ~Scope(){
+            if(m_begin != 0 && is_enabled()) record(m_name, m_begin, now_ns());
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator = (const Scope&) = delete;
+    private:
+        const char* m_name;
+        uint64_t    m_begin;
+    };
+}
+
+#define G_APP_TRACE_CONCAT_INNER(a, b) a##b
+#define G_APP_TRACE_CONCAT(a, b) G_APP_TRACE_CONCAT_INNER(a, b)
+/* Traces the rest of the enclosing scope. */
+#define G_APP_TRACE_SCOPE(name) ::g_app::trace::Scope G_APP_TRACE_CONCAT(g_app_trace_scope_, __LINE__){name}
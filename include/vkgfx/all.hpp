@@ -31,10 +31,25 @@
 #pragma once
 
 #include "buffer.hpp"
+#include "buffer_arena.hpp"
 #include "pipeline.hpp"
 #include "command_buffer.hpp"
 #include "image.hpp"
 #include "render_pass.hpp"
 #include "descriptor.hpp"
 #include "texture.hpp"
+#include "upload.hpp"
+#include "stream_copy.hpp"
+#include "uniform_allocator.hpp"
+#include "indirect_command_stream.hpp"
+#include "draw_list.hpp"
+#include "profiler.hpp"
+#include "per_frame.hpp"
+#include "resource_state.hpp"
+#include "async_compute.hpp"
+#include "render_graph.hpp"
+#include "parallel_recorder.hpp"
+#include "cached_command_buffer.hpp"
+#include "command_capture.hpp"
+#include "command_replay.hpp"
 #include "framebuffer.hpp"
@@ -0,0 +1,221 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "command_buffer.hpp"
+#include "per_frame.hpp"
+
+namespace g_app {
+    class AsyncComputeInit;
+
+    /*
+     * Runs compute work on the compute queue alongside the frame's graphics work. Each frame:
+     *   compute.begin() ... dispatches ... compute.release_buffer(...); compute.submit();
+     *   graphics.begin() ... compute.acquire(graphics) ... graphics.submit(Queue::GRAPHICS, compute.wait(sync));
+     * release_*() hands resources written by the compute work to the graphics queue, with a queue family ownership
+     * transfer when COMPUTE is a dedicated family. wait() makes the graphics submission wait on the compute submission,
+     * only at the stages that consume its results, so everything before them still overlaps the compute work.
+     * Every submit() must be consumed by exactly one graphics submission through wait().
+     */
+    class AsyncCompute {
+    public:
+        AsyncCompute() = default;
+
+        /* Begins recording the current frame's compute command buffer, waiting on its previous submission first. */
+        CommandBuffer& begin(){
+            auto& frame = *self->frames;
+            frame.releases = PipelineBarrierInfoBuilder().set_queue_family_transfer(compute_family(), graphics_family());
+            frame.consumer_stages = 0;
+            frame.submitted = false;
+            return frame.cmd.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        }
+
+        CommandBuffer& command_buffer() { return self->frames->cmd; }
+
+        /*
+         * Hands a buffer written by the compute work over to graphics, consumed at dst_stage with dst_access.
+         * src_stage/src_access describe the compute writes, e.g. VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT/VK_ACCESS_SHADER_WRITE_BIT.
+         */
+        template<BufferView B>
+        AsyncCompute& release_buffer(const B& buffer, VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+                                     VkPipelineStageFlags dst_stage, VkAccessFlags dst_access){
+            auto& frame = *self->frames;
+            // Within one family the semaphore alone makes the writes visible to dst_stage
+            if(is_ownership_transfer()){
+                record_release(PipelineBarrierInfoBuilder()
+                                       .set_stage_flags(src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+                                       .set_queue_family_transfer(compute_family(), graphics_family())
+                                       .add_buffer_memory_barrier(buffer, src_access, 0)
+                                       .build());
+                frame.releases.add_buffer_memory_barrier(buffer, 0, dst_access);
+            }
+            frame.consumer_stages |= dst_stage;
+            return *this;
+        }
+
+        /* Same as release_buffer(), also transitioning the image from old_layout to new_layout. */
+        AsyncCompute& release_image(const Image& image, VkImageLayout old_layout, VkImageLayout new_layout,
+                                    VkImageSubresourceRange subresource_range,
+                                    VkPipelineStageFlags src_stage, VkAccessFlags src_access,
+                                    VkPipelineStageFlags dst_stage, VkAccessFlags dst_access){
+            auto& frame = *self->frames;
+            // Without an ownership transfer the layout transition only happens on the graphics side
+            if(is_ownership_transfer()){
+                record_release(PipelineBarrierInfoBuilder()
+                                       .set_stage_flags(src_stage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT)
+                                       .set_queue_family_transfer(compute_family(), graphics_family())
+                                       .add_image_memory_barrier(image, src_access, 0, old_layout, new_layout, subresource_range)
+                                       .build());
+            }
+            frame.releases.add_image_memory_barrier(image, 0, dst_access, old_layout, new_layout, subresource_range);
+            frame.consumer_stages |= dst_stage;
+            return *this;
+        }
+
+        /* Submits the current frame's compute work. sync can add more waits, e.g. on last frame's graphics work. */
+        SubmitTicket submit(SubmitSyncObjects sync = {}){
+            auto& frame = *self->frames;
+            assert(!frame.submitted && "AsyncCompute::submit() was called twice without begin()!");
+            if(!self->renderer.has_timeline_semaphores()) sync.signal.push_back(frame.finished);
+
+            frame.ticket = frame.cmd.submit(Queue::COMPUTE, sync);
+            frame.submitted = true;
+            return frame.ticket;
+        }
+
+        /*
+         * Records the acquire side of every release into a graphics command buffer, before the commands that consume
+         * the results. Must be outside of a render pass.
+         */
+        AsyncCompute& acquire(CommandBuffer& graphics){
+            auto& frame = *self->frames;
+            if(frame.consumer_stages == 0) return *this;
+
+            // The semaphore wait already orders the compute work before consumer_stages and makes its writes available
+            auto info = frame.releases.build();
+            info.src_stage = frame.consumer_stages;
+            info.dst_stage = frame.consumer_stages;
+            if(!info.buffer_barriers.empty() || !info.image_barriers.empty()) graphics.pipeline_barrier(info);
+            return *this;
+        }
+
+        /* Adds the wait on this frame's compute submission to the graphics submission's sync objects. */
+        SubmitSyncObjects& wait(SubmitSyncObjects& sync) const {
+            const auto& frame = *self->frames;
+            assert(frame.submitted && "AsyncCompute::wait() needs a submitted frame!");
+
+            VkPipelineStageFlags stages = (frame.consumer_stages) ? frame.consumer_stages : VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            if(self->renderer.has_timeline_semaphores()){
+                sync.timeline_wait.push_back(frame.ticket.timeline_point());
+                sync.timeline_wait_stages.push_back(stages);
+            } else {
+                sync.wait.push_back(frame.finished);
+                sync.wait_stages.push_back(stages);
+            }
+            return sync;
+        }
+        SubmitSyncObjects wait(SubmitSyncObjects&& sync) const {
+            wait(sync);
+            return std::move(sync);
+        }
+
+        /* Ticket of the current frame's compute submission. */
+        const SubmitTicket& ticket() const { return self->frames->ticket; }
+        /* False when the compute queue is part of the graphics family, the work then still runs on its own queue
+         * if the family has more than one. */
+        bool is_ownership_transfer() const { return compute_family() != graphics_family(); }
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            std::string label = "unnamed async compute";
+        };
+
+        struct Frame {
+            CommandBuffer cmd = {};
+            Semaphore finished = {}; // Unused with timeline semaphores
+            PipelineBarrierInfoBuilder releases = {}; // Acquire side of this frame's releases
+            VkPipelineStageFlags consumer_stages = 0;
+            SubmitTicket ticket = {};
+            bool submitted = false;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            PerFrame<Frame> frames = {};
+            std::string label;
+        };
+
+        std::shared_ptr<Inner> self;
+
+        AsyncCompute(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+            self->label = config.label;
+            self->frames = PerFrame(renderer, [&](uint32_t i){
+                Frame frame = {};
+                frame.cmd = CommandBuffer(renderer, Queue::COMPUTE);
+                if(!renderer.has_timeline_semaphores()){
+                    frame.finished = Semaphore(renderer, std::format("{} -> Semaphore {}", config.label, i));
+                }
+                return frame;
+            });
+        }
+
+        uint32_t compute_family() const { return self->renderer.queue_family_index(Queue::COMPUTE); }
+        uint32_t graphics_family() const { return self->renderer.queue_family_index(Queue::GRAPHICS); }
+
+        void record_release(const PipelineBarrierInfo& info){
+            self->frames->cmd.pipeline_barrier(info);
+        }
+
+        friend class AsyncComputeInit;
+    };
+
+    class AsyncComputeInit {
+    public:
+        AsyncComputeInit() = default;
+
+        AsyncComputeInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        AsyncCompute init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        AsyncCompute::Config m_config = {};
+    };
+}
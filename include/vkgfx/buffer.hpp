@@ -31,37 +31,155 @@
 #pragma once
 
 #include "renderer.hpp"
+#include "stream_copy.hpp"
+#include "resource_state.hpp"
+
+#include <span>
+#include <concepts>
 
 namespace g_app {
+    /*
+     * Anything that views a typed range of a VkBuffer, i.e. a whole Buffer<T> or a BufferSlice<T> from a BufferArena.
+     * Commands, barriers and descriptor writes accept any BufferView, offsets passed alongside one are relative to the view.
+     */
+    template<typename B>
+    concept BufferView = requires(const B& b) {
+        typename B::value_type;
+        { b.vk_buffer() } -> std::same_as<VkBuffer>;
+        { b.offsetb() } -> std::convertible_to<VkDeviceSize>;
+        { b.size() } -> std::convertible_to<size_t>;
+        { b.sizeb() } -> std::convertible_to<size_t>;
+    };
+
+    /*
+     * Non-owning BufferView of 'count' elements starting 'offset' bytes into a VkBuffer, e.g. part of a buffer of
+     * indirect commands. Whatever owns the VkBuffer has to outlive the commands recorded with it, and isn't tracked
+     * by a CachedCommandBuffer, see CommandBuffer::depends_on().
+     */
+    template<typename T>
+    struct BufferRange {
+        using value_type = T;
+
+        VkBuffer     buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        size_t       count = 0;
+
+        VkBuffer vk_buffer() const { return buffer; }
+        VkDeviceSize offsetb() const { return offset; }
+        size_t size() const { return count; }
+        size_t sizeb() const { return count * sizeof(T); }
+    };
+
+    /* 'count' elements of a view starting at element 'first'. */
+    template<BufferView B>
+    BufferRange<typename B::value_type> buffer_range(const B& view, size_t first, size_t count){
+        assert(first + count <= view.size() && "Range out of the view's bounds!");
+        return {view.vk_buffer(), view.offsetb() + first * sizeof(typename B::value_type), count};
+    }
+
+    /*
+     * Where the host can read the memory behind a view, see CommandCapture. 'base' points at the start of the VkBuffer,
+     * 'allocation' and 'mapped_size' are only set for a whole Buffer.
+     */
+    struct BufferSource {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize end = 0; // End of the view in bytes from the start of the VkBuffer
+        const uint8_t* base = nullptr;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkDeviceSize mapped_size = 0; // Size of a persistently mapped Buffer
+        std::weak_ptr<void> owner = {};
+    };
+
+    template<BufferView B>
+    BufferSource buffer_source(const B& view){
+        BufferSource source = {};
+        source.buffer = view.vk_buffer();
+        source.end = view.offsetb() + view.sizeb();
+        if constexpr(requires { view.weak_ref(); }) source.owner = view.weak_ref();
+        if constexpr(requires { view.is_persistently_mapped(); view.mapped(); }){
+            if(view.is_persistently_mapped()){
+                source.base = reinterpret_cast<const uint8_t*>(view.mapped().data()) - view.offsetb();
+            }
+        }
+        if constexpr(requires { view.vma_allocation(); }){
+            source.allocation = view.vma_allocation();
+            if(view.is_persistently_mapped()) source.mapped_size = view.sizeb();
+        }
+        return source;
+    }
+
     template<typename T>
     class BufferInit;
 
     template<typename T>
     class Buffer {
     public:
+        using value_type = T;
+
         Buffer() = default;
         Buffer(const Buffer&) = default;
         Buffer& operator = (const Buffer&) = default;
 
+        /* Persistently mapped buffers return their mapping, unmap() is then a no-op. */
         T* map(){
+            if(self->mapped) return self->mapped;
+
             void* data = nullptr;
             vmaMapMemory(self->renderer.inner()->allocator, self->allocation, &data);
             return reinterpret_cast<T*>(data);
         }
         void unmap(){
+            if(self->mapped) return;
             vmaUnmapMemory(self->renderer.inner()->allocator, self->allocation);
         }
 
+        /* The buffers memory, valid for its whole lifetime. Only available with BufferInit::set_persistently_mapped(). */
+        std::span<T> mapped() const {
+            assert(self->mapped && "Buffer isn't persistently mapped!");
+            return {self->mapped, self->size};
+        }
+        bool is_persistently_mapped() const { return self->mapped != nullptr; }
+
+        /*
+         * Copies 'count' elements into the buffer at 'offset' (in elements) with stream_copy() and flushes the range
+         * if the memory isn't host coherent. The buffer has to be persistently mapped.
+         */
+        void write(const T* data, size_t count, size_t offset = 0){
+            assert(self->mapped && "Buffer isn't persistently mapped!");
+            assert(offset + count <= self->size && "Write out of the buffer's bounds!");
+
+            stream_copy(self->mapped + offset, data, count * sizeof(T));
+            if(!self->coherent) flush(offset, count);
+        }
+        void write(const T& value, size_t offset = 0){
+            write(&value, 1, offset);
+        }
+
+        /* Makes host writes visible to the device, only needed for non-coherent memory. count = 0 flushes to the end. */
+        void flush(size_t offset = 0, size_t count = 0){
+            VkDeviceSize size = (count > 0) ? count * sizeof(T) : VK_WHOLE_SIZE;
+            vmaFlushAllocation(self->renderer.inner()->allocator, self->allocation, offset * sizeof(T), size);
+        }
+
         VkBuffer vk_buffer() const { return self->buffer; }
         VmaAllocation vma_allocation() const { return self->allocation; }
+        VkDeviceSize offsetb() const { return 0; }
         size_t size() const { return self->size; }
         size_t sizeb() const { return self->size * sizeof(T); }
+        /* Expires with the last copy of the handle, see CachedCommandBuffer. */
+        std::weak_ptr<void> weak_ref() const { return self; }
+
+        /* Tracked state of the whole buffer, see CommandBuffer::require(). Shared by every copy of the handle. */
+        ResourceState& resource_state() const { return self->state; }
     private:
         struct Config {
             VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
             VmaMemoryUsage     memory_usage = VMA_MEMORY_USAGE_AUTO;
             size_t             size = 0;
             const T*           data = nullptr;
+            bool               persistently_mapped = false;
+            bool               random_access = false;
+            bool               concurrent = false;
             std::string        label = "unnamed buffer";
         };
 
@@ -70,12 +188,17 @@ namespace g_app {
             VkBuffer buffer = VK_NULL_HANDLE;
             VmaAllocation allocation = VK_NULL_HANDLE;
             size_t   size = 0;
+            T*       mapped = nullptr; // Set for persistently mapped buffers
+            bool     coherent = true;
+            ResourceState state = {};
             std::string label = "unnamed buffer";
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vmaDestroyBuffer(renderer.inner()->allocator, buffer, allocation);
+                renderer.defer_destroy([allocator = renderer.inner()->allocator, buffer = buffer, allocation = allocation](){
+                    vmaDestroyBuffer(allocator, buffer, allocation);
+                });
             }
         };
 
@@ -87,26 +210,52 @@ namespace g_app {
 
             VmaAllocationCreateInfo alloc_info = {};
             alloc_info.usage = config.memory_usage;
+            if(config.persistently_mapped){
+                alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT |
+                    ((config.random_access) ? VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT
+                                            : VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT);
+            }
 
             VkBufferCreateInfo create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
             create_info.size = config.size * sizeof(T);
             create_info.usage = config.usage;
             create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            const auto& families = renderer.unique_queue_families();
+            if(config.concurrent && families.size() > 1){
+                create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+                create_info.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+                create_info.pQueueFamilyIndices = families.data();
+            }
 
             auto inner = renderer.inner();
             
             VkResult result = VK_SUCCESS;
+            VmaAllocationInfo allocation_info = {};
             if(
                     (result = vmaCreateBuffer(inner->allocator, &create_info, &alloc_info,
-                                              &self->buffer, &self->allocation, nullptr)) != VK_SUCCESS
+                                              &self->buffer, &self->allocation, &allocation_info)) != VK_SUCCESS
             ){
                 throw std::runtime_error(std::format("Failed to create a Buffer! buffer = {}, result = {}", self->label, static_cast<uint32_t>(result)));
             }
 
+            if(config.persistently_mapped){
+                VkMemoryPropertyFlags memory_flags = 0;
+                vmaGetAllocationMemoryProperties(inner->allocator, self->allocation, &memory_flags);
+                if(!(memory_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) || !allocation_info.pMappedData){
+                    throw std::runtime_error(std::format("A persistently mapped Buffer isn't host visible! buffer = {}", self->label));
+                }
+                self->mapped = reinterpret_cast<T*>(allocation_info.pMappedData);
+                self->coherent = memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            }
+
             if(config.data){
-                auto data = this->map();
-                memcpy(data, config.data, config.size*sizeof(T));
-                this->unmap();
+                if(self->mapped){
+                    this->write(config.data, config.size);
+                } else {
+                    auto data = this->map();
+                    memcpy(data, config.data, config.size*sizeof(T));
+                    this->unmap();
+                }
             }
         }
 
@@ -151,6 +300,26 @@ namespace g_app {
             return *this;
         }
 
+        /*
+         * Keeps the buffer mapped for its whole lifetime, see Buffer::mapped() and Buffer::write().
+         * The memory is picked for sequential writes (write-combined) unless random_access is set,
+         * which is better when the host also reads the buffer. Use with VMA_MEMORY_USAGE_AUTO.
+         */
+        BufferInit& set_persistently_mapped(bool random_access = false){
+            m_config.persistently_mapped = true;
+            m_config.random_access = random_access;
+            return *this;
+        }
+
+        /*
+         * Shares the buffer between every queue family instead of transferring ownership between them.
+         * Simpler when it is used on dedicated transfer/compute queues, but access may be slower on some hardware.
+         */
+        BufferInit& set_concurrent_sharing(){
+            m_config.concurrent = true;
+            return *this;
+        }
+
         Buffer<T> init(VulkanRenderer renderer){
             try {
                 return {renderer, m_config};
@@ -167,17 +336,31 @@ namespace g_app {
     public:
         VertexBufferBindings() = default;
 
-        template<typename T>
-        VertexBufferBindings& add_buffer(const Buffer<T>& buffer, VkDeviceSize offset=0){
+        template<BufferView B>
+        VertexBufferBindings& add_buffer(const B& buffer, VkDeviceSize offset=0){
             m_buffers.push_back(buffer.vk_buffer());
-            m_offsets.push_back(offset * sizeof(T));
+            m_offsets.push_back(buffer.offsetb() + offset * sizeof(typename B::value_type));
+            if constexpr(requires { buffer.weak_ref(); }) m_refs.push_back(buffer.weak_ref());
             return *this;
         }
 
         std::vector<VkBuffer>& buffers() { return m_buffers; }
         std::vector<VkDeviceSize>& offsets() { return m_offsets; }
+        const std::vector<VkBuffer>& buffers() const { return m_buffers; }
+        const std::vector<VkDeviceSize>& offsets() const { return m_offsets; }
+        /* Owners of the added buffers that have one, for CachedCommandBuffer dependency tracking. */
+        const std::vector<std::weak_ptr<void>>& refs() const { return m_refs; }
+
+        /* Keeps the capacity, so a VertexBufferBindings reused every frame stops allocating. */
+        VertexBufferBindings& clear(){
+            m_buffers.clear();
+            m_offsets.clear();
+            m_refs.clear();
+            return *this;
+        }
     private:
         std::vector<VkBuffer> m_buffers = {};
         std::vector<VkDeviceSize> m_offsets ={};
+        std::vector<std::weak_ptr<void>> m_refs = {};
     };
 } // g_app
@@ -0,0 +1,232 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+
+#include <numeric>
+
+namespace g_app {
+    /*
+     * One VkBuffer of an arena together with the VMA virtual block that sub-allocates it.
+     * Only holds raw handles, slices keep it alive until their deferred frees have run. Virtual blocks aren't thread
+     * safe and slices can be released on any thread, so every virtual allocation and free goes through 'mutex'.
+     */
+    struct BufferArenaBlock {
+        VmaAllocator allocator = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VmaVirtualBlock virtual_block = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint8_t* mapped = nullptr;
+        std::mutex mutex;
+
+        BufferArenaBlock(VmaAllocator allocator, const VkBufferCreateInfo& create_info, const VmaAllocationCreateInfo& alloc_info);
+        ~BufferArenaBlock();
+    };
+
+    class BufferArena;
+
+    /* A typed range of a BufferArena. Works anywhere a Buffer<T> does, the range is returned to the arena once the
+     * last copy is dropped and the frame that used it has retired. */
+    template<typename T>
+    class BufferSlice {
+    public:
+        using value_type = T;
+
+        BufferSlice() = default;
+
+        VkBuffer vk_buffer() const { return (self) ? self->block->buffer : VK_NULL_HANDLE; }
+        VkDeviceSize offsetb() const { return self->offset; }
+        size_t size() const { return self->size; }
+        size_t sizeb() const { return self->size * sizeof(T); }
+        std::weak_ptr<void> weak_ref() const { return self; }
+        /* Tracked state of the slice, see CommandBuffer::require(). Slices never overlap, so each has its own. */
+        ResourceState& resource_state() const { return self->state; }
+
+        /* Offset in elements, usable as first_vertex/vertex_offset/first_index when many slices share one binding. */
+        uint32_t first_element() const { return static_cast<uint32_t>(self->offset / sizeof(T)); }
+
+        bool is_valid() const { return self != nullptr; }
+
+        bool is_persistently_mapped() const { return self->block->mapped != nullptr; }
+
+        /* Only available when the arena is persistently mapped. */
+        std::span<T> mapped() const {
+            assert(self->block->mapped && "BufferArena isn't persistently mapped!");
+            return {reinterpret_cast<T*>(self->block->mapped + self->offset), self->size};
+        }
+        void write(const T* data, size_t count, size_t offset = 0){
+            assert(offset + count <= self->size && "Write out of the slice's bounds!");
+            auto dst = mapped().data() + offset;
+            stream_copy(dst, data, count * sizeof(T));
+            vmaFlushAllocation(self->block->allocator, self->block->allocation,
+                               self->offset + offset * sizeof(T), count * sizeof(T)); // No-op on coherent memory
+        }
+    private:
+        struct Inner {
+            VulkanRenderer renderer;
+            std::shared_ptr<BufferArenaBlock> block = nullptr;
+            VmaVirtualAllocation allocation = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            size_t size = 0;
+            ResourceState state = {};
+
+            ~Inner(){
+                if(!renderer.is_valid()) return;
+
+                renderer.defer_destroy([block = block, allocation = allocation](){
+                    std::lock_guard lock(block->mutex);
+                    vmaVirtualFree(block->virtual_block, allocation);
+                });
+            }
+        };
+
+        std::shared_ptr<Inner> self;
+
+        BufferSlice(VulkanRenderer renderer, std::shared_ptr<BufferArenaBlock> block,
+                    VmaVirtualAllocation allocation, VkDeviceSize offset, size_t size):
+            self{std::make_shared<Inner>(std::move(renderer), std::move(block), allocation, offset, size)} {}
+
+        friend class BufferArena;
+    };
+
+    class BufferArenaInit;
+
+    /*
+     * Owns a few large VkBuffers and sub-allocates typed BufferSlices out of them with VMA virtual blocks, instead of
+     * creating a VkBuffer and a VMA allocation for every object. Slices of the same type can share a single binding by
+     * offsetting draws with BufferSlice::first_element().
+     * The first block lives as long as the arena, the ones added when it is full are destroyed with their last slice,
+     * so a spike in allocations doesn't pin its memory.
+     */
+    class BufferArena {
+    public:
+        BufferArena() = default;
+
+        /* Allocates 'count' elements. Slices are always aligned to sizeof(T) and at least to 'alignment' (a power of two). */
+        template<typename T>
+        BufferSlice<T> allocate(size_t count, VkDeviceSize alignment = 0){
+            VkDeviceSize element_alignment = std::lcm<VkDeviceSize>(std::max(alignment, self->alignment), sizeof(T));
+            auto range = allocate_range(count * sizeof(T), element_alignment);
+            return {self->renderer, range.block, range.allocation, range.offset, count};
+        }
+
+        /* Allocates and fills a slice, the arena has to be persistently mapped. Use an UploadManager otherwise. */
+        template<typename T>
+        BufferSlice<T> allocate(const T* data, size_t count, VkDeviceSize alignment = 0){
+            auto slice = allocate<T>(count, alignment);
+            slice.write(data, count);
+            return slice;
+        }
+
+        size_t block_count() const {
+            return 1 + std::count_if(self->extra_blocks.begin(), self->extra_blocks.end(), [](const auto& block){ return !block.expired(); });
+        }
+        VkDeviceSize block_size() const { return self->config.block_size; }
+    private:
+        struct Config {
+            VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                                       VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            VmaMemoryUsage     memory_usage = VMA_MEMORY_USAGE_AUTO;
+            VkDeviceSize       block_size = 64 * 1024 * 1024;
+            bool               persistently_mapped = false;
+            std::string        label = "unnamed buffer arena";
+        };
+
+        struct Range {
+            std::shared_ptr<BufferArenaBlock> block;
+            VmaVirtualAllocation allocation;
+            VkDeviceSize offset;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            Config config = {};
+            VkDeviceSize alignment = 16;
+            std::shared_ptr<BufferArenaBlock> first_block = nullptr;
+            std::vector<std::weak_ptr<BufferArenaBlock>> extra_blocks = {}; // Owned by their slices
+        };
+
+        std::shared_ptr<Inner> self;
+
+        BufferArena(VulkanRenderer renderer, const Config& config);
+        Range allocate_range(VkDeviceSize size, VkDeviceSize alignment);
+        std::shared_ptr<BufferArenaBlock> create_block(VkDeviceSize size);
+
+        friend class BufferArenaInit;
+    };
+
+    class BufferArenaInit {
+    public:
+        BufferArenaInit() = default;
+
+        BufferArenaInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /* Usage of every block, all slices share it. VERTEX | INDEX | TRANSFER_DST by default. */
+        BufferArenaInit& set_usage(VkBufferUsageFlags usage){
+            m_config.usage = usage;
+            return *this;
+        }
+
+        BufferArenaInit& set_memory_usage(VmaMemoryUsage usage){
+            m_config.memory_usage = usage;
+            return *this;
+        }
+
+        /* Size in bytes of each VkBuffer. Larger allocations get a block of their own. */
+        BufferArenaInit& set_block_size(VkDeviceSize size){
+            m_config.block_size = size;
+            return *this;
+        }
+
+        /* Keeps every block mapped, see BufferSlice::mapped() and BufferSlice::write(). */
+        BufferArenaInit& set_persistently_mapped(){
+            m_config.persistently_mapped = true;
+            return *this;
+        }
+
+        BufferArena init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        BufferArena::Config m_config = {};
+    };
+}
@@ -0,0 +1,163 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "command_buffer.hpp"
+
+#include <functional>
+
+namespace g_app {
+    class CachedCommandBufferInit;
+
+    /*
+     * Commands recorded once and replayed every frame, for static content that would otherwise be re-recorded
+     * identically each frame. Every pair of swapchain image and frame slot gets a secondary command buffer, recorded by
+     * the record function the first time the pair needs it and then only when it has gone stale:
+     *  - the swapchain was recreated, see VulkanRenderer::swapchain_generation(),
+     *  - the primary's render pass, framebuffer or rendering formats differ from the ones it was recorded against,
+     *  - a pipeline, descriptor set or buffer bound while recording (or passed to depends_on()) was destroyed,
+     *    e.g. replaced by a reloaded pipeline or a resized buffer,
+     *  - a descriptor set bound while recording was rewritten through DescriptorWriter::commit_writes(), or a buffer,
+     *    image view or sampler it refers to was destroyed,
+     *  - invalidate() was called.
+     *
+     *   cmd.begin_default_render_pass(0.2f, 0.2f, 0.2f, 1.0f, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+     *   static_scene.execute(cmd);
+     *   cmd.end_render_pass();
+     *
+     * Only object lifetimes are tracked, not buffer contents, so uniforms and storage buffers can change every frame.
+     * Per-frame resources must be picked with the 'frame' passed to the record function, never captured from
+     * VulkanRenderer::current_frame() or an outside counter, since the commands are replayed in later frames.
+     * Buffers bound by raw VkBuffer (the span overload of CommandBuffer::bind_vertex_buffers(), a BufferRange) can't be
+     * tracked, pass the owning Buffer to depends_on(). DrawList and VertexBufferBindings carry them along already.
+     * The cache holds no references itself, keep whatever the commands use alive for as long as they should stay valid.
+     */
+    class CachedCommandBuffer {
+    public:
+        CachedCommandBuffer() = default;
+
+        /* 'frame' is the frame slot the commands will be executed in, see VulkanRenderer::current_frame(). */
+        using RecordFunction = std::function<void(CommandBuffer& cmd, uint32_t image, uint32_t frame)>;
+
+        /*
+         * Records the commands of the current swapchain image and frame slot if they are stale and executes them in
+         * primary's current render pass, which must have been begun with secondary contents.
+         */
+        CommandBuffer& execute(CommandBuffer& primary);
+        /* Marks the commands of every image and frame slot stale. */
+        void invalidate();
+
+        /* Re-records once 'object' is destroyed. Only valid inside the record function. */
+        template<typename T>
+        void depends_on(const T& object){
+            assert(self->recording && "depends_on() can only be called while recording!");
+            auto ref = object.weak_ref();
+            if(!ref.expired()) self->recording->push_back(std::move(ref));
+        }
+
+        /* How many times commands have been recorded, stays flat while the cache is hit. */
+        uint32_t record_count() const { return self->record_count; }
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            RecordFunction record = nullptr;
+            std::string    label = "unnamed cached command buffer";
+        };
+
+        struct Entry {
+            CommandBuffer cmd = {};
+            bool valid = false;
+            uint64_t swapchain_generation = 0;
+            CommandBufferInheritance inheritance = {}; // What the commands were recorded against
+            std::vector<std::weak_ptr<void>> dependencies = {};
+            std::vector<CommandBuffer::VersionedDependency> versioned_dependencies = {};
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            std::string label;
+            RecordFunction record = nullptr;
+            std::vector<Entry> entries = {}; // Indexed by image * frames_in_flight + frame
+            std::vector<std::weak_ptr<void>>* recording = nullptr; // Dependencies of the entry being recorded
+            uint32_t record_count = 0;
+
+            ~Inner(){
+                if(!renderer.is_valid()) return;
+
+                // Frames still in flight may execute the commands
+                for(auto& entry : entries){
+                    renderer.defer_destroy([cmd = entry.cmd](){});
+                }
+            }
+        };
+
+        std::shared_ptr<Inner> self;
+
+        CachedCommandBuffer(VulkanRenderer renderer, const Config& config);
+
+        bool is_stale(const Entry& entry, const CommandBufferInheritance& inheritance) const;
+        void record(Entry& entry, const CommandBufferInheritance& inheritance, uint32_t image, uint32_t frame);
+
+        friend class CachedCommandBufferInit;
+    };
+
+    class CachedCommandBufferInit {
+    public:
+        CachedCommandBufferInit() = default;
+
+        CachedCommandBufferInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /*
+         * Records the commands of one swapchain image and frame slot into a secondary command buffer that continues the
+         * primary's render pass. Pipelines, descriptor sets and typed buffers bound through the CommandBuffer are
+         * tracked automatically.
+         */
+        CachedCommandBufferInit& set_record_function(const CachedCommandBuffer::RecordFunction& record){
+            m_config.record = record;
+            return *this;
+        }
+
+        CachedCommandBuffer init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        CachedCommandBuffer::Config m_config = {};
+    };
+}
@@ -37,8 +37,17 @@
 #include "image.hpp"
 #include "framebuffer.hpp"
 #include "sync.hpp"
+#include "profiler.hpp"
+#include "command_capture.hpp"
 
 #include <iostream>
+#include <array>
+#include <cstring>
+#include <span>
+#include <initializer_list>
+#include <concepts>
+#include <algorithm>
+#include <deque>
 
 namespace g_app {
     struct SubmitSyncObjects {
@@ -46,8 +55,28 @@ namespace g_app {
         std::vector<VkPipelineStageFlags> wait_stages = {};
         std::vector<Semaphore> signal = {};
         Fence fence;
+        /* Timeline semaphore waits and signals, e.g. another queue's SubmitTicket::timeline_point().
+         * timeline_wait_stages has one entry per timeline_wait. */
+        std::vector<TimelinePoint> timeline_wait = {};
+        std::vector<VkPipelineStageFlags> timeline_wait_stages = {};
+        std::vector<TimelinePoint> timeline_signal = {};
     };
 
+    /* Non-owning semaphore wait for CommandBuffer::submit(), value is only used by timeline semaphores. */
+    struct SubmitWait {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VkPipelineStageFlags stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        uint64_t value = 0;
+    };
+
+    struct SubmitSignal {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t value = 0;
+    };
+
+    /* Most semaphores a single CommandBuffer::submit() can wait on or signal. */
+    constexpr size_t MAX_SUBMIT_SEMAPHORES = 16;
+
     struct PipelineBarrierInfo {
         VkPipelineStageFlags src_stage, dst_stage;
         VkDependencyFlags flags = 0;
@@ -71,6 +100,19 @@ namespace g_app {
             return *this;
         }
 
+        /*
+         * Buffer and image barriers added after this release ownership from src_family (recorded on a queue of src_family)
+         * or acquire it for dst_family (recorded on a queue of dst_family). Record the same barriers on both queues, with
+         * the acquire waiting on a semaphore signalled after the release. Pass VK_QUEUE_FAMILY_IGNORED twice to go back to
+         * plain barriers. See VulkanRenderer::queue_family_index().
+         */
+        PipelineBarrierInfoBuilder& set_queue_family_transfer(uint32_t src_family, uint32_t dst_family){
+            if(src_family == dst_family) src_family = dst_family = VK_QUEUE_FAMILY_IGNORED; // Same family, no transfer needed
+            m_src_family = src_family;
+            m_dst_family = dst_family;
+            return *this;
+        }
+
         PipelineBarrierInfoBuilder& add_memory_barrier(VkAccessFlags src_access, VkAccessFlags dst_access){
             VkMemoryBarrier b = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
             b.srcAccessMask = src_access;
@@ -79,16 +121,16 @@ namespace g_app {
             return *this;
         }
 
-        template<typename T>
-        PipelineBarrierInfoBuilder& add_buffer_memory_barrier(const Buffer<T>& buffer,
+        template<BufferView B>
+        PipelineBarrierInfoBuilder& add_buffer_memory_barrier(const B& buffer,
                                                               VkAccessFlags src_access, VkAccessFlags dst_access, VkDeviceSize offset=0){
             VkBufferMemoryBarrier b = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
-            b.size = buffer.sizeb();
-            b.offset = offset;
+            b.size = buffer.sizeb() - offset;
+            b.offset = buffer.offsetb() + offset;
             b.srcAccessMask = src_access;
             b.dstAccessMask = dst_access;
-            b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.srcQueueFamilyIndex = m_src_family;
+            b.dstQueueFamilyIndex = m_dst_family;
             b.buffer = buffer.vk_buffer();
             m_info.buffer_barriers.push_back(b);
             return *this;
@@ -104,8 +146,8 @@ namespace g_app {
             b.oldLayout = old_layout;
             b.newLayout = new_layout;
             b.subresourceRange = subresource_range;
-            b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-            b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.srcQueueFamilyIndex = m_src_family;
+            b.dstQueueFamilyIndex = m_dst_family;
             b.image =  image.vk_image();
             m_info.image_barriers.push_back(b);
             return *this;
@@ -115,45 +157,332 @@ namespace g_app {
 
     private:
         PipelineBarrierInfo m_info = {};
+        uint32_t m_src_family = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t m_dst_family = VK_QUEUE_FAMILY_IGNORED;
+    };
+
+    /*
+     * Synchronization2 counterpart of PipelineBarrierInfo, every barrier carries its own stage masks and can name
+     * precise stages (VK_PIPELINE_STAGE_2_COPY_BIT, BLIT, CLEAR, ...) instead of TRANSFER.
+     * Needs VulkanRendererInit::enable_synchronization2().
+     */
+    struct DependencyInfo {
+        VkDependencyFlags flags = 0;
+        std::vector<VkMemoryBarrier2> memory_barriers;
+        std::vector<VkBufferMemoryBarrier2> buffer_barriers;
+        std::vector<VkImageMemoryBarrier2> image_barriers;
+    };
+
+    class DependencyInfoBuilder {
+    public:
+        DependencyInfoBuilder() = default;
+
+        DependencyInfoBuilder& set_dependency_flags(VkDependencyFlags flags){
+            m_info.flags = flags;
+            return *this;
+        }
+
+        /* See PipelineBarrierInfoBuilder::set_queue_family_transfer(). */
+        DependencyInfoBuilder& set_queue_family_transfer(uint32_t src_family, uint32_t dst_family){
+            if(src_family == dst_family) src_family = dst_family = VK_QUEUE_FAMILY_IGNORED;
+            m_src_family = src_family;
+            m_dst_family = dst_family;
+            return *this;
+        }
+
+        DependencyInfoBuilder& add_memory_barrier(VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                                                  VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access){
+            VkMemoryBarrier2 b = {VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+            b.srcStageMask = src_stage;
+            b.srcAccessMask = src_access;
+            b.dstStageMask = dst_stage;
+            b.dstAccessMask = dst_access;
+            m_info.memory_barriers.push_back(b);
+            return *this;
+        }
+
+        template<BufferView B>
+        DependencyInfoBuilder& add_buffer_memory_barrier(const B& buffer,
+                                                         VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                                                         VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access,
+                                                         VkDeviceSize offset=0){
+            VkBufferMemoryBarrier2 b = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+            b.size = buffer.sizeb() - offset;
+            b.offset = buffer.offsetb() + offset;
+            b.srcStageMask = src_stage;
+            b.srcAccessMask = src_access;
+            b.dstStageMask = dst_stage;
+            b.dstAccessMask = dst_access;
+            b.srcQueueFamilyIndex = m_src_family;
+            b.dstQueueFamilyIndex = m_dst_family;
+            b.buffer = buffer.vk_buffer();
+            m_info.buffer_barriers.push_back(b);
+            return *this;
+        }
+
+        DependencyInfoBuilder& add_image_memory_barrier(const Image& image,
+                                                        VkPipelineStageFlags2 src_stage, VkAccessFlags2 src_access,
+                                                        VkPipelineStageFlags2 dst_stage, VkAccessFlags2 dst_access,
+                                                        VkImageLayout old_layout, VkImageLayout new_layout,
+                                                        VkImageSubresourceRange subresource_range){
+            VkImageMemoryBarrier2 b = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            b.srcStageMask = src_stage;
+            b.srcAccessMask = src_access;
+            b.dstStageMask = dst_stage;
+            b.dstAccessMask = dst_access;
+            b.oldLayout = old_layout;
+            b.newLayout = new_layout;
+            b.subresourceRange = subresource_range;
+            b.srcQueueFamilyIndex = m_src_family;
+            b.dstQueueFamilyIndex = m_dst_family;
+            b.image = image.vk_image();
+            m_info.image_barriers.push_back(b);
+            return *this;
+        }
+
+        DependencyInfo build() { return m_info; }
+
+    private:
+        DependencyInfo m_info = {};
+        uint32_t m_src_family = VK_QUEUE_FAMILY_IGNORED;
+        uint32_t m_dst_family = VK_QUEUE_FAMILY_IGNORED;
+    };
+
+    /* Attachments and render area for CommandBuffer::begin_rendering(). */
+    struct RenderingInfo {
+        VkRenderingFlags flags = 0;
+        VkRect2D render_area = {};
+        uint32_t layer_count = 1;
+        std::vector<VkRenderingAttachmentInfo> color_attachments;
+        std::optional<VkRenderingAttachmentInfo> depth_attachment;
+        std::optional<VkRenderingAttachmentInfo> stencil_attachment;
+        // Attachment formats, inherited by secondary command buffers
+        std::vector<VkFormat> color_formats;
+        VkFormat depth_format = VK_FORMAT_UNDEFINED;
+        VkFormat stencil_format = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    };
+
+    class RenderingInfoBuilder {
+    public:
+        RenderingInfoBuilder() = default;
+
+        RenderingInfoBuilder& set_render_area(uint32_t width, uint32_t height, int32_t x = 0, int32_t y = 0){
+            m_info.render_area = {{x, y}, {width, height}};
+            return *this;
+        }
+
+        RenderingInfoBuilder& set_layer_count(uint32_t count){
+            m_info.layer_count = count;
+            return *this;
+        }
+
+        /* VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT to record the contents with CommandBuffer::execute_commands(). */
+        RenderingInfoBuilder& set_flags(VkRenderingFlags flags){
+            m_info.flags = flags;
+            return *this;
+        }
+
+        RenderingInfoBuilder& add_color_attachment(const ImageView& view,
+                                                   VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                   VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                                                   VkClearColorValue clear_value = {},
+                                                   VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL){
+            VkClearValue clear = {};
+            clear.color = clear_value;
+            m_info.color_attachments.push_back(attachment(view.vk_image_view(), load_op, store_op, clear, layout));
+            m_info.color_formats.push_back(view.format());
+            m_info.samples = view.samples();
+            return *this;
+        }
+
+        RenderingInfoBuilder& set_depth_attachment(const ImageView& view,
+                                                   VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                   VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                                   VkClearDepthStencilValue clear_value = {1.0f, 0},
+                                                   VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL){
+            VkClearValue clear = {};
+            clear.depthStencil = clear_value;
+            m_info.depth_attachment = attachment(view.vk_image_view(), load_op, store_op, clear, layout);
+            m_info.depth_format = view.format();
+            m_info.samples = view.samples();
+            return *this;
+        }
+
+        RenderingInfoBuilder& set_stencil_attachment(const ImageView& view,
+                                                     VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                     VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                                     VkClearDepthStencilValue clear_value = {1.0f, 0},
+                                                     VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL){
+            VkClearValue clear = {};
+            clear.depthStencil = clear_value;
+            m_info.stencil_attachment = attachment(view.vk_image_view(), load_op, store_op, clear, layout);
+            m_info.stencil_format = view.format();
+            m_info.samples = view.samples();
+            return *this;
+        }
+
+        /* Resolves the last added colour attachment into 'view' at the end of rendering. */
+        RenderingInfoBuilder& set_color_resolve(const ImageView& view, VkResolveModeFlagBits mode = VK_RESOLVE_MODE_AVERAGE_BIT,
+                                                VkImageLayout layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL){
+            assert(!m_info.color_attachments.empty() && "Add the attachment to resolve first!");
+            auto& last = m_info.color_attachments.back();
+            last.resolveMode = mode;
+            last.resolveImageView = view.vk_image_view();
+            last.resolveImageLayout = layout;
+            return *this;
+        }
+
+        RenderingInfo build() { return m_info; }
+
+    private:
+        static VkRenderingAttachmentInfo attachment(VkImageView view, VkAttachmentLoadOp load_op, VkAttachmentStoreOp store_op,
+                                                    VkClearValue clear_value, VkImageLayout layout){
+            VkRenderingAttachmentInfo a = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+            a.imageView = view;
+            a.imageLayout = layout;
+            a.loadOp = load_op;
+            a.storeOp = store_op;
+            a.clearValue = clear_value;
+            return a;
+        }
+
+        RenderingInfo m_info = {};
+    };
+
+    /* Bind commands recorded since begin(), and how many were dropped because the state was already bound. */
+    struct BindStats {
+        uint32_t pipeline_binds = 0;
+        uint32_t skipped_pipeline_binds = 0;
+        uint32_t vertex_buffer_binds = 0;
+        uint32_t skipped_vertex_buffer_binds = 0;
+        uint32_t index_buffer_binds = 0;
+        uint32_t skipped_index_buffer_binds = 0;
+        uint32_t descriptor_set_binds = 0;
+        uint32_t skipped_descriptor_set_binds = 0;
+        uint32_t push_constants = 0;
+        uint32_t skipped_push_constants = 0;
+    };
+
+    /* Render pass state continued by a secondary command buffer, see CommandBuffer::inheritance(). */
+    struct CommandBufferInheritance {
+        VkRenderPass render_pass = VK_NULL_HANDLE;
+        uint32_t subpass = 0;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        // Dynamic rendering, used when render_pass is VK_NULL_HANDLE
+        std::vector<VkFormat> color_formats = {};
+        VkFormat depth_format = VK_FORMAT_UNDEFINED;
+        VkFormat stencil_format = VK_FORMAT_UNDEFINED;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+        VkRect2D render_area = {}; // Viewport and scissor aren't inherited, secondaries set them from this
+        bool secondary_contents = false; // The render pass was begun for execute_commands() rather than inline commands
     };
 
     class CommandBuffer {
     public:
         CommandBuffer() = default;
 
+        /* Allocates from the graphics pool. */
         explicit CommandBuffer(const VulkanRenderer& renderer, VkCommandBufferLevel level=VK_COMMAND_BUFFER_LEVEL_PRIMARY):
-            self{std::make_shared<Inner>(renderer)}
-        {
-            auto inner = self->renderer.inner();
-            VkCommandBufferAllocateInfo alloc_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
-            alloc_info.commandPool = inner->command_pool;
-            alloc_info.commandBufferCount = 1;
-            alloc_info.level = level;
+            CommandBuffer(renderer, Queue::GRAPHICS, level) {}
+
+        /* Allocates from the pool of the queue's family, the command buffer can only be submitted to queues of that family. */
+        CommandBuffer(const VulkanRenderer& renderer, Queue queue, VkCommandBufferLevel level=VK_COMMAND_BUFFER_LEVEL_PRIMARY):
+            CommandBuffer(renderer, renderer.command_pool(queue), renderer.queue_family_index(queue), level, false) {}
+
+        /*
+         * Allocates from a pool owned by the caller, e.g. one per recording thread. The command buffer is released with
+         * the pool (or by a reset of it), never by the CommandBuffer itself.
+         */
+        CommandBuffer(const VulkanRenderer& renderer, VkCommandPool pool, uint32_t queue_family, VkCommandBufferLevel level):
+            CommandBuffer(renderer, pool, queue_family, level, true) {}
+
+        CommandBuffer& begin(VkCommandBufferUsageFlags usage=0){
+            assert(!self->recording && "Can't begin recording when the command buffer is already recording!");
+
+            // The reset of a submitted command buffer is deferred until it is recorded again
+            if(self->pending.is_valid()){
+                G_APP_TRACE_SCOPE("wait_pending_submit");
+                self->pending.wait();
+                self->pending = {};
+                vkResetCommandBuffer(self->cmdbuf, 0);
+            }
+
+            VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            begin_info.flags = usage;
 
             VkResult result = VK_SUCCESS;
-            if((result = vkAllocateCommandBuffers(inner->device, &alloc_info, &self->cmdbuf)) != VK_SUCCESS){
-                spdlog::error("Failed to allocate single use command buffers! result = {}", static_cast<uint32_t>(result));
+            if((result = vkBeginCommandBuffer(self->cmdbuf, &begin_info)) != VK_SUCCESS){
+                spdlog::error("Failed to begin recording single use commands! result = {}", static_cast<uint32_t>(result));
                 std::exit(EXIT_FAILURE);
             }
+
+            self->recording = true;
+            self->bound = {};
+            self->bind_stats = {};
+            self->resources.clear();
+            self->capture_stream.clear();
+            return *this;
         }
 
-        CommandBuffer& begin(VkCommandBufferUsageFlags usage=0){
+        /*
+         * Begins a secondary command buffer that continues the render pass described by 'inheritance', usually the
+         * primary's inheritance(). Viewport and scissor are set to the inherited render area.
+         */
+        CommandBuffer& begin_secondary(const CommandBufferInheritance& inheritance,
+                                       VkCommandBufferUsageFlags usage=VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT){
             assert(!self->recording && "Can't begin recording when the command buffer is already recording!");
+            assert(self->level == VK_COMMAND_BUFFER_LEVEL_SECONDARY && "Only secondary command buffers inherit a render pass!");
+
+            VkCommandBufferInheritanceRenderingInfo rendering_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+            VkCommandBufferInheritanceInfo inheritance_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+            if(inheritance.render_pass != VK_NULL_HANDLE){
+                inheritance_info.renderPass = inheritance.render_pass;
+                inheritance_info.subpass = inheritance.subpass;
+                inheritance_info.framebuffer = inheritance.framebuffer;
+            } else {
+                rendering_info.colorAttachmentCount = inheritance.color_formats.size();
+                rendering_info.pColorAttachmentFormats = inheritance.color_formats.data();
+                rendering_info.depthAttachmentFormat = inheritance.depth_format;
+                rendering_info.stencilAttachmentFormat = inheritance.stencil_format;
+                rendering_info.rasterizationSamples = inheritance.samples;
+                inheritance_info.pNext = &rendering_info;
+            }
 
             VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
-            begin_info.flags = usage;
+            begin_info.flags = usage | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+            begin_info.pInheritanceInfo = &inheritance_info;
 
             VkResult result = VK_SUCCESS;
             if((result = vkBeginCommandBuffer(self->cmdbuf, &begin_info)) != VK_SUCCESS){
-                spdlog::error("Failed to begin recording single use commands! result = {}", static_cast<uint32_t>(result));
+                spdlog::error("Failed to begin recording a secondary command buffer! result = {}", static_cast<uint32_t>(result));
                 std::exit(EXIT_FAILURE);
             }
 
+            const auto& area = inheritance.render_area;
+            VkViewport viewport{};
+            viewport.x = static_cast<float>(area.offset.x);
+            viewport.y = static_cast<float>(area.offset.y);
+            viewport.width = static_cast<float>(area.extent.width);
+            viewport.height = static_cast<float>(area.extent.height);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(self->cmdbuf, 0, 1, &viewport);
+            vkCmdSetScissor(self->cmdbuf, 0, 1, &area);
+
             self->recording = true;
+            self->in_render_pass = true;
+            self->continues_render_pass = true;
+            self->bound = {};
+            self->bind_stats = {};
+            self->capture_stream.clear();
             return *this;
         }
+
         CommandBuffer& end(){
             assert(self->recording && "Can't end a command buffer if its not recording!");
+            flush_barriers();
+            if(self->continues_render_pass) self->in_render_pass = self->continues_render_pass = false;
 
             VkResult result = VK_SUCCESS;
             if((result = vkEndCommandBuffer(self->cmdbuf)) != VK_SUCCESS){
@@ -166,60 +495,218 @@ namespace g_app {
             return *this;
         }
 
-        void submit(Queue queue, const SubmitSyncObjects& sync = {}){
-            if(self->in_render_pass) end_render_pass();
+        /*
+         * Submits the command buffer without waiting for the GPU. The returned ticket can be polled or waited on,
+         * the command buffer itself is reset the next time begin() is called.
+         * If sync.fence is set it is signalled once all work submitted to the queue so far has completed, and backs the
+         * ticket unless timeline semaphores are enabled. Reset it through VulkanRenderer::reset_fence() or Fence::reset().
+         * With timeline semaphores enabled the submission also signals the next point on the queue's timeline,
+         * which backs the returned ticket.
+         */
+        SubmitTicket submit(Queue queue, const SubmitSyncObjects& sync = {}){
+            assert(sync.wait.size() == sync.wait_stages.size());
+            assert(sync.timeline_wait.size() == sync.timeline_wait_stages.size());
+            check_semaphore_counts(sync.wait.size() + sync.timeline_wait.size(), sync.signal.size() + sync.timeline_signal.size());
+
+            std::array<SubmitWait, MAX_SUBMIT_SEMAPHORES> wait = {};
+            std::array<SubmitSignal, MAX_SUBMIT_SEMAPHORES> signal = {};
+            size_t wait_count = 0, signal_count = 0;
+            for(size_t i = 0; i < sync.wait.size(); i++) wait[wait_count++] = {sync.wait[i].vk_semaphore(), sync.wait_stages[i]};
+            for(size_t i = 0; i < sync.timeline_wait.size(); i++){
+                wait[wait_count++] = {sync.timeline_wait[i].semaphore, sync.timeline_wait_stages[i], sync.timeline_wait[i].value};
+            }
+            for(const auto& sem : sync.signal) signal[signal_count++] = {sem.vk_semaphore()};
+            for(const auto& point : sync.timeline_signal) signal[signal_count++] = {point.semaphore, point.value};
+
+            return submit(queue, std::span(wait.data(), wait_count), std::span(signal.data(), signal_count), sync.fence.vk_fence());
+        }
+
+        /*
+         * Same as above without SubmitSyncObjects, which owns its semaphores through shared pointers. Doesn't allocate,
+         * use it for per-frame submissions:
+         *   cmd.submit(Queue::GRAPHICS, {{image_available, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}}, {{render_finished}}, fence);
+         */
+        SubmitTicket submit(Queue queue, std::initializer_list<SubmitWait> wait, std::initializer_list<SubmitSignal> signal,
+                            VkFence fence = VK_NULL_HANDLE){
+            return submit(queue, std::span(wait.begin(), wait.size()), std::span(signal.begin(), signal.size()), fence);
+        }
+
+        SubmitTicket submit(Queue queue, std::span<const SubmitWait> wait, std::span<const SubmitSignal> signal,
+                            VkFence fence = VK_NULL_HANDLE){
+            G_APP_TRACE_SCOPE("submit");
+            assert(self->level == VK_COMMAND_BUFFER_LEVEL_PRIMARY && "Secondary command buffers are run with execute_commands()!");
+            if(self->in_render_pass) (self->dynamic_rendering) ? end_rendering() : end_render_pass();
             if(self->recording) end();
-            
-            std::vector<VkSemaphore> wait = {};
-            std::vector<VkSemaphore> signal = {};
-            wait.reserve(sync.wait.size());
-            signal.reserve(sync.signal.size());
-            
-
-            for(const auto& sem : sync.wait) { wait.push_back(sem.vk_semaphore()); }
-            for(const auto& sem : sync.signal) { signal.push_back(sem.vk_semaphore()); }
-
-            VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
-            submit_info.commandBufferCount = 1;
-            submit_info.pCommandBuffers = &self->cmdbuf;
-            submit_info.waitSemaphoreCount = wait.size();
-            submit_info.pWaitSemaphores = wait.data();
-            submit_info.pWaitDstStageMask = sync.wait_stages.data();
-            submit_info.signalSemaphoreCount = signal.size();
-            submit_info.pSignalSemaphores = signal.data();
-
-            vkQueueSubmit(self->renderer.get_queue(queue), 1, &submit_info, sync.fence.vk_fence());
-            vkQueueWaitIdle(self->renderer.get_queue(queue));
+            if(self->capture.is_valid()){
+                self->capture.add_submission(queue, self->capture_stream);
+                self->capture_stream.clear();
+            }
+            check_semaphore_counts(wait.size(), signal.size());
+            if(self->renderer.queue_family_index(queue) != self->queue_family){
+                spdlog::error("A command buffer allocated for queue family {} can't be submitted to queue family {}! "
+                              "Allocate it with CommandBuffer(renderer, queue).",
+                              self->queue_family, self->renderer.queue_family_index(queue));
+                std::exit(EXIT_FAILURE);
+            }
 
-            vkResetCommandBuffer(self->cmdbuf, 0);
+            // The barriers into the first uses run ahead of the commands in the same submission
+            std::array<VkCommandBuffer, 2> cmdbufs = {self->cmdbuf};
+            uint32_t cmdbuf_count = 1;
+            if(auto prologue = resolve_resources(queue); prologue != VK_NULL_HANDLE){
+                cmdbufs = {prologue, self->cmdbuf};
+                cmdbuf_count = 2;
+            }
+
+            // One extra signal for the queue's timeline
+            std::array<SubmitSignal, MAX_SUBMIT_SEMAPHORES + 1> signals = {};
+            std::copy(signal.begin(), signal.end(), signals.begin());
+            size_t signal_count = signal.size();
 
+            TimelinePoint queue_point = {};
+            if(self->renderer.has_timeline_semaphores()){
+                queue_point = self->renderer.next_timeline_point(queue);
+                signals[signal_count++] = {queue_point.semaphore, queue_point.value};
+            }
+
+            // The timeline point or the caller's fence tracks the submission, a pooled fence is only needed without either
+            PooledFence pooled_fence = {};
+            TrackedFence tracked_fence = {};
+            if(fence != VK_NULL_HANDLE){
+                if(queue_point.semaphore == VK_NULL_HANDLE) tracked_fence = self->renderer.track_fence(fence);
+            } else if(queue_point.semaphore == VK_NULL_HANDLE){
+                pooled_fence = self->renderer.acquire_pooled_fence();
+                fence = pooled_fence.fence;
+            }
+            VkQueue vk_queue = self->renderer.get_queue(queue);
+
+            VkResult result = VK_SUCCESS;
+            if(self->renderer.has_synchronization2()){
+                // Legacy stage bits have the same values in VkPipelineStageFlags2
+                std::array<VkSemaphoreSubmitInfo, MAX_SUBMIT_SEMAPHORES> wait_infos = {};
+                std::array<VkSemaphoreSubmitInfo, MAX_SUBMIT_SEMAPHORES + 1> signal_infos = {};
+                for(size_t i = 0; i < wait.size(); i++){
+                    wait_infos[i] = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+                    wait_infos[i].semaphore = wait[i].semaphore;
+                    wait_infos[i].value = wait[i].value;
+                    wait_infos[i].stageMask = wait[i].stage;
+                }
+                for(size_t i = 0; i < signal_count; i++){
+                    signal_infos[i] = {VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+                    signal_infos[i].semaphore = signals[i].semaphore;
+                    signal_infos[i].value = signals[i].value;
+                    signal_infos[i].stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+                }
+
+                std::array<VkCommandBufferSubmitInfo, 2> cmdbuf_infos = {};
+                for(uint32_t i = 0; i < cmdbuf_count; i++){
+                    cmdbuf_infos[i] = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+                    cmdbuf_infos[i].commandBuffer = cmdbufs[i];
+                }
+
+                VkSubmitInfo2 submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+                submit_info.commandBufferInfoCount = cmdbuf_count;
+                submit_info.pCommandBufferInfos = cmdbuf_infos.data();
+                submit_info.waitSemaphoreInfoCount = wait.size();
+                submit_info.pWaitSemaphoreInfos = wait_infos.data();
+                submit_info.signalSemaphoreInfoCount = signal_count;
+                submit_info.pSignalSemaphoreInfos = signal_infos.data();
+
+                result = self->renderer.queue_submit2(queue, submit_info, fence);
+            } else {
+                std::array<VkSemaphore, MAX_SUBMIT_SEMAPHORES> wait_semaphores = {};
+                std::array<VkPipelineStageFlags, MAX_SUBMIT_SEMAPHORES> wait_stages = {};
+                std::array<uint64_t, MAX_SUBMIT_SEMAPHORES> wait_values = {};
+                std::array<VkSemaphore, MAX_SUBMIT_SEMAPHORES + 1> signal_semaphores = {};
+                std::array<uint64_t, MAX_SUBMIT_SEMAPHORES + 1> signal_values = {};
+                for(size_t i = 0; i < wait.size(); i++){
+                    wait_semaphores[i] = wait[i].semaphore;
+                    wait_stages[i] = wait[i].stage;
+                    wait_values[i] = wait[i].value;
+                }
+                for(size_t i = 0; i < signal_count; i++){
+                    signal_semaphores[i] = signals[i].semaphore;
+                    signal_values[i] = signals[i].value;
+                }
+
+                VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+                submit_info.commandBufferCount = cmdbuf_count;
+                submit_info.pCommandBuffers = cmdbufs.data();
+                submit_info.waitSemaphoreCount = wait.size();
+                submit_info.pWaitSemaphores = wait_semaphores.data();
+                submit_info.pWaitDstStageMask = wait_stages.data();
+                submit_info.signalSemaphoreCount = signal_count;
+                submit_info.pSignalSemaphores = signal_semaphores.data();
+
+                // Binary semaphores ignore their value, but the arrays must match the semaphore counts
+                VkTimelineSemaphoreSubmitInfo timeline_info = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+                if(self->renderer.has_timeline_semaphores()){
+                    timeline_info.waitSemaphoreValueCount = wait.size();
+                    timeline_info.pWaitSemaphoreValues = wait_values.data();
+                    timeline_info.signalSemaphoreValueCount = signal_count;
+                    timeline_info.pSignalSemaphoreValues = signal_values.data();
+                    submit_info.pNext = &timeline_info;
+                }
+
+                result = vkQueueSubmit(vk_queue, 1, &submit_info, fence);
+            }
+            if(result != VK_SUCCESS){
+                spdlog::error("Failed to submit a command buffer! result = {}", static_cast<uint32_t>(result));
+                std::exit(EXIT_FAILURE);
+            }
+
+            self->renderer.track_submission(queue, pooled_fence, tracked_fence);
+
+            if(queue_point.semaphore != VK_NULL_HANDLE)    self->pending = SubmitTicket(self->renderer, queue_point);
+            else if(tracked_fence.fence != VK_NULL_HANDLE) self->pending = SubmitTicket(self->renderer, tracked_fence);
+            else                                           self->pending = SubmitTicket(self->renderer, pooled_fence);
             self->recording = false;
+
+            return self->pending;
         }
 
-        template<typename T>
-        CommandBuffer& copy_buffer(const Buffer<T>& src, const Buffer<T>& dst,
+        /* Opt-in blocking submit, returns once the GPU has finished executing the command buffer. */
+        void submit_blocking(Queue queue, const SubmitSyncObjects& sync = {}){
+            submit(queue, sync).wait();
+
+            self->pending = {};
+            vkResetCommandBuffer(self->cmdbuf, 0);
+        }
+
+        const SubmitTicket& pending_ticket() const { return self->pending; }
+
+        template<BufferView S, BufferView D>
+        requires std::same_as<typename S::value_type, typename D::value_type>
+        CommandBuffer& copy_buffer(const S& src, const D& dst,
                                    VkDeviceSize size = 0, VkDeviceSize src_offset = 0, VkDeviceSize dst_offset = 0){
+            using T = typename S::value_type;
             assert(self->recording && "Commands can't be called without first calling begin()!");
+            flush_barriers();
             if(size == 0) {
                 assert(src.size() == dst.size() && "Buffers must be the same size when performing a full copy!");
             }
 
             VkBufferCopy copy = {};
-            copy.srcOffset = src_offset * sizeof(T);
-            copy.dstOffset = dst_offset * sizeof(T);
+            copy.srcOffset = src.offsetb() + src_offset * sizeof(T);
+            copy.dstOffset = dst.offsetb() + dst_offset * sizeof(T);
             copy.size = (size > 0) ? size * sizeof(T) : src.size() * sizeof(T);
             vkCmdCopyBuffer(self->cmdbuf, src.vk_buffer(), dst.vk_buffer(), 1, &copy);
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::COPY_BUFFER, self->capture.buffer_id(src), copy.srcOffset,
+                           self->capture.buffer_id(dst), copy.dstOffset, copy.size);
+            }
 
             return *this;
         }
 
-        template<typename T>
-        CommandBuffer& copy_buffer_to_image(const Buffer<T>& src, const Image& dst,
+        template<BufferView B>
+        CommandBuffer& copy_buffer_to_image(const B& src, const Image& dst,
                                             VkImageAspectFlags aspect_mask, VkImageLayout dst_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                                             uint32_t mip_level = 0, uint32_t base_layer = 0, uint32_t layer_count = 1){
             assert(self->recording && "Commands can't be called without first calling begin()!");
+            flush_barriers();
 
             VkBufferImageCopy region = {};
+            region.bufferOffset = src.offsetb();
             region.imageSubresource.aspectMask = aspect_mask;
             region.imageSubresource.mipLevel = mip_level;
             region.imageSubresource.baseArrayLayer = base_layer;
@@ -231,10 +718,13 @@ namespace g_app {
                 self->cmdbuf,
                 src.vk_buffer(),
                 dst.vk_image(),
-                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                dst_layout,
                 1,
                 &region
             );
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::COPY_BUFFER_TO_IMAGE, self->capture.buffer_id(src), self->capture.image_id(dst), region);
+            }
 
             return *this;
         }
@@ -267,22 +757,39 @@ namespace g_app {
 
         CommandBuffer& draw_imgui(){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            assert(!self->dynamic_rendering && "ImGui is set up for the default render pass, not dynamic rendering!");
+            if(self->capture.is_valid()) self->capture.skip_command();
             self->renderer.render_imgui(self->cmdbuf);
+            self->bound = {}; // ImGui binds its own state
             return *this;
         }
 
-        CommandBuffer& begin_default_render_pass(float r, float g, float b, float a){
+        CommandBuffer& begin_default_render_pass(float r, float g, float b, float a,
+                                                 VkSubpassContents contents=VK_SUBPASS_CONTENTS_INLINE){
             assert(self->recording && "Commands can't be called without first calling begin()!");
             assert(!self->in_render_pass && "Can't begin a render pass when another has already begun!");
-
-            self->renderer.begin_default_render_pass(self->cmdbuf, r, g, b, a);
+            flush_barriers();
+            if(self->capture.is_valid()) capture_op(TraceOp::BEGIN_DEFAULT_RENDER_PASS, r, g, b, a);
+
+            self->renderer.begin_default_render_pass(self->cmdbuf, r, g, b, a, contents);
+            reset_inheritance();
+            self->inheritance.render_pass = self->renderer.default_render_pass();
+            self->inheritance.framebuffer = self->renderer.current_framebuffer();
+            self->inheritance.render_area = {{0, 0}, self->renderer.swapchain_extent()};
+            self->inheritance.secondary_contents = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
             self->in_render_pass = true;
             return *this;
         }
 
         CommandBuffer& begin_render_pass(const RenderPass& render_pass, const Framebuffer& framebuffer,
                                          const std::vector<VkClearValue>& clear_values,
-                                         const Extent2D<uint32_t>& viewport_extent){
+                                         const Extent2D<uint32_t>& viewport_extent,
+                                         VkSubpassContents contents=VK_SUBPASS_CONTENTS_INLINE){
+            flush_barriers();
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::BEGIN_UNSUPPORTED_PASS);
+                self->capture.skip_command();
+            }
 
             VkExtent2D extent = {viewport_extent.width, viewport_extent.height};
 
@@ -293,7 +800,7 @@ namespace g_app {
             begin_info.clearValueCount = clear_values.size();
             begin_info.pClearValues = clear_values.data();
 
-            vkCmdBeginRenderPass(self->cmdbuf, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+            vkCmdBeginRenderPass(self->cmdbuf, &begin_info, contents);
             VkViewport viewport{};
             viewport.x = 0.0f;
             viewport.y = 0.0f;
@@ -305,93 +812,355 @@ namespace g_app {
             vkCmdSetViewport(self->cmdbuf, 0, 1, &viewport);
             vkCmdSetScissor(self->cmdbuf, 0, 1, &scissor);
 
+            reset_inheritance();
+            self->inheritance.render_pass = render_pass.vk_render_pass();
+            self->inheritance.framebuffer = framebuffer.vk_framebuffer();
+            self->inheritance.render_area = {{0, 0}, extent};
+            self->inheritance.secondary_contents = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
             self->in_render_pass = true;
 
             return *this;
         }
 
+        /*
+         * Dynamic rendering into image views, requires VulkanRenderer::has_dynamic_rendering(). Attachments must already
+         * be in the layouts named in info, e.g. through require(image, ResourceUsage::COLOR_ATTACHMENT), and pipelines
+         * used inside must be built with GraphicsPipelineInit::set_rendering_formats(). Ended by end_rendering().
+         */
+        CommandBuffer& begin_rendering(const RenderingInfo& info){
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            assert(!self->in_render_pass && "Can't begin rendering when a render pass has already begun!");
+            flush_barriers();
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::BEGIN_UNSUPPORTED_PASS);
+                self->capture.skip_command();
+            }
+
+            VkRenderingInfo rendering_info = {VK_STRUCTURE_TYPE_RENDERING_INFO};
+            rendering_info.renderArea = info.render_area;
+            rendering_info.layerCount = info.layer_count;
+            rendering_info.colorAttachmentCount = info.color_attachments.size();
+            rendering_info.pColorAttachments = info.color_attachments.data();
+            rendering_info.pDepthAttachment = (info.depth_attachment) ? &info.depth_attachment.value() : nullptr;
+            rendering_info.pStencilAttachment = (info.stencil_attachment) ? &info.stencil_attachment.value() : nullptr;
+            self->renderer.cmd_begin_rendering(self->cmdbuf, rendering_info);
+
+            const auto& extent = info.render_area.extent;
+            VkViewport viewport{};
+            viewport.x = static_cast<float>(info.render_area.offset.x);
+            viewport.y = static_cast<float>(info.render_area.offset.y);
+            viewport.width = static_cast<float>(extent.width);
+            viewport.height = static_cast<float>(extent.height);
+            viewport.minDepth = 0.0f;
+            viewport.maxDepth = 1.0f;
+            vkCmdSetViewport(self->cmdbuf, 0, 1, &viewport);
+            vkCmdSetScissor(self->cmdbuf, 0, 1, &info.render_area);
+
+            reset_inheritance();
+            self->inheritance.color_formats = info.color_formats;
+            self->inheritance.depth_format = info.depth_format;
+            self->inheritance.stencil_format = info.stencil_format;
+            self->inheritance.samples = info.samples;
+            self->inheritance.render_area = info.render_area;
+            self->inheritance.secondary_contents = (info.flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) != 0;
+            self->in_render_pass = true;
+            self->dynamic_rendering = true;
+            return *this;
+        }
+
+        /* Dynamic rendering into the current swapchain image, see VulkanRenderer::begin_default_rendering(). */
+        CommandBuffer& begin_default_rendering(float r, float g, float b, float a, VkRenderingFlags flags=0){
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            assert(!self->in_render_pass && "Can't begin rendering when a render pass has already begun!");
+            flush_barriers();
+            if(self->capture.is_valid()){
+                self->capture.add_flags(TRACE_USES_DYNAMIC_RENDERING);
+                capture_op(TraceOp::BEGIN_DEFAULT_RENDERING, r, g, b, a);
+            }
+
+            self->renderer.begin_default_rendering(self->cmdbuf, r, g, b, a, flags);
+            reset_inheritance();
+            self->inheritance.color_formats = {self->renderer.chosen_swapchain_format()};
+            self->inheritance.depth_format = self->renderer.chosen_depth_format();
+            self->inheritance.render_area = {{0, 0}, self->renderer.swapchain_extent()};
+            self->inheritance.secondary_contents = (flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT) != 0;
+            self->in_render_pass = true;
+            self->dynamic_rendering = true;
+            self->default_rendering = true;
+            return *this;
+        }
+
+        CommandBuffer& end_rendering(){
+            assert(self->in_render_pass && self->dynamic_rendering && "Can't end rendering when it hasn't begun!");
+            if(self->capture.is_valid()) capture_op(TraceOp::END_RENDERING);
+
+            if(self->default_rendering) self->renderer.end_default_rendering(self->cmdbuf);
+            else self->renderer.cmd_end_rendering(self->cmdbuf);
+            self->in_render_pass = self->dynamic_rendering = self->default_rendering = false;
+            return *this;
+        }
+
         CommandBuffer& end_render_pass(){
             assert(self->in_render_pass && "Can't end a render pass when one hasn't begun!");
+            assert(!self->dynamic_rendering && "Dynamic rendering is ended with end_rendering()!");
+            if(self->capture.is_valid()) capture_op(TraceOp::END_RENDER_PASS);
 
             vkCmdEndRenderPass(self->cmdbuf);
             self->in_render_pass = false;
             return *this;
         }
 
+        /*
+         * The bind commands below shadow what is bound and skip calls that wouldn't change anything, see bind_stats().
+         * Anything bound through vk_cmd() resets the shadow state.
+         */
         CommandBuffer &bind_pipeline(const Pipeline &pipeline, VkPipelineBindPoint bind_point) {
-            assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            assert((bind_point != VK_PIPELINE_BIND_POINT_GRAPHICS || self->in_render_pass) &&
+                   "Can't execute render pass dependant commands when no render pass has begun!");
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::BIND_PIPELINE, self->capture.pipeline_id(pipeline), static_cast<uint32_t>(bind_point));
+            }
+            auto index = bind_point_index(bind_point);
+            if(index < BoundState::BIND_POINTS && self->bound.pipelines[index] == pipeline.vk_pipeline()){
+                self->bind_stats.skipped_pipeline_binds++;
+                return *this;
+            }
+
             vkCmdBindPipeline(self->cmdbuf, bind_point, pipeline.vk_pipeline());
+            track(pipeline);
+            if(index < BoundState::BIND_POINTS) self->bound.pipelines[index] = pipeline.vk_pipeline();
+            self->bind_stats.pipeline_binds++;
             return *this;
         }
 
-        template<typename T>
-        CommandBuffer& bind_vertex_buffer(const Buffer<T>& buffer, VkDeviceSize offset = 0){
+        template<BufferView B>
+        CommandBuffer& bind_vertex_buffer(const B& buffer, VkDeviceSize offset = 0){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
-            VkDeviceSize offset_bytes = offset * sizeof(T);
-            VkBuffer vk_buffer[] = {buffer.vk_buffer()};
-            vkCmdBindVertexBuffers(self->cmdbuf, 0, 1, vk_buffer, &offset_bytes);
+            VkDeviceSize offset_bytes = buffer.offsetb() + offset * sizeof(typename B::value_type);
+            VkBuffer vk_buffer = buffer.vk_buffer();
+            if(self->capture.is_valid()) self->capture.buffer_id(buffer);
+            bind_vertex_buffers(1, &vk_buffer, &offset_bytes);
+            track(buffer);
             return *this;
         }
 
-        template<typename T>
-        CommandBuffer bind_index_buffer(const Buffer<T>& buffer, VkIndexType type, VkDeviceSize offset = 0){
+        template<BufferView B>
+        CommandBuffer& bind_index_buffer(const B& buffer, VkIndexType type, VkDeviceSize offset = 0){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
-            VkDeviceSize offset_bytes = offset * sizeof(T);
+            VkDeviceSize offset_bytes = buffer.offsetb() + offset * sizeof(typename B::value_type);
             VkBuffer vk_buffer = buffer.vk_buffer();
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::BIND_INDEX_BUFFER, self->capture.buffer_id(buffer), offset_bytes, static_cast<uint32_t>(type));
+            }
+
+            auto& bound = self->bound;
+            if(bound.index_buffer == vk_buffer && bound.index_offset == offset_bytes && bound.index_type == type){
+                self->bind_stats.skipped_index_buffer_binds++;
+                return *this;
+            }
+
             vkCmdBindIndexBuffer(self->cmdbuf, vk_buffer, offset_bytes, type);
+            track(buffer);
+            bound.index_buffer = vk_buffer;
+            bound.index_offset = offset_bytes;
+            bound.index_type = type;
+            self->bind_stats.index_buffer_binds++;
             return *this;
         }
 
-        CommandBuffer& bind_vertex_buffers(VertexBufferBindings bindings){
+        CommandBuffer& bind_vertex_buffers(const VertexBufferBindings& bindings){
+            for(const auto& ref : bindings.refs()) depends_on(ref);
+            return bind_vertex_buffers(std::span(bindings.buffers()), std::span(bindings.offsets()));
+        }
+
+        /*
+         * Binds buffers[i] at offsets[i] (in bytes) to binding i. Raw handles aren't tracked by a CachedCommandBuffer,
+         * pass the owners to depends_on().
+         */
+        CommandBuffer& bind_vertex_buffers(std::span<const VkBuffer> buffers, std::span<const VkDeviceSize> offsets){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
-            vkCmdBindVertexBuffers(self->cmdbuf,
-                                   0, bindings.buffers().size(),
-                                   bindings.buffers().data(), bindings.offsets().data());
+            assert(buffers.size() == offsets.size());
+            bind_vertex_buffers(buffers.size(), buffers.data(), offsets.data());
             return *this;
         }
 
         template<typename T>
         CommandBuffer& push_constants(const Pipeline& pipeline, VkShaderStageFlags stage, const T& constants){
+            return push_constants(pipeline, stage, &constants, sizeof(T));
+        }
+
+        /* Untyped version of the above, pushes 'size' bytes at offset 0 of the push constant range. */
+        CommandBuffer& push_constants(const Pipeline& pipeline, VkShaderStageFlags stage, const void* data, uint32_t size){
             assert(self->recording && "Commands can't be called without first calling begin()!");
-            vkCmdPushConstants(self->cmdbuf, pipeline.vk_pipeline_layout(), stage, 0, sizeof(T), &constants);
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::PUSH_CONSTANTS, self->capture.pipeline_id(pipeline), static_cast<uint32_t>(stage), size);
+                trace_write_bytes(self->capture_stream, data, size);
+            }
+            auto& bound = self->bound;
+            if(bound.push_layout == pipeline.vk_pipeline_layout() && bound.push_stages == stage &&
+               bound.push_size == size && std::memcmp(bound.push_data.data(), data, size) == 0){
+                self->bind_stats.skipped_push_constants++;
+                return *this;
+            }
+
+            vkCmdPushConstants(self->cmdbuf, pipeline.vk_pipeline_layout(), stage, 0, size, data);
+            // Constants bigger than the shadow buffer are always pushed
+            bound.push_layout = pipeline.vk_pipeline_layout();
+            bound.push_stages = stage;
+            bound.push_size = (size <= BoundState::MAX_PUSH_CONSTANT_SIZE) ? size : 0;
+            std::memcpy(bound.push_data.data(), data, bound.push_size);
+            self->bind_stats.push_constants++;
             return *this;
         }
 
+        /*
+         * dynamic_offsets holds one offset per dynamic descriptor, in binding order across all sets.
+         * Sets are only shadowed against the same pipeline layout, without dynamic offsets a call that matches the
+         * leading sets already bound only rebinds the sets after them.
+         */
         CommandBuffer& bind_descriptor_sets(
                 const Pipeline& pipeline, VkPipelineBindPoint bind_point,
-                const std::vector<DescriptorSet>& sets){
-            assert(self->recording && "Commands can't be called without first calling begin()!");
+                const std::vector<DescriptorSet>& sets, const std::vector<uint32_t>& dynamic_offsets = {}){
+            return bind_descriptor_sets(pipeline, bind_point, std::span(sets), std::span(dynamic_offsets));
+        }
 
-            std::vector<VkDescriptorSet> vk_sets = {};
-            vk_sets.reserve(sets.size());
+        /* Same as above without building vectors: cmd.bind_descriptor_sets(pipeline, bind_point, {global_set, material_set}); */
+        CommandBuffer& bind_descriptor_sets(
+                const Pipeline& pipeline, VkPipelineBindPoint bind_point,
+                std::initializer_list<DescriptorSet> sets, std::initializer_list<uint32_t> dynamic_offsets = {}){
+            return bind_descriptor_sets(pipeline, bind_point, std::span(sets.begin(), sets.size()),
+                                        std::span(dynamic_offsets.begin(), dynamic_offsets.size()));
+        }
+
+        CommandBuffer& bind_descriptor_sets(
+                const Pipeline& pipeline, VkPipelineBindPoint bind_point,
+                std::span<const DescriptorSet> sets, std::span<const uint32_t> dynamic_offsets){
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            // Captured before elision, the replay elides the same binds
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::BIND_DESCRIPTOR_SETS, self->capture.pipeline_id(pipeline), static_cast<uint32_t>(bind_point),
+                           static_cast<uint32_t>(sets.size()));
+                bool captured = true;
+                for(const auto& set : sets){
+                    auto id = self->capture.descriptor_set_id(set);
+                    captured = captured && id != TRACE_INVALID_ID;
+                    trace_write(self->capture_stream, id);
+                }
+                if(!captured) self->capture.skip_command();
+                trace_write(self->capture_stream, static_cast<uint32_t>(dynamic_offsets.size()));
+                trace_write_bytes(self->capture_stream, dynamic_offsets.data(), dynamic_offsets.size_bytes());
+            }
 
-            for(const auto& set : sets){
-                vk_sets.push_back(set.vk_descriptor_set());
+            // Only more sets than a pipeline layout usually has need the heap
+            std::array<VkDescriptorSet, BoundState::MAX_SETS> small_sets = {};
+            std::vector<VkDescriptorSet> large_sets = {};
+            VkDescriptorSet* vk_sets = small_sets.data();
+            if(sets.size() > small_sets.size()){
+                large_sets.resize(sets.size());
+                vk_sets = large_sets.data();
+            }
+            for(size_t i = 0; i < sets.size(); i++) vk_sets[i] = sets[i].vk_descriptor_set();
+            uint32_t set_count = sets.size();
+
+            auto layout = pipeline.vk_pipeline_layout();
+            auto index = bind_point_index(bind_point);
+            uint32_t first_set = 0;
+            if(index < BoundState::BIND_POINTS && set_count <= BoundState::MAX_SETS &&
+               dynamic_offsets.size() <= BoundState::MAX_DYNAMIC_OFFSETS){
+                auto& bound = self->bound.descriptor_sets[index];
+                auto same_offsets = bound.dynamic_offset_count == dynamic_offsets.size() &&
+                                    std::equal(dynamic_offsets.begin(), dynamic_offsets.end(), bound.dynamic_offsets.begin());
+                if(bound.layout == layout && bound.dynamic_offset_count == 0 && dynamic_offsets.empty()){
+                    while(first_set < set_count && first_set < bound.count && bound.sets[first_set] == vk_sets[first_set]) first_set++;
+                } else if(bound.layout == layout && bound.count == set_count && same_offsets &&
+                          std::equal(vk_sets, vk_sets + set_count, bound.sets.begin())){
+                    first_set = set_count;
+                }
+
+                if(first_set == set_count){
+                    self->bind_stats.skipped_descriptor_set_binds++;
+                    return *this;
+                }
+
+                // Sets after the ones given stay bound, like they would in Vulkan
+                if(bound.layout != layout || bound.dynamic_offset_count != 0 || !dynamic_offsets.empty()) bound.count = 0;
+                bound.layout = layout;
+                std::copy(vk_sets, vk_sets + set_count, bound.sets.begin());
+                bound.count = std::max(bound.count, set_count);
+                std::copy(dynamic_offsets.begin(), dynamic_offsets.end(), bound.dynamic_offsets.begin());
+                bound.dynamic_offset_count = dynamic_offsets.size();
+            } else if(index < BoundState::BIND_POINTS){
+                self->bound.descriptor_sets[index] = {};
             }
 
-            vkCmdBindDescriptorSets(self->cmdbuf, bind_point, pipeline.vk_pipeline_layout(), 0,
-                                    vk_sets.size(), vk_sets.data(),
-                                    0, nullptr);
+            vkCmdBindDescriptorSets(self->cmdbuf, bind_point, layout, first_set,
+                                    set_count - first_set, vk_sets + first_set,
+                                    dynamic_offsets.size(), dynamic_offsets.data());
+            for(size_t i = first_set; self->dependencies && i < sets.size(); i++) track(sets[i]);
+            self->bind_stats.descriptor_set_binds++;
             return *this;
         }
 
+        const BindStats& bind_stats() const { return self->bind_stats; }
+
         // If VK_KHR_push_descriptor is enabled
         CommandBuffer& ext_push_descriptor_set(const Pipeline& pipeline, VkPipelineBindPoint bind_point, uint32_t set,
                                                const std::vector<VkWriteDescriptorSet>& writes){
+            if(self->capture.is_valid()) self->capture.skip_command();
             auto push_descriptor_set = self->renderer.get_extpfn<PFN_vkCmdPushDescriptorSetKHR>("vkCmdPushDescriptorSetKHR");
             push_descriptor_set(self->cmdbuf, bind_point, pipeline.vk_pipeline_layout(), set, static_cast<uint32_t>(writes.size()),
                                 writes.data());
+            auto index = bind_point_index(bind_point);
+            if(index < BoundState::BIND_POINTS) self->bound.descriptor_sets[index] = {};
             return *this;
         }
 
         CommandBuffer& next_subpass(VkSubpassContents contents=VK_SUBPASS_CONTENTS_INLINE){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            if(self->capture.is_valid()) self->capture.skip_command();
             vkCmdNextSubpass(self->cmdbuf, contents);
+            self->inheritance.subpass++;
+            self->inheritance.secondary_contents = contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS;
+            return *this;
+        }
+
+        /* State of the current render pass or dynamic rendering, for begin_secondary(). */
+        const CommandBufferInheritance& inheritance() const {
+            assert(self->in_render_pass && !self->continues_render_pass && "No render pass has begun in this command buffer!");
+            return self->inheritance;
+        }
+
+        /* Runs recorded secondary command buffers inside a render pass begun with secondary contents. */
+        CommandBuffer& execute_commands(std::span<const CommandBuffer> secondaries){
+            assert(self->in_render_pass && self->inheritance.secondary_contents &&
+                   "Secondary command buffers need a render pass begun with secondary contents!");
+
+            // Executed in batches so the handles fit on the stack
+            std::array<VkCommandBuffer, 32> cmdbufs = {};
+            for(size_t first = 0; first < secondaries.size(); first += cmdbufs.size()){
+                uint32_t count = std::min(cmdbufs.size(), secondaries.size() - first);
+                for(uint32_t i = 0; i < count; i++){
+                    const auto& secondary = secondaries[first + i];
+                    assert(!secondary.self->recording && "Secondary command buffers must be ended before they are executed!");
+                    cmdbufs[i] = secondary.self->cmdbuf;
+                    // Captured secondaries are inlined, the trace has no secondary command buffers
+                    if(self->capture.is_valid() && secondary.self->capture.is_valid()){
+                        trace_write_bytes(self->capture_stream, secondary.self->capture_stream.data(), secondary.self->capture_stream.size());
+                    } else if(self->capture.is_valid()){
+                        self->capture.skip_command();
+                    }
+                }
+                vkCmdExecuteCommands(self->cmdbuf, count, cmdbufs.data());
+            }
+            self->bound = {}; // Bound state is undefined after executing secondaries
             return *this;
         }
 
         CommandBuffer& draw(uint32_t vertex_count, uint32_t instance_count, uint32_t first_vertex=0, uint32_t first_instance=0){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            flush_barriers();
+            if(self->capture.is_valid()) capture_op(TraceOp::DRAW, vertex_count, instance_count, first_vertex, first_instance);
             vkCmdDraw(self->cmdbuf, vertex_count, instance_count, first_vertex, first_instance);
             return *this;
         }
@@ -400,6 +1169,10 @@ namespace g_app {
                 uint32_t index_count, uint32_t instance_count, uint32_t first_index=0, int32_t vertex_offset=0, uint32_t first_instance=0
         ){
             assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            flush_barriers();
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::DRAW_INDEXED, index_count, instance_count, first_index, vertex_offset, first_instance);
+            }
             vkCmdDrawIndexed(self->cmdbuf, index_count, instance_count,
                              first_index, vertex_offset, first_instance);
             return *this;
@@ -407,13 +1180,183 @@ namespace g_app {
 
         CommandBuffer& dispatch(uint32_t x, uint32_t y, uint32_t z){
             assert(self->recording && "Commands can't be  called without first calling begin()!");
+            flush_barriers();
+            if(self->capture.is_valid()) capture_op(TraceOp::DISPATCH, x, y, z);
             vkCmdDispatch(self->cmdbuf, x, y, z);
 
             return *this;
         }
 
+        /*
+         * Indirect draws read their parameters from a buffer created with VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, one draw
+         * per command in the view (use buffer_range() for part of a buffer). Commands written by the GPU need
+         * require(buffer, ResourceUsage::INDIRECT_BUFFER) first. Views with more commands than
+         * VulkanRenderer::max_draw_indirect_count() are split into several draws, without multiDrawIndirect that is one
+         * draw per command.
+         */
+        template<BufferView B> requires std::same_as<typename B::value_type, VkDrawIndirectCommand>
+        CommandBuffer& draw_indirect(const B& commands){
+            assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            flush_barriers();
+            uint32_t count = commands.size();
+            uint32_t stride = sizeof(VkDrawIndirectCommand);
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::DRAW_INDIRECT, self->capture.buffer_id(commands), static_cast<VkDeviceSize>(commands.offsetb()), count);
+            }
+            auto max_count = self->renderer.max_draw_indirect_count();
+            for(uint32_t first = 0; first < count; first += max_count){
+                vkCmdDrawIndirect(self->cmdbuf, commands.vk_buffer(), commands.offsetb() + static_cast<VkDeviceSize>(first) * stride,
+                                  std::min(count - first, max_count), stride);
+            }
+            return *this;
+        }
+
+        template<BufferView B> requires std::same_as<typename B::value_type, VkDrawIndexedIndirectCommand>
+        CommandBuffer& draw_indexed_indirect(const B& commands){
+            assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            flush_barriers();
+            uint32_t count = commands.size();
+            uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::DRAW_INDEXED_INDIRECT, self->capture.buffer_id(commands),
+                           static_cast<VkDeviceSize>(commands.offsetb()), count);
+            }
+            auto max_count = self->renderer.max_draw_indirect_count();
+            for(uint32_t first = 0; first < count; first += max_count){
+                vkCmdDrawIndexedIndirect(self->cmdbuf, commands.vk_buffer(), commands.offsetb() + static_cast<VkDeviceSize>(first) * stride,
+                                         std::min(count - first, max_count), stride);
+            }
+            return *this;
+        }
+
+        /*
+         * Like draw_indirect(), but the number of draws is read from counts[count_index] on the GPU, capped at
+         * commands.size() and VulkanRenderer::max_draw_indirect_count(). Requires VulkanRenderer::has_draw_indirect_count().
+         */
+        template<BufferView B, BufferView C>
+            requires std::same_as<typename B::value_type, VkDrawIndirectCommand> && std::same_as<typename C::value_type, uint32_t>
+        CommandBuffer& draw_indirect_count(const B& commands, const C& counts, uint32_t count_index = 0){
+            assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            assert(count_index < counts.size() && "Count index out of the count buffer's bounds!");
+            flush_barriers();
+            if(self->capture.is_valid()) capture_indirect_count(TraceOp::DRAW_INDIRECT_COUNT, commands, counts, count_index);
+            self->renderer.cmd_draw_indirect_count(self->cmdbuf, commands.vk_buffer(), commands.offsetb(),
+                                                   counts.vk_buffer(), counts.offsetb() + count_index * sizeof(uint32_t),
+                                                   max_draw_count(commands.size()), sizeof(VkDrawIndirectCommand));
+            return *this;
+        }
+
+        template<BufferView B, BufferView C>
+            requires std::same_as<typename B::value_type, VkDrawIndexedIndirectCommand> && std::same_as<typename C::value_type, uint32_t>
+        CommandBuffer& draw_indexed_indirect_count(const B& commands, const C& counts, uint32_t count_index = 0){
+            assert(self->in_render_pass && "Can't execute render pass dependant commands when no render pass has begun!");
+            assert(count_index < counts.size() && "Count index out of the count buffer's bounds!");
+            flush_barriers();
+            if(self->capture.is_valid()) capture_indirect_count(TraceOp::DRAW_INDEXED_INDIRECT_COUNT, commands, counts, count_index);
+            self->renderer.cmd_draw_indexed_indirect_count(self->cmdbuf, commands.vk_buffer(), commands.offsetb(),
+                                                           counts.vk_buffer(), counts.offsetb() + count_index * sizeof(uint32_t),
+                                                           max_draw_count(commands.size()), sizeof(VkDrawIndexedIndirectCommand));
+            return *this;
+        }
+
+        /* Dispatches with the group counts in commands[index]. */
+        template<BufferView B> requires std::same_as<typename B::value_type, VkDispatchIndirectCommand>
+        CommandBuffer& dispatch_indirect(const B& commands, uint32_t index = 0){
+            assert(self->recording && "Commands can't be  called without first calling begin()!");
+            assert(index < commands.size() && "Index out of the view's bounds!");
+            flush_barriers();
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::DISPATCH_INDIRECT, self->capture.buffer_id(commands),
+                           static_cast<VkDeviceSize>(commands.offsetb() + index * sizeof(VkDispatchIndirectCommand)));
+            }
+            vkCmdDispatchIndirect(self->cmdbuf, commands.vk_buffer(), commands.offsetb() + index * sizeof(VkDispatchIndirectCommand));
+            return *this;
+        }
+
+        /*
+         * Declares that the following commands use the image as 'usage'. The barrier needed to get there from the image's
+         * tracked state (nothing for a read after a read) is queued and all queued barriers go out as one
+         * vkCmdPipelineBarrier before the next draw, dispatch, copy or render pass. discard drops the image's contents.
+         * The state is tracked per command buffer: the barrier into the first use comes from the state earlier
+         * submissions left the image in and is recorded at submit(), so command buffers can be recorded in any order.
+         * Only primaries can require(), secondaries and CachedCommandBuffers are executed inside render passes anyway.
+         * Render passes move attachments to their final layout behind the tracker's back, set the layout through
+         * resource_state() after them.
+         */
+        CommandBuffer& require(const Image& image, ResourceUsage usage, bool discard = false){
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            assert(!self->in_render_pass && "Barriers can't be queued inside a render pass!");
+            assert(self->level == VK_COMMAND_BUFFER_LEVEL_PRIMARY && "require() is resolved at submit, only primaries can use it!");
+
+            auto& resource = tracked_resource(image.resource_state(), image.weak_ref(), image.vk_image(), image.aspect_mask());
+            if(track_first_use(resource, usage, discard)) return *this;
+
+            auto t = transition_resource_state(resource.state, usage, true, discard);
+            if(!t.needed) return *this;
+
+            queue_image_barrier(self->pending_barriers, t, image.vk_image(), image.aspect_mask());
+            return *this;
+        }
+
+        /*
+         * Buffer version of require(), buffers have no layout so reads never need a barrier between each other.
+         * Views without a tracked state of their own (a BufferRange) wait on every earlier write.
+         */
+        template<BufferView B>
+        CommandBuffer& require(const B& buffer, ResourceUsage usage){
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            assert(!self->in_render_pass && "Barriers can't be queued inside a render pass!");
+            assert(self->level == VK_COMMAND_BUFFER_LEVEL_PRIMARY && "require() is resolved at submit, only primaries can use it!");
+
+            ResourceTransition t = {};
+            if constexpr(requires { buffer.resource_state(); buffer.weak_ref(); }){
+                auto& resource = tracked_resource(buffer.resource_state(), buffer.weak_ref());
+                if(track_first_use(resource, usage, false)) return *this;
+                t = transition_resource_state(resource.state, usage, false);
+                if(!t.needed) return *this;
+            } else {
+                auto info = resource_usage_info(usage);
+                t = {VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, info.stages, VK_ACCESS_MEMORY_WRITE_BIT, info.access};
+            }
+
+            queue_memory_barrier(self->pending_barriers, t);
+            return *this;
+        }
+
+        /*
+         * This command buffer's view of the image's tracked state. Taken before the first require() of the image it starts
+         * from the shared state as of recording and the first barrier is recorded inline rather than at submit, which is
+         * only right for images nothing else uses in between, e.g. a RenderGraph's transients.
+         */
+        ResourceState& resource_state(const Image& image){
+            auto& resource = tracked_resource(image.resource_state(), image.weak_ref(), image.vk_image(), image.aspect_mask());
+            seed_resource(resource);
+            return resource.state;
+        }
+
+        template<BufferView B> requires requires(const B& b) { b.resource_state(); b.weak_ref(); }
+        ResourceState& resource_state(const B& buffer){
+            auto& resource = tracked_resource(buffer.resource_state(), buffer.weak_ref());
+            seed_resource(resource);
+            return resource.state;
+        }
+
+        /* Records every barrier queued by require(), called automatically before action commands. */
+        CommandBuffer& flush_barriers(){
+            auto& pending = self->pending_barriers;
+            if(pending.src_stage == 0) return *this;
+
+            pipeline_barrier(pending);
+            pending.src_stage = pending.dst_stage = 0;
+            pending.memory_barriers.clear();
+            pending.buffer_barriers.clear();
+            pending.image_barriers.clear();
+            return *this;
+        }
+
         CommandBuffer& pipeline_barrier(const PipelineBarrierInfo& info){
             assert(self->recording && "Commands can't be  called without first calling begin()!");
+            if(self->capture.is_valid()) capture_op(TraceOp::BARRIER);
             vkCmdPipelineBarrier(self->cmdbuf, info.src_stage, info.dst_stage, info.flags,
                                  info.memory_barriers.size(), info.memory_barriers.data(),
                                  info.buffer_barriers.size(), info.buffer_barriers.data(),
@@ -421,30 +1364,418 @@ namespace g_app {
             return *this;
         }
 
-        CommandBuffer& cmd(const std::function<void(CommandBuffer&)>& f){
+        /* vkCmdPipelineBarrier2, requires VulkanRenderer::has_synchronization2(). */
+        CommandBuffer& pipeline_barrier(const DependencyInfo& info){
+            assert(self->recording && "Commands can't be  called without first calling begin()!");
+            if(self->capture.is_valid()) capture_op(TraceOp::BARRIER);
+
+            VkDependencyInfo dependency_info = {VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+            dependency_info.dependencyFlags = info.flags;
+            dependency_info.memoryBarrierCount = info.memory_barriers.size();
+            dependency_info.pMemoryBarriers = info.memory_barriers.data();
+            dependency_info.bufferMemoryBarrierCount = info.buffer_barriers.size();
+            dependency_info.pBufferMemoryBarriers = info.buffer_barriers.data();
+            dependency_info.imageMemoryBarrierCount = info.image_barriers.size();
+            dependency_info.pImageMemoryBarriers = info.image_barriers.data();
+            self->renderer.cmd_pipeline_barrier2(self->cmdbuf, dependency_info);
+            return *this;
+        }
+
+        /*
+         * Also records the following commands into 'capture' until end_capture(), each submit() adds what was recorded
+         * since begin() to it. Capturing allocates, keep it out of measured frames. See CommandCapture.
+         */
+        CommandBuffer& begin_capture(const CommandCapture& capture){
+            assert(!self->recording && "Captures start with the next begin()!");
+            self->capture = capture;
+            self->capture_stream.clear();
+            return *this;
+        }
+        CommandBuffer& end_capture(){
+            self->capture = {};
+            self->capture_stream.clear();
+            return *this;
+        }
+
+        /*
+         * Starts a new GpuProfiler frame in this command buffer, following zones are recorded into that profiler.
+         * Must be called outside of a render pass, see GpuProfiler::begin_frame().
+         */
+        CommandBuffer& begin_profiling(const GpuProfiler& profiler){
+            assert(self->recording && "Commands can't be called without first calling begin()!");
+            assert(!self->in_render_pass && "Profiler queries can't be reset inside a render pass!");
+            self->profiler = profiler;
+            self->profiler.begin_frame(self->cmdbuf);
+            return *this;
+        }
+
+        /* Zones nest, each begin_zone() needs a matching end_zone(). No-ops without begin_profiling(). */
+        CommandBuffer& begin_zone(const std::string& name){
+            if(self->profiler.is_valid()) self->profiler.begin_zone(self->cmdbuf, name);
+            return *this;
+        }
+        CommandBuffer& end_zone(){
+            if(self->profiler.is_valid()) self->profiler.end_zone(self->cmdbuf);
+            return *this;
+        }
+
+        /* Callables are taken as templates so lambdas with captures don't go through a std::function. */
+        template<typename F> requires std::invocable<F&, CommandBuffer&>
+        CommandBuffer& cmd(F&& f){
             f(*this);
             return *this;
         }
 
-        CommandBuffer& vk_cmd(const std::function<void(VkCommandBuffer)>& f){
+        template<typename F> requires std::invocable<F&, VkCommandBuffer>
+        CommandBuffer& vk_cmd(F&& f){
+            if(self->capture.is_valid()) self->capture.skip_command();
             f(self->cmdbuf);
+            self->bound = {}; // Unknown commands may have bound anything
+            return *this;
+        }
+
+        /*
+         * Re-records the CachedCommandBuffer recording into this one once the object behind 'ref' is destroyed, for
+         * objects that were bound by raw handle. Does nothing outside of a CachedCommandBuffer.
+         */
+        CommandBuffer& depends_on(const std::weak_ptr<void>& ref){
+            if(self->dependencies && !ref.expired()) self->dependencies->push_back(ref);
             return *this;
         }
     private:
+        /* This command buffer's use of an image or buffer, applied to the shared ResourceState at submit(). */
+        struct TrackedResource {
+            ResourceState* shared = nullptr;
+            std::weak_ptr<void> owner = {};
+            VkImage image = VK_NULL_HANDLE; // VK_NULL_HANDLE for buffers
+            VkImageAspectFlags aspect_mask = 0;
+            bool used = false;
+            bool seeded = false;   // Started from the shared state by resource_state(), nothing is resolved at submit
+            bool discard = false;  // The first use drops the contents
+            ResourceUsageInfo first = {}; // Every use up to the first write, the submit's barrier waits for the others
+            ResourceState state = {};     // After the commands recorded so far
+        };
+
+        /* A generation counter and its value when recorded, see DescriptorSet::generation(). */
+        struct VersionedDependency {
+            std::weak_ptr<const uint64_t> generation;
+            uint64_t recorded = 0;
+        };
+
+        /* What is currently bound, used to drop redundant binds. Only graphics and compute are shadowed. */
+
+        struct BoundState {
+            static constexpr uint32_t BIND_POINTS = 2;
+            static constexpr uint32_t MAX_VERTEX_BINDINGS = 16;
+            static constexpr uint32_t MAX_SETS = 8;
+            static constexpr uint32_t MAX_DYNAMIC_OFFSETS = 16;
+            static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128; // Guaranteed minimum of maxPushConstantsSize
+
+            struct DescriptorSets {
+                VkPipelineLayout layout = VK_NULL_HANDLE;
+                std::array<VkDescriptorSet, MAX_SETS> sets = {};
+                uint32_t count = 0;
+                std::array<uint32_t, MAX_DYNAMIC_OFFSETS> dynamic_offsets = {};
+                uint32_t dynamic_offset_count = 0;
+            };
+
+            std::array<VkPipeline, BIND_POINTS> pipelines = {};
+            std::array<DescriptorSets, BIND_POINTS> descriptor_sets = {};
+            std::array<VkBuffer, MAX_VERTEX_BINDINGS> vertex_buffers = {};
+            std::array<VkDeviceSize, MAX_VERTEX_BINDINGS> vertex_offsets = {};
+            VkBuffer index_buffer = VK_NULL_HANDLE;
+            VkDeviceSize index_offset = 0;
+            VkIndexType index_type = VK_INDEX_TYPE_MAX_ENUM;
+            VkPipelineLayout push_layout = VK_NULL_HANDLE;
+            VkShaderStageFlags push_stages = 0;
+            std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> push_data = {};
+            uint32_t push_size = 0;
+        };
+
+        uint32_t max_draw_count(size_t count) const {
+            return static_cast<uint32_t>(std::min<size_t>(count, self->renderer.max_draw_indirect_count()));
+        }
+
+        /* The semaphores of a submission are copied into fixed arrays, more than they hold would overflow the stack. */
+        static void check_semaphore_counts(size_t wait_count, size_t signal_count){
+            if(wait_count > MAX_SUBMIT_SEMAPHORES || signal_count > MAX_SUBMIT_SEMAPHORES){
+                spdlog::error("A submission can wait on and signal at most {} semaphores each, got {} waits and {} signals!",
+                              MAX_SUBMIT_SEMAPHORES, wait_count, signal_count);
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        /* Keeps the capacity of color_formats so beginning rendering every frame doesn't reallocate it. */
+        void reset_inheritance(){
+            auto color_formats = std::move(self->inheritance.color_formats);
+            color_formats.clear();
+            self->inheritance = {};
+            self->inheritance.color_formats = std::move(color_formats);
+        }
+
+        TrackedResource& tracked_resource(ResourceState& shared, std::weak_ptr<void> owner,
+                                          VkImage image = VK_NULL_HANDLE, VkImageAspectFlags aspect_mask = 0){
+            auto& resources = self->resources;
+            auto it = std::find_if(resources.begin(), resources.end(), [&](const auto& r){ return r.shared == &shared; });
+            if(it != resources.end()) return *it;
+            resources.push_back({&shared, std::move(owner), image, aspect_mask});
+            return resources.back();
+        }
+
+        static void seed_resource(TrackedResource& resource){
+            if(resource.used) return;
+            resource.used = resource.seeded = true;
+            resource.state = *resource.shared;
+        }
+
+        /*
+         * Folds uses before the first write into the barrier submit() records ahead of the commands, returns false
+         * when the use needs a barrier of its own.
+         */
+        static bool track_first_use(TrackedResource& resource, ResourceUsage usage, bool discard){
+            if(resource.seeded) return false;
+
+            bool is_image = resource.image != VK_NULL_HANDLE;
+            auto info = resource_usage_info(usage);
+            if(!resource.used){
+                resource.used = true;
+                resource.discard = discard;
+                resource.first = info;
+                resource.state.layout = (is_image) ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+                transition_resource_state(resource.state, usage, is_image);
+                return true;
+            }
+
+            bool same_layout = !is_image || info.layout == resource.first.layout;
+            if(resource.first.write || resource.state.write_stages != 0 || info.write || !same_layout || discard) return false;
+            resource.first.stages |= info.stages;
+            resource.first.access |= info.access;
+            transition_resource_state(resource.state, usage, is_image);
+            return true;
+        }
+
+        static void queue_image_barrier(PipelineBarrierInfo& barriers, const ResourceTransition& t,
+                                        VkImage image, VkImageAspectFlags aspect_mask){
+            VkImageMemoryBarrier b = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            b.srcAccessMask = t.src_access;
+            b.dstAccessMask = t.dst_access;
+            b.oldLayout = t.old_layout;
+            b.newLayout = t.new_layout;
+            b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.image = image;
+            b.subresourceRange = {aspect_mask, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+
+            barriers.image_barriers.push_back(b);
+            barriers.src_stage |= t.src_stages;
+            barriers.dst_stage |= t.dst_stages;
+        }
+
+        /* Without a layout or ownership change a global memory barrier is as precise and cheaper to batch. */
+        static void queue_memory_barrier(PipelineBarrierInfo& barriers, const ResourceTransition& t){
+            auto& memory_barriers = barriers.memory_barriers;
+            if(memory_barriers.empty()) memory_barriers.push_back({VK_STRUCTURE_TYPE_MEMORY_BARRIER});
+            memory_barriers[0].srcAccessMask |= t.src_access;
+            memory_barriers[0].dstAccessMask |= t.dst_access;
+            barriers.src_stage |= t.src_stages;
+            barriers.dst_stage |= t.dst_stages;
+        }
+
+        /*
+         * Applies the tracked resources to their shared state in submission order and records the barriers into their
+         * first uses into the prologue command buffer. Returns the prologue, or VK_NULL_HANDLE when nothing needs one.
+         */
+        VkCommandBuffer resolve_resources(Queue queue){
+            PipelineBarrierInfo barriers = {};
+            for(auto& resource : self->resources){
+                auto owner = resource.owner.lock();
+                if(!owner) continue;
+                if(resource.seeded){
+                    *resource.shared = resource.state;
+                    continue;
+                }
+
+                bool is_image = resource.image != VK_NULL_HANDLE;
+                auto t = resolve_resource_state(*resource.shared, resource.first, resource.state, is_image, resource.discard);
+                if(!t.needed) continue;
+                if(is_image) queue_image_barrier(barriers, t, resource.image, resource.aspect_mask);
+                else         queue_memory_barrier(barriers, t);
+            }
+            self->resources.clear();
+            if(barriers.src_stage == 0) return VK_NULL_HANDLE;
+
+            auto inner = self->renderer.inner();
+            if(self->prologue == VK_NULL_HANDLE){
+                self->prologue_pool = self->renderer.command_pool(queue);
+                VkCommandBufferAllocateInfo alloc_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+                alloc_info.commandPool = self->prologue_pool;
+                alloc_info.commandBufferCount = 1;
+                alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+                VkResult result = VK_SUCCESS;
+                if((result = vkAllocateCommandBuffers(inner->device, &alloc_info, &self->prologue)) != VK_SUCCESS){
+                    spdlog::error("Failed to allocate a barrier command buffer! result = {}", static_cast<uint32_t>(result));
+                    std::exit(EXIT_FAILURE);
+                }
+            } else {
+                // begin() waited for the previous submission, which the prologue was part of
+                vkResetCommandBuffer(self->prologue, 0);
+            }
+
+            VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+            begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            vkBeginCommandBuffer(self->prologue, &begin_info);
+            vkCmdPipelineBarrier(self->prologue, barriers.src_stage, barriers.dst_stage, 0,
+                                 barriers.memory_barriers.size(), barriers.memory_barriers.data(),
+                                 0, nullptr,
+                                 barriers.image_barriers.size(), barriers.image_barriers.data());
+            vkEndCommandBuffer(self->prologue);
+            return self->prologue;
+        }
+
+        /* Adds the object to the dependencies of the CachedCommandBuffer recording into this one, if there is one. */
+        template<typename T>
+        void track(const T& object){
+            if(!self->dependencies) return;
+            if constexpr(requires { object.weak_ref(); }){
+                auto ref = object.weak_ref();
+                if(!ref.expired()) self->dependencies->push_back(std::move(ref));
+            }
+            // Descriptor sets can be rewritten in place and refer to resources that are never bound directly
+            if constexpr(requires { object.generation_ref(); }){
+                if(self->versioned_dependencies) self->versioned_dependencies->push_back({object.generation_ref(), object.generation()});
+            }
+            if constexpr(requires { object.descriptors(); }){
+                for(const auto& record : object.descriptors()){
+                    for(const auto& ref : record.refs){
+                        if(!ref.expired()) self->dependencies->push_back(ref);
+                    }
+                }
+            }
+        }
+
+        /* Appends a command and its arguments to the capture stream, see TraceOp. */
+        template<typename... Args>
+        void capture_op(TraceOp op, const Args&... args){
+            trace_write(self->capture_stream, op);
+            (trace_write(self->capture_stream, args), ...);
+        }
+
+        template<BufferView B, BufferView C>
+        void capture_indirect_count(TraceOp op, const B& commands, const C& counts, uint32_t count_index){
+            self->capture.add_flags(TRACE_USES_DRAW_INDIRECT_COUNT);
+            capture_op(op, self->capture.buffer_id(commands), static_cast<VkDeviceSize>(commands.offsetb()),
+                       static_cast<uint32_t>(commands.size()), self->capture.buffer_id(counts),
+                       static_cast<VkDeviceSize>(counts.offsetb() + count_index * sizeof(uint32_t)));
+        }
+
+        static uint32_t bind_point_index(VkPipelineBindPoint bind_point){
+            switch(bind_point){
+                case VK_PIPELINE_BIND_POINT_GRAPHICS: return 0;
+                case VK_PIPELINE_BIND_POINT_COMPUTE: return 1;
+                default: return BoundState::BIND_POINTS;
+            }
+        }
+
+        void bind_vertex_buffers(uint32_t count, const VkBuffer* buffers, const VkDeviceSize* offsets){
+            if(self->capture.is_valid()){
+                capture_op(TraceOp::BIND_VERTEX_BUFFERS, count);
+                for(uint32_t i = 0; i < count; i++){
+                    trace_write(self->capture_stream, self->capture.buffer_id(buffers[i]));
+                    trace_write(self->capture_stream, offsets[i]);
+                }
+            }
+
+            // Only the bindings from the first one that changed are rebound
+            auto& bound = self->bound;
+            uint32_t first = 0;
+            while(first < count && first < BoundState::MAX_VERTEX_BINDINGS &&
+                  bound.vertex_buffers[first] == buffers[first] && bound.vertex_offsets[first] == offsets[first]) first++;
+            if(first == count){
+                self->bind_stats.skipped_vertex_buffer_binds++;
+                return;
+            }
+
+            vkCmdBindVertexBuffers(self->cmdbuf, first, count - first, buffers + first, offsets + first);
+            for(uint32_t i = first; i < count && i < BoundState::MAX_VERTEX_BINDINGS; i++){
+                bound.vertex_buffers[i] = buffers[i];
+                bound.vertex_offsets[i] = offsets[i];
+            }
+            self->bind_stats.vertex_buffer_binds++;
+        }
+
+        CommandBuffer(const VulkanRenderer& renderer, VkCommandPool pool, uint32_t queue_family, VkCommandBufferLevel level,
+                      bool pool_owned): self{std::make_shared<Inner>(renderer)}
+        {
+            auto inner = self->renderer.inner();
+            self->pool = pool;
+            self->queue_family = queue_family;
+            self->level = level;
+            self->pool_owned = pool_owned;
+
+            VkCommandBufferAllocateInfo alloc_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+            alloc_info.commandPool = self->pool;
+            alloc_info.commandBufferCount = 1;
+            alloc_info.level = level;
+
+            VkResult result = VK_SUCCESS;
+            if((result = vkAllocateCommandBuffers(inner->device, &alloc_info, &self->cmdbuf)) != VK_SUCCESS){
+                spdlog::error("Failed to allocate single use command buffers! result = {}", static_cast<uint32_t>(result));
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
         struct Inner {
             VulkanRenderer renderer;
             VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
+            VkCommandPool pool = VK_NULL_HANDLE;
+            uint32_t queue_family = 0;
+            VkCommandBufferLevel level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            bool pool_owned = false; // Freed with its pool instead of by the destructor
             bool recording = false;
-            bool in_render_pass = false;
+            bool in_render_pass = false; // Also set between begin_rendering() and end_rendering()
+            bool dynamic_rendering = false;
+            bool default_rendering = false; // Rendering into the swapchain image through begin_default_rendering()
+            bool continues_render_pass = false; // Secondary begun with begin_secondary()
+            CommandBufferInheritance inheritance = {}; // Of the current render pass
+            SubmitTicket pending = {};
+            GpuProfiler profiler = {};
+            PipelineBarrierInfo pending_barriers = {}; // Queued by require()
+            std::deque<TrackedResource> resources = {}; // require()d since begin(), resolved at submit(). Stable references
+            VkCommandBuffer prologue = VK_NULL_HANDLE;   // Barriers into the first uses of 'resources'
+            VkCommandPool prologue_pool = VK_NULL_HANDLE;
+            BoundState bound = {};
+            BindStats bind_stats = {};
+            std::vector<std::weak_ptr<void>>* dependencies = nullptr; // Set while a CachedCommandBuffer records into it
+            std::vector<VersionedDependency>* versioned_dependencies = nullptr; // Likewise
+            CommandCapture capture = {}; // Set between begin_capture() and end_capture()
+            std::vector<uint8_t> capture_stream = {}; // Commands captured since begin()
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
+                pending.wait(); // Can't free a command buffer the GPU is still executing
                 auto inner = renderer.inner();
-                vkFreeCommandBuffers(inner->device, inner->command_pool, 1, &cmdbuf);
+                if(prologue != VK_NULL_HANDLE) vkFreeCommandBuffers(inner->device, prologue_pool, 1, &prologue);
+                if(pool_owned) return;
+                vkFreeCommandBuffers(inner->device, pool, 1, &cmdbuf);
             }
         };
 
         std::shared_ptr<Inner> self;
+
+        friend class CachedCommandBuffer;
+    };
+
+    /* Begins a profiler zone on construction and ends it when it goes out of scope. */
+    class ProfileScope {
+    public:
+        ProfileScope(CommandBuffer cmd, const std::string& name): m_cmd{std::move(cmd)} { m_cmd.begin_zone(name); }
+        ~ProfileScope() { m_cmd.end_zone(); }
+
+        ProfileScope(const ProfileScope&) = delete;
+        ProfileScope& operator = (const ProfileScope&) = delete;
+    private:
+        CommandBuffer m_cmd;
     };
 }
@@ -0,0 +1,301 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+#include "image.hpp"
+#include "descriptor.hpp"
+#include "pipeline.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <span>
+#include <type_traits>
+#include <unordered_map>
+
+namespace g_app {
+    /*
+     * Trace layout written by CommandCapture::save() and read by CommandTrace::load(), all values in host byte order:
+     *   header          TRACE_MAGIC, TRACE_VERSION, flags, extent, swapchain and depth format
+     *   buffers         count, then size, host visible and size bytes of contents per buffer (zeroed when not host visible)
+     *   images          count, then type, format, extent, mip levels, layers, samples, usage and the texels of every
+     *                   mip level, if they could be read back
+     *   samplers        count, then the create info of each sampler field by field
+     *   set layouts     count, then flags and bindings of each layout
+     *   descriptor sets count, then layout and descriptors of each set, see CommandCapture::descriptor_set_id()
+     *   pipelines       count, then kind, label, set layouts and the recipe of each pipeline
+     *   submissions     count, then queue and a stream of TraceOps per submission
+     * Resources are referenced by their index. Info structs are stored as-is, bump TRACE_VERSION when they change.
+     */
+    constexpr char     TRACE_MAGIC[8] = {'G', 'A', 'P', 'P', 'T', 'R', 'C', 'E'};
+    constexpr uint32_t TRACE_VERSION = 3;
+    constexpr uint32_t TRACE_INVALID_ID = ~0u;
+
+    enum TraceFlags : uint32_t {
+        TRACE_USES_DYNAMIC_RENDERING    = 1 << 0,
+        TRACE_USES_DRAW_INDIRECT_COUNT  = 1 << 1,
+        TRACE_SKIPPED_COMMANDS          = 1 << 2, // Some recorded work couldn't be captured, see CaptureStats
+    };
+
+    enum class TracePipelineKind : uint8_t {
+        UNSUPPORTED = 0,
+        GRAPHICS = 1,
+        COMPUTE = 2,
+    };
+
+    enum class TraceRenderTarget : uint8_t {
+        DEFAULT_RENDER_PASS = 0,
+        RENDERING_FORMATS = 1,
+    };
+
+    /* Commands, followed by their arguments in the order of the CommandBuffer call that recorded them. */
+    enum class TraceOp : uint8_t {
+        BEGIN_DEFAULT_RENDER_PASS,   // f32 r, g, b, a
+        BEGIN_DEFAULT_RENDERING,     // f32 r, g, b, a
+        BEGIN_UNSUPPORTED_PASS,      // Render pass or rendering into other images, skipped until its end
+        END_RENDER_PASS,
+        END_RENDERING,
+        BIND_PIPELINE,               // u32 pipeline, u32 bind point
+        BIND_VERTEX_BUFFERS,         // u32 count, count * (u32 buffer, u64 offset in bytes)
+        BIND_INDEX_BUFFER,           // u32 buffer, u64 offset in bytes, u32 index type
+        PUSH_CONSTANTS,              // u32 pipeline, u32 stages, u32 size, size bytes
+        BARRIER,                     // Replayed as a full memory barrier
+        DRAW,                        // u32 vertex count, instance count, first vertex, first instance
+        DRAW_INDEXED,                // u32 index count, instance count, first index, i32 vertex offset, u32 first instance
+        DRAW_INDIRECT,               // u32 buffer, u64 offset, u32 count
+        DRAW_INDEXED_INDIRECT,       // u32 buffer, u64 offset, u32 count
+        DRAW_INDIRECT_COUNT,         // u32 buffer, u64 offset, u32 max count, u32 count buffer, u64 count offset
+        DRAW_INDEXED_INDIRECT_COUNT, // u32 buffer, u64 offset, u32 max count, u32 count buffer, u64 count offset
+        DISPATCH,                    // u32 x, y, z
+        DISPATCH_INDIRECT,           // u32 buffer, u64 offset
+        BIND_DESCRIPTOR_SETS,        // u32 pipeline, u32 bind point, u32 count, count * u32 set, u32 count, count * u32 offset
+        COPY_BUFFER,                 // u32 src, u64 src offset, u32 dst, u64 dst offset, u64 size, offsets in bytes
+        COPY_BUFFER_TO_IMAGE,        // u32 buffer, u32 image, VkBufferImageCopy
+    };
+
+    /* Descriptors written with a VkDescriptorBufferInfo, the others a trace can hold use a VkDescriptorImageInfo. */
+    constexpr bool trace_is_buffer_descriptor(VkDescriptorType type){
+        return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+               type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    }
+
+    constexpr bool trace_is_image_descriptor(VkDescriptorType type){
+        return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+               type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+               type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+    }
+
+    template<typename T> requires std::is_trivially_copyable_v<T>
+    void trace_write(std::vector<uint8_t>& out, const T& value){
+        auto size = out.size();
+        out.resize(size + sizeof(T));
+        std::memcpy(out.data() + size, &value, sizeof(T));
+    }
+
+    inline void trace_write_bytes(std::vector<uint8_t>& out, const void* data, size_t size){
+        auto bytes = reinterpret_cast<const uint8_t*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    inline void trace_write_string(std::vector<uint8_t>& out, const std::string& str){
+        trace_write(out, static_cast<uint32_t>(str.size()));
+        trace_write_bytes(out, str.data(), str.size());
+    }
+
+    struct CaptureStats {
+        uint32_t submissions = 0;
+        uint32_t buffers = 0;
+        uint32_t unreadable_buffers = 0;    // Not host visible, replayed with zeroed contents
+        uint32_t images = 0;
+        uint32_t samplers = 0;
+        uint32_t descriptor_sets = 0;       // One per set and generation bound
+        uint32_t unsupported_descriptor_sets = 0; // Replayed draws and dispatches using them are skipped
+        uint32_t pipelines = 0;
+        uint32_t unsupported_pipelines = 0; // Replayed draws and dispatches using them are skipped
+        uint32_t skipped_commands = 0;      // Commands the trace can't express, e.g. vk_cmd() or draw_imgui()
+    };
+
+    class CommandCaptureInit;
+
+    /*
+     * Collects what CommandBuffers record between CommandBuffer::begin_capture() and end_capture() into a trace that a
+     * CommandReplay can run headlessly, e.g. to benchmark g_app itself without the application that recorded it.
+     *
+     * Buffers are identified by their VkBuffer and captured from offset 0 to the end of the furthest view referencing
+     * them, with the contents they had when a reference first reached them. Only host visible memory can be read, other
+     * buffers are replayed zeroed. Images reached through descriptor sets or copies are read back by save(), with the
+     * contents they have at that point, for the formats format_texel_size() knows. Copies are captured, vk_cmd(),
+     * draw_imgui() and passes into other images aren't.
+     * Descriptor sets are captured with what DescriptorWriter last wrote to them when they are bound, a set rewritten
+     * between binds becomes a new set in the trace. Set layouts with immutable samplers or push descriptors aren't
+     * supported. Pipelines need VulkanRendererInit::enable_command_capture() and are only supported with supported
+     * set layouts, built for the default render pass or dynamic rendering. Secondary command buffers are inlined into
+     * the primary that executes them. Captured objects are kept alive until the capture is cleared or destroyed.
+     *
+     * Thread safe, command buffers recording on several threads can share one capture.
+     */
+    class CommandCapture {
+    public:
+        CommandCapture() = default;
+
+        /*
+         * Index of the buffer in the trace, capturing its contents up to the end of the view. Also call it with the owning
+         * Buffer of anything bound by handle or through a BufferRange (e.g. IndirectCommandStream::buffer()), so the
+         * buffer gets its size and persistently mapped contents can be read.
+         */
+        template<BufferView B>
+        uint32_t buffer_id(const B& view){
+            return buffer_id(buffer_source(view));
+        }
+
+        uint32_t buffer_id(const BufferSource& source){
+            std::lock_guard lock(self->mutex);
+            return add_buffer(source);
+        }
+
+        /* Index of a buffer only known by its handle, it keeps whatever size views of it have given it. */
+        uint32_t buffer_id(VkBuffer buffer){
+            std::lock_guard lock(self->mutex);
+            return find_buffer(buffer);
+        }
+
+        /* Index of the image in the trace, its contents are read back by save(). */
+        uint32_t image_id(const Image& image){
+            std::lock_guard lock(self->mutex);
+            return add_image(image);
+        }
+
+        /*
+         * Index of the set with what was last written to it, or TRACE_INVALID_ID if its layout isn't supported or a
+         * resource it refers to has been destroyed.
+         */
+        uint32_t descriptor_set_id(const DescriptorSet& set);
+
+        /* Index of the pipeline in the trace, its recipe is written the first time it is seen. */
+        uint32_t pipeline_id(const Pipeline& pipeline);
+
+        /* Called by CommandBuffer::submit() with the commands recorded since begin(). */
+        void add_submission(Queue queue, std::span<const uint8_t> commands);
+
+        void add_flags(uint32_t flags) { self->flags.fetch_or(flags, std::memory_order_relaxed); }
+        void skip_command(){
+            self->skipped_commands.fetch_add(1, std::memory_order_relaxed);
+            add_flags(TRACE_SKIPPED_COMMANDS);
+        }
+
+        /*
+         * Writes the trace, returns false if the file couldn't be written. Waits for the device to be idle to read
+         * the captured images back, call it from the thread submitting to the graphics queue.
+         */
+        bool save(const std::string& path) const;
+        /* Drops everything captured so far and releases the captured objects. No command buffer may be capturing. */
+        void clear();
+
+        CaptureStats stats() const;
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            std::string label = "unnamed command capture";
+        };
+
+        struct CapturedBuffer {
+            std::vector<uint8_t> contents = {};
+            bool host_visible = true; // Contents could be read
+            std::shared_ptr<void> keep_alive = nullptr;
+            const uint8_t* host_base = nullptr; // Mapping of a persistently mapped Buffer, for views without one
+            VkDeviceSize host_size = 0;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            std::mutex mutex;
+            std::unordered_map<VkBuffer, uint32_t> buffer_ids = {};
+            std::vector<CapturedBuffer> buffers = {};
+            std::unordered_map<VkImage, uint32_t> image_ids = {};
+            std::vector<Image> images = {};
+            std::unordered_map<VkSampler, uint32_t> sampler_ids = {};
+            std::vector<Sampler> samplers = {};
+            std::unordered_map<VkDescriptorSetLayout, uint32_t> set_layout_ids = {};
+            std::vector<DescriptorSetLayout> set_layouts = {};
+            std::map<std::pair<VkDescriptorSet, uint64_t>, uint32_t> descriptor_set_ids = {}; // Set and generation
+            std::vector<std::vector<uint8_t>> descriptor_sets = {}; // Serialised layouts and descriptors
+            std::vector<std::shared_ptr<void>> descriptor_set_refs = {};
+            uint32_t unsupported_descriptor_sets = 0;
+            std::unordered_map<VkPipeline, uint32_t> pipeline_ids = {};
+            std::vector<std::vector<uint8_t>> pipelines = {}; // Serialised recipes
+            std::vector<std::shared_ptr<void>> pipeline_refs = {};
+            uint32_t unsupported_pipelines = 0;
+            std::vector<uint8_t> submissions = {};
+            uint32_t submission_count = 0;
+            std::atomic<uint32_t> flags = 0;
+            std::atomic<uint32_t> skipped_commands = 0;
+            std::string label;
+        };
+
+        std::shared_ptr<Inner> self;
+
+        CommandCapture(VulkanRenderer renderer, const Config& config);
+        // Called with 'mutex' held
+        uint32_t find_buffer(VkBuffer buffer);
+        uint32_t add_buffer(const BufferSource& source);
+        uint32_t add_image(const Image& image);
+        uint32_t add_sampler(const Sampler& sampler);
+        uint32_t add_set_layout(const DescriptorSetLayout& layout); // TRACE_INVALID_ID if unsupported
+        static void grow_buffer(CapturedBuffer& captured, VkDeviceSize end, const uint8_t* base);
+        static void write_module(std::vector<uint8_t>& out, const ShaderModule& module);
+        std::vector<std::vector<uint8_t>> read_back_images() const; // Indexed like images, empty where unreadable
+
+        friend class CommandCaptureInit;
+    };
+
+    class CommandCaptureInit {
+    public:
+        CommandCaptureInit() = default;
+
+        CommandCaptureInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        CommandCapture init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        CommandCapture::Config m_config = {};
+    };
+}
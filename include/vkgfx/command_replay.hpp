@@ -0,0 +1,282 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+#include "image.hpp"
+#include "descriptor.hpp"
+#include "pipeline.hpp"
+#include "command_buffer.hpp"
+#include "command_capture.hpp"
+#include "per_frame.hpp"
+
+#include <optional>
+#include <algorithm>
+#include <map>
+#include <tuple>
+
+namespace g_app {
+    class CommandReplay;
+
+    /* A trace written by CommandCapture::save(), parsed and validated but not yet turned into Vulkan objects. */
+    class CommandTrace {
+    public:
+        CommandTrace() = default;
+
+        /* Exits with an error if the file can't be read or wasn't written with this TRACE_VERSION. */
+        static CommandTrace load(const std::string& path){
+            try {
+                return CommandTrace(path);
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        /* Swapchain extent of the captured renderer, replay with a headless renderer of the same size. */
+        VkExtent2D extent() const { return self->extent; }
+        bool uses_dynamic_rendering() const { return self->flags & TRACE_USES_DYNAMIC_RENDERING; }
+        bool uses_draw_indirect_count() const { return self->flags & TRACE_USES_DRAW_INDIRECT_COUNT; }
+        uint32_t buffer_count() const { return static_cast<uint32_t>(self->buffers.size()); }
+        uint32_t image_count() const { return static_cast<uint32_t>(self->images.size()); }
+        uint32_t descriptor_set_count() const { return static_cast<uint32_t>(self->descriptor_sets.size()); }
+        uint32_t pipeline_count() const { return static_cast<uint32_t>(self->pipelines.size()); }
+        uint32_t submission_count() const { return static_cast<uint32_t>(self->submissions.size()); }
+        /* Pipelines that couldn't be captured, e.g. ones using push descriptors. Draws using them aren't replayed. */
+        uint32_t unsupported_pipeline_count() const {
+            return static_cast<uint32_t>(std::count_if(self->pipelines.begin(), self->pipelines.end(), [](const auto& pipeline){
+                return pipeline.kind == TracePipelineKind::UNSUPPORTED;
+            }));
+        }
+        /* Commands were skipped while capturing (vk_cmd(), draw_imgui(), passes into other images, unsupported sets). */
+        bool has_skipped_commands() const { return self->flags & TRACE_SKIPPED_COMMANDS; }
+        /* Replaying it runs exactly the captured work, so its timings can be compared. */
+        bool is_complete() const { return unsupported_pipeline_count() == 0 && !has_skipped_commands(); }
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct TracedBuffer {
+            std::vector<uint8_t> contents = {};
+            bool host_visible = true;
+        };
+
+        struct TracedImage {
+            VkImageType image_type = VK_IMAGE_TYPE_2D;
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            VkExtent3D extent = {};
+            uint32_t mip_levels = 1;
+            uint32_t layer_count = 1;
+            VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+            VkImageUsageFlags usage = 0;
+            std::vector<uint8_t> contents = {}; // Empty if it couldn't be read back
+        };
+
+        struct TracedSetLayout {
+            VkDescriptorSetLayoutCreateFlags flags = 0;
+            std::vector<VkDescriptorSetLayoutBinding> bindings = {};
+        };
+
+        struct TracedDescriptor {
+            uint32_t binding = 0;
+            VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            uint32_t buffer = TRACE_INVALID_ID;
+            VkDeviceSize offset = 0;
+            VkDeviceSize range = 0;
+            uint32_t image = TRACE_INVALID_ID;
+            VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D;
+            VkImageAspectFlags aspect_mask = 0;
+            uint32_t sampler = TRACE_INVALID_ID;
+        };
+
+        struct TracedDescriptorSet {
+            uint32_t layout = 0;
+            std::vector<TracedDescriptor> descriptors = {};
+        };
+
+        struct TracedModule {
+            VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+            std::string entry;
+            std::vector<char> src = {};
+        };
+
+        struct TracedPipeline {
+            TracePipelineKind kind = TracePipelineKind::UNSUPPORTED;
+            std::string label;
+            std::vector<uint32_t> set_layouts = {};
+            std::vector<TracedModule> modules = {}; // One for compute pipelines
+            std::vector<VkPushConstantRange> push_constants = {};
+            std::vector<VertexBinding> bindings = {};
+            TraceRenderTarget target = TraceRenderTarget::DEFAULT_RENDER_PASS;
+            uint32_t subpass = 0;
+            std::vector<VkFormat> color_formats = {};
+            VkFormat depth_format = VK_FORMAT_UNDEFINED;
+            VkFormat stencil_format = VK_FORMAT_UNDEFINED;
+            VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+            RasterizationInfo rasterization_info;
+            VkSampleCountFlagBits sample_count = VK_SAMPLE_COUNT_1_BIT;
+            BlendInfo blend_info;
+            DepthStencilInfo depth_stencil_info;
+        };
+
+        struct TracedSubmission {
+            Queue queue = Queue::GRAPHICS;
+            std::vector<uint8_t> commands = {}; // TraceOps
+        };
+
+        struct Inner {
+            uint32_t flags = 0;
+            VkExtent2D extent = {};
+            VkFormat swapchain_format = VK_FORMAT_UNDEFINED;
+            VkFormat depth_format = VK_FORMAT_UNDEFINED;
+            std::vector<TracedBuffer> buffers = {};
+            std::vector<TracedImage> images = {};
+            std::vector<VkSamplerCreateInfo> samplers = {};
+            std::vector<TracedSetLayout> set_layouts = {};
+            std::vector<TracedDescriptorSet> descriptor_sets = {};
+            std::vector<TracedPipeline> pipelines = {};
+            std::vector<TracedSubmission> submissions = {};
+        };
+
+        std::shared_ptr<const Inner> self;
+
+        explicit CommandTrace(const std::string& path);
+
+        friend class CommandReplay;
+    };
+
+    struct ReplayTimings {
+        std::vector<double> cpu_record_ms = {}; // One sample per replayed submission, recording through CommandBuffer
+        std::vector<double> cpu_submit_ms = {}; // CommandBuffer::submit()
+        std::vector<double> gpu_ms = {};        // From the start to the end of the command buffer, empty without timestamps
+        uint32_t skipped_commands = 0;          // Commands whose pipeline, buffers or descriptor sets couldn't be recreated
+    };
+
+    class CommandReplayInit;
+
+    /*
+     * Recreates the buffers, images, descriptor sets and pipelines of a CommandTrace and re-records its submissions
+     * through CommandBuffer, so changes to g_app's recording and submission paths can be measured against the same
+     * command stream. Images are kept in VK_IMAGE_LAYOUT_GENERAL, so captured layout transitions replay as barriers.
+     *
+     *   auto trace = CommandTrace::load("frame.gtrace");
+     *   auto renderer = VulkanRendererInit().set_headless(trace.extent().width, trace.extent().height).init();
+     *   auto replay = CommandReplayInit().set_trace(trace).init(renderer);
+     *   auto timings = replay.run(100);
+     *
+     * Every submission is replayed as one frame on the graphics queue, waiting for the swapchain image and signalling
+     * the frame's semaphores and fence. Commands the trace couldn't capture are missing, see CommandCapture and
+     * CommandTrace::is_complete().
+     */
+    class CommandReplay {
+    public:
+        CommandReplay() = default;
+
+        /* Replays every submission 'iterations' times and returns the timings of all of them. */
+        ReplayTimings run(uint32_t iterations);
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            CommandTrace trace = {};
+            std::string label = "unnamed command replay";
+        };
+
+        struct Frame {
+            CommandBuffer cmd;
+            bool timed = false; // Its timestamp queries hold results that haven't been read yet
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            CommandTrace trace;
+            std::vector<Buffer<uint8_t>> buffers = {};
+            std::vector<VkBuffer> vk_buffers = {};            // VK_NULL_HANDLE for buffers that were never sized
+            std::vector<Image> images = {};
+            std::map<std::tuple<uint32_t, VkImageViewType, VkImageAspectFlags>, ImageView> image_views = {}; // By image
+            std::vector<Sampler> samplers = {};
+            std::vector<DescriptorSetLayout> set_layouts = {};
+            DescriptorPool descriptor_pool = {};
+            std::vector<std::optional<DescriptorSet>> descriptor_sets = {}; // Empty if a buffer they use was never sized
+            std::vector<std::optional<Pipeline>> pipelines = {}; // Empty for unsupported pipelines
+            PerFrame<Frame> frames = {};
+            VkQueryPool query_pool = VK_NULL_HANDLE;           // Two timestamps per frame in flight
+            double timestamp_period = 1.0;
+            PipelineBarrierInfo barrier = {};
+            std::string label;
+
+            ~Inner(){
+                if(!renderer.is_valid()) return;
+
+                renderer.defer_destroy([device = renderer.inner()->device, pool = query_pool](){
+                    if(pool != VK_NULL_HANDLE) vkDestroyQueryPool(device, pool, nullptr);
+                });
+            }
+        };
+
+        std::shared_ptr<Inner> self;
+
+        CommandReplay(VulkanRenderer renderer, const Config& config);
+        void create_images();
+        void create_descriptor_sets();
+        const ImageView& image_view(const CommandTrace::TracedDescriptor& traced);
+        void create_pipeline(const CommandTrace::TracedPipeline& traced);
+        uint32_t replay(CommandBuffer& cmd, const std::vector<uint8_t>& commands);
+        void resolve_timestamps(uint32_t frame, ReplayTimings& timings);
+
+        friend class CommandReplayInit;
+    };
+
+    class CommandReplayInit {
+    public:
+        CommandReplayInit() = default;
+
+        CommandReplayInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        CommandReplayInit& set_trace(const CommandTrace& trace){
+            m_config.trace = trace;
+            return *this;
+        }
+
+        CommandReplay init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        CommandReplay::Config m_config = {};
+    };
+}
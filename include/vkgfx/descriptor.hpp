@@ -34,6 +34,9 @@
 #include "image.hpp"
 #include "buffer.hpp"
 
+#include <array>
+#include <span>
+
 namespace g_app {
     class DescriptorPoolInit;
     class DescriptorSetLayoutInit;
@@ -53,12 +56,16 @@ namespace g_app {
         struct Inner {
             VulkanRenderer renderer;
             VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+            std::vector<VkDescriptorSetLayoutBinding> bindings = {}; // For CommandCapture
+            VkDescriptorSetLayoutCreateFlags flags = 0;
             std::string label;
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroyDescriptorSetLayout(renderer.inner()->device, layout, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, layout = layout](){
+                    vkDestroyDescriptorSetLayout(device, layout, nullptr);
+                });
             }
         };
 
@@ -67,6 +74,7 @@ namespace g_app {
         DescriptorSetLayout(VulkanRenderer renderer, const Config& config);
 
         friend class DescriptorSetLayoutInit;
+        friend class CommandCapture;
     };
 
     class DescriptorSetLayoutInit {
@@ -107,25 +115,60 @@ namespace g_app {
         DescriptorSetLayout::Config m_config = {};
     };
 
+    /* What a DescriptorWriter last wrote to a binding of a set, see DescriptorSet::descriptors(). */
+    struct DescriptorRecord {
+        uint32_t binding = 0;
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        VkDescriptorBufferInfo buffer = {};
+        BufferSource buffer_source = {}; // Up to the end of the written range
+        VkDescriptorImageInfo image = {};
+        std::array<std::weak_ptr<void>, 2> refs = {}; // Buffer, or image view and sampler
+    };
+
     class DescriptorPool;
     class DescriptorSet {
     public:
         DescriptorSet() = default;
 
         VkDescriptorSet vk_descriptor_set() const { return (self) ? self->set : VK_NULL_HANDLE; }
+        std::weak_ptr<void> weak_ref() const { return self; }
+
+        /* Bumped every time a DescriptorWriter commits a write or copy into the set. */
+        uint64_t generation() const { return self->generation; }
+        /* Shares ownership with the set, expires with it. */
+        std::weak_ptr<const uint64_t> generation_ref() const {
+            return std::shared_ptr<const uint64_t>(self, &self->generation);
+        }
+        /* The buffers, image views and samplers last written to each binding. */
+        const std::vector<DescriptorRecord>& descriptors() const { return self->descriptors; }
+        const DescriptorSetLayout& layout() const { return self->layout; }
 
     private:
         struct Inner {
             VulkanRenderer renderer;
             VkDescriptorSet set = VK_NULL_HANDLE;
+            DescriptorSetLayout layout = {};
             std::string label;
+            uint64_t generation = 0;
+            std::vector<DescriptorRecord> descriptors = {};
         };
 
         std::shared_ptr<Inner> self;
 
-        DescriptorSet(const VulkanRenderer& renderer, VkDescriptorSet set, const std::string& label);
+        DescriptorSet(const VulkanRenderer& renderer, VkDescriptorSet set, const DescriptorSetLayout& layout,
+                      const std::string& label);
+
+        /* Replaces what 'binding' refers to, called by DescriptorWriter::commit_writes(). */
+        void set_descriptors(uint32_t binding, std::span<const DescriptorRecord> records){
+            std::erase_if(self->descriptors, [binding](const auto& record){ return record.binding == binding; });
+            for(auto record : records){
+                record.binding = binding;
+                self->descriptors.push_back(std::move(record));
+            }
+        }
 
         friend class DescriptorPool;
+        friend class DescriptorWriter;
     };
 
     class DescriptorPool {
@@ -171,8 +214,8 @@ namespace g_app {
 
             std::vector<DescriptorSet> sets;
             sets.reserve(vk_sets.size());
-            for(auto set : vk_sets){
-                sets.push_back({self->renderer, set, std::format("Descriptor Set: pool = {}", self->label)});
+            for(size_t i = 0; i < vk_sets.size(); i++){
+                sets.push_back({self->renderer, vk_sets[i], layouts[i], std::format("Descriptor Set: pool = {}", self->label)});
             }
 
             return sets;
@@ -193,7 +236,9 @@ namespace g_app {
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroyDescriptorPool(renderer.inner()->device, pool, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, pool = pool](){
+                    vkDestroyDescriptorPool(device, pool, nullptr);
+                });
             }
         };
 
@@ -244,14 +289,18 @@ namespace g_app {
     public:
         DescriptorWriter() = default;
 
-        template<typename T>
+        /*
+         * offset and range are in bytes, a range of 0 covers the rest of the buffer.
+         * Dynamic descriptors (e.g. a UniformAllocator's buffer) need the range of a single slice.
+         */
+        template<BufferView B>
         DescriptorWriter& write_buffer(const DescriptorSet& dst, uint32_t binding, VkDescriptorType type,
-                                       const Buffer<T>& buffer, VkDeviceSize offset=0){
+                                       const B& buffer, VkDeviceSize offset=0, VkDeviceSize range=0){
             m_buffer_infos.push_back(std::make_shared<VkDescriptorBufferInfo>());
             auto& info = m_buffer_infos[m_buffer_infos.size()-1];
             info->buffer = buffer.vk_buffer();
-            info->offset = offset;
-            info->range = buffer.size() * sizeof(T);
+            info->offset = buffer.offsetb() + offset;
+            info->range = (range > 0) ? range : buffer.sizeb() - offset;
 
             VkWriteDescriptorSet write = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
             write.dstSet = dst.vk_descriptor_set();
@@ -261,7 +310,15 @@ namespace g_app {
             write.descriptorCount = 1;
             write.pBufferInfo = info.get();
 
+            DescriptorRecord record = {};
+            record.type = type;
+            record.buffer = *info;
+            record.buffer_source = buffer_source(buffer);
+            record.buffer_source.end = info->offset + info->range;
+            record.refs[0] = record.buffer_source.owner;
+
             m_writes.push_back(write);
+            m_write_targets.push_back({dst, binding, record});
 
             return *this;
         }
@@ -283,7 +340,13 @@ namespace g_app {
             write.descriptorCount = 1;
             write.pImageInfo = info.get();
 
+            DescriptorRecord record = {};
+            record.type = type;
+            record.image = *info;
+            record.refs = {image_view.weak_ref(), sampler.weak_ref()};
+
             m_writes.push_back(write);
+            m_write_targets.push_back({dst, binding, record});
 
             return *this;
         }
@@ -299,22 +362,55 @@ namespace g_app {
             copy.descriptorCount = 1;
 
             m_copies.push_back(copy);
+            m_copy_targets.push_back({dst, dst_binding, src, src_binding});
 
             return *this;
         }
 
+        /* Also bumps the generation of every set written, so CachedCommandBuffers that bound them re-record. */
         void commit_writes(VulkanRenderer renderer){
             vkUpdateDescriptorSets(
                     renderer.inner()->device, m_writes.size(), m_writes.data(),
                     m_copies.size(), m_copies.data());
+
+            // Copies are applied after the writes, like vkUpdateDescriptorSets does
+            for(auto& target : m_write_targets){
+                if(!target.set.self) continue;
+                target.set.set_descriptors(target.binding, std::span(&target.record, 1));
+                target.set.self->generation++;
+            }
+            for(auto& copy : m_copy_targets){
+                if(!copy.dst.self || !copy.src.self) continue;
+                std::vector<DescriptorRecord> records = {};
+                for(const auto& record : copy.src.descriptors()){
+                    if(record.binding == copy.src_binding) records.push_back(record);
+                }
+                copy.dst.set_descriptors(copy.dst_binding, records);
+                copy.dst.self->generation++;
+            }
         }
         
         std::vector<VkWriteDescriptorSet>& get_writes(){ return m_writes; }
     private:
+        struct WriteTarget {
+            DescriptorSet set;
+            uint32_t binding = 0;
+            DescriptorRecord record = {};
+        };
+
+        struct CopyTarget {
+            DescriptorSet dst;
+            uint32_t dst_binding = 0;
+            DescriptorSet src;
+            uint32_t src_binding = 0;
+        };
+
         std::vector<std::shared_ptr<VkDescriptorBufferInfo>> m_buffer_infos = {};
         std::vector<std::shared_ptr<VkDescriptorImageInfo>> m_image_infos = {};
         std::vector<VkWriteDescriptorSet> m_writes = {};
         std::vector<VkCopyDescriptorSet> m_copies = {};
+        std::vector<WriteTarget> m_write_targets = {}; // Parallel to m_writes
+        std::vector<CopyTarget> m_copy_targets = {}; // Parallel to m_copies
     };
 
 
@@ -0,0 +1,306 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+#include "pipeline.hpp"
+#include "descriptor.hpp"
+#include "command_buffer.hpp"
+#include "indirect_command_stream.hpp"
+
+#include <map>
+
+namespace g_app {
+    /* Everything needed to issue one graphics draw, built with DrawPacketBuilder and collected by a DrawList. */
+    struct DrawPacket {
+        static constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+        static constexpr uint32_t MAX_VERTEX_BUFFERS = 4;
+        static constexpr uint32_t MAX_PUSH_CONSTANT_SIZE = 128;
+
+        Pipeline pipeline = {};
+        std::array<DescriptorSet, MAX_DESCRIPTOR_SETS> descriptor_sets = {};
+        uint32_t descriptor_set_count = 0;
+        std::array<VkBuffer, MAX_VERTEX_BUFFERS> vertex_buffers = {};
+        std::array<VkDeviceSize, MAX_VERTEX_BUFFERS> vertex_offsets = {};
+        uint32_t vertex_buffer_count = 0;
+        VkBuffer index_buffer = VK_NULL_HANDLE; // Non-indexed draw when null
+        VkDeviceSize index_offset = 0;
+        VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+        // Owners of the buffers, so a CachedCommandBuffer recording the DrawList re-records once one is destroyed
+        std::array<std::weak_ptr<void>, MAX_VERTEX_BUFFERS> vertex_buffer_refs = {};
+        std::weak_ptr<void> index_buffer_ref = {};
+        VkShaderStageFlags push_stages = 0;
+        std::array<uint8_t, MAX_PUSH_CONSTANT_SIZE> push_data = {};
+        uint32_t push_size = 0;
+
+        uint32_t count = 0; // Vertex count, or index count for indexed draws
+        uint32_t instance_count = 1;
+        uint32_t first = 0; // First vertex, or first index for indexed draws
+        int32_t vertex_offset = 0;
+        uint32_t first_instance = 0;
+        uint8_t layer = 0; // Lower layers are drawn first regardless of state, e.g. opaque before transparent
+    };
+
+    class DrawPacketBuilder {
+    public:
+        explicit DrawPacketBuilder(const Pipeline& pipeline){
+            m_packet.pipeline = pipeline;
+        }
+
+        /* Graphics sets starting at set 0, no dynamic offsets. */
+        DrawPacketBuilder& set_descriptor_sets(std::initializer_list<DescriptorSet> sets){
+            assert(sets.size() <= DrawPacket::MAX_DESCRIPTOR_SETS && "Too many descriptor sets!");
+            std::copy(sets.begin(), sets.end(), m_packet.descriptor_sets.begin());
+            m_packet.descriptor_set_count = sets.size();
+            return *this;
+        }
+
+        /* Appends a vertex buffer to the next binding, offset is in elements. */
+        template<BufferView B>
+        DrawPacketBuilder& add_vertex_buffer(const B& buffer, VkDeviceSize offset = 0){
+            assert(m_packet.vertex_buffer_count < DrawPacket::MAX_VERTEX_BUFFERS && "Too many vertex buffers!");
+            m_packet.vertex_buffers[m_packet.vertex_buffer_count] = buffer.vk_buffer();
+            m_packet.vertex_offsets[m_packet.vertex_buffer_count] = buffer.offsetb() + offset * sizeof(typename B::value_type);
+            if constexpr(requires { buffer.weak_ref(); }) m_packet.vertex_buffer_refs[m_packet.vertex_buffer_count] = buffer.weak_ref();
+            m_packet.vertex_buffer_count++;
+            return *this;
+        }
+
+        template<BufferView B>
+        DrawPacketBuilder& set_index_buffer(const B& buffer, VkIndexType type, VkDeviceSize offset = 0){
+            m_packet.index_buffer = buffer.vk_buffer();
+            m_packet.index_offset = buffer.offsetb() + offset * sizeof(typename B::value_type);
+            m_packet.index_type = type;
+            if constexpr(requires { buffer.weak_ref(); }) m_packet.index_buffer_ref = buffer.weak_ref();
+            return *this;
+        }
+
+        template<typename T>
+        DrawPacketBuilder& set_push_constants(VkShaderStageFlags stages, const T& constants){
+            static_assert(sizeof(T) <= DrawPacket::MAX_PUSH_CONSTANT_SIZE, "Push constants are too big for a DrawPacket!");
+            m_packet.push_stages = stages;
+            m_packet.push_size = sizeof(T);
+            std::memcpy(m_packet.push_data.data(), &constants, sizeof(T));
+            return *this;
+        }
+
+        DrawPacketBuilder& draw(uint32_t vertex_count, uint32_t instance_count = 1, uint32_t first_vertex = 0, uint32_t first_instance = 0){
+            m_packet.count = vertex_count;
+            m_packet.instance_count = instance_count;
+            m_packet.first = first_vertex;
+            m_packet.first_instance = first_instance;
+            return *this;
+        }
+
+        /* Requires set_index_buffer(). */
+        DrawPacketBuilder& draw_indexed(uint32_t index_count, uint32_t instance_count = 1, uint32_t first_index = 0,
+                                        int32_t vertex_offset = 0, uint32_t first_instance = 0){
+            m_packet.count = index_count;
+            m_packet.instance_count = instance_count;
+            m_packet.first = first_index;
+            m_packet.vertex_offset = vertex_offset;
+            m_packet.first_instance = first_instance;
+            return *this;
+        }
+
+        DrawPacketBuilder& set_layer(uint8_t layer){
+            m_packet.layer = layer;
+            return *this;
+        }
+
+        DrawPacket build() { return m_packet; }
+    private:
+        DrawPacket m_packet = {};
+    };
+
+    /* State changes needed to replay a DrawList, in submission order and after sorting. */
+    struct DrawListStats {
+        uint32_t packets = 0;
+        uint32_t draw_calls = 0; // Draw commands recorded into the command buffer
+        uint32_t instanced_merges = 0; // Packets folded into the previous draw's instances
+        uint32_t multi_draw_merges = 0; // Packets folded into a multi-draw indirect call
+        // Pipeline, descriptor set, vertex/index buffer and push constant changes, need DrawListInit::enable_bind_stats()
+        uint32_t unsorted_binds = 0;
+        uint32_t sorted_binds = 0;
+    };
+
+    class DrawListInit;
+
+    /*
+     * Collects draws in scene order and replays them sorted by state, so pipelines and descriptor sets are bound once
+     * per group instead of thrashing between meshes. Each packet gets a 64-bit key, most significant first:
+     * layer (8 bits) | pipeline (16) | descriptor sets (16) | vertex and index buffers (24), where the ids are handed
+     * out in first-use order. Keys are radix sorted, packets with equal keys keep their submission order.
+     *
+     * Consecutive packets with the same state and push constants are merged: draws of the same mesh with contiguous
+     * instance ranges become one instanced draw, and with DrawListInit::set_multi_draw_capacity() anything else becomes
+     * a single multi-draw indirect call (gl_DrawID then differs per merged draw).
+     *
+     *   draw_list.clear();
+     *   for(const auto& mesh : scene) draw_list.add(DrawPacketBuilder(mesh.pipeline)...build());
+     *   draw_list.record(cmd); // Inside a render pass
+     *
+     * Pipelines and descriptor sets are held by the list until clear(), vertex and index buffers aren't.
+     */
+    class DrawList {
+    public:
+        DrawList() = default;
+
+        DrawList& add(const DrawPacket& packet);
+        /* Drops every packet, keeps the allocated memory. */
+        DrawList& clear();
+        /* Sorts if needed and records the draws into cmd, which must be inside a render pass. */
+        DrawList& record(CommandBuffer& cmd);
+
+        uint32_t size() const { return self->entries.size(); }
+        /* Stats of the last record(). */
+        const DrawListStats& stats() const { return self->stats; }
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            uint32_t    multi_draw_capacity = 0; // Indirect commands per frame, 0 disables multi-draw merging
+            bool        bind_stats = false;
+            std::string label = "unnamed draw list";
+        };
+
+        struct DescriptorSetsKey {
+            std::array<VkDescriptorSet, DrawPacket::MAX_DESCRIPTOR_SETS> sets = {};
+            uint32_t count = 0;
+            auto operator <=> (const DescriptorSetsKey&) const = default;
+        };
+
+        struct Geometry {
+            std::array<VkBuffer, DrawPacket::MAX_VERTEX_BUFFERS> vertex_buffers = {};
+            std::array<VkDeviceSize, DrawPacket::MAX_VERTEX_BUFFERS> vertex_offsets = {};
+            uint32_t vertex_buffer_count = 0;
+            VkBuffer index_buffer = VK_NULL_HANDLE;
+            VkDeviceSize index_offset = 0;
+            VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+            auto operator <=> (const Geometry&) const = default;
+        };
+
+        struct Entry {
+            uint32_t pipeline = 0;
+            uint32_t descriptor_sets = 0;
+            uint32_t geometry = 0;
+            uint32_t push_offset = 0; // Into push_data
+            uint32_t push_size = 0;
+            VkShaderStageFlags push_stages = 0;
+            uint32_t count = 0;
+            uint32_t instance_count = 0;
+            uint32_t first = 0;
+            int32_t vertex_offset = 0;
+            uint32_t first_instance = 0;
+        };
+
+        struct SortItem {
+            uint64_t key = 0;
+            uint32_t entry = 0;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            std::string label;
+
+            std::vector<Pipeline> pipelines = {};
+            std::map<VkPipeline, uint32_t> pipeline_ids = {};
+            std::vector<std::array<DescriptorSet, DrawPacket::MAX_DESCRIPTOR_SETS>> descriptor_sets = {};
+            std::vector<uint32_t> descriptor_set_counts = {};
+            std::map<DescriptorSetsKey, uint32_t> descriptor_set_ids = {};
+            std::vector<Geometry> geometries = {};
+            std::vector<std::vector<std::weak_ptr<void>>> geometry_refs = {}; // Owners of each geometry's buffers
+            std::map<Geometry, uint32_t> geometry_ids = {};
+
+            std::vector<Entry> entries = {};
+            std::vector<uint8_t> push_data = {};
+            std::vector<SortItem> order = {};
+            std::vector<SortItem> scratch = {};
+            bool sorted = false;
+
+            IndirectCommandStream<VkDrawIndirectCommand> draw_stream = {};
+            IndirectCommandStream<VkDrawIndexedIndirectCommand> indexed_stream = {};
+            std::vector<VkDrawIndirectCommand> draw_commands = {}; // Commands of the current merged run
+            std::vector<VkDrawIndexedIndirectCommand> indexed_commands = {};
+
+            DrawListStats stats = {};
+            bool bind_stats = false;
+        };
+
+        std::shared_ptr<Inner> self;
+
+        DrawList(VulkanRenderer renderer, const Config& config);
+
+        void sort();
+        uint32_t count_binds(bool sorted) const;
+        bool same_state(const Entry& a, const Entry& b) const;
+        void record_run(CommandBuffer& cmd, uint32_t begin, uint32_t end);
+        void count_multi_draw(size_t count);
+
+        friend class DrawListInit;
+    };
+
+    class DrawListInit {
+    public:
+        DrawListInit() = default;
+
+        DrawListInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /*
+         * Merges runs of packets that share all state into multi-draw indirect calls, written to a per-frame stream
+         * that holds 'capacity' commands. Only used when the device supports multiDrawIndirect.
+         */
+        DrawListInit& set_multi_draw_capacity(uint32_t capacity){
+            m_config.multi_draw_capacity = capacity;
+            return *this;
+        }
+
+        /* Counts the binds of the list in submission and sorted order on every record(), which walks it twice more. */
+        DrawListInit& enable_bind_stats(){
+            m_config.bind_stats = true;
+            return *this;
+        }
+
+        DrawList init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        DrawList::Config m_config = {};
+    };
+}
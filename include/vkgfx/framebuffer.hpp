@@ -55,6 +55,7 @@ namespace g_app {
         };
 
         VkFramebuffer vk_framebuffer() const { return self->framebuffer; }
+        std::weak_ptr<void> weak_ref() const { return self; }
     private:
         Framebuffer(VulkanRenderer renderer, const Config& config);
 
@@ -67,7 +68,9 @@ namespace g_app {
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroyFramebuffer(renderer.inner()->device, framebuffer, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, framebuffer = framebuffer](){
+                    vkDestroyFramebuffer(device, framebuffer, nullptr);
+                });
             }
         };
         std::shared_ptr<Inner> self;
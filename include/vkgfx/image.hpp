@@ -31,6 +31,7 @@
 #pragma once
 
 #include "renderer.hpp"
+#include "resource_state.hpp"
 
 #include <format>
 
@@ -39,6 +40,46 @@
 namespace g_app {
     class VulkanRenderer;
 
+    /* Size of one texel of an uncompressed color format in bytes, 0 for formats it doesn't know. */
+    constexpr uint32_t format_texel_size(VkFormat format){
+        switch(format){
+            case VK_FORMAT_R8_UNORM:
+            case VK_FORMAT_R8_SNORM:
+            case VK_FORMAT_R8_UINT:
+            case VK_FORMAT_R8_SRGB:
+                return 1;
+            case VK_FORMAT_R8G8_UNORM:
+            case VK_FORMAT_R8G8_SRGB:
+            case VK_FORMAT_R16_UNORM:
+            case VK_FORMAT_R16_UINT:
+            case VK_FORMAT_R16_SFLOAT:
+                return 2;
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SNORM:
+            case VK_FORMAT_R8G8B8A8_UINT:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+            case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+            case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+            case VK_FORMAT_R16G16_UNORM:
+            case VK_FORMAT_R16G16_SFLOAT:
+            case VK_FORMAT_R32_UINT:
+            case VK_FORMAT_R32_SFLOAT:
+                return 4;
+            case VK_FORMAT_R16G16B16A16_UNORM:
+            case VK_FORMAT_R16G16B16A16_SFLOAT:
+            case VK_FORMAT_R32G32_UINT:
+            case VK_FORMAT_R32G32_SFLOAT:
+                return 8;
+            case VK_FORMAT_R32G32B32A32_UINT:
+            case VK_FORMAT_R32G32B32A32_SFLOAT:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
     class ImageInit;
     class Image {
     public:
@@ -51,9 +92,32 @@ namespace g_app {
         uint32_t mip_levels() const { return self->mip_levels; }
         uint32_t layer_count() const { return self->layer_count; }
         VkExtent3D extent() const { return self->extent; }
+        VkSampleCountFlagBits samples() const { return self->samples; }
 
         VkImage vk_image() const { return self->image; }
         VmaAllocation vma_allocation() const { return self->allocation; }
+        std::weak_ptr<void> weak_ref() const { return self; }
+
+        /* Aspects of the whole image, derived from its format. */
+        VkImageAspectFlags aspect_mask() const {
+            switch(self->format){
+                case VK_FORMAT_D16_UNORM:
+                case VK_FORMAT_X8_D24_UNORM_PACK32:
+                case VK_FORMAT_D32_SFLOAT:
+                    return VK_IMAGE_ASPECT_DEPTH_BIT;
+                case VK_FORMAT_D16_UNORM_S8_UINT:
+                case VK_FORMAT_D24_UNORM_S8_UINT:
+                case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                    return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+                case VK_FORMAT_S8_UINT:
+                    return VK_IMAGE_ASPECT_STENCIL_BIT;
+                default:
+                    return VK_IMAGE_ASPECT_COLOR_BIT;
+            }
+        }
+
+        /* Tracked state of the whole image, see CommandBuffer::require(). Shared by every copy of the handle. */
+        ResourceState& resource_state() const { return self->state; }
     private:
         struct Config {
             VkImageType image_type = VK_IMAGE_TYPE_2D;
@@ -67,6 +131,8 @@ namespace g_app {
             VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
             VkImageLayout initial_layout = VK_IMAGE_LAYOUT_UNDEFINED;
             VmaMemoryUsage memory_usage = VMA_MEMORY_USAGE_AUTO;
+            bool concurrent = false;
+            VmaAllocation aliased_allocation = VK_NULL_HANDLE;
             std::string label = "unnamed image";
         };
 
@@ -78,12 +144,18 @@ namespace g_app {
             VkFormat format;
             uint32_t mip_levels = 1;
             uint32_t layer_count = 1;
+            VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+            VkImageType image_type = VK_IMAGE_TYPE_2D;
+            VkImageUsageFlags usage = 0;
+            ResourceState state = {};
             std::string label;
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vmaDestroyImage(renderer.inner()->allocator, image, allocation);
+                renderer.defer_destroy([allocator = renderer.inner()->allocator, image = image, allocation = allocation](){
+                    vmaDestroyImage(allocator, image, allocation);
+                });
             }
         };
 
@@ -92,6 +164,7 @@ namespace g_app {
         Image(VulkanRenderer renderer, const Config& config);
 
         friend class ImageInit;
+        friend class CommandCapture;
     };
 
     class ImageInit {
@@ -153,6 +226,24 @@ namespace g_app {
             return *this;
         }
 
+        /*
+         * Binds the image to the start of existing memory instead of allocating its own, e.g. to alias transient images
+         * whose lifetimes don't overlap. The allocation must outlive the image and isn't freed with it.
+         */
+        ImageInit& set_aliased_allocation(VmaAllocation allocation){
+            m_config.aliased_allocation = allocation;
+            return *this;
+        }
+
+        /*
+         * Shares the image between every queue family instead of transferring ownership between them.
+         * Simpler when it is used on dedicated transfer/compute queues, but may disable compression on some hardware.
+         */
+        ImageInit& set_concurrent_sharing(){
+            m_config.concurrent = true;
+            return *this;
+        }
+
         Image init(const VulkanRenderer& renderer){
             try {
                 return {renderer, m_config};
@@ -173,7 +264,10 @@ namespace g_app {
 
         ImageView(const ImageView&) = default;
 
-        VkImageView vk_image_view() const { return self->view; }
+        VkImageView vk_image_view() const { return (self) ? self->view : VK_NULL_HANDLE; }
+        std::weak_ptr<void> weak_ref() const { return self; }
+        VkFormat format() const { return self->format; }
+        VkSampleCountFlagBits samples() const { return self->samples; }
     private:
         struct Config {
             Image image;
@@ -186,12 +280,19 @@ namespace g_app {
         struct Inner {
             VulkanRenderer renderer;
             VkImageView view = VK_NULL_HANDLE;
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+            Image image = {}; // Kept alive for as long as the view
+            VkImageViewType view_type = VK_IMAGE_VIEW_TYPE_2D;
+            VkImageAspectFlags aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT;
             std::string label;
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroyImageView(renderer.inner()->device, view, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, view = view](){
+                    vkDestroyImageView(device, view, nullptr);
+                });
             }
         };
 
@@ -200,6 +301,7 @@ namespace g_app {
         ImageView(const VulkanRenderer& renderer, const Config& config);
 
         friend class ImageViewInit;
+        friend class CommandCapture;
     };
 
     class ImageViewInit {
@@ -243,7 +345,8 @@ namespace g_app {
     public:
         Sampler() = default;
 
-        VkSampler vk_sampler() const { return self->sampler; }
+        VkSampler vk_sampler() const { return (self) ? self->sampler : VK_NULL_HANDLE; }
+        std::weak_ptr<void> weak_ref() const { return self; }
     private:
         struct Config {
             VkFilter mag_filter = VK_FILTER_LINEAR;
@@ -266,12 +369,15 @@ namespace g_app {
         struct Inner {
             VulkanRenderer renderer;
             VkSampler sampler = VK_NULL_HANDLE;
+            VkSamplerCreateInfo create_info = {}; // For CommandCapture
             std::string label;
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroySampler(renderer.inner()->device, sampler, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, sampler = sampler](){
+                    vkDestroySampler(device, sampler, nullptr);
+                });
             }
         };
 
@@ -280,6 +386,7 @@ namespace g_app {
         Sampler(const VulkanRenderer& renderer, const Config& config);
 
         friend class SamplerInit;
+        friend class CommandCapture;
     };
 
     class SamplerInit {
@@ -0,0 +1,141 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+#include "per_frame.hpp"
+
+namespace g_app {
+    template<typename T>
+    concept IndirectCommand = std::same_as<T, VkDrawIndirectCommand> || std::same_as<T, VkDrawIndexedIndirectCommand> ||
+                              std::same_as<T, VkDispatchIndirectCommand>;
+
+    template<IndirectCommand T>
+    class IndirectCommandStreamInit;
+
+    /*
+     * Frame scoped stream of indirect commands, so thousands of draws go out in one draw_indirect() call instead of a
+     * draw per mesh. Commands go into the current frame's region of one persistently mapped buffer, see FrameRing.
+     *
+     *   auto first = stream.count();
+     *   for(const auto& mesh : meshes) stream.push({mesh.index_count, 1, mesh.first_index, mesh.vertex_offset, mesh.id});
+     *   cmd.draw_indexed_indirect(stream.commands(first));
+     *
+     * The buffer is also a storage buffer, so a compute pass can rewrite the commands in place (e.g. zero the
+     * instance count of culled meshes) before they are drawn. Push only after acquire_next_swapchain_image().
+     */
+    template<IndirectCommand T>
+    class IndirectCommandStream {
+    public:
+        IndirectCommandStream() = default;
+
+        /* Appends a command and returns its index within this frame's commands. */
+        uint32_t push(const T& command){
+            return push(std::span(&command, 1));
+        }
+
+        /* Appends commands and returns the index of the first one. */
+        uint32_t push(std::span<const T> commands){
+            auto first = static_cast<uint32_t>(self->ring.allocate(commands.size()));
+            self->buffer.write(commands.data(), commands.size(), self->ring.frame_offset() + first);
+            return first;
+        }
+
+        /* This frame's commands from index 'first' on, pass it to CommandBuffer::draw_indirect() and friends. */
+        BufferRange<T> commands(uint32_t first = 0) const {
+            assert(first <= count() && "First command out of this frame's commands!");
+            return {self->buffer.vk_buffer(), (self->ring.frame_offset() + first) * sizeof(T), count() - first};
+        }
+
+        /* Commands pushed this frame. */
+        uint32_t count() const { return static_cast<uint32_t>(self->ring.used()); }
+        /* Commands each frame can hold. */
+        uint32_t capacity() const { return static_cast<uint32_t>(self->ring.frame_size()); }
+        const Buffer<T>& buffer() const { return self->buffer; }
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            uint32_t    capacity = 4096;
+            std::string label = "unnamed indirect command stream";
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            Buffer<T>   buffer = {};
+            FrameRing   ring = {};
+            std::string label;
+        };
+
+        std::shared_ptr<Inner> self;
+
+        IndirectCommandStream(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+            self->label = config.label;
+            self->ring = FrameRing(renderer, config.capacity, std::format("IndirectCommandStream {}", self->label), "capacity");
+            self->buffer = BufferInit<T>()
+                    .set_label(std::format("{} -> Buffer", self->label))
+                    .set_usage(VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+                    .set_size(self->ring.total_size())
+                    .set_persistently_mapped()
+                    .init(renderer);
+        }
+
+        friend class IndirectCommandStreamInit<T>;
+    };
+
+    template<IndirectCommand T>
+    class IndirectCommandStreamInit {
+    public:
+        IndirectCommandStreamInit() = default;
+
+        IndirectCommandStreamInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /* Commands each frame can hold, 4096 by default. */
+        IndirectCommandStreamInit& set_capacity(uint32_t capacity){
+            m_config.capacity = capacity;
+            return *this;
+        }
+
+        IndirectCommandStream<T> init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        IndirectCommandStream<T>::Config m_config = {};
+    };
+}
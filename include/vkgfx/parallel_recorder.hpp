@@ -0,0 +1,197 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "command_buffer.hpp"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <concepts>
+#include <memory>
+
+namespace g_app {
+    class ParallelRecorderInit;
+
+    /*
+     * Splits command recording across a pool of worker threads. Every thread slot owns one command pool per frame in
+     * flight, so recording never shares a pool between threads, and a slot's pool is reset the first time it is used
+     * in a frame instead of freeing command buffers one by one.
+     *
+     *   cmd.begin_render_pass(render_pass, framebuffer, clear_values, extent, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+     *   recorder.record(cmd, draws.size(), [&](CommandBuffer& secondary, uint32_t begin, uint32_t end){
+     *       for(uint32_t i = begin; i < end; i++) { ... secondary.draw_indexed(...); }
+     *   });
+     *   cmd.end_render_pass();
+     *
+     * Secondaries stay valid until the renderer comes back around to the same frame slot, so the primary they are
+     * executed in has to be part of that frame's graphics submission.
+     */
+    class ParallelRecorder {
+    public:
+        ParallelRecorder() = default;
+
+        /*
+         * Splits [0, count) into one contiguous range per thread and records each into a secondary command buffer that
+         * continues primary's current render pass, which must have been begun with secondary contents. The secondaries
+         * are executed in primary in range order, so draw order is preserved. f(secondary, begin, end) is called
+         * concurrently and record() returns once every range is recorded.
+         * f is only referenced for the duration of the call, nothing is copied or allocated to pass it to the workers.
+         */
+        template<typename F> requires std::invocable<F&, CommandBuffer&, uint32_t, uint32_t>
+        CommandBuffer& record(CommandBuffer& primary, uint32_t count, F&& f){
+            return record_ranges(primary, count, [](void* context, CommandBuffer& secondary, uint32_t begin, uint32_t end){
+                (*static_cast<std::remove_reference_t<F>*>(context))(secondary, begin, end);
+            }, const_cast<void*>(static_cast<const void*>(std::addressof(f))));
+        }
+
+        /* Calls f(thread, begin, end) for one contiguous range of [0, count) per thread and waits for all of them. */
+        template<typename F> requires std::invocable<F&, uint32_t, uint32_t, uint32_t>
+        void parallel_for(uint32_t count, F&& f){
+            for_each_range(count, [](void* context, uint32_t thread, uint32_t begin, uint32_t end){
+                (*static_cast<std::remove_reference_t<F>*>(context))(thread, begin, end);
+            }, const_cast<void*>(static_cast<const void*>(std::addressof(f))));
+        }
+
+        /* A secondary command buffer from the thread's pool for this frame. Only valid inside parallel_for(). */
+        CommandBuffer acquire_secondary(uint32_t thread);
+
+        uint32_t thread_count() const { return self->thread_count; }
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        using RecordCallback = void(*)(void* context, CommandBuffer& secondary, uint32_t begin, uint32_t end);
+        using RangeCallback = void(*)(void* context, uint32_t thread, uint32_t begin, uint32_t end);
+        using TaskCallback = void(*)(void* context, uint32_t task);
+
+        struct Config {
+            uint32_t thread_count = 0; // 0 uses every hardware thread
+            Queue queue = Queue::GRAPHICS;
+            std::string label = "unnamed parallel recorder";
+        };
+
+        struct ThreadPool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<CommandBuffer> secondaries = {};
+            uint32_t used = 0;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            std::string label;
+            uint32_t queue_family = 0;
+            uint32_t thread_count = 1;
+            std::vector<std::vector<ThreadPool>> pools = {}; // [frame][thread]
+            std::vector<uint64_t> reset_frame = {}; // frame_count() at which each frame's pools were last reset
+            std::vector<CommandBuffer> recorded = {}; // One secondary per range of the last record()
+
+            std::vector<std::thread> workers = {}; // thread_count - 1, the calling thread takes part as well
+            std::mutex mutex;
+            std::condition_variable work_cv;
+            std::condition_variable done_cv;
+            TaskCallback task = nullptr;
+            void* task_context = nullptr;
+            uint32_t task_count = 0;
+            std::atomic<uint32_t> next_task = 0;
+            uint32_t finished_tasks = 0;
+            uint32_t active_workers = 0;
+            uint64_t generation = 0;
+            bool stop = false;
+
+            void worker();
+            void run_tasks();
+
+            ~Inner(){
+                {
+                    std::lock_guard lock(mutex);
+                    stop = true;
+                }
+                work_cv.notify_all();
+                for(auto& worker : workers) worker.join();
+
+                if(!renderer.is_valid()) return;
+                for(auto& frame : pools){
+                    for(auto& thread : frame){
+                        thread.secondaries.clear();
+                        renderer.defer_destroy([device = renderer.inner()->device, pool = thread.pool](){
+                            vkDestroyCommandPool(device, pool, nullptr);
+                        });
+                    }
+                }
+            }
+        };
+
+        std::shared_ptr<Inner> self;
+
+        ParallelRecorder(VulkanRenderer renderer, const Config& config);
+
+        void reset_frame_pools();
+        CommandBuffer& record_ranges(CommandBuffer& primary, uint32_t count, RecordCallback f, void* context);
+        void for_each_range(uint32_t count, RangeCallback f, void* context);
+        void run(uint32_t count, TaskCallback task, void* context);
+
+        friend class ParallelRecorderInit;
+    };
+
+    class ParallelRecorderInit {
+    public:
+        ParallelRecorderInit() = default;
+
+        ParallelRecorderInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /* Number of recording threads including the calling one, 0 (the default) uses every hardware thread. */
+        ParallelRecorderInit& set_thread_count(uint32_t count){
+            m_config.thread_count = count;
+            return *this;
+        }
+
+        /* Queue the recorded command buffers are submitted to, GRAPHICS by default. */
+        ParallelRecorderInit& set_queue(Queue queue){
+            m_config.queue = queue;
+            return *this;
+        }
+
+        ParallelRecorder init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        ParallelRecorder::Config m_config = {};
+    };
+}
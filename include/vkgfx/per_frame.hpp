@@ -0,0 +1,126 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "renderer.hpp"
+
+#include <type_traits>
+#include <format>
+
+namespace g_app {
+    /*
+     * One copy of a resource per frame in flight, indexed by the renderer's current frame.
+     * e.g. PerFrame cmd(renderer, [&](uint32_t){ return CommandBuffer(renderer); }); cmd->begin()...
+     */
+    template<typename T>
+    class PerFrame {
+    public:
+        PerFrame() = default;
+
+        /* Calls create(frame) for every frame in flight. */
+        template<typename F>
+        requires std::is_invocable_r_v<T, F, uint32_t>
+        PerFrame(const VulkanRenderer& renderer, F&& create): m_renderer{renderer} {
+            m_items.reserve(renderer.frames_in_flight());
+            for(uint32_t i = 0; i < renderer.frames_in_flight(); i++){
+                m_items.push_back(create(i));
+            }
+        }
+
+        T& current() { return m_items[m_renderer.current_frame()]; }
+        const T& current() const { return m_items[m_renderer.current_frame()]; }
+
+        T* operator -> () { return &current(); }
+        const T* operator -> () const { return &current(); }
+        T& operator * () { return current(); }
+        const T& operator * () const { return current(); }
+
+        T& operator [] (uint32_t frame) { return m_items[frame]; }
+        const T& operator [] (uint32_t frame) const { return m_items[frame]; }
+
+        uint32_t size() const { return static_cast<uint32_t>(m_items.size()); }
+        auto begin() { return m_items.begin(); }
+        auto end() { return m_items.end(); }
+        auto begin() const { return m_items.begin(); }
+        auto end() const { return m_items.end(); }
+    private:
+        VulkanRenderer m_renderer = {};
+        std::vector<T> m_items = {};
+    };
+
+    template<typename F>
+    PerFrame(const VulkanRenderer&, F&&) -> PerFrame<std::invoke_result_t<F, uint32_t>>;
+
+    /*
+     * Bump allocator over a buffer split into a region of 'frame_size' units per frame in flight. The current frame's
+     * region starts empty and is recycled once the renderer comes back around to the same frame slot, so allocate
+     * only after acquire_next_swapchain_image(). Used by UniformAllocator (bytes) and IndirectCommandStream (commands).
+     */
+    class FrameRing {
+    public:
+        FrameRing() = default;
+        /* 'name' is used in the out of space error, e.g. "UniformAllocator Camera", 'size_name' for the setting to raise. */
+        FrameRing(const VulkanRenderer& renderer, uint64_t frame_size, const std::string& name, const std::string& size_name):
+            m_renderer{renderer}, m_frame_size{frame_size}, m_name{name}, m_size_name{size_name} {}
+
+        /* Units the whole buffer needs. */
+        uint64_t total_size() const { return m_frame_size * m_renderer.frames_in_flight(); }
+        uint64_t frame_size() const { return m_frame_size; }
+        /* Start of the current frame's region. */
+        uint64_t frame_offset() const { return static_cast<uint64_t>(m_renderer.current_frame()) * m_frame_size; }
+        /* Units allocated in the current frame. */
+        uint64_t used() const { return (m_frame == m_renderer.frame_count()) ? m_head : 0; }
+
+        /* Returns the offset of 'size' units within the current frame's region, exits when the region is full. */
+        uint64_t allocate(uint64_t size, uint64_t alignment = 1){
+            if(m_frame != m_renderer.frame_count()){
+                m_frame = m_renderer.frame_count();
+                m_head = 0;
+            }
+
+            uint64_t offset = (m_head + alignment - 1) / alignment * alignment;
+            if(offset + size > m_frame_size){
+                spdlog::error("{} ran out of space for this frame, increase its {}! {} = {}",
+                              m_name, m_size_name, m_size_name, m_frame_size);
+                std::exit(EXIT_FAILURE);
+            }
+            m_head = offset + size;
+            return offset;
+        }
+    private:
+        VulkanRenderer m_renderer = {};
+        uint64_t m_frame_size = 0;
+        uint64_t m_head = 0;
+        uint64_t m_frame = UINT64_MAX; // Frame the head belongs to
+        std::string m_name;
+        std::string m_size_name;
+    };
+}
@@ -43,6 +43,7 @@
 
 namespace g_app {
     class ShaderModuleInit;
+    class CommandCapture;
 
     class ShaderModule {
     public:
@@ -73,6 +74,7 @@ namespace g_app {
             VkPipelineShaderStageCreateInfo stage_info = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO};
             std::string entry;
             std::string label;
+            std::vector<char> src = {}; // Only kept with VulkanRenderer::has_command_capture()
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
@@ -86,6 +88,7 @@ namespace g_app {
         ShaderModule(VulkanRenderer renderer, const Config& config);
 
         friend class ShaderModuleInit;
+        friend class CommandCapture;
     };
 
     class ShaderModuleInit {
@@ -313,16 +316,23 @@ namespace g_app {
 
         VkPipeline vk_pipeline() const { return self->pipeline; }
         VkPipelineLayout vk_pipeline_layout() const { return self->layout; }
+        std::weak_ptr<void> weak_ref() const { return self; }
     private:
         struct GraphicsConfig {
             std::string label = "unnamed pipeline";
             std::vector<ShaderModule> modules = {};
             std::vector<VkPushConstantRange> push_constants = {};
             std::vector<VkDescriptorSetLayout> set_layouts = {};
+            std::vector<DescriptorSetLayout> set_layout_refs = {}; // Parallel to set_layouts, for CommandCapture
             std::vector<VertexBinding> bindings = {};
             VkRenderPass render_pass = VK_NULL_HANDLE;
             VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
             uint32_t subpass = 0;
+            // Dynamic rendering, used instead of render_pass when dynamic_rendering is set
+            bool dynamic_rendering = false;
+            std::vector<VkFormat> color_formats = {};
+            VkFormat depth_format = VK_FORMAT_UNDEFINED;
+            VkFormat stencil_format = VK_FORMAT_UNDEFINED;
 
             VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
             RasterizationInfo rasterization_info;
@@ -336,6 +346,7 @@ namespace g_app {
             ShaderModule module;
             std::vector<VkPushConstantRange> push_constants = {};
             std::vector<VkDescriptorSetLayout> set_layouts = {};
+            std::vector<DescriptorSetLayout> set_layout_refs = {}; // Parallel to set_layouts, for CommandCapture
             VkPipelineCache pipeline_cache = VK_NULL_HANDLE;
         };
 
@@ -344,12 +355,18 @@ namespace g_app {
             VkPipeline pipeline = VK_NULL_HANDLE;
             VkPipelineLayout layout = VK_NULL_HANDLE;
             std::string label;
+            // Only kept with VulkanRenderer::has_command_capture()
+            std::shared_ptr<const GraphicsConfig> graphics_config = nullptr;
+            std::shared_ptr<const ComputeConfig> compute_config = nullptr;
+            bool default_render_pass = false; // Built for VulkanRenderer::default_render_pass()
 
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroyPipeline(renderer.inner()->device, pipeline, nullptr);
-                vkDestroyPipelineLayout(renderer.inner()->device, layout, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, pipeline = pipeline, layout = layout](){
+                    vkDestroyPipeline(device, pipeline, nullptr);
+                    vkDestroyPipelineLayout(device, layout, nullptr);
+                });
             }
         };
 
@@ -361,6 +378,7 @@ namespace g_app {
 
         friend class GraphicsPipelineInit;
         friend class ComputePipelineInit;
+        friend class CommandCapture;
     };
 
     class VertexBindingBuilder {
@@ -421,6 +439,7 @@ namespace g_app {
         }
         GraphicsPipelineInit& add_descriptor_set_layout(const DescriptorSetLayout& layout){
             m_config.set_layouts.push_back(layout.vk_descriptor_set_layout());
+            m_config.set_layout_refs.push_back(layout);
             return *this;
         }
         GraphicsPipelineInit& set_render_pass(const RenderPass& render_pass){
@@ -435,6 +454,19 @@ namespace g_app {
             m_config.subpass = subpass;
             return *this;
         }
+        /*
+         * Builds the pipeline for CommandBuffer::begin_rendering() with attachments of these formats instead of for a
+         * render pass. Requires VulkanRendererInit::enable_dynamic_rendering().
+         */
+        GraphicsPipelineInit& set_rendering_formats(const std::vector<VkFormat>& color_formats,
+                                                    VkFormat depth_format = VK_FORMAT_UNDEFINED,
+                                                    VkFormat stencil_format = VK_FORMAT_UNDEFINED){
+            m_config.dynamic_rendering = true;
+            m_config.color_formats = color_formats;
+            m_config.depth_format = depth_format;
+            m_config.stencil_format = stencil_format;
+            return *this;
+        }
         GraphicsPipelineInit& set_pipeline_cache(const PipelineCache& cache){
             m_config.pipeline_cache = cache.vk_pipeline_cache();
             return *this;
@@ -474,6 +506,7 @@ namespace g_app {
         }
         ComputePipelineInit& add_descriptor_set_layout(const DescriptorSetLayout& layout){
             m_config.set_layouts.push_back(layout.vk_descriptor_set_layout());
+            m_config.set_layout_refs.push_back(layout);
             return *this;
         }
         ComputePipelineInit& set_pipeline_cache(const PipelineCache& cache){
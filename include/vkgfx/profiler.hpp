@@ -0,0 +1,155 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "renderer.hpp"
+
+namespace g_app {
+    /* One resolved zone. Zones are stored in the order they began, so a zone's children directly follow it. */
+    struct GpuZoneTiming {
+        std::string name;
+        double   begin_ms = 0.0;    // Relative to the first zone of the frame
+        double   duration_ms = 0.0;
+        uint32_t depth = 0;
+        int32_t  parent = -1;       // Index into the same frame, -1 for top level zones
+    };
+
+    struct GpuFrameTimings {
+        uint64_t frame = 0;         // VulkanRenderer::frame_count() of the frame that was measured
+        std::vector<GpuZoneTiming> zones = {};
+        uint32_t dropped_zones = 0; // Zones that didn't fit into the query pool
+    };
+
+    class GpuProfilerInit;
+
+    /*
+     * Measures GPU time with timestamp queries. There's one query pool per frame in flight, a frame's results are read
+     * back without blocking when its slot comes around again (i.e. frames_in_flight() frames later).
+     * Record zones through CommandBuffer::begin_profiling(), begin_zone() and end_zone().
+     */
+    class GpuProfiler {
+    public:
+        GpuProfiler() = default;
+
+        /*
+         * Resolves the results of the last frame recorded in the current slot and resets its queries.
+         * Must be recorded outside of a render pass, after acquire_next_swapchain_image().
+         */
+        void begin_frame(VkCommandBuffer cmd);
+        void begin_zone(VkCommandBuffer cmd, const std::string& name);
+        void end_zone(VkCommandBuffer cmd);
+
+        /* The most recent frame whose results have been resolved. */
+        const GpuFrameTimings& last_frame() const { return self->resolved; }
+
+        /* Draws last_frame() as an indented tree, call between ImGui::NewFrame() and ImGui::Render(). */
+        void draw_imgui(const char* title = "GPU Profiler") const;
+
+        bool is_supported() const { return self->supported; }
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            uint32_t    max_zones = 256; // Per frame
+            std::string label = "unnamed gpu profiler";
+        };
+
+        struct Zone {
+            std::string name;
+            uint32_t depth;
+            int32_t  parent;
+        };
+
+        struct Slot {
+            VkQueryPool pool = VK_NULL_HANDLE;
+            std::vector<Zone> zones = {};
+            std::vector<int32_t> stack = {};
+            uint64_t frame = 0;
+            uint32_t dropped = 0;
+            bool     recorded = false;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            std::vector<Slot> slots = {};
+            uint32_t max_zones = 0;
+            double   period_ns = 1.0;      // timestampPeriod
+            uint64_t valid_mask = ~0ull;   // From timestampValidBits
+            bool     supported = true;
+            uint32_t current_slot = 0;
+            GpuFrameTimings resolved = {};
+            std::string label;
+
+            ~Inner(){
+                if(!renderer.is_valid()) return;
+
+                for(auto& slot : slots){
+                    renderer.defer_destroy([device = renderer.inner()->device, pool = slot.pool](){
+                        vkDestroyQueryPool(device, pool, nullptr);
+                    });
+                }
+            }
+        };
+
+        std::shared_ptr<Inner> self;
+
+        GpuProfiler(VulkanRenderer renderer, const Config& config);
+        void resolve(Slot& slot);
+
+        friend class GpuProfilerInit;
+    };
+
+    class GpuProfilerInit {
+    public:
+        GpuProfilerInit() = default;
+
+        GpuProfilerInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /* Maximum number of zones per frame, each zone uses two timestamp queries. */
+        GpuProfilerInit& set_max_zones(uint32_t max){
+            m_config.max_zones = max;
+            return *this;
+        }
+
+        GpuProfiler init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        GpuProfiler::Config m_config = {};
+    };
+}
@@ -0,0 +1,282 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#include "renderer.hpp"
+#include "image.hpp"
+#include "buffer.hpp"
+#include "command_buffer.hpp"
+#include "resource_state.hpp"
+
+#include <optional>
+#include <functional>
+
+namespace g_app {
+    struct RenderGraphImage {
+        uint32_t index = UINT32_MAX;
+        bool is_valid() const { return index != UINT32_MAX; }
+    };
+
+    struct RenderGraphBuffer {
+        uint32_t index = UINT32_MAX;
+        bool is_valid() const { return index != UINT32_MAX; }
+    };
+
+    /* Description of a transient image, owned by the graph. */
+    struct RenderGraphImageDesc {
+        VkExtent2D extent = {0, 0};
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        uint32_t mip_levels = 1;
+        uint32_t array_layers = 1;
+        VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    };
+
+    struct RenderGraphStats {
+        uint32_t pass_count = 0;
+        uint32_t culled_pass_count = 0;
+        uint32_t transient_image_count = 0;
+        VkDeviceSize transient_bytes = 0;   // Sum of every transient image's memory requirements
+        VkDeviceSize allocated_bytes = 0;   // Memory actually allocated after aliasing
+    };
+
+    class RenderGraph;
+
+    /* Returned by RenderGraph::add_pass() to declare what the pass accesses. */
+    class RenderGraphPassBuilder {
+    public:
+        RenderGraphPassBuilder(RenderGraph& graph, uint32_t pass): m_graph{graph}, m_pass{pass} {}
+
+        RenderGraphPassBuilder& read(RenderGraphImage image, ResourceUsage usage);
+        /*
+         * layout_after is the layout the pass leaves the image in when it differs from usage's layout,
+         * e.g. the finalLayout of the render pass that writes it.
+         */
+        RenderGraphPassBuilder& write(RenderGraphImage image, ResourceUsage usage,
+                                      std::optional<VkImageLayout> layout_after = std::nullopt);
+        RenderGraphPassBuilder& read(RenderGraphBuffer buffer, ResourceUsage usage);
+        RenderGraphPassBuilder& write(RenderGraphBuffer buffer, ResourceUsage usage);
+        /*
+         * The graph begins dynamic rendering into the pass's attachments before it runs and ends it afterwards, so the
+         * pass only records draws. Declares the attachment write as well. The render area is the first attachment's
+         * extent. Requires VulkanRendererInit::enable_dynamic_rendering(), imported attachments need a view.
+         */
+        RenderGraphPassBuilder& add_color_attachment(RenderGraphImage image,
+                                                     VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                     VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE,
+                                                     VkClearColorValue clear_value = {});
+        RenderGraphPassBuilder& set_depth_attachment(RenderGraphImage image,
+                                                     VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR,
+                                                     VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+                                                     VkClearDepthStencilValue clear_value = {1.0f, 0});
+        /* VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT when the pass records its draws into secondaries. */
+        RenderGraphPassBuilder& set_rendering_flags(VkRenderingFlags flags);
+        /* The pass is never culled, even if nothing reads what it writes. */
+        RenderGraphPassBuilder& set_side_effects();
+    private:
+        RenderGraph& m_graph;
+        uint32_t m_pass;
+    };
+
+    class RenderGraphInit;
+
+    /*
+     * Frame graph on top of CommandBuffer. Passes are added with the resources they read and write, compile() culls
+     * passes that contribute nothing to an imported resource (or a pass with side effects), orders the rest by their
+     * dependencies and places transient images whose lifetimes don't overlap into shared memory. execute() records
+     * the passes, with the minimal barriers between them coming from CommandBuffer::require().
+     *
+     *   auto hdr = graph.create_image("hdr", {extent, VK_FORMAT_R16G16B16A16_SFLOAT});
+     *   auto out = graph.import_image("output", output_image, ResourceUsage::FRAGMENT_SHADER_READ);
+     *   graph.add_pass("scene", [&](CommandBuffer& cmd){ ... }).add_color_attachment(hdr);
+     *   graph.add_pass("tonemap", [&](CommandBuffer& cmd){ ... })
+     *        .read(hdr, ResourceUsage::FRAGMENT_SHADER_READ).add_color_attachment(out);
+     *   graph.compile(); // Once, and again after the graph or a transient's description changes
+     *   graph.execute(cmd); // Every frame, outside of a render pass
+     *
+     * Passes with attachments are recorded between begin_rendering() and end_rendering() by the graph, passes without
+     * them begin their own render pass if they need one. Transient images and their views are available through
+     * image()/view() after compile(), e.g. for descriptor writes. Transient contents never survive from one frame to the next.
+     */
+    class RenderGraph {
+    public:
+        RenderGraph() = default;
+
+        RenderGraphImage create_image(const std::string& name, const RenderGraphImageDesc& desc);
+        /* final_usage is the state the image is left in after execute(), for use outside of the graph.
+         * The view is only needed when a pass uses the image as an attachment. */
+        RenderGraphImage import_image(const std::string& name, const Image& image,
+                                      std::optional<ResourceUsage> final_usage = std::nullopt, const ImageView& view = {});
+        template<typename T>
+        RenderGraphBuffer import_buffer(const std::string& name, const Buffer<T>& buffer,
+                                        std::optional<ResourceUsage> final_usage = std::nullopt){
+            BufferResource resource = {};
+            resource.name = name;
+            resource.final_usage = final_usage;
+            resource.require = [buffer](CommandBuffer& cmd, ResourceUsage usage){ cmd.require(buffer, usage); };
+            self->buffers.push_back(std::move(resource));
+            self->compiled = false;
+            return {static_cast<uint32_t>(self->buffers.size() - 1)};
+        }
+
+        /* Swaps the image behind an imported handle, e.g. to the current frame's target. Doesn't need a recompile. */
+        void set_imported_image(RenderGraphImage handle, const Image& image, const ImageView& view = {});
+        /* Changes a transient's description, e.g. on resize. Needs a recompile. */
+        void set_image_desc(RenderGraphImage handle, const RenderGraphImageDesc& desc);
+
+        RenderGraphPassBuilder add_pass(const std::string& name, std::function<void(CommandBuffer&)>&& execute);
+
+        void compile();
+        void execute(CommandBuffer& cmd);
+
+        const Image& image(RenderGraphImage handle) const;
+        const ImageView& view(RenderGraphImage handle) const;
+        const RenderGraphStats& stats() const { return self->stats; }
+        bool is_compiled() const { return self->compiled; }
+
+        /* Names of the passes in execution order, culled passes excluded. */
+        std::vector<std::string> execution_order() const;
+
+        bool is_valid() const { return self != nullptr; }
+    private:
+        struct Config {
+            std::string label = "unnamed render graph";
+        };
+
+        struct Access {
+            uint32_t resource = 0;
+            bool image = true;
+            ResourceUsage usage = ResourceUsage::FRAGMENT_SHADER_READ;
+            bool write = false;
+            std::optional<VkImageLayout> layout_after = std::nullopt;
+        };
+
+        struct Attachment {
+            uint32_t image = 0;
+            VkAttachmentLoadOp load_op = VK_ATTACHMENT_LOAD_OP_CLEAR;
+            VkAttachmentStoreOp store_op = VK_ATTACHMENT_STORE_OP_STORE;
+            VkClearValue clear_value = {};
+        };
+
+        struct Pass {
+            std::string name;
+            std::function<void(CommandBuffer&)> execute;
+            std::vector<Access> accesses = {};
+            bool side_effects = false;
+            std::vector<Attachment> color_attachments = {};
+            std::optional<Attachment> depth_attachment = std::nullopt;
+            VkRenderingFlags rendering_flags = 0;
+            std::optional<RenderingInfo> rendering = std::nullopt; // Built from the attachments, kept between frames
+        };
+
+        struct ImageResource {
+            std::string name;
+            bool imported = false;
+            std::optional<ResourceUsage> final_usage = std::nullopt;
+            RenderGraphImageDesc desc = {};
+            Image image = {};
+            ImageView view = {};
+            // Set by compile()
+            uint32_t first_use = UINT32_MAX; // Position in the execution order
+            uint32_t last_use = 0;
+            uint32_t memory_block = UINT32_MAX;
+            uint32_t alias_previous = UINT32_MAX; // Transient that used the memory before this one
+        };
+
+        struct BufferResource {
+            std::string name;
+            std::optional<ResourceUsage> final_usage = std::nullopt;
+            std::function<void(CommandBuffer&, ResourceUsage)> require;
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            std::string label;
+            std::vector<Pass> passes = {};
+            std::vector<ImageResource> images = {};
+            std::vector<BufferResource> buffers = {};
+            std::vector<uint32_t> order = {}; // Indices into passes, culled passes left out
+            std::vector<VmaAllocation> memory_blocks = {};
+            RenderGraphStats stats = {};
+            bool compiled = false;
+            bool rendering_dirty = false; // An imported attachment changed since the rendering infos were built
+
+            ~Inner(){
+                if(!renderer.is_valid()) return;
+                // Images are released before the memory they alias
+                images.clear();
+                free_memory_blocks();
+            }
+
+            void free_memory_blocks(){
+                for(auto allocation : memory_blocks){
+                    renderer.defer_destroy([allocator = renderer.inner()->allocator, allocation = allocation](){
+                        vmaFreeMemory(allocator, allocation);
+                    });
+                }
+                memory_blocks.clear();
+            }
+        };
+
+        std::shared_ptr<Inner> self;
+
+        RenderGraph(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+            self->label = config.label;
+        }
+
+        void sort_and_cull();
+        void allocate_transients();
+        void build_rendering_infos();
+
+        friend class RenderGraphPassBuilder;
+        friend class RenderGraphInit;
+    };
+
+    class RenderGraphInit {
+    public:
+        RenderGraphInit() = default;
+
+        RenderGraphInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        RenderGraph init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        RenderGraph::Config m_config = {};
+    };
+}
@@ -68,7 +68,9 @@ namespace g_app {
             ~Inner(){
                 if(!renderer.is_valid()) return;
 
-                vkDestroyRenderPass(renderer.inner()->device, render_pass, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, render_pass = render_pass](){
+                    vkDestroyRenderPass(device, render_pass, nullptr);
+                });
             }
         };
 
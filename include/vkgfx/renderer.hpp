@@ -43,8 +43,16 @@
 #include <string>
 #include <memory>
 #include <vector>
+#include <functional>
+#include <algorithm>
+#include <mutex>
+#include <deque>
+#include <array>
+#include <unordered_map>
 
 #include "types.hpp"
+#include "trace.hpp"
+#include "frame_pacer.hpp"
 
 namespace g_app {
     enum class Queue {
@@ -59,12 +67,36 @@ namespace g_app {
         uint32_t count = 0;
     };
 
+    /* A fence borrowed from the renderer's fence pool. The generation is bumped every time the
+     * pool recycles the fence, so a stale handle can tell that its submission has long completed. */
+    struct PooledFence {
+        uint32_t index = 0;
+        uint64_t generation = 0;
+        VkFence  fence = VK_NULL_HANDLE;
+    };
+
+    /* A fence owned by the caller of CommandBuffer::submit(). A fence can only be reset once its submission has completed,
+     * so when VulkanRenderer::reset_fence() has changed the generation since, the submission is known to be done. */
+    struct TrackedFence {
+        VkFence  fence = VK_NULL_HANDLE;
+        uint64_t generation = 0;
+    };
+
+    /* A value on a timeline semaphore. The point is reached once the semaphore's counter is >= value. */
+    struct TimelinePoint {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        uint64_t    value = 0;
+    };
+
     class VulkanRendererInit;
     class RenderPass;
+    class UploadManager;
+    struct UploadState;
 
     class VulkanRenderer {
     public:
-        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+        /* Upper bound for VulkanRendererInit::set_frames_in_flight(), use frames_in_flight() for the actual count. */
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
         static constexpr VkFormat TARGET_SWAPCHAIN_FORMAT = VK_FORMAT_B8G8R8A8_UNORM;
 
         struct SwapchainDepthResources {
@@ -77,6 +109,7 @@ namespace g_app {
         struct Swapchain {
             VkSwapchainKHR swapchain = VK_NULL_HANDLE;
             std::vector<VkImage> images = {};
+            std::vector<VmaAllocation> allocations = {}; // Only used by the offscreen images of a headless renderer
             std::vector<VkImageView> image_views = {};
             SwapchainDepthResources depth_resources = {};
             std::vector<VkFramebuffer> framebuffers = {};
@@ -91,37 +124,109 @@ namespace g_app {
                     vmaDestroyImage(allocator, depth_resources.images[i], depth_resources.allocations[i]);
                     vkDestroyImageView(device, depth_resources.image_views[i], nullptr);
                     vkDestroyImageView(device, image_views[i], nullptr);
+                    if(!allocations.empty()) vmaDestroyImage(allocator, images[i], allocations[i]);
                 }
-                vkDestroySwapchainKHR(device, swapchain, nullptr);
+                if(swapchain != VK_NULL_HANDLE) vkDestroySwapchainKHR(device, swapchain, nullptr);
             }
         };
 
+        struct FencePoolEntry {
+            VkFence  fence = VK_NULL_HANDLE;
+            uint64_t generation = 0;
+            bool     in_use = false;
+        };
+
+        struct QueueTimeline {
+            VkSemaphore semaphore = VK_NULL_HANDLE;
+            uint64_t    value = 0; // Last value handed out for a signal
+        };
+
+        /* Submissions to one queue without timeline semaphores, numbered in submission order. */
+        struct QueueSubmissions {
+            struct Pending {
+                uint64_t     serial = 0;
+                PooledFence  pooled_fence = {};
+                TrackedFence tracked_fence = {};
+            };
+
+            uint64_t submitted = 0; // Serial of the last submission
+            uint64_t completed = 0; // Every submission up to this serial has completed
+            std::vector<Pending> pending = {}; // Oldest first
+        };
+
+        /* Objects released during one frame, destroyed once each queue has completed the serial recorded for it. */
+        struct DeletionBatch {
+            std::array<uint64_t, static_cast<size_t>(Queue::MAX)> serials = {};
+            std::vector<std::function<void()>> destroys = {};
+        };
+
         struct Inner {
             GLFWwindow* window = nullptr;
+            bool headless = false;
             VkInstance instance = VK_NULL_HANDLE;
             VkSurfaceKHR surface = VK_NULL_HANDLE;
             VkPhysicalDevice physical_device = VK_NULL_HANDLE;
             VkDevice device = VK_NULL_HANDLE;
-            std::vector<VkQueue> queues = {};
-            QueueFamilyInfo queue_family_info = {};
+            std::vector<VkQueue> queues = {}; // Indexed by Queue, entries alias when there are no dedicated queues
+            std::vector<uint32_t> queue_families = {}; // Family index of each entry in queues
+            std::vector<uint32_t> unique_queue_families = {};
+            QueueFamilyInfo queue_family_info = {}; // The graphics family
             VmaAllocator allocator = VK_NULL_HANDLE;
-            VkCommandPool command_pool = VK_NULL_HANDLE;
+            std::vector<VkCommandPool> command_pools = {}; // Indexed by Queue, queues of the same family share a pool
             Swapchain swapchain = {};
             VkRenderPass default_render_pass = VK_NULL_HANDLE;
             std::vector<VkSemaphore> image_available_semaphores = {};
             std::vector<VkSemaphore> render_finished_semaphores = {};
             std::vector<VkFence> in_flight_fences = {};
+            std::vector<FencePoolEntry> fence_pool = {};
+            std::unordered_map<VkFence, uint64_t> fence_generations = {}; // Resets of fences passed to submissions
+            uint64_t last_fence_generation = 0; // Generations are unique across fences, so a recycled handle never matches
+            mutable std::mutex fence_mutex; // Guards the above, submissions and releases happen on recording threads
+            bool timeline_semaphores = false;
+            std::vector<QueueTimeline> queue_timelines = {}; // One per entry in queues, empty without timeline semaphores
+            std::vector<uint64_t> frame_timeline_values = {}; // Graphics timeline value each frame slot has to reach
+            bool synchronization2 = false;
+            PFN_vkCmdPipelineBarrier2 cmd_pipeline_barrier2 = nullptr; // Core or KHR entry point, null without synchronization2
+            PFN_vkQueueSubmit2 queue_submit2 = nullptr;
+            bool dynamic_rendering = false;
+            PFN_vkCmdBeginRendering cmd_begin_rendering = nullptr; // Core or KHR entry point, null without dynamic rendering
+            PFN_vkCmdEndRendering cmd_end_rendering = nullptr;
+            bool multi_draw_indirect = false;
+            uint32_t max_draw_indirect_count = 1; // maxDrawIndirectCount, 1 without multiDrawIndirect
+            bool draw_indirect_count = false;
+            PFN_vkCmdDrawIndirectCount cmd_draw_indirect_count = nullptr; // Core or KHR entry point, null without draw indirect count
+            PFN_vkCmdDrawIndexedIndirectCount cmd_draw_indexed_indirect_count = nullptr;
+            bool command_capture = false; // Pipelines and shader modules keep what they were built from
+            std::vector<QueueSubmissions> queue_submissions = {}; // One per entry in queues, unused with timeline semaphores
+            std::vector<std::function<void()>> frame_deletions = {}; // Released since the last present()
+            std::deque<DeletionBatch> deletion_batches = {}; // Oldest first, serials only ever increase
+            std::mutex deletion_mutex; // Objects can be released from recording threads
+            std::shared_ptr<UploadState> upload_state = nullptr; // Created on the first call to uploads()
+            VkDeviceSize upload_staging_size = 0;
             VkDescriptorPool descriptor_pool = VK_NULL_HANDLE;
             bool cleanup_imgui = false;
             std::unordered_map<std::string, PFN_vkVoidFunction> ext_pfn = {};
 
             uint32_t current_frame = 0;
+            uint32_t frames_in_flight = 2;
             uint32_t current_image = 0;
+            uint64_t swapchain_generation = 0; // Incremented by every recreate_swapchain()
+            uint64_t frame_count = 0; // Frames presented since initialisation
+            FramePacer pacer = {};
+            uint32_t frame_rate_limit = 0; // Requested by the application
+            uint32_t frame_rate_override = 0; // Set by the App while unfocused
 
             ~Inner(){
+                if(device != VK_NULL_HANDLE) vkDeviceWaitIdle(device);
+                for(auto& batch : deletion_batches){
+                    for(auto& destroy : batch.destroys) destroy();
+                }
+                for(auto& destroy : frame_deletions) destroy();
+                upload_state.reset();
+
                 if(cleanup_imgui){
                     ImGui_ImplVulkan_Shutdown();
-                    ImGui_ImplGlfw_Shutdown();
+                    if(!headless) ImGui_ImplGlfw_Shutdown();
                     ImGui::DestroyContext();
                     vkDestroyDescriptorPool(device, descriptor_pool, nullptr);
                 }
@@ -130,14 +235,25 @@ namespace g_app {
                 for(uint32_t i = 0; i < image_available_semaphores.size(); i++) {
                     vkDestroySemaphore(device, image_available_semaphores[i], nullptr);
                     vkDestroySemaphore(device, render_finished_semaphores[i], nullptr);
-                    vkDestroyFence(device, in_flight_fences[i], nullptr);
+                }
+                for(auto fence : in_flight_fences){
+                    vkDestroyFence(device, fence, nullptr);
+                }
+                for(auto& entry : fence_pool){
+                    vkDestroyFence(device, entry.fence, nullptr);
+                }
+                for(auto& timeline : queue_timelines){
+                    vkDestroySemaphore(device, timeline.semaphore, nullptr);
                 }
                 vkDestroyRenderPass(device, default_render_pass, nullptr);
                 swapchain.destroy(device, allocator);
-                vkDestroyCommandPool(device, command_pool, nullptr);
+                for(size_t i = 0; i < command_pools.size(); i++){
+                    if(std::find(command_pools.begin(), command_pools.begin() + i, command_pools[i]) != command_pools.begin() + i) continue;
+                    vkDestroyCommandPool(device, command_pools[i], nullptr);
+                }
                 vmaDestroyAllocator(allocator);
                 vkDestroyDevice(device, nullptr);
-                vkDestroySurfaceKHR(instance, surface, nullptr);
+                if(surface != VK_NULL_HANDLE) vkDestroySurfaceKHR(instance, surface, nullptr);
                 vkDestroyInstance(instance, nullptr);
             }
         };
@@ -147,7 +263,15 @@ namespace g_app {
         VulkanRenderer& operator = (const VulkanRenderer&) = default;
 
         bool acquire_next_swapchain_image();
-        void begin_default_render_pass(VkCommandBuffer cmd, float r, float g, float b, float a);
+        void begin_default_render_pass(VkCommandBuffer cmd, float r, float g, float b, float a,
+                                       VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
+        /*
+         * Dynamic rendering counterpart of begin_default_render_pass(), renders into the current swapchain image and its
+         * depth image without the default render pass or framebuffers. end_default_rendering() leaves the image ready
+         * to be presented (or read back when headless).
+         */
+        void begin_default_rendering(VkCommandBuffer cmd, float r, float g, float b, float a, VkRenderingFlags flags = 0);
+        void end_default_rendering(VkCommandBuffer cmd);
         void present();
         
         template<typename T>
@@ -163,16 +287,51 @@ namespace g_app {
         }
 
         VkFormat chosen_swapchain_format() const { return self->swapchain.format; }
+        VkFormat chosen_depth_format() const { return self->swapchain.depth_resources.format; }
         VkExtent2D swapchain_extent() const { return self->swapchain.extent; }
+        uint32_t swapchain_image_count() const { return static_cast<uint32_t>(self->swapchain.images.size()); }
+        VkImage current_swapchain_image() const { return self->swapchain.images[current_image()]; }
+        VkFramebuffer current_framebuffer() const { return self->swapchain.framebuffers[current_image()]; }
+
+        /* A headless renderer has no window or surface, the swapchain is replaced by a ring of offscreen images. */
+        bool is_headless() const { return self->headless; }
 
         uint32_t current_frame() const { return self->current_frame; }
+        /* Number of frames the CPU may record ahead of the GPU, size per-frame resources with this (or use PerFrame<T>). */
+        uint32_t frames_in_flight() const { return self->frames_in_flight; }
         uint32_t current_image() const { return self->current_image; }
+        /* Changes whenever the swapchain is recreated, its images, views and framebuffers are new objects from then on. */
+        uint64_t swapchain_generation() const { return self->swapchain_generation; }
+        /* Caps the frame rate, present() blocks until the frame's deadline. 0 removes the limit. Can be changed at any time. */
+        void set_frame_rate_limit(uint32_t limit){
+            self->frame_rate_limit = limit;
+            apply_frame_rate_limit();
+        }
+        /* The limit last set by the application, not lowered by the override. */
+        uint32_t frame_rate_limit() const { return self->frame_rate_limit; }
+        /*
+         * Temporary cap on top of the application's limit, e.g. while the window is unfocused. The lower of the two
+         * applies and the application's limit comes back once the override is set to 0.
+         */
+        void set_frame_rate_override(uint32_t limit){
+            self->frame_rate_override = limit;
+            apply_frame_rate_limit();
+        }
+        /* What present() currently paces to. */
+        uint32_t effective_frame_rate_limit() const { return self->pacer.target_fps(); }
+        const FramePacingStats& frame_pacing_stats() const { return self->pacer.stats(); }
+
+        /* Monotonic frame counter, incremented by every present(). */
+        uint64_t frame_count() const { return self->frame_count; }
 
         bool is_valid() const { return self != nullptr; }
 
         VkSemaphore current_image_available_semaphore() const { return self->image_available_semaphores[current_frame()]; }
         VkSemaphore current_render_finished_semaphore() const { return self->render_finished_semaphores[current_frame()]; }
-        VkFence current_in_flight_fence() const { return self->in_flight_fences[current_frame()]; }
+        /* VK_NULL_HANDLE when timeline semaphores are enabled, frames are then tracked on the graphics timeline. */
+        VkFence current_in_flight_fence() const {
+            return (self->in_flight_fences.empty()) ? VK_NULL_HANDLE : self->in_flight_fences[current_frame()];
+        }
 
         VkRenderPass default_render_pass() const { return self->default_render_pass; }
 
@@ -186,21 +345,143 @@ namespace g_app {
             vkGetPhysicalDeviceFeatures(self->physical_device, &features);
             return features;
         }
-        VkQueue get_queue(Queue queue) const {
-            if(static_cast<size_t>(queue) >= self->queues.size()){
-                return self->queues[std::clamp<size_t>(static_cast<size_t>(queue), 0, self->queues.size()-1)];
-            }
-            return self->queues[static_cast<uint32_t>(queue)];
+        /*
+         * TRANSFER and COMPUTE come from dedicated transfer-only and compute-only families when the device has them
+         * (see VulkanRendererInit::set_dedicated_queues()), otherwise they are extra queues of the graphics family,
+         * or the graphics queue itself when the family runs out of queues.
+         */
+        VkQueue get_queue(Queue queue) const { return self->queues[queue_index(queue)]; }
+        uint32_t queue_index(Queue queue) const { return static_cast<uint32_t>(queue); }
+        uint32_t queue_family_index(Queue queue) const { return self->queue_families[queue_index(queue)]; }
+        /* True when the queue belongs to a different family than GRAPHICS. Resources with exclusive sharing then
+         * need a queue family ownership transfer, see PipelineBarrierInfoBuilder::set_queue_family_transfer(). */
+        bool has_dedicated_queue(Queue queue) const { return queue_family_index(queue) != self->queue_family_info.index; }
+        /* Every family a queue was created from, used for VK_SHARING_MODE_CONCURRENT resources. */
+        const std::vector<uint32_t>& unique_queue_families() const { return self->unique_queue_families; }
+        /* Pool of the queue's family, command buffers must be submitted to a queue of the same family. */
+        VkCommandPool command_pool(Queue queue = Queue::GRAPHICS) const { return self->command_pools[queue_index(queue)]; }
+
+        /*
+         * Timeline semaphores (Vulkan 1.2), see VulkanRendererInit::enable_timeline_semaphores().
+         * Every queue owns one timeline whose value increases with each submission, CommandBuffer::submit() signals it
+         * and backs its SubmitTicket with the signalled point instead of a pooled fence.
+         */
+        bool has_timeline_semaphores() const { return self->timeline_semaphores; }
+        /* Reserves the next value on the queue's timeline, the caller must signal it in a submission to that queue. */
+        TimelinePoint next_timeline_point(Queue queue);
+        /* The most recently reserved point on the queue's timeline, wait on it to depend on all work submitted so far. */
+        TimelinePoint queue_timeline_point(Queue queue) const;
+        /* Current counter value of a timeline semaphore. */
+        uint64_t timeline_value(VkSemaphore semaphore) const;
+        bool is_timeline_point_reached(const TimelinePoint& point) const;
+        bool wait_timeline_point(const TimelinePoint& point, uint64_t timeout = UINT64_MAX) const;
+
+        /*
+         * Synchronization2 (Vulkan 1.3 or VK_KHR_synchronization2), see VulkanRendererInit::enable_synchronization2().
+         * CommandBuffer::submit() goes through vkQueueSubmit2 and CommandBuffer::pipeline_barrier() accepts a DependencyInfo.
+         */
+        bool has_synchronization2() const { return self->synchronization2; }
+        void cmd_pipeline_barrier2(VkCommandBuffer cmd, const VkDependencyInfo& info) const {
+            assert(self->synchronization2 && "Synchronization2 isn't enabled!");
+            self->cmd_pipeline_barrier2(cmd, &info);
+        }
+        VkResult queue_submit2(Queue queue, const VkSubmitInfo2& submit_info, VkFence fence) const {
+            assert(self->synchronization2 && "Synchronization2 isn't enabled!");
+            return self->queue_submit2(get_queue(queue), 1, &submit_info, fence);
         }
 
+        /*
+         * Dynamic rendering (Vulkan 1.3 or VK_KHR_dynamic_rendering), see VulkanRendererInit::enable_dynamic_rendering().
+         * Lets CommandBuffer::begin_rendering() render into image views without a RenderPass or Framebuffer.
+         */
+        bool has_dynamic_rendering() const { return self->dynamic_rendering; }
+        void cmd_begin_rendering(VkCommandBuffer cmd, const VkRenderingInfo& info) const {
+            assert(self->dynamic_rendering && "Dynamic rendering isn't enabled!");
+            self->cmd_begin_rendering(cmd, &info);
+        }
+        void cmd_end_rendering(VkCommandBuffer cmd) const {
+            assert(self->dynamic_rendering && "Dynamic rendering isn't enabled!");
+            self->cmd_end_rendering(cmd);
+        }
+
+        /* Whether a single indirect draw can read more than one command. Without it CommandBuffer issues one draw per command. */
+        bool has_multi_draw_indirect() const { return self->multi_draw_indirect; }
+        /* Most commands a single indirect draw can read. */
+        uint32_t max_draw_indirect_count() const { return self->max_draw_indirect_count; }
+
+        /*
+         * Draw counts read from a buffer (Vulkan 1.2 or VK_KHR_draw_indirect_count), see
+         * VulkanRendererInit::enable_draw_indirect_count() and CommandBuffer::draw_indexed_indirect_count().
+         */
+        bool has_draw_indirect_count() const { return self->draw_indirect_count; }
+        void cmd_draw_indirect_count(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkBuffer count_buffer,
+                                     VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride) const {
+            assert(self->draw_indirect_count && "Draw indirect count isn't enabled!");
+            self->cmd_draw_indirect_count(cmd, buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+        }
+        void cmd_draw_indexed_indirect_count(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize offset, VkBuffer count_buffer,
+                                             VkDeviceSize count_offset, uint32_t max_draw_count, uint32_t stride) const {
+            assert(self->draw_indirect_count && "Draw indirect count isn't enabled!");
+            self->cmd_draw_indexed_indirect_count(cmd, buffer, offset, count_buffer, count_offset, max_draw_count, stride);
+        }
+
+        /* Whether pipelines can be recreated by a CommandReplay, see VulkanRendererInit::enable_command_capture(). */
+        bool has_command_capture() const { return self->command_capture; }
+
+        /* Fences used to track asynchronous submissions. Signalled fences are reset and handed out again,
+         * so steady state submission never creates new fence objects. */
+        PooledFence acquire_pooled_fence();
+        bool is_pooled_fence_signaled(const PooledFence& fence) const;
+        bool wait_pooled_fence(const PooledFence& fence, uint64_t timeout = UINT64_MAX) const;
+
+        /*
+         * Caller owned fences signalled by a submission, e.g. current_in_flight_fence(). Reset them through reset_fence()
+         * rather than vkResetFences, so tickets backed by them know the submission completed before the reset.
+         */
+        TrackedFence track_fence(VkFence fence);
+        void reset_fence(VkFence fence);
+        bool is_tracked_fence_signaled(const TrackedFence& fence) const;
+        bool wait_tracked_fence(const TrackedFence& fence, uint64_t timeout = UINT64_MAX) const;
+
+        /*
+         * Queues the destruction of a Vulkan object until everything submitted to any queue by the end of the current
+         * frame has completed. The next present() stamps it with the last submission of every queue (its timeline value
+         * with timeline semaphores), acquire_next_swapchain_image() destroys it once all of them have completed.
+         * Every wrapper releases its handles through this, so dropping a resource never stalls on the GPU.
+         */
+        void defer_destroy(std::function<void()>&& destroy);
+
+        /*
+         * Numbers a submission to 'queue' that signals one of the fences, deferred destructions wait on it.
+         * Called by CommandBuffer::submit() and the UploadManager, only raw vkQueueSubmit calls that use resources
+         * need it. Does nothing with timeline semaphores, every submission already advances its queue's timeline.
+         */
+        void track_submission(Queue queue, const PooledFence& pooled_fence, const TrackedFence& tracked_fence = {});
+
+        /* The renderer's staging ring, see upload.hpp. */
+        UploadManager uploads() const;
+
+        /* Also destroys every released object. */
         void device_wait_idle(){
             vkDeviceWaitIdle(self->device);
+            retire_deletions(true);
         }
 
         std::shared_ptr<Inner> inner() { return self; }
 
         static constexpr uint32_t MAX_QUEUE_COUNT = 3;
     private:
+        void apply_frame_rate_limit(){
+            auto limit = self->frame_rate_limit;
+            auto override_limit = self->frame_rate_override;
+            // 0 means unlimited, so it loses to any real limit
+            if(override_limit != 0 && (limit == 0 || override_limit < limit)) limit = override_limit;
+            if(self->pacer.target_fps() != limit) self->pacer.set_target_fps(limit);
+        }
+
+        /* Pending submissions per queue before track_submission() polls their fences itself. */
+        static constexpr size_t MAX_PENDING_SUBMISSIONS = 64;
+
         struct Config {
             uint32_t api_version = VK_API_VERSION_1_3;
             uint32_t app_version = VK_MAKE_VERSION(1, 0, 0);
@@ -212,6 +493,17 @@ namespace g_app {
             VkPhysicalDeviceFeatures enabled_features = {};
             uint32_t    frame_rate_limit = 0; // Leave 0 for unlimited
             std::vector<const char*> pfnload = {};
+            bool        headless = false;
+            VkExtent2D  headless_extent = {800, 600};
+            uint32_t    headless_image_count = 3;
+            VkDeviceSize upload_staging_size = 64 * 1024 * 1024;
+            uint32_t    frames_in_flight = 2;
+            bool        timeline_semaphores = false;
+            bool        synchronization2 = false;
+            bool        dynamic_rendering = false;
+            bool        draw_indirect_count = false;
+            bool        command_capture = false;
+            bool        dedicated_queues = false;
         };
 
         /* All vulkan object abstractions are contained within a shared_ptr to allow for easy copying without worrying about
@@ -225,13 +517,18 @@ namespace g_app {
         void init_device(const Config& config);
         void load_extensions(const Config& config);
         void init_allocator(const Config& config);
-        void init_command_pool();
+        void init_command_pools();
         void init_swapchain(VkSwapchainKHR old_swapchain=VK_NULL_HANDLE);
+        void init_headless_swapchain(const Config& config);
         void init_default_render_pass();
         void init_framebuffers();
         void init_sync_objects();
         void init_descriptor_pool();
         void recreate_swapchain();
+        uint64_t submitted_serial(uint32_t queue) const;
+        uint64_t completed_serial(uint32_t queue);
+        void retire_deletions(bool all = false);
+        void advance_frame();
 
         friend class VulkanRendererInit;
     };
@@ -272,6 +569,15 @@ namespace g_app {
             m_config.enabled_features = features;
             return *this;
         }
+        /*
+         * How many frames the CPU may record while the GPU is still working on earlier ones, from 1 to MAX_FRAMES_IN_FLIGHT.
+         * Fewer frames lower input latency, more frames absorb CPU/GPU spikes at the cost of latency. 2 by default.
+         */
+        VulkanRendererInit& set_frames_in_flight(uint32_t count){
+            m_config.frames_in_flight = std::clamp(count, 1u, VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
+            return *this;
+        }
+        /* Initial frame rate limit, see VulkanRenderer::set_frame_rate_limit(). */
         VulkanRendererInit& set_frame_rate_limit(uint32_t limit){
             m_config.frame_rate_limit = limit;
             return *this;
@@ -280,9 +586,85 @@ namespace g_app {
             m_config.pfnload = names;
             return *this;
         }
+        /* Runs without a window or surface. Frames are rendered into 'image_count' offscreen images of the given size,
+         * which stand in for the swapchain images. Pass nullptr to init() when this is set. */
+        VulkanRendererInit& set_headless(uint32_t width, uint32_t height, uint32_t image_count = 3){
+            m_config.headless = true;
+            m_config.headless_extent = {width, height};
+            m_config.headless_image_count = std::max(image_count, 1u);
+            return *this;
+        }
+
+        /* Size in bytes of the persistently mapped staging ring used by uploads(). Uploads larger than this
+         * fall back to a dedicated staging buffer. */
+        VulkanRendererInit& set_upload_staging_size(VkDeviceSize size){
+            m_config.upload_staging_size = size;
+            return *this;
+        }
 
-        VulkanRenderer init(GLFWwindow* window) const {
+        /*
+         * Creates TRANSFER and COMPUTE from dedicated transfer-only and compute-only queue families when the device
+         * exposes them, so uploads and compute can overlap graphics. Disabled by default, command buffers submitted to
+         * TRANSFER or COMPUTE then have to be allocated for that queue, see CommandBuffer(renderer, queue).
+         */
+        VulkanRendererInit& set_dedicated_queues(bool dedicated){
+            m_config.dedicated_queues = dedicated;
+            return *this;
+        }
+
+        /*
+         * Tracks frames and submissions with one timeline semaphore per queue instead of fences (requires Vulkan 1.2
+         * or VK_KHR_timeline_semaphore). Falls back to fences with a warning when the device doesn't support them.
+         */
+        VulkanRendererInit& enable_timeline_semaphores(){
+            m_config.timeline_semaphores = true;
+            return *this;
+        }
+
+        /*
+         * Enables vkCmdPipelineBarrier2 and vkQueueSubmit2, which take per-barrier stage masks with finer stages such as
+         * COPY, BLIT and CLEAR (requires Vulkan 1.3 or VK_KHR_synchronization2). Falls back to the legacy path with a
+         * warning when the device doesn't support it.
+         */
+        VulkanRendererInit& enable_synchronization2(){
+            m_config.synchronization2 = true;
+            return *this;
+        }
+
+        /*
+         * Enables CommandBuffer::begin_rendering() and GraphicsPipelineInit::set_rendering_formats(), which replace
+         * RenderPass and Framebuffer objects (requires Vulkan 1.3 or VK_KHR_dynamic_rendering). Exits with an error
+         * when the device doesn't support it, since there is no fallback for pipelines built without a render pass.
+         */
+        VulkanRendererInit& enable_dynamic_rendering(){
+            m_config.dynamic_rendering = true;
+            return *this;
+        }
+
+        /*
+         * Enables CommandBuffer::draw_indirect_count() and draw_indexed_indirect_count(), which read the number of draws
+         * from a buffer so a GPU culling pass can decide it (requires Vulkan 1.2 or VK_KHR_draw_indirect_count).
+         * Exits with an error when the device doesn't support it.
+         */
+        VulkanRendererInit& enable_draw_indirect_count(){
+            m_config.draw_indirect_count = true;
+            return *this;
+        }
+
+        /*
+         * Makes shader modules keep their SPIR-V and pipelines keep their configuration, so a CommandCapture can write
+         * them into a trace. Costs a copy of every shader, leave it off outside of capture builds.
+         */
+        VulkanRendererInit& enable_command_capture(){
+            m_config.command_capture = true;
+            return *this;
+        }
+
+        VulkanRenderer init(GLFWwindow* window = nullptr) const {
             try {
+                if(!window && !m_config.headless){
+                    throw std::runtime_error("VulkanRendererInit::init() requires a window unless set_headless() is used.");
+                }
                 return {window, m_config};
             } catch(const std::runtime_error& e) {
                 spdlog::error(e.what());
@@ -0,0 +1,218 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+namespace g_app {
+    /*
+     * How a command buffer is about to use an image or buffer, see CommandBuffer::require().
+     * The layout only applies to images.
+     */
+    enum class ResourceUsage {
+        TRANSFER_READ,
+        TRANSFER_WRITE,
+        VERTEX_BUFFER,
+        INDEX_BUFFER,
+        INDIRECT_BUFFER,
+        UNIFORM_BUFFER,         // Any graphics or compute shader
+        VERTEX_SHADER_READ,     // Sampled image or storage buffer read
+        FRAGMENT_SHADER_READ,
+        COMPUTE_SHADER_READ,
+        COMPUTE_SHADER_WRITE,   // Storage image/buffer, GENERAL layout
+        COMPUTE_SHADER_READ_WRITE,
+        COLOR_ATTACHMENT,
+        DEPTH_STENCIL_ATTACHMENT,
+        DEPTH_STENCIL_READ,     // Read only depth, e.g. sampled shadow maps
+        PRESENT,
+        HOST_READ,
+    };
+
+    struct ResourceUsageInfo {
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool write = false;
+    };
+
+    constexpr ResourceUsageInfo resource_usage_info(ResourceUsage usage){
+        constexpr VkPipelineStageFlags all_shaders = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+                                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        switch(usage){
+            case ResourceUsage::TRANSFER_READ:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+            case ResourceUsage::TRANSFER_WRITE:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+            case ResourceUsage::VERTEX_BUFFER:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case ResourceUsage::INDEX_BUFFER:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case ResourceUsage::INDIRECT_BUFFER:
+                return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case ResourceUsage::UNIFORM_BUFFER:
+                return {all_shaders, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case ResourceUsage::VERTEX_SHADER_READ:
+                return {VK_PIPELINE_STAGE_VERTEX_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+            case ResourceUsage::FRAGMENT_SHADER_READ:
+                return {VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+            case ResourceUsage::COMPUTE_SHADER_READ:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+            case ResourceUsage::COMPUTE_SHADER_WRITE:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+            case ResourceUsage::COMPUTE_SHADER_READ_WRITE:
+                return {VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_GENERAL, true};
+            case ResourceUsage::COLOR_ATTACHMENT:
+                return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+            case ResourceUsage::DEPTH_STENCIL_ATTACHMENT:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true};
+            case ResourceUsage::DEPTH_STENCIL_READ:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false};
+            case ResourceUsage::PRESENT:
+                return {VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, false};
+            case ResourceUsage::HOST_READ:
+                return {VK_PIPELINE_STAGE_HOST_BIT, VK_ACCESS_HOST_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+        }
+        return {};
+    }
+
+    /*
+     * The last known use of an image or buffer, in submission order. Kept by Image, Buffer and BufferSlice and updated
+     * when a CommandBuffer that require()d it is submitted, so only the barriers that are actually needed get recorded.
+     */
+    struct ResourceState {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags write_stages = 0; // Last write
+        VkAccessFlags write_access = 0;
+        VkPipelineStageFlags read_stages = 0;  // Reads since the last write, which the write has been made visible to
+        VkAccessFlags read_access = 0;
+    };
+
+    struct ResourceTransition {
+        VkPipelineStageFlags src_stages = 0;
+        VkPipelineStageFlags dst_stages = 0;
+        VkAccessFlags src_access = 0;
+        VkAccessFlags dst_access = 0;
+        VkImageLayout old_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout new_layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        bool needed = false;
+    };
+
+    /*
+     * Moves state to usage and returns the barrier that takes it there. Reads after reads in the same layout need
+     * nothing, reads after a write wait on the write once per stage and writes wait on every earlier access.
+     * discard lets an image transition from UNDEFINED, dropping its contents.
+     */
+    constexpr ResourceTransition transition_resource_state(ResourceState& state, ResourceUsage usage,
+                                                           bool is_image, bool discard = false){
+        auto info = resource_usage_info(usage);
+        ResourceTransition t = {};
+        t.old_layout = (discard) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+        t.new_layout = (is_image) ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        bool layout_change = is_image && state.layout != info.layout;
+
+        if(info.write || layout_change){
+            // Write after read only needs an execution dependency, write after write also needs the writes made available
+            t.src_stages = state.write_stages | state.read_stages;
+            t.src_access = state.write_access;
+            t.needed = layout_change || t.src_stages != 0;
+
+            state.write_stages = info.stages;
+            state.write_access = (info.write) ? info.access & ~(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_READ_BIT |
+                                                                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT)
+                                              : 0;
+            // A layout transition is a write, made visible to this usage by the barrier itself
+            state.read_stages = (info.write) ? 0 : info.stages;
+            state.read_access = (info.write) ? 0 : info.access;
+        } else {
+            bool visible = (state.read_stages & info.stages) == info.stages && (state.read_access & info.access) == info.access;
+            t.needed = state.write_stages != 0 && !visible;
+            t.src_stages = state.write_stages;
+            t.src_access = state.write_access;
+
+            state.read_stages |= info.stages;
+            state.read_access |= info.access;
+        }
+        if(is_image) state.layout = info.layout;
+
+        t.dst_stages = info.stages;
+        t.dst_access = info.access;
+        if(t.src_stages == 0) t.src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        return t;
+    }
+
+    /*
+     * Resolves a command buffer's use of a resource against the state earlier submissions left it in.
+     * 'first' is every use the command buffer made before its first write (or of all of it when it only reads),
+     * 'recorded' its state after the last recorded command. Returns the barrier that has to run before the
+     * command buffer and moves state to where the command buffer leaves it.
+     */
+    constexpr ResourceTransition resolve_resource_state(ResourceState& state, const ResourceUsageInfo& first,
+                                                        const ResourceState& recorded, bool is_image, bool discard = false){
+        ResourceTransition t = {};
+        t.old_layout = (discard) ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+        t.new_layout = (is_image) ? first.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        bool layout_change = is_image && state.layout != first.layout;
+
+        if(first.write || layout_change){
+            t.src_stages = state.write_stages | state.read_stages;
+            t.src_access = state.write_access;
+            t.needed = layout_change || t.src_stages != 0;
+        } else {
+            bool visible = (state.read_stages & first.stages) == first.stages && (state.read_access & first.access) == first.access;
+            t.needed = state.write_stages != 0 && !visible;
+            t.src_stages = state.write_stages;
+            t.src_access = state.write_access;
+        }
+        t.dst_stages = first.stages;
+        t.dst_access = first.access;
+        if(t.src_stages == 0) t.src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+        if(first.write || recorded.write_stages != 0){
+            state = recorded;
+        } else if(layout_change){
+            // The transition is a write the reads after this command buffer still have to wait on
+            state = recorded;
+            state.write_stages = first.stages;
+            state.write_access = 0;
+        } else {
+            state.read_stages |= recorded.read_stages;
+            state.read_access |= recorded.read_access;
+        }
+        return t;
+    }
+}
@@ -0,0 +1,91 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define G_APP_STREAM_COPY_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace g_app {
+    /*
+     * memcpy for write-combined (host visible, uncached) memory such as mapped staging and uniform buffers.
+     * The bulk of the copy uses non-temporal 16 byte stores, which fill whole write-combining lines without
+     * pulling the destination into the cache. Falls back to memcpy when SSE2 isn't available.
+     * Never read back from the destination, write-combined memory is very slow to read.
+     */
+    inline void stream_copy(void* dst, const void* src, size_t size){
+#ifdef G_APP_STREAM_COPY_SSE2
+        auto d = static_cast<uint8_t*>(dst);
+        auto s = static_cast<const uint8_t*>(src);
+
+        // Small copies aren't worth the fence
+        if(size < 64){
+            memcpy(d, s, size);
+            return;
+        }
+
+        // Non-temporal stores need an aligned destination
+        size_t head = (16 - (reinterpret_cast<uintptr_t>(d) & 15)) & 15;
+        memcpy(d, s, head);
+        d += head; s += head; size -= head;
+
+        size_t blocks = size / 64;
+        for(size_t i = 0; i < blocks; i++){
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+            __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 16));
+            __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 32));
+            __m128i e = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 48));
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d), a);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + 16), b);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + 32), c);
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d + 48), e);
+            d += 64; s += 64;
+        }
+        size -= blocks * 64;
+
+        while(size >= 16){
+            _mm_stream_si128(reinterpret_cast<__m128i*>(d), _mm_loadu_si128(reinterpret_cast<const __m128i*>(s)));
+            d += 16; s += 16; size -= 16;
+        }
+        memcpy(d, s, size);
+
+        // Order the streaming stores before anything that hands the memory to the GPU
+        _mm_sfence();
+#else
+        memcpy(dst, src, size);
+#endif
+    }
+}
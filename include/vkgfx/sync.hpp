@@ -47,17 +47,56 @@ namespace g_app {
             }
         }
 
+        /* Creates a timeline semaphore, requires VulkanRendererInit::enable_timeline_semaphores(). */
+        static Semaphore timeline(VulkanRenderer renderer, uint64_t initial_value = 0, const std::string& label = "unnamed timeline semaphore"){
+            assert(renderer.has_timeline_semaphores() && "Timeline semaphores aren't enabled!");
+            Semaphore semaphore = {};
+            semaphore.self = std::make_shared<Inner>(renderer);
+            semaphore.self->label = label;
+            semaphore.self->timeline = true;
+
+            VkSemaphoreTypeCreateInfo type_info = {VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+            type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+            type_info.initialValue = initial_value;
+            VkSemaphoreCreateInfo create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+            create_info.pNext = &type_info;
+
+            VkResult result = VK_SUCCESS;
+            if((result = vkCreateSemaphore(renderer.inner()->device, &create_info, nullptr, &semaphore.self->semaphore)) != VK_SUCCESS){
+                throw std::runtime_error(
+                    std::format("Failed to create a timeline semaphore! label = {}, result = {}", label, static_cast<uint32_t>(result) )
+                );
+            }
+            return semaphore;
+        }
+
         VkSemaphore vk_semaphore() const { return (self) ? self->semaphore : VK_NULL_HANDLE; }
+        bool is_timeline() const { return self && self->timeline; }
+
+        /* Timeline semaphore only helpers. */
+        TimelinePoint at(uint64_t value) const { return {vk_semaphore(), value}; }
+        uint64_t value() const { return self->renderer.timeline_value(self->semaphore); }
+        bool wait(uint64_t value, uint64_t timeout = UINT64_MAX) const { return self->renderer.wait_timeline_point(at(value), timeout); }
+        /* Signals the timeline from the host. */
+        void signal(uint64_t value) const {
+            VkSemaphoreSignalInfo signal_info = {VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO};
+            signal_info.semaphore = self->semaphore;
+            signal_info.value = value;
+            vkSignalSemaphore(self->renderer.inner()->device, &signal_info);
+        }
     private:
         struct Inner {
             ~Inner(){
                 if(!renderer.is_valid()) return;
-                vkDestroySemaphore(renderer.inner()->device, semaphore, nullptr);
+                renderer.defer_destroy([device = renderer.inner()->device, semaphore = semaphore](){
+                    vkDestroySemaphore(device, semaphore, nullptr);
+                });
             }
 
             VulkanRenderer renderer;
             VkSemaphore semaphore;
             std::string label;
+            bool timeline = false;
         };
         std::shared_ptr<Inner> self;
     };
@@ -82,11 +121,23 @@ namespace g_app {
         }
  
         VkFence vk_fence() const { return (self) ? self->fence : VK_NULL_HANDLE; }
+        /* Goes through VulkanRenderer::reset_fence(), which keeps tickets of submissions that signalled this fence valid. */
+        void reset() const {
+            assert(self && self->renderer.is_valid() && "Can't reset a fence that wasn't created through a renderer!");
+            self->renderer.reset_fence(self->fence);
+        }
     private:
         struct Inner {
             ~Inner(){
                 if(!renderer.is_valid()) return;
-                vkDestroyFence(renderer.inner()->device, fence, nullptr);
+                // Weak, the deletion queue lives in the renderer. Tickets still holding the fence then report signalled
+                renderer.defer_destroy([inner = std::weak_ptr(renderer.inner()), device = renderer.inner()->device, fence = fence](){
+                    if(auto renderer = inner.lock()){
+                        std::lock_guard lock(renderer->fence_mutex);
+                        renderer->fence_generations.erase(fence);
+                    }
+                    vkDestroyFence(device, fence, nullptr);
+                });
             }
 
             VulkanRenderer renderer;
@@ -96,4 +147,42 @@ namespace g_app {
 
         std::shared_ptr<Inner> self;
     };
+
+    /* Returned by CommandBuffer::submit(). Tracks the completion of one submission through a pooled fence, the caller's
+     * fence or the point it signalled on its queue's timeline, and is cheap to copy around. A default constructed ticket
+     * is always complete. */
+    class SubmitTicket {
+    public:
+        SubmitTicket() = default;
+        SubmitTicket(VulkanRenderer renderer, const PooledFence& fence): m_renderer{std::move(renderer)}, m_fence{fence} {}
+        SubmitTicket(VulkanRenderer renderer, const TrackedFence& fence): m_renderer{std::move(renderer)}, m_tracked_fence{fence} {}
+        SubmitTicket(VulkanRenderer renderer, const TimelinePoint& point): m_renderer{std::move(renderer)}, m_timeline{point} {}
+
+        bool is_valid() const { return m_renderer.is_valid(); }
+
+        /* Non-blocking check, returns true once the GPU has finished the submission. */
+        bool is_complete() const {
+            if(!is_valid()) return true;
+            if(m_timeline.semaphore != VK_NULL_HANDLE) return m_renderer.is_timeline_point_reached(m_timeline);
+            if(m_tracked_fence.fence != VK_NULL_HANDLE) return m_renderer.is_tracked_fence_signaled(m_tracked_fence);
+            return m_renderer.is_pooled_fence_signaled(m_fence);
+        }
+
+        /* Blocks until the submission has completed or the timeout (in nanoseconds) expires. */
+        bool wait(uint64_t timeout = UINT64_MAX) const {
+            if(!is_valid()) return true;
+            if(m_timeline.semaphore != VK_NULL_HANDLE) return m_renderer.wait_timeline_point(m_timeline, timeout);
+            if(m_tracked_fence.fence != VK_NULL_HANDLE) return m_renderer.wait_tracked_fence(m_tracked_fence, timeout);
+            return m_renderer.wait_pooled_fence(m_fence, timeout);
+        }
+
+        /* The timeline point signalled by the submission, only set when timeline semaphores are enabled.
+         * Other submissions can wait on it through SubmitSyncObjects::timeline_wait. */
+        const TimelinePoint& timeline_point() const { return m_timeline; }
+    private:
+        VulkanRenderer m_renderer = {};
+        PooledFence    m_fence = {};
+        TrackedFence   m_tracked_fence = {};
+        TimelinePoint  m_timeline = {};
+    };
 }
@@ -31,6 +31,7 @@
 #pragma once
 
 #include "command_buffer.hpp"
+#include "upload.hpp"
 
 namespace g_app {
 
@@ -76,7 +77,19 @@ namespace g_app {
             return *this;
         }
 
+        /* Uploads the pixels and waits for the transfer to finish. */
         std::pair<Image, ImageView> init(const VulkanRenderer &renderer) {
+            auto uploads = renderer.uploads();
+            auto texture = init(renderer, uploads);
+            uploads.flush().wait();
+            return texture;
+        }
+
+        /*
+         * Queues the pixels on an UploadManager instead of submitting them right away, so many textures can share
+         * one transfer. The image can't be sampled until the ticket of the next flush() has completed.
+         */
+        std::pair<Image, ImageView> init(const VulkanRenderer &renderer, UploadManager &uploads) {
             auto image = ImageInit()
                     .set_label(std::format("{} -> Image", m_config.label))
                     .set_image_type(VK_IMAGE_TYPE_2D)
@@ -85,44 +98,10 @@ namespace g_app {
                     .set_usage(VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT)
                     .set_memory_usage(VMA_MEMORY_USAGE_GPU_ONLY)
                     .init(renderer);
-            {
-                auto staging_buffer = BufferInit<uint8_t>()
-                        .set_label(std::format("{} -> Staging Buffer", m_config.label))
-                        .set_usage(VK_BUFFER_USAGE_TRANSFER_SRC_BIT)
-                        .set_memory_usage(VMA_MEMORY_USAGE_CPU_ONLY)
-                        .set_size(m_config.extent.width * m_config.extent.height * m_config.size)
-                        .set_data((uint8_t *) m_config.pixels)
-                        .init(renderer);
-
-                CommandBuffer(renderer)
-                        .begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT)
-                        /*.transition_image_layout(image,
-                             VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                             {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
-                             0, VK_ACCESS_TRANSFER_WRITE_BIT,
-                             VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                             VK_PIPELINE_STAGE_TRANSFER_BIT)*/
-                        .pipeline_barrier(PipelineBarrierInfoBuilder()
-                            .set_stage_flags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT)
-                            .add_image_memory_barrier(image, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
-                                VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1})
-                                .build())
-                        .copy_buffer_to_image(staging_buffer, image, VK_IMAGE_ASPECT_COLOR_BIT)
-                        /*.transition_image_layout(image,
-                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                             {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
-                             VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-                             VK_PIPELINE_STAGE_TRANSFER_BIT,
-                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)*/
-                        .pipeline_barrier(PipelineBarrierInfoBuilder()
-                              .set_stage_flags(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT)
-                              .add_image_memory_barrier(image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
-                                  VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-                                  {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1})
-                              .build())
-                        .submit(Queue::TRANSFER);
-            }
+
+            uploads.upload_image(image, m_config.pixels, m_config.size, VK_IMAGE_ASPECT_COLOR_BIT,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 
             auto image_view = ImageViewInit()
                     .set_label(std::format("{} -> Image View", m_config.label))
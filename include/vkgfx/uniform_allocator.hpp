@@ -0,0 +1,150 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+#include "per_frame.hpp"
+
+namespace g_app {
+    /* A slice of a UniformAllocator. Pass 'offset' as the dynamic offset of the binding when binding descriptor sets. */
+    template<typename T>
+    struct UniformAllocation {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        uint32_t offset = 0;
+        T*       data = nullptr;
+    };
+
+    class UniformAllocatorInit;
+
+    /*
+     * Frame scoped bump allocator for per-frame uniform data, allocations carve aligned slices out of the current
+     * frame's region of one persistently mapped buffer, see FrameRing.
+     * Bind buffer() once as VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC with a range of the largest slice,
+     * then select each slice with its dynamic offset.
+     * Allocate only after acquire_next_swapchain_image(), which is when the frame's previous use has retired.
+     */
+    class UniformAllocator {
+    public:
+        UniformAllocator() = default;
+
+        /* Allocates room for 'count' T's without writing them. The memory is write-combined, don't read it back. */
+        template<typename T>
+        UniformAllocation<T> allocate(size_t count = 1){
+            auto offset = bump(count * sizeof(T));
+            return {self->buffer.vk_buffer(), offset, reinterpret_cast<T*>(self->buffer.mapped().data() + offset)};
+        }
+
+        /* Allocates and writes value. */
+        template<typename T>
+        UniformAllocation<T> push(const T& value){
+            auto offset = bump(sizeof(T));
+            self->buffer.write(reinterpret_cast<const uint8_t*>(&value), sizeof(T), offset);
+            return {self->buffer.vk_buffer(), offset, reinterpret_cast<T*>(self->buffer.mapped().data() + offset)};
+        }
+
+        const Buffer<uint8_t>& buffer() const { return self->buffer; }
+        VkDeviceSize alignment() const { return self->alignment; }
+        VkDeviceSize size_per_frame() const { return self->ring.frame_size(); }
+        /*
+         * Where 'frame's region starts, which is also the offset of that frame's first allocation. Lets commands
+         * recorded once per frame slot (see CachedCommandBuffer) bind the slice without knowing the frame's allocations.
+         */
+        uint32_t frame_offset(uint32_t frame) const { return static_cast<uint32_t>(frame * self->ring.frame_size()); }
+        /* Bytes allocated in the current frame. */
+        VkDeviceSize used() const { return self->ring.used(); }
+    private:
+        struct Config {
+            VkDeviceSize size_per_frame = 1024 * 1024;
+            std::string  label = "unnamed uniform allocator";
+        };
+
+        struct Inner {
+            VulkanRenderer renderer;
+            Buffer<uint8_t> buffer = {};
+            VkDeviceSize alignment = 256;
+            FrameRing    ring = {};
+            std::string  label;
+        };
+
+        std::shared_ptr<Inner> self;
+
+        UniformAllocator(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+            self->label = config.label;
+
+            auto limits = renderer.physical_device_properties().limits;
+            self->alignment = std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 16);
+            auto frame_size = (config.size_per_frame + self->alignment - 1) / self->alignment * self->alignment;
+            self->ring = FrameRing(renderer, frame_size, std::format("UniformAllocator {}", self->label), "size per frame");
+
+            self->buffer = BufferInit<uint8_t>()
+                    .set_label(std::format("{} -> Buffer", self->label))
+                    .set_usage(VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+                    .set_size(self->ring.total_size())
+                    .set_persistently_mapped()
+                    .init(renderer);
+        }
+
+        uint32_t bump(VkDeviceSize size){
+            auto offset = self->ring.allocate(size, self->alignment);
+            return static_cast<uint32_t>(self->ring.frame_offset() + offset);
+        }
+
+        friend class UniformAllocatorInit;
+    };
+
+    class UniformAllocatorInit {
+    public:
+        UniformAllocatorInit() = default;
+
+        UniformAllocatorInit& set_label(const std::string& label){
+            m_config.label = label;
+            return *this;
+        }
+
+        /* Bytes available to each frame, rounded up to the uniform offset alignment. */
+        UniformAllocatorInit& set_size_per_frame(VkDeviceSize size){
+            m_config.size_per_frame = size;
+            return *this;
+        }
+
+        UniformAllocator init(const VulkanRenderer& renderer){
+            try {
+                return {renderer, m_config};
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+    private:
+        UniformAllocator::Config m_config = {};
+    };
+}
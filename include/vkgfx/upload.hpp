@@ -0,0 +1,182 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#pragma once
+
+#include "renderer.hpp"
+#include "buffer.hpp"
+#include "image.hpp"
+#include "sync.hpp"
+
+#include <deque>
+
+namespace g_app {
+    /*
+     * Everything the UploadManager needs to outlive its handles. Owned by the renderer and only holds raw Vulkan handles,
+     * so the renderer can keep it alive without a reference cycle.
+     */
+    struct UploadState {
+        struct BufferCopy {
+            VkBuffer src;
+            VkBuffer dst;
+            VkBufferCopy region;
+        };
+
+        struct ImageCopy {
+            VkBuffer src;
+            VkImage  dst;
+            VkBufferImageCopy region;
+            VkImageLayout final_layout;
+            VkAccessFlags dst_access;
+            VkPipelineStageFlags dst_stage;
+            ResourceState* state; // The image's, updated once the copy is submitted
+        };
+
+        struct DedicatedBuffer {
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VmaAllocation allocation = VK_NULL_HANDLE;
+        };
+
+        struct Batch {
+            PooledFence fence = {};
+            TimelinePoint timeline = {}; // Used instead of the fence when timeline semaphores are enabled
+            VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
+            VkCommandBuffer acquire_cmdbuf = VK_NULL_HANDLE; // Graphics side of an ownership transfer
+            VkSemaphore semaphore = VK_NULL_HANDLE; // Orders the acquire after the copies without timeline semaphores
+            uint64_t ring_end = 0; // Everything in the ring before this is free once the batch has retired
+            std::vector<DedicatedBuffer> dedicated = {};
+        };
+
+        VkDevice device = VK_NULL_HANDLE;
+        VmaAllocator allocator = VK_NULL_HANDLE;
+        uint32_t transfer_family = 0;
+        uint32_t graphics_family = 0;
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        VkCommandPool acquire_command_pool = VK_NULL_HANDLE; // Only created for a dedicated transfer family
+
+        VkBuffer staging = VK_NULL_HANDLE;
+        VmaAllocation staging_allocation = VK_NULL_HANDLE;
+        uint8_t* mapped = nullptr;
+        VkDeviceSize capacity = 0;
+
+        // Monotonic byte offsets into the ring, the physical offset is (offset % capacity)
+        uint64_t head = 0;
+        uint64_t tail = 0;
+
+        std::vector<BufferCopy> buffer_copies = {};
+        std::vector<ImageCopy> image_copies = {};
+        std::vector<DedicatedBuffer> dedicated = {};
+        std::deque<Batch> in_flight = {};
+        std::vector<VkCommandBuffer> free_cmdbufs = {};
+        std::vector<VkCommandBuffer> free_acquire_cmdbufs = {};
+        std::vector<VkSemaphore> free_semaphores = {};
+        PooledFence last_fence = {};
+        TimelinePoint last_timeline = {};
+
+        UploadState(VkDevice device, VmaAllocator allocator, uint32_t transfer_family, uint32_t graphics_family,
+                    VkDeviceSize capacity);
+        ~UploadState();
+    };
+
+    /*
+     * Streams data into GPU only buffers and images through one persistently mapped staging ring.
+     * Uploads are sub-allocated from the ring and their copies are batched until flush(), which records them into a
+     * single command buffer and submits it to the transfer queue. The returned ticket signals when the data has landed.
+     * With a dedicated transfer queue family the destinations are released to the graphics family and acquired by a
+     * small submission on the graphics queue, so they are ready for graphics (and graphics family compute) use.
+     * Only the uploaded range is valid afterwards, a buffer last used on another family loses the rest of its contents.
+     * Obtained through VulkanRenderer::uploads(), every handle shares the renderer's ring.
+     */
+    class UploadManager {
+    public:
+        UploadManager() = default;
+        UploadManager(VulkanRenderer renderer, std::shared_ptr<UploadState> state):
+            m_renderer{std::move(renderer)}, m_state{std::move(state)} {}
+
+        /* Copies 'size' elements from data into dst at 'dst_offset' (in elements). dst needs VK_BUFFER_USAGE_TRANSFER_DST_BIT. */
+        template<BufferView B>
+        UploadManager& upload_buffer(const B& dst, const typename B::value_type* data, size_t size, size_t dst_offset = 0){
+            using T = typename B::value_type;
+            assert(dst_offset + size <= dst.size() && "Upload doesn't fit into the destination buffer!");
+
+            auto staged = stage(data, size * sizeof(T), 4);
+
+            VkBufferCopy region = {};
+            region.srcOffset = staged.offset;
+            region.dstOffset = dst.offsetb() + dst_offset * sizeof(T);
+            region.size = size * sizeof(T);
+            m_state->buffer_copies.push_back({staged.buffer, dst.vk_buffer(), region});
+            return *this;
+        }
+
+        /* Uploads the whole buffer. */
+        template<BufferView B>
+        UploadManager& upload_buffer(const B& dst, const typename B::value_type* data){
+            return upload_buffer(dst, data, dst.size());
+        }
+
+        /*
+         * Copies tightly packed pixels into one mip level of dst. The image is transitioned from an undefined layout,
+         * so the previous contents of the subresource are discarded, and left in final_layout for dst_stage/dst_access.
+         * texel_size is the size of one pixel in bytes.
+         */
+        UploadManager& upload_image(const Image& dst, const void* pixels, size_t texel_size,
+                                    VkImageAspectFlags aspect_mask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                    VkImageLayout final_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                    VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                    VkAccessFlags dst_access = VK_ACCESS_SHADER_READ_BIT,
+                                    uint32_t mip_level = 0, uint32_t base_layer = 0, uint32_t layer_count = 1);
+
+        /* Submits every upload recorded since the last flush. Returns the last ticket if there was nothing to submit. */
+        SubmitTicket flush();
+
+        /* Ticket of the most recent flush. */
+        SubmitTicket last_ticket() const;
+
+        bool has_pending() const { return !m_state->buffer_copies.empty() || !m_state->image_copies.empty(); }
+        VkDeviceSize staging_capacity() const { return m_state->capacity; }
+
+        bool is_valid() const { return m_state != nullptr; }
+    private:
+        struct Staged {
+            VkBuffer buffer;
+            VkDeviceSize offset;
+        };
+
+        VulkanRenderer m_renderer = {};
+        std::shared_ptr<UploadState> m_state = nullptr;
+
+        Staged stage(const void* data, VkDeviceSize size, VkDeviceSize alignment);
+        Staged stage_dedicated(const void* data, VkDeviceSize size);
+        void retire_batches(bool wait_oldest);
+        VkCommandBuffer allocate_command_buffer(VkCommandPool pool, std::vector<VkCommandBuffer>& free_list);
+        VkSemaphore acquire_semaphore();
+    };
+}
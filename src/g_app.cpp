@@ -41,14 +41,36 @@ namespace g_app {
         },
         m_renderer{config.renderer_init.init(m_window.glfw_window())}
     {
+        if(!config.trace_path.empty()) trace::dump_at_exit(config.trace_path);
+        m_unfocused_frame_rate_limit = config.unfocused_frame_rate_limit;
+    }
+
+    void App::update_frame_rate_limit(){
+        if(m_unfocused_frame_rate_limit == 0) return;
 
+        bool focused = glfwGetWindowAttrib(m_window.glfw_window(), GLFW_FOCUSED) == GLFW_TRUE;
+        if(focused == m_focused) return;
+        m_focused = focused;
+
+        // An override rather than a new limit, so limits the app sets while unfocused aren't lost
+        m_renderer.set_frame_rate_override((focused) ? 0 : m_unfocused_frame_rate_limit);
     }
     void App::main_loop(std::function<void(const std::vector<Event>&, const Time &)> f){
         try {
             while (m_window.is_open()) {
-                auto events = m_window.poll_events();
+                G_APP_TRACE_SCOPE("frame");
+
+                std::vector<Event> events;
+                {
+                    G_APP_TRACE_SCOPE("poll_events");
+                    events = m_window.poll_events();
+                }
+                update_frame_rate_limit();
                 m_time.update(glfwGetTime());
-                f(events, m_time);
+                {
+                    G_APP_TRACE_SCOPE("update");
+                    f(events, m_time);
+                }
             }
         } catch(const std::runtime_error& e) {
             spdlog::error(e.what());
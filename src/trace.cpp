@@ -0,0 +1,158 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "../include/trace.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <fstream>
+#include <thread>
+#include <algorithm>
+#include <cstdlib>
+
+namespace g_app::trace {
+    struct Zone {
+        const char* name;
+        uint64_t begin_ns;
+        uint64_t end_ns;
+    };
+
+    /* Single producer ring, only its own thread writes to it. A dump stops recording and waits for writes in progress. */
+    struct ThreadRing {
+        static constexpr size_t CAPACITY = 1 << 16;
+
+        std::unique_ptr<Zone[]> zones = std::make_unique<Zone[]>(CAPACITY);
+        std::atomic<uint64_t> head = 0;
+        std::atomic<bool> writing = false;
+        uint32_t thread_id = 0;
+    };
+
+    static std::mutex g_rings_mutex;
+    static std::vector<std::shared_ptr<ThreadRing>> g_rings;
+    static std::string g_exit_path;
+
+    static ThreadRing& thread_ring(){
+        thread_local std::shared_ptr<ThreadRing> ring = [](){
+            auto r = std::make_shared<ThreadRing>();
+            std::lock_guard lock(g_rings_mutex);
+            r->thread_id = static_cast<uint32_t>(g_rings.size());
+            g_rings.push_back(r); // Kept after the thread exits so its zones still get dumped
+            return r;
+        }();
+        return *ring;
+    }
+
+    void record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+        auto& ring = thread_ring();
+        // Announced before tracing is checked again, a dump disables tracing and then waits for announced writes
+        ring.writing.store(true, std::memory_order_seq_cst);
+        if(g_enabled.load(std::memory_order_seq_cst)){
+            uint64_t head = ring.head.load(std::memory_order_relaxed);
+            ring.zones[head % ThreadRing::CAPACITY] = {name, begin_ns, end_ns};
+            ring.head.store(head + 1, std::memory_order_relaxed);
+        }
+        ring.writing.store(false, std::memory_order_release);
+    }
+
+    static void write_escaped(std::ofstream& out, const char* s){
+        for(; *s; s++){
+            if(*s == '"' || *s == '\\') out << '\\';
+            out << *s;
+        }
+    }
+
+    bool dump_chrome_json(const std::string& path) {
+        std::ofstream out(path);
+        if(!out.is_open()){
+            spdlog::error("Failed to open the trace output! path = {}", path);
+            return false;
+        }
+
+        std::vector<std::shared_ptr<ThreadRing>> rings;
+        {
+            std::lock_guard lock(g_rings_mutex);
+            rings = g_rings;
+        }
+
+        // Recording threads may still be running (e.g. workers during exit), the rings are only read once they're quiet
+        bool was_enabled = g_enabled.exchange(false, std::memory_order_seq_cst);
+        for(const auto& ring : rings){
+            while(ring->writing.load(std::memory_order_acquire)) std::this_thread::yield();
+        }
+
+        std::vector<Zone> zones;
+        zones.reserve(ThreadRing::CAPACITY);
+        uint64_t origin = UINT64_MAX;
+        for(const auto& ring : rings){
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t first = (head > ThreadRing::CAPACITY) ? head - ThreadRing::CAPACITY : 0;
+            for(uint64_t i = first; i < head; i++) origin = std::min(origin, ring->zones[i % ThreadRing::CAPACITY].begin_ns);
+        }
+
+        out << "{\"traceEvents\":[\n";
+        bool first_event = true;
+        for(const auto& ring : rings){
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t first = (head > ThreadRing::CAPACITY) ? head - ThreadRing::CAPACITY : 0;
+
+            zones.clear();
+            for(uint64_t i = first; i < head; i++) zones.push_back(ring->zones[i % ThreadRing::CAPACITY]);
+
+            for(const auto& zone : zones){
+                if(!first_event) out << ",\n";
+                first_event = false;
+
+                out << "{\"name\":\"";
+                write_escaped(out, zone.name);
+                out << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->thread_id
+                    << ",\"ts\":" << static_cast<double>(zone.begin_ns - origin) / 1000.0
+                    << ",\"dur\":" << static_cast<double>(zone.end_ns - zone.begin_ns) / 1000.0 << "}";
+            }
+        }
+        out << "\n]}\n";
+
+        g_enabled.store(was_enabled, std::memory_order_seq_cst);
+        return out.good();
+    }
+
+    void dump_at_exit(const std::string& path) {
+        set_enabled(true);
+
+        static bool registered = false;
+        g_exit_path = path;
+        if(!registered){
+            registered = true;
+            std::atexit([](){ dump_chrome_json(g_exit_path); });
+        }
+    }
+}
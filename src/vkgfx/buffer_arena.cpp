@@ -0,0 +1,135 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "../include/vkgfx/buffer_arena.hpp"
+
+#include <stdexcept>
+#include <format>
+
+namespace g_app {
+    BufferArenaBlock::BufferArenaBlock(VmaAllocator allocator, const VkBufferCreateInfo& create_info,
+                                       const VmaAllocationCreateInfo& alloc_info): allocator{allocator}, size{create_info.size} {
+        VmaAllocationInfo allocation_info = {};
+
+        VkResult result = VK_SUCCESS;
+        if((result = vmaCreateBuffer(allocator, &create_info, &alloc_info, &buffer, &allocation, &allocation_info)) != VK_SUCCESS){
+            throw std::runtime_error(std::format("Failed to create a buffer arena block! size = {}, result = {}",
+                                                 size, static_cast<uint32_t>(result)));
+        }
+        mapped = static_cast<uint8_t*>(allocation_info.pMappedData);
+
+        VmaVirtualBlockCreateInfo block_info = {};
+        block_info.size = size;
+        if((result = vmaCreateVirtualBlock(&block_info, &virtual_block)) != VK_SUCCESS){
+            vmaDestroyBuffer(allocator, buffer, allocation);
+            throw std::runtime_error(std::format("Failed to create a virtual block! size = {}, result = {}",
+                                                 size, static_cast<uint32_t>(result)));
+        }
+    }
+
+    BufferArenaBlock::~BufferArenaBlock() {
+        // Slices hold a reference to their block until their deferred free has run, so nothing is left allocated here
+        vmaDestroyVirtualBlock(virtual_block);
+        vmaDestroyBuffer(allocator, buffer, allocation);
+    }
+
+    BufferArena::BufferArena(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->config = config;
+
+        auto limits = renderer.physical_device_properties().limits;
+        if(config.usage & VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT){
+            self->alignment = std::max(self->alignment, limits.minUniformBufferOffsetAlignment);
+        }
+        if(config.usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT){
+            self->alignment = std::max(self->alignment, limits.minStorageBufferOffsetAlignment);
+        }
+        if(config.usage & (VK_BUFFER_USAGE_UNIFORM_TEXEL_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_TEXEL_BUFFER_BIT)){
+            self->alignment = std::max(self->alignment, limits.minTexelBufferOffsetAlignment);
+        }
+
+        self->first_block = create_block(config.block_size);
+    }
+
+    std::shared_ptr<BufferArenaBlock> BufferArena::create_block(VkDeviceSize size) {
+        VkBufferCreateInfo create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        create_info.size = size;
+        create_info.usage = self->config.usage;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = self->config.memory_usage;
+        if(self->config.persistently_mapped){
+            alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+        }
+
+        return std::make_shared<BufferArenaBlock>(self->renderer.inner()->allocator, create_info, alloc_info);
+    }
+
+    BufferArena::Range BufferArena::allocate_range(VkDeviceSize size, VkDeviceSize alignment) {
+        // Virtual allocations only take power of two alignments. Others (e.g. sizeof(Vertex)) are padded and aligned by hand.
+        bool pow2 = (alignment & (alignment - 1)) == 0;
+
+        VmaVirtualAllocationCreateInfo alloc_info = {};
+        alloc_info.size = (pow2) ? size : size + alignment - self->alignment;
+        alloc_info.alignment = (pow2) ? alignment : self->alignment;
+
+        auto try_block = [&](const std::shared_ptr<BufferArenaBlock>& block, Range& range){
+            VmaVirtualAllocation allocation = VK_NULL_HANDLE;
+            VkDeviceSize offset = 0;
+            {
+                std::lock_guard lock(block->mutex);
+                if(vmaVirtualAllocate(block->virtual_block, &alloc_info, &allocation, &offset) != VK_SUCCESS) return false;
+            }
+
+            range = {block, allocation, (offset + alignment - 1) / alignment * alignment};
+            return true;
+        };
+
+        Range range = {};
+        if(try_block(self->first_block, range)) return range;
+
+        // Blocks whose slices have all been freed are gone already
+        auto& blocks = self->extra_blocks;
+        blocks.erase(std::remove_if(blocks.begin(), blocks.end(), [](const auto& block){ return block.expired(); }), blocks.end());
+        for(const auto& weak_block : blocks){
+            auto block = weak_block.lock();
+            if(block && try_block(block, range)) return range;
+        }
+
+        // Every block is full, oversized requests get a block of their own
+        auto block = create_block(std::max(self->config.block_size, alloc_info.size));
+        blocks.push_back(block);
+        if(!try_block(block, range)){
+            spdlog::error("Failed to allocate from a new buffer arena block! label = {}, size = {}", self->config.label, size);
+            std::exit(EXIT_FAILURE);
+        }
+        return range;
+    }
+}
@@ -0,0 +1,123 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include "../include/vkgfx/cached_command_buffer.hpp"
+
+#include <format>
+#include <algorithm>
+
+namespace g_app {
+    namespace {
+        bool same_inheritance(const CommandBufferInheritance& a, const CommandBufferInheritance& b){
+            return a.render_pass == b.render_pass && a.subpass == b.subpass && a.framebuffer == b.framebuffer &&
+                   a.color_formats == b.color_formats && a.depth_format == b.depth_format &&
+                   a.stencil_format == b.stencil_format && a.samples == b.samples &&
+                   a.render_area.offset.x == b.render_area.offset.x && a.render_area.offset.y == b.render_area.offset.y &&
+                   a.render_area.extent.width == b.render_area.extent.width &&
+                   a.render_area.extent.height == b.render_area.extent.height;
+        }
+    }
+
+    CachedCommandBuffer::CachedCommandBuffer(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->label = config.label;
+        self->record = config.record;
+        if(!self->record){
+            throw std::runtime_error(std::format("A CachedCommandBuffer needs a record function! label = {}", self->label));
+        }
+    }
+
+    CommandBuffer& CachedCommandBuffer::execute(CommandBuffer& primary) {
+        G_APP_TRACE_SCOPE("cached_command_buffer_execute");
+        const auto& inheritance = primary.inheritance();
+        assert(inheritance.secondary_contents && "The render pass must be begun with secondary contents!");
+
+        // Per-frame uniforms and descriptor sets differ between frame slots, so the slot is part of the key
+        auto image = self->renderer.current_image();
+        auto frame = self->renderer.current_frame();
+        auto frames = self->renderer.frames_in_flight();
+        auto index = image * frames + frame;
+        if(index >= self->entries.size()){
+            self->entries.resize(std::max(index + 1, self->renderer.swapchain_image_count() * frames));
+        }
+
+        auto& entry = self->entries[index];
+        if(is_stale(entry, inheritance)) record(entry, inheritance, image, frame);
+        return primary.execute_commands(std::span(&entry.cmd, 1));
+    }
+
+    void CachedCommandBuffer::invalidate() {
+        for(auto& entry : self->entries) entry.valid = false;
+    }
+
+    bool CachedCommandBuffer::is_stale(const Entry& entry, const CommandBufferInheritance& inheritance) const {
+        if(!entry.valid || entry.swapchain_generation != self->renderer.swapchain_generation()) return true;
+        if(!same_inheritance(entry.inheritance, inheritance)) return true;
+        auto rewritten = std::any_of(entry.versioned_dependencies.begin(), entry.versioned_dependencies.end(),
+                                     [](const auto& dependency){
+            auto generation = dependency.generation.lock();
+            return !generation || *generation != dependency.recorded;
+        });
+        return rewritten || std::any_of(entry.dependencies.begin(), entry.dependencies.end(), [](const auto& dependency){
+            return dependency.expired();
+        });
+    }
+
+    void CachedCommandBuffer::record(Entry& entry, const CommandBufferInheritance& inheritance, uint32_t image, uint32_t frame) {
+        G_APP_TRACE_SCOPE("cached_command_buffer_record");
+        // Earlier frames may still be executing the old commands, they are freed once those have retired
+        if(entry.cmd.self) self->renderer.defer_destroy([cmd = entry.cmd](){});
+
+        entry.cmd = CommandBuffer(self->renderer, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        entry.dependencies.clear();
+        entry.versioned_dependencies.clear();
+        entry.cmd.self->dependencies = &entry.dependencies;
+        entry.cmd.self->versioned_dependencies = &entry.versioned_dependencies;
+        self->recording = &entry.dependencies;
+
+        entry.cmd.begin_secondary(inheritance, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+        self->record(entry.cmd, image, frame);
+        entry.cmd.end();
+
+        entry.cmd.self->dependencies = nullptr;
+        entry.cmd.self->versioned_dependencies = nullptr;
+        self->recording = nullptr;
+
+        // Objects bound more than once are only checked once per frame
+        auto& dependencies = entry.dependencies;
+        std::sort(dependencies.begin(), dependencies.end(), [](const auto& a, const auto& b){ return a.owner_before(b); });
+        dependencies.erase(std::unique(dependencies.begin(), dependencies.end(), [](const auto& a, const auto& b){
+            return !a.owner_before(b) && !b.owner_before(a);
+        }), dependencies.end());
+
+        entry.valid = true;
+        entry.swapchain_generation = self->renderer.swapchain_generation();
+        entry.inheritance = inheritance;
+        self->record_count++;
+    }
+}
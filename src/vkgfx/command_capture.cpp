@@ -0,0 +1,565 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include "../include/vkgfx/command_capture.hpp"
+
+#include <algorithm>
+#include <format>
+#include <fstream>
+
+namespace g_app {
+    CommandCapture::CommandCapture(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->label = config.label;
+
+        if(!renderer.has_command_capture()){
+            spdlog::warn("Command capture {} is used without VulkanRendererInit::enable_command_capture(), "
+                         "its pipelines won't be replayable!", self->label);
+        }
+    }
+
+    uint32_t CommandCapture::find_buffer(VkBuffer buffer){
+        auto [it, inserted] = self->buffer_ids.try_emplace(buffer, static_cast<uint32_t>(self->buffers.size()));
+        if(inserted) self->buffers.emplace_back();
+        return it->second;
+    }
+
+    uint32_t CommandCapture::add_buffer(const BufferSource& source){
+        auto id = find_buffer(source.buffer);
+        auto& captured = self->buffers[id];
+        if(captured.contents.size() >= source.end) return id;
+
+        // Views only have a mapping or allocation while something owns them
+        auto owner = source.owner.lock();
+        if(!captured.keep_alive) captured.keep_alive = owner;
+        const uint8_t* base = (owner) ? source.base : nullptr;
+        VmaAllocation allocation = (owner) ? source.allocation : VK_NULL_HANDLE;
+
+        // A whole Buffer, its mapping stays valid while the capture keeps it alive
+        if(base && source.mapped_size > 0){
+            captured.host_base = base;
+            captured.host_size = source.mapped_size;
+        }
+        if(!base && source.end <= captured.host_size) base = captured.host_base;
+
+        auto allocator = self->renderer.inner()->allocator;
+        VmaAllocation mapped_allocation = VK_NULL_HANDLE;
+        if(!base && allocation != VK_NULL_HANDLE){
+            VkMemoryPropertyFlags memory_flags = 0;
+            vmaGetAllocationMemoryProperties(allocator, allocation, &memory_flags);
+            void* data = nullptr;
+            if((memory_flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) && vmaMapMemory(allocator, allocation, &data) == VK_SUCCESS){
+                mapped_allocation = allocation;
+                vmaInvalidateAllocation(allocator, mapped_allocation, 0, VK_WHOLE_SIZE);
+                base = reinterpret_cast<const uint8_t*>(data);
+            }
+        }
+
+        grow_buffer(captured, source.end, base);
+        if(mapped_allocation != VK_NULL_HANDLE) vmaUnmapMemory(allocator, mapped_allocation);
+        return id;
+    }
+
+    uint32_t CommandCapture::add_image(const Image& image){
+        auto [it, inserted] = self->image_ids.try_emplace(image.vk_image(), static_cast<uint32_t>(self->images.size()));
+        if(inserted) self->images.push_back(image);
+        return it->second;
+    }
+
+    uint32_t CommandCapture::add_sampler(const Sampler& sampler){
+        auto [it, inserted] = self->sampler_ids.try_emplace(sampler.vk_sampler(), static_cast<uint32_t>(self->samplers.size()));
+        if(inserted) self->samplers.push_back(sampler);
+        return it->second;
+    }
+
+    uint32_t CommandCapture::add_set_layout(const DescriptorSetLayout& layout){
+        if(!layout.self) return TRACE_INVALID_ID;
+        auto found = self->set_layout_ids.find(layout.vk_descriptor_set_layout());
+        if(found != self->set_layout_ids.end()) return found->second;
+
+        const auto& inner = *layout.self;
+        bool supported = !(inner.flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR) &&
+                         std::all_of(inner.bindings.begin(), inner.bindings.end(), [](const VkDescriptorSetLayoutBinding& binding){
+                             return !binding.pImmutableSamplers && (trace_is_buffer_descriptor(binding.descriptorType) ||
+                                                                    trace_is_image_descriptor(binding.descriptorType));
+                         });
+        uint32_t id = TRACE_INVALID_ID;
+        if(supported){
+            id = static_cast<uint32_t>(self->set_layouts.size());
+            self->set_layouts.push_back(layout);
+        }
+        self->set_layout_ids.emplace(layout.vk_descriptor_set_layout(), id);
+        return id;
+    }
+
+    uint32_t CommandCapture::descriptor_set_id(const DescriptorSet& set){
+        std::lock_guard lock(self->mutex);
+        std::pair key(set.vk_descriptor_set(), set.generation());
+        auto found = self->descriptor_set_ids.find(key);
+        if(found != self->descriptor_set_ids.end()) return found->second;
+
+        std::vector<uint8_t> out = {};
+        auto layout = add_set_layout(set.layout());
+        bool supported = layout != TRACE_INVALID_ID;
+        trace_write(out, layout);
+        trace_write(out, static_cast<uint32_t>(set.descriptors().size()));
+        for(const auto& record : set.descriptors()){
+            trace_write(out, record.binding);
+            trace_write(out, record.type);
+            if(trace_is_buffer_descriptor(record.type)){
+                trace_write(out, add_buffer(record.buffer_source));
+                trace_write(out, record.buffer.offset);
+                trace_write(out, record.buffer.range);
+                continue;
+            }
+            if(!trace_is_image_descriptor(record.type)){
+                supported = false;
+                continue;
+            }
+
+            // DescriptorWriter::write_image() refers to the ImageView and Sampler it was given
+            auto view = std::static_pointer_cast<ImageView::Inner>(record.refs[0].lock());
+            auto sampler = std::static_pointer_cast<Sampler::Inner>(record.refs[1].lock());
+            bool needs_view = record.type != VK_DESCRIPTOR_TYPE_SAMPLER;
+            bool needs_sampler = record.type == VK_DESCRIPTOR_TYPE_SAMPLER || record.type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            if((needs_view && (!view || !view->image.self)) || (needs_sampler && !sampler)){
+                supported = false;
+                continue;
+            }
+
+            trace_write(out, (needs_view) ? add_image(view->image) : TRACE_INVALID_ID);
+            trace_write(out, (needs_view) ? view->view_type : VK_IMAGE_VIEW_TYPE_2D);
+            trace_write(out, (needs_view) ? view->aspect_mask : VkImageAspectFlags{0});
+            uint32_t sampler_id = TRACE_INVALID_ID;
+            if(needs_sampler){
+                Sampler handle = {};
+                handle.self = sampler;
+                sampler_id = add_sampler(handle);
+            }
+            trace_write(out, sampler_id);
+        }
+
+        uint32_t id = TRACE_INVALID_ID;
+        if(supported){
+            id = static_cast<uint32_t>(self->descriptor_sets.size());
+            self->descriptor_sets.push_back(std::move(out));
+            self->descriptor_set_refs.push_back(set.weak_ref().lock());
+        } else {
+            self->unsupported_descriptor_sets++;
+        }
+        self->descriptor_set_ids.emplace(key, id);
+        return id;
+    }
+
+    void CommandCapture::grow_buffer(CapturedBuffer& captured, VkDeviceSize end, const uint8_t* base){
+        auto size = captured.contents.size();
+        captured.contents.resize(end);
+        if(base) std::memcpy(captured.contents.data() + size, base + size, end - size);
+        else captured.host_visible = false;
+    }
+
+    void CommandCapture::write_module(std::vector<uint8_t>& out, const ShaderModule& module){
+        const auto& inner = *module.self;
+        trace_write(out, static_cast<uint32_t>(inner.stage_info.stage));
+        trace_write_string(out, inner.entry);
+        trace_write(out, static_cast<uint64_t>(inner.src.size()));
+        trace_write_bytes(out, inner.src.data(), inner.src.size());
+    }
+
+    uint32_t CommandCapture::pipeline_id(const Pipeline& pipeline){
+        std::lock_guard lock(self->mutex);
+        auto [it, inserted] = self->pipeline_ids.try_emplace(pipeline.vk_pipeline(), static_cast<uint32_t>(self->pipelines.size()));
+        if(!inserted) return it->second;
+
+        // Kept alive so the handle can't be reused by another pipeline during the capture
+        self->pipeline_refs.push_back(pipeline.weak_ref().lock());
+        auto& out = self->pipelines.emplace_back();
+
+        const auto& inner = *pipeline.self;
+        const auto* graphics = inner.graphics_config.get();
+        const auto* compute = inner.compute_config.get();
+        std::vector<uint32_t> set_layouts = {};
+        if(graphics || compute){
+            for(const auto& layout : (graphics) ? graphics->set_layout_refs : compute->set_layout_refs){
+                set_layouts.push_back(add_set_layout(layout));
+            }
+        }
+        bool supported = (graphics && (graphics->dynamic_rendering || inner.default_render_pass)) || compute;
+        supported = supported && std::find(set_layouts.begin(), set_layouts.end(), TRACE_INVALID_ID) == set_layouts.end();
+        if(!supported){
+            trace_write(out, TracePipelineKind::UNSUPPORTED);
+            trace_write_string(out, inner.label);
+            self->unsupported_pipelines++;
+            return it->second;
+        }
+
+        auto write_set_layouts = [&out, &set_layouts](){
+            trace_write(out, static_cast<uint32_t>(set_layouts.size()));
+            for(auto layout : set_layouts) trace_write(out, layout);
+        };
+
+        if(compute){
+            trace_write(out, TracePipelineKind::COMPUTE);
+            trace_write_string(out, inner.label);
+            write_set_layouts();
+            write_module(out, compute->module);
+            trace_write(out, static_cast<uint32_t>(compute->push_constants.size()));
+            for(const auto& range : compute->push_constants) trace_write(out, range);
+            return it->second;
+        }
+
+        trace_write(out, TracePipelineKind::GRAPHICS);
+        trace_write_string(out, inner.label);
+        write_set_layouts();
+        trace_write(out, static_cast<uint32_t>(graphics->modules.size()));
+        for(const auto& module : graphics->modules) write_module(out, module);
+        trace_write(out, static_cast<uint32_t>(graphics->push_constants.size()));
+        for(const auto& range : graphics->push_constants) trace_write(out, range);
+
+        trace_write(out, static_cast<uint32_t>(graphics->bindings.size()));
+        for(const auto& binding : graphics->bindings){
+            trace_write(out, binding.stride);
+            trace_write(out, binding.input_rate);
+            trace_write(out, static_cast<uint32_t>(binding.attributes.size()));
+            for(const auto& attribute : binding.attributes) trace_write(out, attribute);
+        }
+
+        if(graphics->dynamic_rendering){
+            trace_write(out, TraceRenderTarget::RENDERING_FORMATS);
+            trace_write(out, static_cast<uint32_t>(graphics->color_formats.size()));
+            for(auto format : graphics->color_formats) trace_write(out, format);
+            trace_write(out, graphics->depth_format);
+            trace_write(out, graphics->stencil_format);
+            add_flags(TRACE_USES_DYNAMIC_RENDERING);
+        } else {
+            trace_write(out, TraceRenderTarget::DEFAULT_RENDER_PASS);
+            trace_write(out, graphics->subpass);
+        }
+
+        trace_write(out, graphics->topology);
+        trace_write(out, graphics->rasterization_info);
+        trace_write(out, graphics->sample_count);
+        trace_write(out, graphics->blend_info);
+        trace_write(out, graphics->depth_stencil_info);
+        return it->second;
+    }
+
+    void CommandCapture::add_submission(Queue queue, std::span<const uint8_t> commands){
+        std::lock_guard lock(self->mutex);
+        trace_write(self->submissions, static_cast<uint32_t>(queue));
+        trace_write(self->submissions, static_cast<uint64_t>(commands.size()));
+        trace_write_bytes(self->submissions, commands.data(), commands.size());
+        self->submission_count++;
+    }
+
+    std::vector<std::vector<uint8_t>> CommandCapture::read_back_images() const {
+        std::vector<std::vector<uint8_t>> contents(self->images.size());
+
+        // Every mip level of every layer, tightly packed
+        struct ReadBack {
+            size_t image;
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+        auto mip_extent = [](VkExtent3D extent, uint32_t mip){
+            return VkExtent3D{std::max(extent.width >> mip, 1u), std::max(extent.height >> mip, 1u), std::max(extent.depth >> mip, 1u)};
+        };
+
+        std::vector<ReadBack> read_backs = {};
+        VkDeviceSize staging_size = 0;
+        for(size_t i = 0; i < self->images.size(); i++){
+            const auto& inner = *self->images[i].self;
+            auto texel_size = format_texel_size(inner.format);
+            if(texel_size == 0 || inner.samples != VK_SAMPLE_COUNT_1_BIT || !(inner.usage & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) ||
+               inner.state.layout == VK_IMAGE_LAYOUT_UNDEFINED) continue;
+
+            VkDeviceSize size = 0;
+            for(uint32_t mip = 0; mip < inner.mip_levels; mip++){
+                auto extent = mip_extent(inner.extent, mip);
+                size += static_cast<VkDeviceSize>(extent.width) * extent.height * extent.depth * inner.layer_count * texel_size;
+            }
+            staging_size = (staging_size + 15) & ~VkDeviceSize{15}; // A multiple of every texel size
+            read_backs.push_back({i, staging_size, size});
+            staging_size += size;
+        }
+        if(read_backs.empty()) return contents;
+
+        auto device = self->renderer.inner()->device;
+        auto allocator = self->renderer.inner()->allocator;
+
+        VkBufferCreateInfo buffer_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        buffer_info.size = staging_size;
+        buffer_info.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+        buffer_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+        alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT;
+
+        VkBuffer staging = VK_NULL_HANDLE;
+        VmaAllocation staging_allocation = VK_NULL_HANDLE;
+        VmaAllocationInfo allocation_info = {};
+        if(vmaCreateBuffer(allocator, &buffer_info, &alloc_info, &staging, &staging_allocation, &allocation_info) != VK_SUCCESS){
+            spdlog::error("Failed to create a buffer to read back the images of command capture {}", self->label);
+            return contents;
+        }
+
+        VkCommandBufferAllocateInfo cmd_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        cmd_info.commandPool = self->renderer.command_pool(Queue::GRAPHICS);
+        cmd_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        cmd_info.commandBufferCount = 1;
+        VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
+        vkAllocateCommandBuffers(device, &cmd_info, &cmdbuf);
+
+        VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmdbuf, &begin_info);
+
+        // Images go back to the layouts the application left them in, their tracked state stays valid
+        std::vector<VkImageMemoryBarrier> barriers = {};
+        for(const auto& read_back : read_backs){
+            const auto& inner = *self->images[read_back.image].self;
+            VkImageMemoryBarrier b = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            b.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+            b.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            b.oldLayout = inner.state.layout;
+            b.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.image = inner.image;
+            b.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, inner.mip_levels, 0, inner.layer_count};
+            barriers.push_back(b);
+        }
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                             0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        std::vector<VkBufferImageCopy> regions = {};
+        for(const auto& read_back : read_backs){
+            const auto& inner = *self->images[read_back.image].self;
+            auto offset = read_back.offset;
+            regions.clear();
+            for(uint32_t mip = 0; mip < inner.mip_levels; mip++){
+                VkBufferImageCopy region = {};
+                region.bufferOffset = offset;
+                region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, inner.layer_count};
+                region.imageExtent = mip_extent(inner.extent, mip);
+                regions.push_back(region);
+                offset += static_cast<VkDeviceSize>(region.imageExtent.width) * region.imageExtent.height *
+                          region.imageExtent.depth * inner.layer_count * format_texel_size(inner.format);
+            }
+            vkCmdCopyImageToBuffer(cmdbuf, inner.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging,
+                                   static_cast<uint32_t>(regions.size()), regions.data());
+        }
+
+        for(auto& b : barriers){
+            std::swap(b.oldLayout, b.newLayout);
+            b.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            b.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+        }
+        VkMemoryBarrier host_barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        host_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        host_barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+                             1, &host_barrier, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+        vkEndCommandBuffer(cmdbuf);
+
+        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        VkFence fence = VK_NULL_HANDLE;
+        vkCreateFence(device, &fence_info, nullptr, &fence);
+
+        VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &cmdbuf;
+        VkResult result = vkQueueSubmit(self->renderer.get_queue(Queue::GRAPHICS), 1, &submit_info, fence);
+        if(result == VK_SUCCESS) result = vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+
+        if(result == VK_SUCCESS){
+            vmaInvalidateAllocation(allocator, staging_allocation, 0, VK_WHOLE_SIZE);
+            auto mapped = reinterpret_cast<const uint8_t*>(allocation_info.pMappedData);
+            for(const auto& read_back : read_backs){
+                contents[read_back.image].assign(mapped + read_back.offset, mapped + read_back.offset + read_back.size);
+            }
+        } else {
+            spdlog::error("Failed to read back the images of command capture {}, result = {}",
+                          self->label, static_cast<uint32_t>(result));
+        }
+
+        vkDestroyFence(device, fence, nullptr);
+        vkFreeCommandBuffers(device, cmd_info.commandPool, 1, &cmdbuf);
+        vmaDestroyBuffer(allocator, staging, staging_allocation);
+        return contents;
+    }
+
+    bool CommandCapture::save(const std::string& path) const {
+        std::lock_guard lock(self->mutex);
+
+        std::ofstream fp(path, std::ios::binary);
+        if(!fp.is_open()){
+            spdlog::error("Failed to open {} to save command capture {}", path, self->label);
+            return false;
+        }
+        auto write = [&fp](const std::vector<uint8_t>& bytes){
+            fp.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        };
+
+        std::vector<uint8_t> out = {};
+        trace_write_bytes(out, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+        trace_write(out, TRACE_VERSION);
+        trace_write(out, self->flags.load(std::memory_order_relaxed));
+        trace_write(out, self->renderer.swapchain_extent());
+        trace_write(out, self->renderer.chosen_swapchain_format());
+        trace_write(out, self->renderer.chosen_depth_format());
+
+        // Buffer contents are written straight from the capture instead of being copied into 'out'
+        trace_write(out, static_cast<uint32_t>(self->buffers.size()));
+        write(out);
+        for(const auto& buffer : self->buffers){
+            out.clear();
+            trace_write(out, static_cast<uint64_t>(buffer.contents.size()));
+            trace_write(out, static_cast<uint8_t>(buffer.host_visible));
+            write(out);
+            write(buffer.contents);
+        }
+
+        self->renderer.device_wait_idle();
+        auto image_contents = read_back_images();
+        out.clear();
+        trace_write(out, static_cast<uint32_t>(self->images.size()));
+        write(out);
+        for(size_t i = 0; i < self->images.size(); i++){
+            const auto& inner = *self->images[i].self;
+            out.clear();
+            trace_write(out, inner.image_type);
+            trace_write(out, inner.format);
+            trace_write(out, inner.extent);
+            trace_write(out, inner.mip_levels);
+            trace_write(out, inner.layer_count);
+            trace_write(out, inner.samples);
+            trace_write(out, inner.usage);
+            trace_write(out, static_cast<uint64_t>(image_contents[i].size())); // 0 when it couldn't be read back
+            write(out);
+            write(image_contents[i]);
+        }
+
+        out.clear();
+        trace_write(out, static_cast<uint32_t>(self->samplers.size()));
+        for(const auto& sampler : self->samplers){
+            const auto& info = sampler.self->create_info;
+            trace_write(out, info.magFilter);
+            trace_write(out, info.minFilter);
+            trace_write(out, info.mipmapMode);
+            trace_write(out, info.addressModeU);
+            trace_write(out, info.addressModeV);
+            trace_write(out, info.addressModeW);
+            trace_write(out, info.mipLodBias);
+            trace_write(out, info.anisotropyEnable);
+            trace_write(out, info.maxAnisotropy);
+            trace_write(out, info.compareEnable);
+            trace_write(out, info.compareOp);
+            trace_write(out, info.minLod);
+            trace_write(out, info.maxLod);
+            trace_write(out, info.borderColor);
+        }
+
+        trace_write(out, static_cast<uint32_t>(self->set_layouts.size()));
+        for(const auto& layout : self->set_layouts){
+            const auto& inner = *layout.self;
+            trace_write(out, inner.flags);
+            trace_write(out, static_cast<uint32_t>(inner.bindings.size()));
+            for(const auto& binding : inner.bindings){
+                trace_write(out, binding.binding);
+                trace_write(out, binding.descriptorType);
+                trace_write(out, binding.descriptorCount);
+                trace_write(out, binding.stageFlags);
+            }
+        }
+
+        trace_write(out, static_cast<uint32_t>(self->descriptor_sets.size()));
+        write(out);
+        for(const auto& set : self->descriptor_sets) write(set);
+
+        out.clear();
+        trace_write(out, static_cast<uint32_t>(self->pipelines.size()));
+        write(out);
+        for(const auto& pipeline : self->pipelines) write(pipeline);
+
+        out.clear();
+        trace_write(out, self->submission_count);
+        write(out);
+        write(self->submissions);
+
+        fp.close();
+        if(fp.fail()){
+            spdlog::error("Failed to write command capture {} to {}", self->label, path);
+            return false;
+        }
+        return true;
+    }
+
+    void CommandCapture::clear(){
+        std::lock_guard lock(self->mutex);
+        self->buffer_ids.clear();
+        self->buffers.clear();
+        self->image_ids.clear();
+        self->images.clear();
+        self->sampler_ids.clear();
+        self->samplers.clear();
+        self->set_layout_ids.clear();
+        self->set_layouts.clear();
+        self->descriptor_set_ids.clear();
+        self->descriptor_sets.clear();
+        self->descriptor_set_refs.clear();
+        self->unsupported_descriptor_sets = 0;
+        self->pipeline_ids.clear();
+        self->pipelines.clear();
+        self->pipeline_refs.clear();
+        self->unsupported_pipelines = 0;
+        self->submissions.clear();
+        self->submission_count = 0;
+        self->flags = 0;
+        self->skipped_commands = 0;
+    }
+
+    CaptureStats CommandCapture::stats() const {
+        std::lock_guard lock(self->mutex);
+        CaptureStats stats = {};
+        stats.submissions = self->submission_count;
+        stats.buffers = static_cast<uint32_t>(self->buffers.size());
+        for(const auto& buffer : self->buffers){
+            if(!buffer.host_visible) stats.unreadable_buffers++;
+        }
+        stats.images = static_cast<uint32_t>(self->images.size());
+        stats.samplers = static_cast<uint32_t>(self->samplers.size());
+        stats.descriptor_sets = static_cast<uint32_t>(self->descriptor_sets.size());
+        stats.unsupported_descriptor_sets = self->unsupported_descriptor_sets;
+        stats.pipelines = static_cast<uint32_t>(self->pipelines.size());
+        stats.unsupported_pipelines = self->unsupported_pipelines;
+        stats.skipped_commands = self->skipped_commands.load(std::memory_order_relaxed);
+        return stats;
+    }
+} // g_app
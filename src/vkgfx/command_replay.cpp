@@ -0,0 +1,864 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include "../include/vkgfx/command_replay.hpp"
+
+#include <format>
+#include <fstream>
+#include <chrono>
+
+namespace g_app {
+    namespace {
+        /* Bounds checked reads from a trace, throws on truncated data. */
+        class TraceReader {
+        public:
+            explicit TraceReader(std::span<const uint8_t> data): m_data{data} {}
+
+            template<typename T> requires std::is_trivially_copyable_v<T>
+            T read(){
+                T value;
+                std::memcpy(&value, take(sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            std::string read_string(){
+                auto size = read<uint32_t>();
+                auto data = take(size);
+                return {reinterpret_cast<const char*>(data), size};
+            }
+
+            std::span<const uint8_t> read_bytes(size_t size){
+                return {take(size), size};
+            }
+
+            void skip(size_t size) { take(size); }
+            bool at_end() const { return m_offset == m_data.size(); }
+        private:
+            const uint8_t* take(size_t size){
+                if(size > m_data.size() - m_offset) throw std::runtime_error("Command trace is truncated!");
+                auto data = m_data.data() + m_offset;
+                m_offset += size;
+                return data;
+            }
+
+            std::span<const uint8_t> m_data;
+            size_t m_offset = 0;
+        };
+
+        constexpr size_t BUFFER_REF = sizeof(uint32_t) + sizeof(VkDeviceSize); // Buffer index and offset
+
+        /* Reads past a command's arguments, throws on commands this version doesn't know. */
+        void skip_arguments(TraceReader& reader, TraceOp op){
+            switch(op){
+                case TraceOp::BEGIN_DEFAULT_RENDER_PASS:
+                case TraceOp::BEGIN_DEFAULT_RENDERING: reader.skip(4 * sizeof(float)); break;
+                case TraceOp::BEGIN_UNSUPPORTED_PASS:
+                case TraceOp::END_RENDER_PASS:
+                case TraceOp::END_RENDERING:
+                case TraceOp::BARRIER: break;
+                case TraceOp::BIND_PIPELINE: reader.skip(2 * sizeof(uint32_t)); break;
+                case TraceOp::BIND_VERTEX_BUFFERS: reader.skip(reader.read<uint32_t>() * BUFFER_REF); break;
+                case TraceOp::BIND_INDEX_BUFFER: reader.skip(BUFFER_REF + sizeof(uint32_t)); break;
+                case TraceOp::PUSH_CONSTANTS: reader.skip(2 * sizeof(uint32_t)); reader.skip(reader.read<uint32_t>()); break;
+                case TraceOp::DRAW: reader.skip(4 * sizeof(uint32_t)); break;
+                case TraceOp::DRAW_INDEXED: reader.skip(5 * sizeof(uint32_t)); break;
+                case TraceOp::DRAW_INDIRECT:
+                case TraceOp::DRAW_INDEXED_INDIRECT: reader.skip(BUFFER_REF + sizeof(uint32_t)); break;
+                case TraceOp::DRAW_INDIRECT_COUNT:
+                case TraceOp::DRAW_INDEXED_INDIRECT_COUNT: reader.skip(2 * BUFFER_REF + sizeof(uint32_t)); break;
+                case TraceOp::DISPATCH: reader.skip(3 * sizeof(uint32_t)); break;
+                case TraceOp::DISPATCH_INDIRECT: reader.skip(BUFFER_REF); break;
+                case TraceOp::BIND_DESCRIPTOR_SETS:
+                    reader.skip(2 * sizeof(uint32_t));
+                    reader.skip(reader.read<uint32_t>() * sizeof(uint32_t));
+                    reader.skip(reader.read<uint32_t>() * sizeof(uint32_t));
+                    break;
+                case TraceOp::COPY_BUFFER: reader.skip(2 * BUFFER_REF + sizeof(VkDeviceSize)); break;
+                case TraceOp::COPY_BUFFER_TO_IMAGE: reader.skip(2 * sizeof(uint32_t) + sizeof(VkBufferImageCopy)); break;
+                default:
+                    throw std::runtime_error(std::format("Unknown command {} in trace!", static_cast<uint32_t>(op)));
+            }
+        }
+
+        /* The captured renderer's swapchain and depth formats become the replaying renderer's. */
+        VkFormat replay_format(VkFormat format, VkFormat captured_swapchain, VkFormat captured_depth, const VulkanRenderer& renderer){
+            if(format != VK_FORMAT_UNDEFINED && format == captured_swapchain) return renderer.chosen_swapchain_format();
+            if(format != VK_FORMAT_UNDEFINED && format == captured_depth) return renderer.chosen_depth_format();
+            return format;
+        }
+
+        // Whatever the captured buffers were used as, the recreated ones can be used the same way
+        constexpr VkBufferUsageFlags REPLAY_BUFFER_USAGE =
+                VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+        VkExtent3D mip_extent(VkExtent3D extent, uint32_t mip){
+            return {std::max(extent.width >> mip, 1u), std::max(extent.height >> mip, 1u), std::max(extent.depth >> mip, 1u)};
+        }
+
+        /* Throws if 'id' doesn't refer to one of 'count' resources, TRACE_INVALID_ID is accepted where 'optional'. */
+        void check_id(uint32_t id, size_t count, bool optional, const std::string& path){
+            if(id < count || (optional && id == TRACE_INVALID_ID)) return;
+            throw std::runtime_error(std::format("Command trace {} refers to a resource it doesn't have!", path));
+        }
+    }
+
+    CommandTrace::CommandTrace(const std::string& path) {
+        std::ifstream fp(path, std::ios::binary | std::ios::ate);
+        if(!fp.is_open()) throw std::runtime_error(std::format("Failed to open command trace {}", path));
+
+        std::vector<uint8_t> data(static_cast<size_t>(fp.tellg()));
+        fp.seekg(0);
+        fp.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size()));
+        fp.close();
+
+        TraceReader reader(data);
+        auto magic = reader.read_bytes(sizeof(TRACE_MAGIC));
+        if(std::memcmp(magic.data(), TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0){
+            throw std::runtime_error(std::format("{} isn't a command trace!", path));
+        }
+        auto version = reader.read<uint32_t>();
+        if(version != TRACE_VERSION){
+            throw std::runtime_error(std::format("Command trace {} has version {}, expected {}!", path, version, TRACE_VERSION));
+        }
+
+        auto inner = std::make_shared<Inner>();
+        inner->flags = reader.read<uint32_t>();
+        inner->extent = reader.read<VkExtent2D>();
+        inner->swapchain_format = reader.read<VkFormat>();
+        inner->depth_format = reader.read<VkFormat>();
+
+        inner->buffers.resize(reader.read<uint32_t>());
+        for(auto& buffer : inner->buffers){
+            auto size = reader.read<uint64_t>();
+            buffer.host_visible = reader.read<uint8_t>() != 0;
+            auto contents = reader.read_bytes(size);
+            buffer.contents.assign(contents.begin(), contents.end());
+        }
+
+        inner->images.resize(reader.read<uint32_t>());
+        for(auto& image : inner->images){
+            image.image_type = reader.read<VkImageType>();
+            image.format = reader.read<VkFormat>();
+            image.extent = reader.read<VkExtent3D>();
+            image.mip_levels = reader.read<uint32_t>();
+            image.layer_count = reader.read<uint32_t>();
+            image.samples = reader.read<VkSampleCountFlagBits>();
+            image.usage = reader.read<VkImageUsageFlags>();
+            auto contents = reader.read_bytes(reader.read<uint64_t>());
+            image.contents.assign(contents.begin(), contents.end());
+
+            VkDeviceSize size = 0;
+            for(uint32_t mip = 0; mip < image.mip_levels; mip++){
+                auto extent = mip_extent(image.extent, mip);
+                size += static_cast<VkDeviceSize>(extent.width) * extent.height * extent.depth * image.layer_count *
+                        format_texel_size(image.format);
+            }
+            if(!image.contents.empty() && image.contents.size() != size){
+                throw std::runtime_error(std::format("Command trace {} has an image with contents of the wrong size!", path));
+            }
+        }
+
+        inner->samplers.resize(reader.read<uint32_t>());
+        for(auto& sampler : inner->samplers){
+            sampler = {VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+            sampler.magFilter = reader.read<VkFilter>();
+            sampler.minFilter = reader.read<VkFilter>();
+            sampler.mipmapMode = reader.read<VkSamplerMipmapMode>();
+            sampler.addressModeU = reader.read<VkSamplerAddressMode>();
+            sampler.addressModeV = reader.read<VkSamplerAddressMode>();
+            sampler.addressModeW = reader.read<VkSamplerAddressMode>();
+            sampler.mipLodBias = reader.read<float>();
+            sampler.anisotropyEnable = reader.read<VkBool32>();
+            sampler.maxAnisotropy = reader.read<float>();
+            sampler.compareEnable = reader.read<VkBool32>();
+            sampler.compareOp = reader.read<VkCompareOp>();
+            sampler.minLod = reader.read<float>();
+            sampler.maxLod = reader.read<float>();
+            sampler.borderColor = reader.read<VkBorderColor>();
+        }
+
+        inner->set_layouts.resize(reader.read<uint32_t>());
+        for(auto& layout : inner->set_layouts){
+            layout.flags = reader.read<VkDescriptorSetLayoutCreateFlags>();
+            layout.bindings.resize(reader.read<uint32_t>());
+            for(auto& binding : layout.bindings){
+                binding = {};
+                binding.binding = reader.read<uint32_t>();
+                binding.descriptorType = reader.read<VkDescriptorType>();
+                binding.descriptorCount = reader.read<uint32_t>();
+                binding.stageFlags = reader.read<VkShaderStageFlags>();
+            }
+        }
+
+        inner->descriptor_sets.resize(reader.read<uint32_t>());
+        for(auto& set : inner->descriptor_sets){
+            set.layout = reader.read<uint32_t>();
+            check_id(set.layout, inner->set_layouts.size(), false, path);
+            set.descriptors.resize(reader.read<uint32_t>());
+            for(auto& descriptor : set.descriptors){
+                descriptor.binding = reader.read<uint32_t>();
+                descriptor.type = reader.read<VkDescriptorType>();
+                if(trace_is_buffer_descriptor(descriptor.type)){
+                    descriptor.buffer = reader.read<uint32_t>();
+                    descriptor.offset = reader.read<VkDeviceSize>();
+                    descriptor.range = reader.read<VkDeviceSize>();
+                    check_id(descriptor.buffer, inner->buffers.size(), false, path);
+                } else if(trace_is_image_descriptor(descriptor.type)){
+                    descriptor.image = reader.read<uint32_t>();
+                    descriptor.view_type = reader.read<VkImageViewType>();
+                    descriptor.aspect_mask = reader.read<VkImageAspectFlags>();
+                    descriptor.sampler = reader.read<uint32_t>();
+                    check_id(descriptor.image, inner->images.size(), descriptor.type == VK_DESCRIPTOR_TYPE_SAMPLER, path);
+                    check_id(descriptor.sampler, inner->samplers.size(), true, path);
+                } else {
+                    throw std::runtime_error(std::format("Command trace {} has a descriptor of unknown type!", path));
+                }
+            }
+        }
+
+        auto read_module = [&reader](){
+            TracedModule module = {};
+            module.stage = static_cast<VkShaderStageFlagBits>(reader.read<uint32_t>());
+            module.entry = reader.read_string();
+            auto src = reader.read_bytes(reader.read<uint64_t>());
+            module.src.assign(src.begin(), src.end());
+            return module;
+        };
+        auto read_push_constants = [&reader](TracedPipeline& pipeline){
+            pipeline.push_constants.resize(reader.read<uint32_t>());
+            for(auto& range : pipeline.push_constants) range = reader.read<VkPushConstantRange>();
+        };
+
+        inner->pipelines.resize(reader.read<uint32_t>());
+        for(auto& pipeline : inner->pipelines){
+            pipeline.kind = reader.read<TracePipelineKind>();
+            pipeline.label = reader.read_string();
+            if(pipeline.kind != TracePipelineKind::UNSUPPORTED){
+                pipeline.set_layouts.resize(reader.read<uint32_t>());
+                for(auto& layout : pipeline.set_layouts){
+                    layout = reader.read<uint32_t>();
+                    check_id(layout, inner->set_layouts.size(), false, path);
+                }
+            }
+            if(pipeline.kind == TracePipelineKind::COMPUTE){
+                pipeline.modules.push_back(read_module());
+                read_push_constants(pipeline);
+            } else if(pipeline.kind == TracePipelineKind::GRAPHICS){
+                pipeline.modules.resize(reader.read<uint32_t>());
+                for(auto& module : pipeline.modules) module = read_module();
+                read_push_constants(pipeline);
+
+                pipeline.bindings.resize(reader.read<uint32_t>());
+                for(auto& binding : pipeline.bindings){
+                    binding.stride = reader.read<uint32_t>();
+                    binding.input_rate = reader.read<VkVertexInputRate>();
+                    binding.attributes.resize(reader.read<uint32_t>());
+                    for(auto& attribute : binding.attributes) attribute = reader.read<VertexAttribute>();
+                }
+
+                pipeline.target = reader.read<TraceRenderTarget>();
+                if(pipeline.target == TraceRenderTarget::RENDERING_FORMATS){
+                    pipeline.color_formats.resize(reader.read<uint32_t>());
+                    for(auto& format : pipeline.color_formats) format = reader.read<VkFormat>();
+                    pipeline.depth_format = reader.read<VkFormat>();
+                    pipeline.stencil_format = reader.read<VkFormat>();
+                } else {
+                    pipeline.subpass = reader.read<uint32_t>();
+                }
+
+                pipeline.topology = reader.read<VkPrimitiveTopology>();
+                pipeline.rasterization_info = reader.read<RasterizationInfo>();
+                pipeline.sample_count = reader.read<VkSampleCountFlagBits>();
+                pipeline.blend_info = reader.read<BlendInfo>();
+                pipeline.depth_stencil_info = reader.read<DepthStencilInfo>();
+            } else if(pipeline.kind != TracePipelineKind::UNSUPPORTED){
+                throw std::runtime_error(std::format("Command trace {} has a pipeline of unknown kind!", path));
+            }
+        }
+
+        // Every command stream is walked once, so replaying can't run into malformed commands
+        inner->submissions.resize(reader.read<uint32_t>());
+        for(auto& submission : inner->submissions){
+            submission.queue = static_cast<Queue>(reader.read<uint32_t>());
+            auto commands = reader.read_bytes(reader.read<uint64_t>());
+            submission.commands.assign(commands.begin(), commands.end());
+
+            TraceReader command_reader(submission.commands);
+            while(!command_reader.at_end()) skip_arguments(command_reader, command_reader.read<TraceOp>());
+        }
+
+        if(!reader.at_end()) throw std::runtime_error(std::format("Command trace {} has trailing data!", path));
+        self = std::move(inner);
+    }
+
+    CommandReplay::CommandReplay(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->label = config.label;
+        self->trace = config.trace;
+        if(!self->trace.is_valid()){
+            throw std::runtime_error(std::format("A CommandReplay needs a trace! label = {}", self->label));
+        }
+        if(self->trace.uses_dynamic_rendering() && !renderer.has_dynamic_rendering()){
+            throw std::runtime_error(std::format("The trace of {} uses dynamic rendering, which wasn't enabled on the renderer!", self->label));
+        }
+        if(self->trace.uses_draw_indirect_count() && !renderer.has_draw_indirect_count()){
+            throw std::runtime_error(std::format("The trace of {} uses draw indirect count, which wasn't enabled on the renderer!", self->label));
+        }
+
+        // Buffers that weren't host visible are uploaded, so they stay in the kind of memory they were captured from
+        auto uploads = renderer.uploads();
+        const auto& traced_buffers = self->trace.self->buffers;
+        self->buffers.resize(traced_buffers.size());
+        self->vk_buffers.resize(traced_buffers.size(), VK_NULL_HANDLE);
+        for(size_t i = 0; i < traced_buffers.size(); i++){
+            const auto& traced = traced_buffers[i];
+            if(traced.contents.empty()) continue;
+
+            auto init = BufferInit<uint8_t>()
+                    .set_label(std::format("{} buffer {}", self->label, i))
+                    .set_usage(REPLAY_BUFFER_USAGE)
+                    .set_size(traced.contents.size());
+            if(traced.host_visible){
+                self->buffers[i] = init.set_memory_usage(VMA_MEMORY_USAGE_CPU_TO_GPU).set_data(traced.contents.data()).init(renderer);
+            } else {
+                self->buffers[i] = init.set_memory_usage(VMA_MEMORY_USAGE_GPU_ONLY).init(renderer);
+                uploads.upload_buffer(self->buffers[i], traced.contents.data());
+            }
+            self->vk_buffers[i] = self->buffers[i].vk_buffer();
+        }
+        uploads.flush().wait();
+
+        create_images();
+        create_descriptor_sets();
+        for(const auto& traced : self->trace.self->pipelines) create_pipeline(traced);
+
+        self->frames = PerFrame(renderer, [&](uint32_t){ return Frame{CommandBuffer(renderer)}; });
+        self->barrier = PipelineBarrierInfoBuilder()
+                .set_stage_flags(VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT)
+                .add_memory_barrier(VK_ACCESS_MEMORY_WRITE_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+                .build();
+
+        auto props = renderer.physical_device_properties();
+        if(props.limits.timestampComputeAndGraphics){
+            self->timestamp_period = props.limits.timestampPeriod;
+
+            VkQueryPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+            pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            pool_info.queryCount = 2 * renderer.frames_in_flight();
+
+            VkResult result = VK_SUCCESS;
+            if((result = vkCreateQueryPool(renderer.inner()->device, &pool_info, nullptr, &self->query_pool)) != VK_SUCCESS){
+                throw std::runtime_error(
+                        std::format("Failed to create a query pool! label = {}, result = {}", self->label, static_cast<uint32_t>(result))
+                );
+            }
+        } else {
+            spdlog::warn("The device doesn't support timestamps, {} only measures CPU time", self->label);
+        }
+    }
+
+    void CommandReplay::create_images() {
+        auto& renderer = self->renderer;
+        auto uploads = renderer.uploads();
+        auto to_general = PipelineBarrierInfoBuilder()
+                .set_stage_flags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+        bool has_transitions = false;
+
+        const auto& traced_images = self->trace.self->images;
+        for(size_t i = 0; i < traced_images.size(); i++){
+            const auto& traced = traced_images[i];
+            auto image = ImageInit()
+                    .set_label(std::format("{} image {}", self->label, i))
+                    .set_image_type(traced.image_type)
+                    .set_extent(traced.extent.width, traced.extent.height, traced.extent.depth)
+                    .set_mip_levels(traced.mip_levels)
+                    .set_array_layers(traced.layer_count)
+                    .set_format(traced.format)
+                    .set_samples(traced.samples)
+                    .set_usage((traced.usage & ~VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) | VK_IMAGE_USAGE_TRANSFER_DST_BIT)
+                    .init(renderer);
+            self->images.push_back(image);
+
+            // Images that couldn't be read back are replayed zeroed, where the format allows uploading zeroes
+            auto texel_size = format_texel_size(traced.format);
+            if(texel_size == 0 || traced.samples != VK_SAMPLE_COUNT_1_BIT){
+                to_general.add_image_memory_barrier(image, 0, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                                                    VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                                                    {image.aspect_mask(), 0, traced.mip_levels, 0, traced.layer_count});
+                image.resource_state().layout = VK_IMAGE_LAYOUT_GENERAL;
+                has_transitions = true;
+                continue;
+            }
+
+            // Mip levels are tightly packed, the first one is the largest
+            std::vector<uint8_t> zeroes = {};
+            VkDeviceSize offset = 0;
+            for(uint32_t mip = 0; mip < traced.mip_levels; mip++){
+                auto extent = mip_extent(traced.extent, mip);
+                VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * extent.depth * traced.layer_count * texel_size;
+                if(traced.contents.empty() && zeroes.empty()) zeroes.resize(size);
+                const uint8_t* pixels = (traced.contents.empty()) ? zeroes.data() : traced.contents.data() + offset;
+                uploads.upload_image(image, pixels, texel_size, VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_GENERAL,
+                                     VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT,
+                                     mip, 0, traced.layer_count);
+                offset += size;
+            }
+        }
+        uploads.flush().wait();
+
+        if(has_transitions) CommandBuffer(renderer).begin().pipeline_barrier(to_general.build()).submit_blocking(Queue::GRAPHICS);
+    }
+
+    const ImageView& CommandReplay::image_view(const CommandTrace::TracedDescriptor& traced) {
+        auto [it, inserted] = self->image_views.try_emplace({traced.image, traced.view_type, traced.aspect_mask});
+        if(inserted){
+            it->second = ImageViewInit()
+                    .set_label(std::format("{} image {} view", self->label, traced.image))
+                    .set_image(self->images[traced.image])
+                    .set_type(traced.view_type)
+                    .set_aspect_mask(traced.aspect_mask)
+                    .init(self->renderer);
+        }
+        return it->second;
+    }
+
+    void CommandReplay::create_descriptor_sets() {
+        auto& renderer = self->renderer;
+        const auto& trace = *self->trace.self;
+
+        for(const auto& traced : trace.samplers){
+            auto init = SamplerInit()
+                    .set_filter(traced.magFilter, traced.minFilter)
+                    .set_mipmap_mode(traced.mipmapMode)
+                    .set_address_modes(traced.addressModeU, traced.addressModeV, traced.addressModeW)
+                    .set_border_color(traced.borderColor)
+                    .set_mip_options(traced.mipLodBias, traced.minLod, traced.maxLod);
+            if(traced.anisotropyEnable) init.enable_anisotropy(traced.maxAnisotropy);
+            if(traced.compareEnable) init.enable_compare_op(traced.compareOp);
+            self->samplers.push_back(init.init(renderer));
+        }
+
+        for(const auto& traced : trace.set_layouts){
+            auto init = DescriptorSetLayoutInit()
+                    .set_label(std::format("{} set layout {}", self->label, self->set_layouts.size()))
+                    .set_flags(traced.flags);
+            for(const auto& binding : traced.bindings){
+                init.add_binding(binding.binding, binding.descriptorType, binding.descriptorCount, binding.stageFlags);
+            }
+            self->set_layouts.push_back(init.init(renderer));
+        }
+
+        if(trace.descriptor_sets.empty()) return;
+
+        // One pool holding exactly the captured sets
+        std::map<VkDescriptorType, uint32_t> pool_sizes = {};
+        std::vector<DescriptorSetLayout> layouts = {};
+        for(const auto& traced : trace.descriptor_sets){
+            layouts.push_back(self->set_layouts[traced.layout]);
+            for(const auto& binding : trace.set_layouts[traced.layout].bindings){
+                pool_sizes[binding.descriptorType] += binding.descriptorCount;
+            }
+        }
+        auto pool_init = DescriptorPoolInit()
+                .set_label(std::format("{} descriptor pool", self->label))
+                .set_max_sets(static_cast<uint32_t>(layouts.size()));
+        for(auto [type, count] : pool_sizes) pool_init.add_pool_size(type, count);
+        self->descriptor_pool = pool_init.init(renderer);
+        auto sets = self->descriptor_pool.allocate_sets(layouts);
+
+        DescriptorWriter writer = {};
+        for(size_t i = 0; i < sets.size(); i++){
+            auto& set = self->descriptor_sets.emplace_back();
+            bool valid = true;
+            for(const auto& descriptor : trace.descriptor_sets[i].descriptors){
+                if(trace_is_buffer_descriptor(descriptor.type)){
+                    auto buffer = self->vk_buffers[descriptor.buffer];
+                    valid = valid && buffer != VK_NULL_HANDLE;
+                    if(buffer == VK_NULL_HANDLE) continue;
+                    writer.write_buffer(sets[i], descriptor.binding, descriptor.type,
+                                        BufferRange<uint8_t>{buffer, descriptor.offset, descriptor.range});
+                    continue;
+                }
+
+                auto view = (descriptor.image != TRACE_INVALID_ID) ? image_view(descriptor) : ImageView{};
+                auto sampler = (descriptor.sampler != TRACE_INVALID_ID) ? self->samplers[descriptor.sampler] : Sampler{};
+                writer.write_image(sets[i], descriptor.binding, descriptor.type, view, sampler, VK_IMAGE_LAYOUT_GENERAL);
+            }
+            if(valid) set = sets[i];
+        }
+        writer.commit_writes(renderer);
+    }
+
+    void CommandReplay::create_pipeline(const CommandTrace::TracedPipeline& traced) {
+        auto& renderer = self->renderer;
+        auto& pipeline = self->pipelines.emplace_back();
+        if(traced.kind == TracePipelineKind::UNSUPPORTED){
+            spdlog::warn("Pipeline {} couldn't be captured, {} skips the commands using it", traced.label, self->label);
+            return;
+        }
+
+        auto module = [&renderer](const CommandTrace::TracedModule& traced_module){
+            return ShaderModuleInit()
+                    .set_src(traced_module.src)
+                    .set_stage(traced_module.stage)
+                    .set_entry_point(traced_module.entry)
+                    .init(renderer);
+        };
+
+        if(traced.kind == TracePipelineKind::COMPUTE){
+            auto init = ComputePipelineInit()
+                    .set_label(traced.label)
+                    .set_shader_module(module(traced.modules[0]));
+            for(auto layout : traced.set_layouts) init.add_descriptor_set_layout(self->set_layouts[layout]);
+            for(const auto& range : traced.push_constants) init.add_push_constant_range(range);
+            pipeline = init.init(renderer);
+            return;
+        }
+
+        auto init = GraphicsPipelineInit()
+                .set_label(traced.label)
+                .set_topology(traced.topology)
+                .set_rasterization_info(traced.rasterization_info)
+                .set_sample_count(traced.sample_count)
+                .set_blend_info(traced.blend_info)
+                .set_depth_stencil_info(traced.depth_stencil_info);
+        for(const auto& traced_module : traced.modules) init.attach_shader_module(module(traced_module));
+        for(auto layout : traced.set_layouts) init.add_descriptor_set_layout(self->set_layouts[layout]);
+        for(const auto& range : traced.push_constants) init.add_push_constant_range(range);
+        for(const auto& binding : traced.bindings) init.add_vertex_binding(binding);
+
+        if(traced.target == TraceRenderTarget::RENDERING_FORMATS){
+            const auto& trace = *self->trace.self;
+            std::vector<VkFormat> color_formats = {};
+            for(auto format : traced.color_formats){
+                color_formats.push_back(replay_format(format, trace.swapchain_format, trace.depth_format, renderer));
+            }
+            init.set_rendering_formats(color_formats,
+                                       replay_format(traced.depth_format, trace.swapchain_format, trace.depth_format, renderer),
+                                       replay_format(traced.stencil_format, trace.swapchain_format, trace.depth_format, renderer));
+        } else {
+            init.set_render_pass(renderer.default_render_pass()).set_subpass(traced.subpass);
+        }
+        pipeline = init.init(renderer);
+    }
+
+    uint32_t CommandReplay::replay(CommandBuffer& cmd, const std::vector<uint8_t>& commands) {
+        const auto& pipelines = self->pipelines;
+        const auto& vk_buffers = self->vk_buffers;
+        auto find_pipeline = [&pipelines](uint32_t id) -> const Pipeline* {
+            return (id < pipelines.size() && pipelines[id]) ? &pipelines[id].value() : nullptr;
+        };
+        auto find_buffer = [&vk_buffers](uint32_t id){
+            return (id < vk_buffers.size()) ? vk_buffers[id] : VK_NULL_HANDLE;
+        };
+        auto find_image = [this](uint32_t id) -> const Image* {
+            return (id < self->images.size()) ? &self->images[id] : nullptr;
+        };
+        auto find_set = [this](uint32_t id) -> const DescriptorSet* {
+            return (id < self->descriptor_sets.size() && self->descriptor_sets[id]) ? &self->descriptor_sets[id].value() : nullptr;
+        };
+
+        // Draws need everything they use to have been recreated
+        const Pipeline* graphics = nullptr;
+        const Pipeline* compute = nullptr;
+        bool vertex_buffers_valid = true;
+        bool index_buffer_valid = false;
+        bool graphics_sets_valid = true;
+        bool compute_sets_valid = true;
+        std::vector<DescriptorSet> sets = {};
+        std::vector<uint32_t> dynamic_offsets = {};
+        bool in_render_pass = false;
+        bool in_rendering = false;
+        bool skipping_pass = false; // Inside a render pass the trace doesn't have
+        uint32_t skipped = 0;
+
+        TraceReader reader(commands);
+        while(!reader.at_end()){
+            auto op = reader.read<TraceOp>();
+            if(skipping_pass && op != TraceOp::END_RENDER_PASS && op != TraceOp::END_RENDERING){
+                skip_arguments(reader, op);
+                continue;
+            }
+
+            switch(op){
+                case TraceOp::BEGIN_DEFAULT_RENDER_PASS:
+                case TraceOp::BEGIN_DEFAULT_RENDERING: {
+                    auto color = reader.read<std::array<float, 4>>();
+                    in_render_pass = op == TraceOp::BEGIN_DEFAULT_RENDER_PASS;
+                    in_rendering = !in_render_pass;
+                    if(in_render_pass) cmd.begin_default_render_pass(color[0], color[1], color[2], color[3]);
+                    else cmd.begin_default_rendering(color[0], color[1], color[2], color[3]);
+                    break;
+                }
+                case TraceOp::BEGIN_UNSUPPORTED_PASS:
+                    skipping_pass = true;
+                    break;
+                case TraceOp::END_RENDER_PASS:
+                case TraceOp::END_RENDERING:
+                    if(in_render_pass) cmd.end_render_pass();
+                    if(in_rendering) cmd.end_rendering();
+                    in_render_pass = in_rendering = skipping_pass = false;
+                    break;
+                case TraceOp::BIND_PIPELINE: {
+                    auto pipeline = find_pipeline(reader.read<uint32_t>());
+                    auto bind_point = static_cast<VkPipelineBindPoint>(reader.read<uint32_t>());
+                    if(bind_point == VK_PIPELINE_BIND_POINT_COMPUTE) compute = pipeline;
+                    else graphics = pipeline;
+                    if(pipeline) cmd.bind_pipeline(*pipeline, bind_point);
+                    break;
+                }
+                case TraceOp::BIND_VERTEX_BUFFERS: {
+                    std::array<VkBuffer, 32> buffers = {};
+                    std::array<VkDeviceSize, 32> offsets = {};
+                    auto count = reader.read<uint32_t>();
+                    vertex_buffers_valid = count <= buffers.size();
+                    for(uint32_t i = 0; i < count; i++){
+                        auto buffer = find_buffer(reader.read<uint32_t>());
+                        auto offset = reader.read<VkDeviceSize>();
+                        if(i >= buffers.size()) continue;
+                        buffers[i] = buffer;
+                        offsets[i] = offset;
+                        vertex_buffers_valid = vertex_buffers_valid && buffer != VK_NULL_HANDLE;
+                    }
+                    if(vertex_buffers_valid) cmd.bind_vertex_buffers(std::span(buffers.data(), count), std::span(offsets.data(), count));
+                    break;
+                }
+                case TraceOp::BIND_INDEX_BUFFER: {
+                    auto buffer = find_buffer(reader.read<uint32_t>());
+                    auto offset = reader.read<VkDeviceSize>();
+                    auto type = static_cast<VkIndexType>(reader.read<uint32_t>());
+                    index_buffer_valid = buffer != VK_NULL_HANDLE;
+                    if(index_buffer_valid) cmd.bind_index_buffer(BufferRange<uint8_t>{buffer, offset}, type);
+                    break;
+                }
+                case TraceOp::BIND_DESCRIPTOR_SETS: {
+                    auto pipeline = find_pipeline(reader.read<uint32_t>());
+                    auto bind_point = static_cast<VkPipelineBindPoint>(reader.read<uint32_t>());
+                    auto count = reader.read<uint32_t>();
+                    bool valid = pipeline != nullptr;
+                    sets.clear();
+                    for(uint32_t i = 0; i < count; i++){
+                        auto set = find_set(reader.read<uint32_t>());
+                        valid = valid && set;
+                        if(set) sets.push_back(*set);
+                    }
+                    dynamic_offsets.resize(reader.read<uint32_t>());
+                    for(auto& offset : dynamic_offsets) offset = reader.read<uint32_t>();
+
+                    if(bind_point == VK_PIPELINE_BIND_POINT_COMPUTE) compute_sets_valid = valid;
+                    else graphics_sets_valid = valid;
+                    if(valid) cmd.bind_descriptor_sets(*pipeline, bind_point, sets, dynamic_offsets);
+                    break;
+                }
+                case TraceOp::COPY_BUFFER: {
+                    auto src = find_buffer(reader.read<uint32_t>());
+                    auto src_offset = reader.read<VkDeviceSize>();
+                    auto dst = find_buffer(reader.read<uint32_t>());
+                    auto dst_offset = reader.read<VkDeviceSize>();
+                    auto size = reader.read<VkDeviceSize>();
+                    if(src != VK_NULL_HANDLE && dst != VK_NULL_HANDLE){
+                        cmd.copy_buffer(BufferRange<uint8_t>{src, src_offset, size}, BufferRange<uint8_t>{dst, dst_offset, size}, size);
+                    } else {
+                        skipped++;
+                    }
+                    break;
+                }
+                case TraceOp::COPY_BUFFER_TO_IMAGE: {
+                    auto buffer = find_buffer(reader.read<uint32_t>());
+                    auto image = find_image(reader.read<uint32_t>());
+                    auto region = reader.read<VkBufferImageCopy>();
+                    const auto& subresource = region.imageSubresource;
+                    if(buffer != VK_NULL_HANDLE && image){
+                        cmd.copy_buffer_to_image(BufferRange<uint8_t>{buffer, region.bufferOffset}, *image, subresource.aspectMask,
+                                                 VK_IMAGE_LAYOUT_GENERAL, subresource.mipLevel, subresource.baseArrayLayer,
+                                                 subresource.layerCount);
+                    } else {
+                        skipped++;
+                    }
+                    break;
+                }
+                case TraceOp::PUSH_CONSTANTS: {
+                    auto pipeline = find_pipeline(reader.read<uint32_t>());
+                    auto stages = reader.read<uint32_t>();
+                    auto data = reader.read_bytes(reader.read<uint32_t>());
+                    if(pipeline) cmd.push_constants(*pipeline, stages, data.data(), static_cast<uint32_t>(data.size()));
+                    break;
+                }
+                case TraceOp::BARRIER:
+                    if(!in_render_pass && !in_rendering) cmd.pipeline_barrier(self->barrier);
+                    break;
+                case TraceOp::DRAW: {
+                    auto args = reader.read<std::array<uint32_t, 4>>();
+                    if(graphics && graphics_sets_valid && vertex_buffers_valid) cmd.draw(args[0], args[1], args[2], args[3]);
+                    else skipped++;
+                    break;
+                }
+                case TraceOp::DRAW_INDEXED: {
+                    auto index_count = reader.read<uint32_t>();
+                    auto instance_count = reader.read<uint32_t>();
+                    auto first_index = reader.read<uint32_t>();
+                    auto vertex_offset = reader.read<int32_t>();
+                    auto first_instance = reader.read<uint32_t>();
+                    if(graphics && graphics_sets_valid && vertex_buffers_valid && index_buffer_valid){
+                        cmd.draw_indexed(index_count, instance_count, first_index, vertex_offset, first_instance);
+                    } else {
+                        skipped++;
+                    }
+                    break;
+                }
+                case TraceOp::DRAW_INDIRECT:
+                case TraceOp::DRAW_INDEXED_INDIRECT: {
+                    auto buffer = find_buffer(reader.read<uint32_t>());
+                    auto offset = reader.read<VkDeviceSize>();
+                    auto count = reader.read<uint32_t>();
+                    bool indexed = op == TraceOp::DRAW_INDEXED_INDIRECT;
+                    if(!graphics || !graphics_sets_valid || !vertex_buffers_valid || (indexed && !index_buffer_valid) ||
+                       buffer == VK_NULL_HANDLE){
+                        skipped++;
+                    } else if(indexed){
+                        cmd.draw_indexed_indirect(BufferRange<VkDrawIndexedIndirectCommand>{buffer, offset, count});
+                    } else {
+                        cmd.draw_indirect(BufferRange<VkDrawIndirectCommand>{buffer, offset, count});
+                    }
+                    break;
+                }
+                case TraceOp::DRAW_INDIRECT_COUNT:
+                case TraceOp::DRAW_INDEXED_INDIRECT_COUNT: {
+                    auto buffer = find_buffer(reader.read<uint32_t>());
+                    auto offset = reader.read<VkDeviceSize>();
+                    auto max_count = reader.read<uint32_t>();
+                    auto count_buffer = find_buffer(reader.read<uint32_t>());
+                    auto count_offset = reader.read<VkDeviceSize>();
+                    bool indexed = op == TraceOp::DRAW_INDEXED_INDIRECT_COUNT;
+                    BufferRange<uint32_t> counts = {count_buffer, count_offset, 1};
+                    if(!graphics || !graphics_sets_valid || !vertex_buffers_valid || (indexed && !index_buffer_valid) ||
+                       buffer == VK_NULL_HANDLE || count_buffer == VK_NULL_HANDLE){
+                        skipped++;
+                    } else if(indexed){
+                        cmd.draw_indexed_indirect_count(BufferRange<VkDrawIndexedIndirectCommand>{buffer, offset, max_count}, counts);
+                    } else {
+                        cmd.draw_indirect_count(BufferRange<VkDrawIndirectCommand>{buffer, offset, max_count}, counts);
+                    }
+                    break;
+                }
+                case TraceOp::DISPATCH: {
+                    auto groups = reader.read<std::array<uint32_t, 3>>();
+                    if(compute && compute_sets_valid) cmd.dispatch(groups[0], groups[1], groups[2]);
+                    else skipped++;
+                    break;
+                }
+                case TraceOp::DISPATCH_INDIRECT: {
+                    auto buffer = find_buffer(reader.read<uint32_t>());
+                    auto offset = reader.read<VkDeviceSize>();
+                    if(compute && compute_sets_valid && buffer != VK_NULL_HANDLE) cmd.dispatch_indirect(BufferRange<VkDispatchIndirectCommand>{buffer, offset, 1});
+                    else skipped++;
+                    break;
+                }
+                default:
+                    skip_arguments(reader, op); // Unreachable, the trace was validated on load
+                    break;
+            }
+        }
+
+        if(in_render_pass) cmd.end_render_pass();
+        if(in_rendering) cmd.end_rendering();
+        return skipped;
+    }
+
+    void CommandReplay::resolve_timestamps(uint32_t frame, ReplayTimings& timings) {
+        auto& slot = self->frames[frame];
+        if(!slot.timed) return;
+        slot.timed = false;
+
+        std::array<uint64_t, 2> timestamps = {};
+        VkResult result = vkGetQueryPoolResults(self->renderer.inner()->device, self->query_pool, frame * 2, 2,
+                                                sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+                                                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+        if(result != VK_SUCCESS) return;
+        timings.gpu_ms.push_back(static_cast<double>(timestamps[1] - timestamps[0]) * self->timestamp_period / 1e6);
+    }
+
+    ReplayTimings CommandReplay::run(uint32_t iterations) {
+        using clock = std::chrono::steady_clock;
+        auto elapsed_ms = [](clock::time_point begin, clock::time_point end){
+            return std::chrono::duration<double, std::milli>(end - begin).count();
+        };
+
+        auto& renderer = self->renderer;
+        const auto& submissions = self->trace.self->submissions;
+        ReplayTimings timings = {};
+        timings.cpu_record_ms.reserve(iterations * submissions.size());
+        timings.cpu_submit_ms.reserve(iterations * submissions.size());
+        if(self->query_pool != VK_NULL_HANDLE) timings.gpu_ms.reserve(iterations * submissions.size());
+
+        for(uint32_t i = 0; i < iterations; i++){
+            for(const auto& submission : submissions){
+                if(!renderer.acquire_next_swapchain_image()) continue;
+
+                // The frame's fence has been waited on, its previous timestamps are available
+                auto frame = renderer.current_frame();
+                resolve_timestamps(frame, timings);
+                auto& slot = self->frames[frame];
+                auto& cmd = slot.cmd;
+
+                auto record_begin = clock::now();
+                cmd.begin();
+                if(self->query_pool != VK_NULL_HANDLE){
+                    cmd.vk_cmd([&](VkCommandBuffer vk_cmd){
+                        vkCmdResetQueryPool(vk_cmd, self->query_pool, frame * 2, 2);
+                        vkCmdWriteTimestamp(vk_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, self->query_pool, frame * 2);
+                    });
+                }
+                timings.skipped_commands += replay(cmd, submission.commands);
+                if(self->query_pool != VK_NULL_HANDLE){
+                    cmd.vk_cmd([&](VkCommandBuffer vk_cmd){
+                        vkCmdWriteTimestamp(vk_cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, self->query_pool, frame * 2 + 1);
+                    });
+                    slot.timed = true;
+                }
+                auto record_end = clock::now();
+
+                cmd.submit(Queue::GRAPHICS,
+                           {{renderer.current_image_available_semaphore(), VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT}},
+                           {{renderer.current_render_finished_semaphore()}},
+                           renderer.current_in_flight_fence());
+                auto submit_end = clock::now();
+                renderer.present();
+
+                timings.cpu_record_ms.push_back(elapsed_ms(record_begin, record_end));
+                timings.cpu_submit_ms.push_back(elapsed_ms(record_end, submit_end));
+            }
+        }
+
+        renderer.device_wait_idle();
+        for(uint32_t frame = 0; frame < self->frames.size(); frame++) resolve_timestamps(frame, timings);
+        return timings;
+    }
+} // g_app
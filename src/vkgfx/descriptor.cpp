@@ -55,6 +55,8 @@ namespace g_app {
         self{std::make_shared<Inner>(renderer)}
     {
         self->label = config.label;
+        self->bindings = config.bindings;
+        self->flags = config.flags;
 
         auto inner = renderer.inner();
 
@@ -73,10 +75,12 @@ namespace g_app {
         }
     }
 
-    DescriptorSet::DescriptorSet(const VulkanRenderer& renderer, VkDescriptorSet set, const std::string &label):
+    DescriptorSet::DescriptorSet(const VulkanRenderer& renderer, VkDescriptorSet set, const DescriptorSetLayout& layout,
+                                 const std::string &label):
         self{std::make_shared<Inner>(renderer)}
     {
         self->label = label;
         self->set = set;
+        self->layout = layout;
     }
 }
\ No newline at end of file
@@ -0,0 +1,305 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include "../include/vkgfx/draw_list.hpp"
+
+#include <format>
+
+namespace g_app {
+    namespace {
+        // Bit widths of the fields of a packet's sort key, see DrawList
+        constexpr uint32_t PIPELINE_BITS = 16;
+        constexpr uint32_t DESCRIPTOR_SET_BITS = 16;
+        constexpr uint32_t GEOMETRY_BITS = 24;
+
+        // Ids past a field's range share its last value, which only costs grouping, not correctness
+        uint64_t key_field(uint32_t id, uint32_t bits){
+            return std::min<uint64_t>(id, (1ull << bits) - 1);
+        }
+    }
+
+    DrawList::DrawList(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->label = config.label;
+        self->bind_stats = config.bind_stats;
+
+        if(config.multi_draw_capacity > 0 && renderer.has_multi_draw_indirect()){
+            self->draw_stream = IndirectCommandStreamInit<VkDrawIndirectCommand>()
+                    .set_label(std::format("{} -> Draw Stream", self->label))
+                    .set_capacity(config.multi_draw_capacity)
+                    .init(renderer);
+            self->indexed_stream = IndirectCommandStreamInit<VkDrawIndexedIndirectCommand>()
+                    .set_label(std::format("{} -> Indexed Draw Stream", self->label))
+                    .set_capacity(config.multi_draw_capacity)
+                    .init(renderer);
+        }
+    }
+
+    DrawList& DrawList::add(const DrawPacket& packet) {
+        assert(packet.push_size <= DrawPacket::MAX_PUSH_CONSTANT_SIZE && "Push constants are too big for a DrawPacket!");
+
+        auto [pipeline, new_pipeline] = self->pipeline_ids.try_emplace(packet.pipeline.vk_pipeline(), self->pipelines.size());
+        if(new_pipeline) self->pipelines.push_back(packet.pipeline);
+
+        DescriptorSetsKey sets_key = {};
+        sets_key.count = packet.descriptor_set_count;
+        for(uint32_t i = 0; i < packet.descriptor_set_count; i++) sets_key.sets[i] = packet.descriptor_sets[i].vk_descriptor_set();
+        auto [sets, new_sets] = self->descriptor_set_ids.try_emplace(sets_key, self->descriptor_sets.size());
+        if(new_sets){
+            self->descriptor_sets.push_back(packet.descriptor_sets);
+            self->descriptor_set_counts.push_back(packet.descriptor_set_count);
+        }
+
+        Geometry geometry = {};
+        geometry.vertex_buffer_count = packet.vertex_buffer_count;
+        for(uint32_t i = 0; i < packet.vertex_buffer_count; i++){
+            geometry.vertex_buffers[i] = packet.vertex_buffers[i];
+            geometry.vertex_offsets[i] = packet.vertex_offsets[i];
+        }
+        if(packet.index_buffer != VK_NULL_HANDLE){
+            geometry.index_buffer = packet.index_buffer;
+            geometry.index_offset = packet.index_offset;
+            geometry.index_type = packet.index_type;
+        }
+        auto [geometry_id, new_geometry] = self->geometry_ids.try_emplace(geometry, self->geometries.size());
+        if(new_geometry){
+            self->geometries.push_back(geometry);
+            auto& refs = self->geometry_refs.emplace_back();
+            for(uint32_t i = 0; i < packet.vertex_buffer_count; i++){
+                if(!packet.vertex_buffer_refs[i].expired()) refs.push_back(packet.vertex_buffer_refs[i]);
+            }
+            if(!packet.index_buffer_ref.expired()) refs.push_back(packet.index_buffer_ref);
+        }
+
+        Entry entry = {};
+        entry.pipeline = pipeline->second;
+        entry.descriptor_sets = sets->second;
+        entry.geometry = geometry_id->second;
+        entry.push_offset = self->push_data.size();
+        entry.push_size = packet.push_size;
+        entry.push_stages = packet.push_stages;
+        entry.count = packet.count;
+        entry.instance_count = packet.instance_count;
+        entry.first = packet.first;
+        entry.vertex_offset = packet.vertex_offset;
+        entry.first_instance = packet.first_instance;
+        self->push_data.insert(self->push_data.end(), packet.push_data.begin(), packet.push_data.begin() + packet.push_size);
+
+        uint64_t key = static_cast<uint64_t>(packet.layer) << (PIPELINE_BITS + DESCRIPTOR_SET_BITS + GEOMETRY_BITS);
+        key |= key_field(entry.pipeline, PIPELINE_BITS) << (DESCRIPTOR_SET_BITS + GEOMETRY_BITS);
+        key |= key_field(entry.descriptor_sets, DESCRIPTOR_SET_BITS) << GEOMETRY_BITS;
+        key |= key_field(entry.geometry, GEOMETRY_BITS);
+
+        self->order.push_back({key, static_cast<uint32_t>(self->entries.size())});
+        self->entries.push_back(entry);
+        self->sorted = false;
+        return *this;
+    }
+
+    DrawList& DrawList::clear() {
+        self->pipelines.clear();
+        self->pipeline_ids.clear();
+        self->descriptor_sets.clear();
+        self->descriptor_set_counts.clear();
+        self->descriptor_set_ids.clear();
+        self->geometries.clear();
+        self->geometry_refs.clear();
+        self->geometry_ids.clear();
+        self->entries.clear();
+        self->push_data.clear();
+        self->order.clear();
+        self->sorted = false;
+        return *this;
+    }
+
+    DrawList& DrawList::record(CommandBuffer& cmd) {
+        G_APP_TRACE_SCOPE("draw_list_record");
+        self->stats = {};
+        self->stats.packets = self->entries.size();
+        if(self->bind_stats) self->stats.unsorted_binds = count_binds(false);
+        if(!self->sorted) sort();
+        if(self->bind_stats) self->stats.sorted_binds = count_binds(true);
+
+        const auto& order = self->order;
+        uint32_t begin = 0;
+        while(begin < order.size()){
+            const auto& first = self->entries[order[begin].entry];
+            uint32_t end = begin + 1;
+            while(end < order.size() && same_state(first, self->entries[order[end].entry])) end++;
+
+            record_run(cmd, begin, end);
+            begin = end;
+        }
+        return *this;
+    }
+
+    void DrawList::sort() {
+        // LSD radix sort over 8-bit digits, each pass is stable so equal keys keep their submission order
+        auto& items = self->order;
+        auto& scratch = self->scratch;
+        self->sorted = true;
+        if(items.size() < 2) return;
+
+        scratch.resize(items.size());
+        for(uint32_t shift = 0; shift < 64; shift += 8){
+            std::array<uint32_t, 256> offsets = {};
+            for(const auto& item : items) offsets[(item.key >> shift) & 0xFF]++;
+            // Most high digits are shared by every key (few layers, few pipelines), those passes change nothing
+            if(offsets[(items[0].key >> shift) & 0xFF] == items.size()) continue;
+
+            uint32_t sum = 0;
+            for(auto& offset : offsets){
+                auto count = offset;
+                offset = sum;
+                sum += count;
+            }
+            for(const auto& item : items) scratch[offsets[(item.key >> shift) & 0xFF]++] = item;
+            items.swap(scratch);
+        }
+    }
+
+    uint32_t DrawList::count_binds(bool sorted) const {
+        uint32_t binds = 0;
+        const Entry* previous = nullptr;
+        for(uint32_t i = 0; i < self->entries.size(); i++){
+            const auto& entry = self->entries[(sorted) ? self->order[i].entry : i];
+            const auto& geometry = self->geometries[entry.geometry];
+            const Geometry* previous_geometry = (previous) ? &self->geometries[previous->geometry] : nullptr;
+
+            if(!previous || previous->pipeline != entry.pipeline) binds++;
+            if(self->descriptor_set_counts[entry.descriptor_sets] > 0 &&
+               (!previous || previous->descriptor_sets != entry.descriptor_sets)) binds++;
+            if(geometry.vertex_buffer_count > 0 &&
+               (!previous_geometry || previous_geometry->vertex_buffer_count != geometry.vertex_buffer_count ||
+                previous_geometry->vertex_buffers != geometry.vertex_buffers || previous_geometry->vertex_offsets != geometry.vertex_offsets)) binds++;
+            if(geometry.index_buffer != VK_NULL_HANDLE &&
+               (!previous_geometry || previous_geometry->index_buffer != geometry.index_buffer ||
+                previous_geometry->index_offset != geometry.index_offset || previous_geometry->index_type != geometry.index_type)) binds++;
+            if(entry.push_size > 0 &&
+               (!previous || previous->push_stages != entry.push_stages || previous->push_size != entry.push_size ||
+                std::memcmp(self->push_data.data() + previous->push_offset, self->push_data.data() + entry.push_offset, entry.push_size) != 0)) binds++;
+
+            previous = &entry;
+        }
+        return binds;
+    }
+
+    bool DrawList::same_state(const Entry& a, const Entry& b) const {
+        return a.pipeline == b.pipeline && a.descriptor_sets == b.descriptor_sets && a.geometry == b.geometry &&
+               a.push_stages == b.push_stages && a.push_size == b.push_size &&
+               std::memcmp(self->push_data.data() + a.push_offset, self->push_data.data() + b.push_offset, a.push_size) == 0;
+    }
+
+    void DrawList::count_multi_draw(size_t count) {
+        // CommandBuffer splits indirect draws at maxDrawIndirectCount
+        auto max_count = self->renderer.max_draw_indirect_count();
+        auto draws = static_cast<uint32_t>((count + max_count - 1) / max_count);
+        self->stats.draw_calls += draws;
+        self->stats.multi_draw_merges += count - draws;
+    }
+
+    void DrawList::record_run(CommandBuffer& cmd, uint32_t begin, uint32_t end) {
+        const auto& first = self->entries[self->order[begin].entry];
+        const auto& pipeline = self->pipelines[first.pipeline];
+        const auto& geometry = self->geometries[first.geometry];
+        auto set_count = self->descriptor_set_counts[first.descriptor_sets];
+
+        // Buffers are bound by handle, so their owners are registered with a recording CachedCommandBuffer by hand
+        for(const auto& ref : self->geometry_refs[first.geometry]) cmd.depends_on(ref);
+
+        // The command buffer drops binds that match what is already bound
+        cmd.bind_pipeline(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        if(set_count > 0){
+            cmd.bind_descriptor_sets(pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                     std::span<const DescriptorSet>(self->descriptor_sets[first.descriptor_sets].data(), set_count), {});
+        }
+        if(geometry.vertex_buffer_count > 0){
+            cmd.bind_vertex_buffers(std::span(geometry.vertex_buffers.data(), geometry.vertex_buffer_count),
+                                    std::span(geometry.vertex_offsets.data(), geometry.vertex_buffer_count));
+        }
+        if(first.push_size > 0) cmd.push_constants(pipeline, first.push_stages, self->push_data.data() + first.push_offset, first.push_size);
+
+        auto& stats = self->stats;
+        if(geometry.index_buffer != VK_NULL_HANDLE){
+            cmd.bind_index_buffer(BufferRange<uint8_t>{geometry.index_buffer, geometry.index_offset, 0}, geometry.index_type);
+
+            // Draws of the same mesh with contiguous instance ranges become one instanced draw
+            auto& commands = self->indexed_commands;
+            commands.clear();
+            for(uint32_t i = begin; i < end; i++){
+                const auto& entry = self->entries[self->order[i].entry];
+                if(!commands.empty()){
+                    auto& last = commands.back();
+                    if(last.indexCount == entry.count && last.firstIndex == entry.first && last.vertexOffset == entry.vertex_offset &&
+                       last.firstInstance + last.instanceCount == entry.first_instance){
+                        last.instanceCount += entry.instance_count;
+                        stats.instanced_merges++;
+                        continue;
+                    }
+                }
+                commands.push_back({entry.count, entry.instance_count, entry.first, entry.vertex_offset, entry.first_instance});
+            }
+
+            auto& stream = self->indexed_stream;
+            if(commands.size() > 1 && stream.is_valid() && stream.count() + commands.size() <= stream.capacity()){
+                auto first_command = stream.push(std::span(commands));
+                cmd.draw_indexed_indirect(stream.commands(first_command));
+                count_multi_draw(commands.size());
+            } else {
+                for(const auto& c : commands) cmd.draw_indexed(c.indexCount, c.instanceCount, c.firstIndex, c.vertexOffset, c.firstInstance);
+                stats.draw_calls += commands.size();
+            }
+        } else {
+            auto& commands = self->draw_commands;
+            commands.clear();
+            for(uint32_t i = begin; i < end; i++){
+                const auto& entry = self->entries[self->order[i].entry];
+                if(!commands.empty()){
+                    auto& last = commands.back();
+                    if(last.vertexCount == entry.count && last.firstVertex == entry.first &&
+                       last.firstInstance + last.instanceCount == entry.first_instance){
+                        last.instanceCount += entry.instance_count;
+                        stats.instanced_merges++;
+                        continue;
+                    }
+                }
+                commands.push_back({entry.count, entry.instance_count, entry.first, entry.first_instance});
+            }
+
+            auto& stream = self->draw_stream;
+            if(commands.size() > 1 && stream.is_valid() && stream.count() + commands.size() <= stream.capacity()){
+                auto first_command = stream.push(std::span(commands));
+                cmd.draw_indirect(stream.commands(first_command));
+                count_multi_draw(commands.size());
+            } else {
+                for(const auto& c : commands) cmd.draw(c.vertexCount, c.instanceCount, c.firstVertex, c.firstInstance);
+                stats.draw_calls += commands.size();
+            }
+        }
+    }
+}
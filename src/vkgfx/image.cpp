@@ -39,7 +39,10 @@ g_app::Image::Image(g_app::VulkanRenderer renderer, const g_app::Image::Config &
     self->format = config.format;
     self->mip_levels = config.mip_levels;
     self->layer_count = config.array_layers;
+    self->samples = config.samples;
     self->extent = config.extent;
+    self->image_type = config.image_type;
+    self->state.layout = config.initial_layout;
 
     VkImageCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
     create_info.imageType = config.image_type;
@@ -50,17 +53,34 @@ g_app::Image::Image(g_app::VulkanRenderer renderer, const g_app::Image::Config &
     create_info.tiling = config.tiling;
     create_info.initialLayout = config.initial_layout;
     create_info.usage = config.usage;
+    // Lets CommandCapture::save() read the image back. Transient attachments can't be copied from, and aliased
+    // images have to keep the memory requirements their allocation was made for.
+    if(renderer.has_command_capture() && !(config.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) &&
+       config.aliased_allocation == VK_NULL_HANDLE){
+        create_info.usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    }
+    self->usage = create_info.usage;
     create_info.flags = config.flags;
     create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     create_info.samples = config.samples;
+    const auto& families = renderer.unique_queue_families();
+    if(config.concurrent && families.size() > 1){
+        create_info.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        create_info.queueFamilyIndexCount = static_cast<uint32_t>(families.size());
+        create_info.pQueueFamilyIndices = families.data();
+    }
 
     VmaAllocationCreateInfo alloc_info = {};
     alloc_info.usage = config.memory_usage;
 
     VkResult result = VK_SUCCESS;
-    if((result =
-            vmaCreateImage(renderer.inner()->allocator, &create_info, &alloc_info,
-                           &self->image, &self->allocation, nullptr)) != VK_SUCCESS)
+    if(config.aliased_allocation != VK_NULL_HANDLE){
+        // self->allocation stays null, so destroying the image leaves the shared memory alone
+        result = vmaCreateAliasingImage(renderer.inner()->allocator, config.aliased_allocation, &create_info, &self->image);
+    } else {
+        result = vmaCreateImage(renderer.inner()->allocator, &create_info, &alloc_info, &self->image, &self->allocation, nullptr);
+    }
+    if(result != VK_SUCCESS)
     {
         throw std::runtime_error(
                 std::format("Failed to create an image! label = {}, result = {}", self->label, static_cast<uint32_t>(result) )
@@ -70,6 +90,11 @@ g_app::Image::Image(g_app::VulkanRenderer renderer, const g_app::Image::Config &
 
 g_app::ImageView::ImageView(const g_app::VulkanRenderer& renderer, const g_app::ImageView::Config &config): self{std::make_shared<Inner>(renderer)} {
     self->label = config.label;
+    self->format = config.image.format();
+    self->samples = config.image.samples();
+    self->image = config.image;
+    self->view_type = config.view_type;
+    self->aspect_mask = config.aspect_mask;
 
     VkImageViewCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
 
@@ -113,6 +138,7 @@ g_app::Sampler::Sampler(const g_app::VulkanRenderer &renderer, const g_app::Samp
     create_info.minLod = config.min_lod;
     create_info.maxLod = config.max_lod;
 
+    self->create_info = create_info;
     VkResult result = vkCreateSampler(inner->device, &create_info, nullptr, &self->sampler);
     if(result != VK_SUCCESS){
         throw std::runtime_error(
@@ -0,0 +1,174 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include "../include/vkgfx/parallel_recorder.hpp"
+
+#include <format>
+
+namespace g_app {
+    ParallelRecorder::ParallelRecorder(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->label = config.label;
+        self->queue_family = renderer.queue_family_index(config.queue);
+        self->thread_count = (config.thread_count > 0) ? config.thread_count : std::max(std::thread::hardware_concurrency(), 1u);
+
+        auto device = renderer.inner()->device;
+        self->pools.resize(renderer.frames_in_flight());
+        self->reset_frame.resize(renderer.frames_in_flight(), UINT64_MAX);
+        self->recorded.resize(self->thread_count);
+        for(auto& frame : self->pools){
+            frame.resize(self->thread_count);
+            for(auto& thread : frame){
+                VkCommandPoolCreateInfo create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+                create_info.queueFamilyIndex = self->queue_family;
+                create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+                VkResult result = VK_SUCCESS;
+                if((result = vkCreateCommandPool(device, &create_info, nullptr, &thread.pool)) != VK_SUCCESS){
+                    throw std::runtime_error(std::format("Failed to create a recording thread's command pool! label = {}, result = {}",
+                                                         self->label, static_cast<uint32_t>(result)));
+                }
+            }
+        }
+
+        auto inner = self.get();
+        for(uint32_t i = 1; i < self->thread_count; i++){
+            self->workers.emplace_back([inner](){ inner->worker(); });
+        }
+    }
+
+    CommandBuffer& ParallelRecorder::record_ranges(CommandBuffer& primary, uint32_t count, RecordCallback f, void* context) {
+        G_APP_TRACE_SCOPE("parallel_record");
+        const auto& inheritance = primary.inheritance();
+        assert(inheritance.secondary_contents && "The render pass must be begun with secondary contents!");
+
+        uint32_t range_count = std::min(self->thread_count, count);
+        if(range_count == 0) return primary;
+
+        auto record = [&](uint32_t thread, uint32_t begin, uint32_t end){
+            auto cmd = acquire_secondary(thread);
+            cmd.begin_secondary(inheritance);
+            f(context, cmd, begin, end);
+            cmd.end();
+            self->recorded[thread] = cmd;
+        };
+        parallel_for(count, record);
+        return primary.execute_commands(std::span(self->recorded.data(), range_count));
+    }
+
+    void ParallelRecorder::for_each_range(uint32_t count, RangeCallback f, void* context) {
+        uint32_t range_count = std::min(self->thread_count, count);
+        if(range_count == 0) return;
+
+        struct RangeTask {
+            RangeCallback f;
+            void* context;
+            uint32_t count;
+            uint32_t range_count;
+        } range_task = {f, context, count, range_count};
+
+        reset_frame_pools();
+        run(range_count, [](void* task_context, uint32_t range){
+            auto& task = *static_cast<RangeTask*>(task_context);
+            auto begin = static_cast<uint32_t>(static_cast<uint64_t>(task.count) * range / task.range_count);
+            auto end = static_cast<uint32_t>(static_cast<uint64_t>(task.count) * (range + 1) / task.range_count);
+            task.f(task.context, range, begin, end);
+        }, &range_task);
+    }
+
+    CommandBuffer ParallelRecorder::acquire_secondary(uint32_t thread) {
+        assert(thread < self->thread_count && "Invalid recording thread!");
+        auto& slot = self->pools[self->renderer.current_frame()][thread];
+        if(slot.used == slot.secondaries.size()){
+            slot.secondaries.emplace_back(self->renderer, slot.pool, self->queue_family, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        }
+        return slot.secondaries[slot.used++];
+    }
+
+    void ParallelRecorder::reset_frame_pools() {
+        // The frame slot was waited on by acquire_next_swapchain_image(), its last secondaries have finished executing
+        auto frame = self->renderer.current_frame();
+        if(self->reset_frame[frame] == self->renderer.frame_count()) return;
+
+        auto device = self->renderer.inner()->device;
+        for(auto& thread : self->pools[frame]){
+            if(thread.used == 0) continue;
+            vkResetCommandPool(device, thread.pool, 0);
+            thread.used = 0;
+        }
+        self->reset_frame[frame] = self->renderer.frame_count();
+    }
+
+    void ParallelRecorder::run(uint32_t count, TaskCallback task, void* context) {
+        {
+            std::lock_guard lock(self->mutex);
+            self->task = task;
+            self->task_context = context;
+            self->task_count = count;
+            self->next_task = 0;
+            self->finished_tasks = 0;
+            self->generation++;
+        }
+        self->work_cv.notify_all();
+
+        self->run_tasks();
+
+        std::unique_lock lock(self->mutex);
+        self->done_cv.wait(lock, [&](){ return self->finished_tasks == self->task_count && self->active_workers == 0; });
+        self->task = nullptr;
+        self->task_context = nullptr;
+    }
+
+    void ParallelRecorder::Inner::worker() {
+        uint64_t seen = 0;
+        std::unique_lock lock(mutex);
+        while(true){
+            work_cv.wait(lock, [&](){ return stop || generation != seen; });
+            if(stop) return;
+            seen = generation;
+
+            active_workers++;
+            lock.unlock();
+            run_tasks();
+            lock.lock();
+            active_workers--;
+            done_cv.notify_all();
+        }
+    }
+
+    void ParallelRecorder::Inner::run_tasks() {
+        // Ranges map to thread slots, not OS threads, so whichever thread picks up a range has its pool to itself
+        uint32_t i = 0;
+        while((i = next_task.fetch_add(1)) < task_count){
+            task(task_context, i);
+
+            std::lock_guard lock(mutex);
+            finished_tasks++;
+        }
+    }
+}
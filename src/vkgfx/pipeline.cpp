@@ -52,6 +52,8 @@ namespace g_app {
         self->stage_info.stage = config.stage;
         self->stage_info.pName = self->entry.c_str();
         self->stage_info.pSpecializationInfo = nullptr;
+
+        if(renderer.has_command_capture()) self->src = config.src;
     }
 
     Pipeline::Pipeline(VulkanRenderer renderer, const Pipeline::GraphicsConfig &config): self{std::make_shared<Inner>(renderer)} {
@@ -216,6 +218,21 @@ namespace g_app {
         create_info.basePipelineHandle = VK_NULL_HANDLE;
         create_info.subpass = config.subpass;
 
+        VkPipelineRenderingCreateInfo rendering_info = {VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO};
+        if(config.dynamic_rendering){
+            if(!renderer.has_dynamic_rendering()){
+                throw std::runtime_error(
+                        std::format("Pipeline {} uses dynamic rendering, which wasn't enabled on the renderer!", self->label));
+            }
+            rendering_info.colorAttachmentCount = static_cast<uint32_t>(config.color_formats.size());
+            rendering_info.pColorAttachmentFormats = config.color_formats.data();
+            rendering_info.depthAttachmentFormat = config.depth_format;
+            rendering_info.stencilAttachmentFormat = config.stencil_format;
+            create_info.pNext = &rendering_info;
+            create_info.renderPass = VK_NULL_HANDLE;
+            create_info.subpass = 0;
+        }
+
         if((result =
             vkCreateGraphicsPipelines(inner->device, config.pipeline_cache, 1, &create_info, nullptr, &self->pipeline))
             != VK_SUCCESS){
@@ -223,6 +240,11 @@ namespace g_app {
                     std::format("Failed to create a graphics pipeline! label = {}, result = {}", self->label, static_cast<uint32_t>(result) )
             );
         }
+
+        if(renderer.has_command_capture()){
+            self->graphics_config = std::make_shared<const GraphicsConfig>(config);
+            self->default_render_pass = !config.dynamic_rendering && config.render_pass == renderer.default_render_pass();
+        }
     }
 
     Pipeline::Pipeline(VulkanRenderer renderer, const Pipeline::ComputeConfig &config): self{std::make_shared<Inner>(renderer)} {
@@ -252,5 +274,7 @@ namespace g_app {
                     std::format("Failed to create a compute pipeline! label = {}, result = {}", self->label, static_cast<uint32_t>(result) )
             );
         }
+
+        if(renderer.has_command_capture()) self->compute_config = std::make_shared<const ComputeConfig>(config);
     }
 } // g_app
\ No newline at end of file
@@ -0,0 +1,181 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "../include/vkgfx/profiler.hpp"
+
+#include <stdexcept>
+#include <format>
+
+namespace g_app {
+    GpuProfiler::GpuProfiler(VulkanRenderer renderer, const Config& config): self{std::make_shared<Inner>(renderer)} {
+        self->label = config.label;
+        self->max_zones = config.max_zones;
+
+        auto inner = renderer.inner();
+        self->period_ns = renderer.physical_device_properties().limits.timestampPeriod;
+
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(inner->physical_device, &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(inner->physical_device, &family_count, families.data());
+
+        uint32_t valid_bits = families[inner->queue_family_info.index].timestampValidBits;
+        if(valid_bits == 0){
+            spdlog::warn("Timestamps aren't supported on the graphics queue, the GpuProfiler won't record anything. label = {}", self->label);
+            self->supported = false;
+            return;
+        }
+        self->valid_mask = (valid_bits >= 64) ? ~0ull : ((1ull << valid_bits) - 1);
+
+        VkQueryPoolCreateInfo create_info = {VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        create_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        create_info.queryCount = self->max_zones * 2;
+
+        self->slots.resize(renderer.frames_in_flight());
+        for(auto& slot : self->slots){
+            VkResult result = VK_SUCCESS;
+            if((result = vkCreateQueryPool(inner->device, &create_info, nullptr, &slot.pool)) != VK_SUCCESS){
+                throw std::runtime_error(
+                    std::format("Failed to create a timestamp query pool! label = {}, result = {}", self->label, static_cast<uint32_t>(result))
+                );
+            }
+            slot.zones.reserve(self->max_zones);
+        }
+    }
+
+    void GpuProfiler::begin_frame(VkCommandBuffer cmd) {
+        if(!self->supported) return;
+
+        self->current_slot = self->renderer.current_frame();
+        auto& slot = self->slots[self->current_slot];
+        if(slot.recorded) resolve(slot);
+
+        vkCmdResetQueryPool(cmd, slot.pool, 0, self->max_zones * 2);
+        slot.zones.clear();
+        slot.stack.clear();
+        slot.frame = self->renderer.frame_count();
+        slot.dropped = 0;
+        slot.recorded = true;
+    }
+
+    void GpuProfiler::begin_zone(VkCommandBuffer cmd, const std::string& name) {
+        if(!self->supported) return;
+
+        auto& slot = self->slots[self->current_slot];
+        assert(slot.recorded && "GpuProfiler::begin_frame() hasn't been called!");
+
+        if(slot.zones.size() >= self->max_zones){
+            slot.dropped++;
+            slot.stack.push_back(-1); // Keeps end_zone() balanced
+            return;
+        }
+
+        auto index = static_cast<int32_t>(slot.zones.size());
+        int32_t parent = -1;
+        for(auto it = slot.stack.rbegin(); it != slot.stack.rend(); it++){
+            if(*it >= 0) { parent = *it; break; }
+        }
+        slot.zones.push_back({name, static_cast<uint32_t>(slot.stack.size()), parent});
+        slot.stack.push_back(index);
+
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.pool, index * 2);
+    }
+
+    void GpuProfiler::end_zone(VkCommandBuffer cmd) {
+        if(!self->supported) return;
+
+        auto& slot = self->slots[self->current_slot];
+        assert(!slot.stack.empty() && "end_zone() called without a matching begin_zone()!");
+
+        int32_t index = slot.stack.back();
+        slot.stack.pop_back();
+        if(index < 0) return;
+
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, slot.pool, index * 2 + 1);
+    }
+
+    void GpuProfiler::resolve(Slot& slot) {
+        slot.recorded = false;
+        if(slot.zones.empty() || !slot.stack.empty()) return; // Nothing recorded, or zones were left open
+
+        // Pairs of (timestamp, availability)
+        std::vector<uint64_t> results(slot.zones.size() * 4);
+        VkResult result = vkGetQueryPoolResults(
+                self->renderer.inner()->device, slot.pool, 0, static_cast<uint32_t>(slot.zones.size() * 2),
+                results.size() * sizeof(uint64_t), results.data(), 2 * sizeof(uint64_t),
+                VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if(result != VK_SUCCESS && result != VK_NOT_READY) return;
+
+        auto to_ms = [&](uint64_t ticks){ return static_cast<double>(ticks & self->valid_mask) * self->period_ns / 1e6; };
+
+        auto& resolved = self->resolved;
+        resolved.frame = slot.frame;
+        resolved.dropped_zones = slot.dropped;
+        resolved.zones.clear();
+        resolved.zones.reserve(slot.zones.size());
+
+        uint64_t frame_begin = results[0] & self->valid_mask;
+        for(size_t i = 0; i < slot.zones.size(); i++){
+            uint64_t begin = results[i * 4], begin_available = results[i * 4 + 1];
+            uint64_t end = results[i * 4 + 2], end_available = results[i * 4 + 3];
+
+            GpuZoneTiming timing = {};
+            timing.name = slot.zones[i].name;
+            timing.depth = slot.zones[i].depth;
+            timing.parent = slot.zones[i].parent;
+            if(begin_available && end_available){
+                timing.begin_ms = to_ms((begin & self->valid_mask) - frame_begin);
+                timing.duration_ms = to_ms((end & self->valid_mask) - (begin & self->valid_mask));
+            }
+            resolved.zones.push_back(std::move(timing));
+        }
+    }
+
+    void GpuProfiler::draw_imgui(const char* title) const {
+        ImGui::Begin(title);
+        if(!self->supported){
+            ImGui::TextUnformatted("Timestamps aren't supported on this device.");
+            ImGui::End();
+            return;
+        }
+
+        const auto& frame = self->resolved;
+        ImGui::Text("Frame %llu", static_cast<unsigned long long>(frame.frame));
+        if(frame.dropped_zones > 0) ImGui::Text("%u zones dropped, increase max_zones", frame.dropped_zones);
+        ImGui::Separator();
+
+        for(const auto& zone : frame.zones){
+            ImGui::Indent(static_cast<float>(zone.depth) * 12.0f + 1.0f);
+            ImGui::Text("%-24s %8.3f ms", zone.name.c_str(), zone.duration_ms);
+            ImGui::Unindent(static_cast<float>(zone.depth) * 12.0f + 1.0f);
+        }
+        ImGui::End();
+    }
+}
@@ -0,0 +1,468 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+#include "../include/vkgfx/render_graph.hpp"
+
+#include <algorithm>
+#include <queue>
+#include <format>
+
+namespace g_app {
+    RenderGraphPassBuilder& RenderGraphPassBuilder::read(RenderGraphImage image, ResourceUsage usage) {
+        assert(image.index < m_graph.self->images.size() && "Invalid render graph image!");
+        m_graph.self->passes[m_pass].accesses.push_back({image.index, true, usage, false});
+        return *this;
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::write(RenderGraphImage image, ResourceUsage usage,
+                                                          std::optional<VkImageLayout> layout_after) {
+        assert(image.index < m_graph.self->images.size() && "Invalid render graph image!");
+        m_graph.self->passes[m_pass].accesses.push_back({image.index, true, usage, true, layout_after});
+        return *this;
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::read(RenderGraphBuffer buffer, ResourceUsage usage) {
+        assert(buffer.index < m_graph.self->buffers.size() && "Invalid render graph buffer!");
+        m_graph.self->passes[m_pass].accesses.push_back({buffer.index, false, usage, false});
+        return *this;
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::write(RenderGraphBuffer buffer, ResourceUsage usage) {
+        assert(buffer.index < m_graph.self->buffers.size() && "Invalid render graph buffer!");
+        m_graph.self->passes[m_pass].accesses.push_back({buffer.index, false, usage, true});
+        return *this;
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::add_color_attachment(RenderGraphImage image, VkAttachmentLoadOp load_op,
+                                                                         VkAttachmentStoreOp store_op, VkClearColorValue clear_value) {
+        assert(m_graph.self->renderer.has_dynamic_rendering() && "Render graph attachments require dynamic rendering!");
+        VkClearValue clear = {};
+        clear.color = clear_value;
+        m_graph.self->passes[m_pass].color_attachments.push_back({image.index, load_op, store_op, clear});
+        return write(image, ResourceUsage::COLOR_ATTACHMENT);
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::set_depth_attachment(RenderGraphImage image, VkAttachmentLoadOp load_op,
+                                                                         VkAttachmentStoreOp store_op, VkClearDepthStencilValue clear_value) {
+        assert(m_graph.self->renderer.has_dynamic_rendering() && "Render graph attachments require dynamic rendering!");
+        VkClearValue clear = {};
+        clear.depthStencil = clear_value;
+        m_graph.self->passes[m_pass].depth_attachment = Attachment{image.index, load_op, store_op, clear};
+        return write(image, ResourceUsage::DEPTH_STENCIL_ATTACHMENT);
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::set_rendering_flags(VkRenderingFlags flags) {
+        m_graph.self->passes[m_pass].rendering_flags = flags;
+        return *this;
+    }
+
+    RenderGraphPassBuilder& RenderGraphPassBuilder::set_side_effects() {
+        m_graph.self->passes[m_pass].side_effects = true;
+        return *this;
+    }
+
+    RenderGraphImage RenderGraph::create_image(const std::string& name, const RenderGraphImageDesc& desc) {
+        ImageResource resource = {};
+        resource.name = name;
+        resource.desc = desc;
+        self->images.push_back(std::move(resource));
+        self->compiled = false;
+        return {static_cast<uint32_t>(self->images.size() - 1)};
+    }
+
+    RenderGraphImage RenderGraph::import_image(const std::string& name, const Image& image, std::optional<ResourceUsage> final_usage,
+                                               const ImageView& view) {
+        ImageResource resource = {};
+        resource.name = name;
+        resource.imported = true;
+        resource.final_usage = final_usage;
+        resource.image = image;
+        resource.view = view;
+        self->images.push_back(std::move(resource));
+        self->compiled = false;
+        return {static_cast<uint32_t>(self->images.size() - 1)};
+    }
+
+    void RenderGraph::set_imported_image(RenderGraphImage handle, const Image& image, const ImageView& view) {
+        assert(self->images[handle.index].imported && "Only imported images can be swapped!");
+        self->images[handle.index].image = image;
+        self->images[handle.index].view = view;
+        self->rendering_dirty = true;
+    }
+
+    void RenderGraph::set_image_desc(RenderGraphImage handle, const RenderGraphImageDesc& desc) {
+        assert(!self->images[handle.index].imported && "Imported images have no description!");
+        self->images[handle.index].desc = desc;
+        self->compiled = false;
+    }
+
+    RenderGraphPassBuilder RenderGraph::add_pass(const std::string& name, std::function<void(CommandBuffer&)>&& execute) {
+        self->passes.push_back({name, std::move(execute)});
+        self->compiled = false;
+        return {*this, static_cast<uint32_t>(self->passes.size() - 1)};
+    }
+
+    const Image& RenderGraph::image(RenderGraphImage handle) const {
+        return self->images[handle.index].image;
+    }
+
+    const ImageView& RenderGraph::view(RenderGraphImage handle) const {
+        return self->images[handle.index].view;
+    }
+
+    std::vector<std::string> RenderGraph::execution_order() const {
+        std::vector<std::string> names = {};
+        names.reserve(self->order.size());
+        for(auto pass : self->order) names.push_back(self->passes[pass].name);
+        return names;
+    }
+
+    void RenderGraph::compile() {
+        G_APP_TRACE_SCOPE("render_graph_compile");
+        sort_and_cull();
+        allocate_transients();
+        build_rendering_infos();
+        self->compiled = true;
+    }
+
+    void RenderGraph::sort_and_cull() {
+        auto& passes = self->passes;
+        auto pass_count = static_cast<uint32_t>(passes.size());
+
+        // Every hazard is an edge, producers only covers read/write after write, which is what keeps a pass alive
+        std::vector<std::vector<uint32_t>> successors(pass_count);
+        std::vector<std::vector<uint32_t>> producers(pass_count);
+        std::vector<uint32_t> in_degree(pass_count, 0);
+
+        struct LastAccess {
+            uint32_t writer = UINT32_MAX;
+            std::vector<uint32_t> readers = {};
+        };
+        std::vector<LastAccess> image_access(self->images.size());
+        std::vector<LastAccess> buffer_access(self->buffers.size());
+
+        auto add_edge = [&](uint32_t from, uint32_t to){
+            if(from == to) return;
+            if(std::find(successors[from].begin(), successors[from].end(), to) != successors[from].end()) return;
+            successors[from].push_back(to);
+            in_degree[to]++;
+        };
+
+        for(uint32_t p = 0; p < pass_count; p++){
+            for(const auto& access : passes[p].accesses){
+                auto& last = (access.image) ? image_access[access.resource] : buffer_access[access.resource];
+                if(last.writer != UINT32_MAX){
+                    add_edge(last.writer, p);
+                    if(last.writer != p) producers[p].push_back(last.writer);
+                }
+                if(access.write){
+                    for(auto reader : last.readers) add_edge(reader, p);
+                }
+            }
+            for(const auto& access : passes[p].accesses){
+                auto& last = (access.image) ? image_access[access.resource] : buffer_access[access.resource];
+                if(access.write){
+                    last.writer = p;
+                    last.readers.clear();
+                } else {
+                    last.readers.push_back(p);
+                }
+            }
+        }
+
+        // Anything that ends up outside of the graph keeps its producers alive
+        std::vector<bool> needed(pass_count, false);
+        std::vector<uint32_t> stack = {};
+        for(uint32_t p = 0; p < pass_count; p++){
+            bool external = passes[p].side_effects;
+            for(const auto& access : passes[p].accesses){
+                if(access.write && (!access.image || self->images[access.resource].imported)) external = true;
+            }
+            if(external){
+                needed[p] = true;
+                stack.push_back(p);
+            }
+        }
+        while(!stack.empty()){
+            auto p = stack.back();
+            stack.pop_back();
+            for(auto producer : producers[p]){
+                if(needed[producer]) continue;
+                needed[producer] = true;
+                stack.push_back(producer);
+            }
+        }
+
+        // Kahn's algorithm, ties go to the pass that was added first so the order stays predictable
+        std::priority_queue<uint32_t, std::vector<uint32_t>, std::greater<>> ready = {};
+        for(uint32_t p = 0; p < pass_count; p++){
+            if(in_degree[p] == 0) ready.push(p);
+        }
+
+        self->order.clear();
+        while(!ready.empty()){
+            auto p = ready.top();
+            ready.pop();
+            if(needed[p]) self->order.push_back(p);
+            for(auto next : successors[p]){
+                if(--in_degree[next] == 0) ready.push(next);
+            }
+        }
+
+        self->stats.pass_count = static_cast<uint32_t>(self->order.size());
+        self->stats.culled_pass_count = pass_count - self->stats.pass_count;
+    }
+
+    void RenderGraph::allocate_transients() {
+        auto& images = self->images;
+        auto device = self->renderer.inner()->device;
+        auto allocator = self->renderer.inner()->allocator;
+
+        for(auto& resource : images){
+            if(resource.imported) continue;
+            resource.view = {};
+            resource.image = {};
+        }
+        self->free_memory_blocks();
+
+        for(auto& resource : images){
+            resource.first_use = UINT32_MAX;
+            resource.last_use = 0;
+            resource.memory_block = UINT32_MAX;
+            resource.alias_previous = UINT32_MAX;
+        }
+        for(uint32_t position = 0; position < self->order.size(); position++){
+            for(const auto& access : self->passes[self->order[position]].accesses){
+                if(!access.image) continue;
+                auto& resource = images[access.resource];
+                resource.first_use = std::min(resource.first_use, position);
+                resource.last_use = std::max(resource.last_use, position);
+            }
+        }
+
+        auto create_info_for = [](const RenderGraphImageDesc& desc){
+            VkImageCreateInfo create_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            create_info.imageType = VK_IMAGE_TYPE_2D;
+            create_info.extent = {desc.extent.width, desc.extent.height, 1};
+            create_info.mipLevels = desc.mip_levels;
+            create_info.arrayLayers = desc.array_layers;
+            create_info.format = desc.format;
+            create_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            create_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            create_info.usage = desc.usage;
+            create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            create_info.samples = desc.samples;
+            return create_info;
+        };
+
+        // Memory requirements come from a throwaway image, the real ones are created once their memory is known
+        std::vector<uint32_t> transients = {};
+        std::vector<VkMemoryRequirements> requirements(images.size());
+        self->stats.transient_bytes = 0;
+        for(uint32_t i = 0; i < images.size(); i++){
+            if(images[i].imported || images[i].first_use == UINT32_MAX) continue;
+
+            auto create_info = create_info_for(images[i].desc);
+            VkImage probe = VK_NULL_HANDLE;
+            VkResult result = VK_SUCCESS;
+            if((result = vkCreateImage(device, &create_info, nullptr, &probe)) != VK_SUCCESS){
+                spdlog::error("Failed to create a render graph image! graph = {}, image = {}, result = {}",
+                              self->label, images[i].name, static_cast<uint32_t>(result));
+                std::exit(EXIT_FAILURE);
+            }
+            vkGetImageMemoryRequirements(device, probe, &requirements[i]);
+            vkDestroyImage(device, probe, nullptr);
+
+            transients.push_back(i);
+            self->stats.transient_bytes += requirements[i].size;
+        }
+
+        // Largest first, each image goes into the first block whose occupants are all dead or not yet alive
+        std::stable_sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b){
+            return requirements[a].size > requirements[b].size;
+        });
+
+        struct Block {
+            VkMemoryRequirements requirements = {};
+            std::vector<uint32_t> occupants = {};
+        };
+        std::vector<Block> blocks = {};
+
+        for(auto i : transients){
+            const auto& req = requirements[i];
+            uint32_t chosen = UINT32_MAX;
+            for(uint32_t b = 0; b < blocks.size() && chosen == UINT32_MAX; b++){
+                auto& block = blocks[b];
+                if(req.size > block.requirements.size || req.alignment > block.requirements.alignment) continue;
+                if((req.memoryTypeBits & block.requirements.memoryTypeBits) == 0) continue;
+
+                bool overlaps = std::any_of(block.occupants.begin(), block.occupants.end(), [&](uint32_t o){
+                    return images[i].first_use <= images[o].last_use && images[o].first_use <= images[i].last_use;
+                });
+                if(!overlaps) chosen = b;
+            }
+
+            if(chosen == UINT32_MAX){
+                blocks.push_back({req, {}});
+                chosen = static_cast<uint32_t>(blocks.size() - 1);
+            }
+            blocks[chosen].requirements.memoryTypeBits &= req.memoryTypeBits;
+            blocks[chosen].occupants.push_back(i);
+            images[i].memory_block = chosen;
+        }
+
+        self->stats.allocated_bytes = 0;
+        for(auto& block : blocks){
+            VmaAllocationCreateInfo alloc_info = {};
+            alloc_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+            VmaAllocation allocation = VK_NULL_HANDLE;
+            VkResult result = VK_SUCCESS;
+            if((result = vmaAllocateMemory(allocator, &block.requirements, &alloc_info, &allocation, nullptr)) != VK_SUCCESS){
+                spdlog::error("Failed to allocate render graph memory! graph = {}, size = {}, result = {}",
+                              self->label, block.requirements.size, static_cast<uint32_t>(result));
+                std::exit(EXIT_FAILURE);
+            }
+            self->memory_blocks.push_back(allocation);
+            self->stats.allocated_bytes += block.requirements.size;
+
+            // Occupants in the order they come alive, the first one follows the last one of the previous frame
+            std::sort(block.occupants.begin(), block.occupants.end(), [&](uint32_t a, uint32_t b){
+                return images[a].first_use < images[b].first_use;
+            });
+            for(size_t k = 0; k < block.occupants.size() && block.occupants.size() > 1; k++){
+                images[block.occupants[k]].alias_previous = block.occupants[(k + block.occupants.size() - 1) % block.occupants.size()];
+            }
+
+            for(auto i : block.occupants){
+                auto& resource = images[i];
+                const auto& desc = resource.desc;
+                resource.image = ImageInit()
+                        .set_label(std::format("{} -> {}", self->label, resource.name))
+                        .set_extent(desc.extent.width, desc.extent.height)
+                        .set_format(desc.format)
+                        .set_usage(desc.usage)
+                        .set_mip_levels(desc.mip_levels)
+                        .set_array_layers(desc.array_layers)
+                        .set_samples(desc.samples)
+                        .set_aliased_allocation(allocation)
+                        .init(self->renderer);
+                resource.view = ImageViewInit()
+                        .set_label(std::format("{} -> {} view", self->label, resource.name))
+                        .set_image(resource.image)
+                        .set_type((desc.array_layers > 1) ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D)
+                        .set_aspect_mask(resource.image.aspect_mask())
+                        .init(self->renderer);
+            }
+        }
+        self->stats.transient_image_count = static_cast<uint32_t>(transients.size());
+    }
+
+    void RenderGraph::build_rendering_infos() {
+        auto extent_of = [&](uint32_t image){
+            const auto& resource = self->images[image];
+            if(!resource.imported) return resource.desc.extent;
+            auto extent = resource.image.extent();
+            return VkExtent2D{extent.width, extent.height};
+        };
+
+        for(auto p : self->order){
+            auto& pass = self->passes[p];
+            pass.rendering.reset();
+            if(pass.color_attachments.empty() && !pass.depth_attachment) continue;
+
+            auto builder = RenderingInfoBuilder();
+            builder.set_flags(pass.rendering_flags);
+            for(const auto& attachment : pass.color_attachments){
+                const auto& view = self->images[attachment.image].view;
+                assert(view.vk_image_view() != VK_NULL_HANDLE && "Imported attachments need a view!");
+                builder.add_color_attachment(view, attachment.load_op, attachment.store_op, attachment.clear_value.color);
+            }
+            if(pass.depth_attachment){
+                const auto& attachment = *pass.depth_attachment;
+                const auto& view = self->images[attachment.image].view;
+                assert(view.vk_image_view() != VK_NULL_HANDLE && "Imported attachments need a view!");
+                builder.set_depth_attachment(view, attachment.load_op, attachment.store_op, attachment.clear_value.depthStencil);
+            }
+            auto extent = extent_of((!pass.color_attachments.empty()) ? pass.color_attachments[0].image : pass.depth_attachment->image);
+            builder.set_render_area(extent.width, extent.height);
+            pass.rendering = builder.build();
+        }
+        self->rendering_dirty = false;
+    }
+
+    void RenderGraph::execute(CommandBuffer& cmd) {
+        G_APP_TRACE_SCOPE("render_graph_execute");
+        if(!self->compiled) compile();
+        if(self->rendering_dirty) build_rendering_infos();
+
+        auto& images = self->images;
+        for(uint32_t position = 0; position < self->order.size(); position++){
+            auto& pass = self->passes[self->order[position]];
+
+            for(const auto& access : pass.accesses){
+                if(!access.image){
+                    self->buffers[access.resource].require(cmd, access.usage);
+                    continue;
+                }
+
+                auto& resource = images[access.resource];
+                bool first_use = !resource.imported && resource.first_use == position;
+                if(first_use && resource.alias_previous != UINT32_MAX){
+                    // The memory was last used by another image, wait for everything it did before reusing it
+                    // Both only live in this graph, so the barrier can be recorded here rather than at submit
+                    const auto& previous = cmd.resource_state(images[resource.alias_previous].image);
+                    auto& state = cmd.resource_state(resource.image);
+                    state.write_stages |= previous.write_stages | previous.read_stages;
+                    state.write_access |= previous.write_access;
+                }
+                // Transients are rewritten every frame, so their old contents are discarded
+                cmd.require(resource.image, access.usage, first_use);
+            }
+
+            cmd.begin_zone(pass.name);
+            if(pass.rendering) cmd.begin_rendering(*pass.rendering);
+            pass.execute(cmd);
+            if(pass.rendering) cmd.end_rendering();
+            cmd.end_zone();
+
+            for(const auto& access : pass.accesses){
+                if(access.image && access.layout_after) cmd.resource_state(images[access.resource].image).layout = *access.layout_after;
+            }
+        }
+
+        for(auto& resource : images){
+            if(resource.imported && resource.final_usage) cmd.require(resource.image, *resource.final_usage);
+        }
+        for(auto& resource : self->buffers){
+            if(resource.final_usage) resource.require(cmd, *resource.final_usage);
+        }
+        cmd.flush_barriers();
+    }
+}
@@ -35,18 +35,27 @@
 #include <cstring>
 #include <limits>
 #include <algorithm>
+#include <bit>
+#include <map>
 
 namespace g_app {
     VulkanRenderer::VulkanRenderer(GLFWwindow* window, const Config& config): self{std::make_shared<Inner>()} {
         self->window = window;
+        self->headless = config.headless;
+        self->upload_staging_size = config.upload_staging_size;
+        self->command_capture = config.command_capture;
+        self->frame_rate_limit = config.frame_rate_limit;
+        self->pacer.set_target_fps(config.frame_rate_limit);
+        self->frames_in_flight = config.frames_in_flight;
         init_instance(config);
-        init_surface();
+        if(!self->headless) init_surface();
         pick_physical_device(config);
         init_device(config);
         load_extensions(config);
         init_allocator(config);
-        init_command_pool();
-        init_swapchain(VK_NULL_HANDLE);
+        init_command_pools();
+        if(self->headless) init_headless_swapchain(config);
+        else               init_swapchain(VK_NULL_HANDLE);
         init_default_render_pass();
         init_framebuffers();
         init_sync_objects();
@@ -104,10 +113,12 @@ namespace g_app {
         } else throw std::runtime_error("Enabled validation layers not supported, continuing without validation.");
 
         uint32_t req_instance_extension_count = 0;
-        const char** req_exts = glfwGetRequiredInstanceExtensions(&req_instance_extension_count);
+        const char** req_exts = nullptr;
+        // Headless renderers don't need any surface extensions, GLFW may not even be initialised
+        if(!config.headless) req_exts = glfwGetRequiredInstanceExtensions(&req_instance_extension_count);
 
         std::vector<const char*> extensions(req_instance_extension_count);
-        memcpy(extensions.data(), req_exts, req_instance_extension_count*sizeof(const char*));
+        if(req_exts) memcpy(extensions.data(), req_exts, req_instance_extension_count*sizeof(const char*));
 
         if(is_instance_extensions_supported(extensions)){
             info.enabledExtensionCount = req_instance_extension_count;
@@ -162,14 +173,16 @@ namespace g_app {
                 queue_family.queueFlags & VK_QUEUE_COMPUTE_BIT &&
                 queue_family.queueCount > highest_queue_count
             ){
-                VkBool32 present_support = VK_FALSE;
-                vkGetPhysicalDeviceSurfaceSupportKHR(device, family_index, surface, &present_support);
-                if(!present_support) continue;
-
-                chosen_family = family_index;
-                queue_count = queue_family.queueCount;
-                highest_queue_count = queue_family.queueCount;
-                family_found = true;
+                // Without a surface (headless) there is nothing to present to
+                VkBool32 present_support = VK_TRUE;
+                if(surface != VK_NULL_HANDLE) vkGetPhysicalDeviceSurfaceSupportKHR(device, family_index, surface, &present_support);
+
+                if(present_support){
+                    chosen_family = family_index;
+                    queue_count = queue_family.queueCount;
+                    highest_queue_count = queue_family.queueCount;
+                    family_found = true;
+                }
             }
             family_index++;
         }
@@ -180,6 +193,29 @@ namespace g_app {
         return std::make_optional<QueueFamilyInfo>(chosen_family, queue_count);
     }
 
+    /* A family supporting 'required' but none of 'excluded', preferring the one with the fewest other capabilities. */
+    std::optional<uint32_t> find_dedicated_queue_family(VkPhysicalDevice device, VkQueueFlags required, VkQueueFlags excluded){
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, nullptr);
+
+        std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families.data());
+
+        std::optional<uint32_t> chosen_family = {};
+        uint32_t fewest_flags = UINT32_MAX;
+        for(uint32_t i = 0; i < queue_family_count; i++){
+            auto flags = queue_families[i].queueFlags;
+            if((flags & required) != required || (flags & excluded) || queue_families[i].queueCount == 0) continue;
+
+            auto flag_count = static_cast<uint32_t>(std::popcount(flags));
+            if(flag_count < fewest_flags){
+                chosen_family = i;
+                fewest_flags = flag_count;
+            }
+        }
+        return chosen_family;
+    }
+
     bool is_device_extensions_supported(VkPhysicalDevice device, const std::vector<const char*>& extensions){
         uint32_t extension_count = 0;
         vkEnumerateDeviceExtensionProperties(device, nullptr, &extension_count, nullptr);
@@ -229,7 +265,8 @@ namespace g_app {
     bool is_physical_device_suitable(VkPhysicalDevice device, VkSurfaceKHR surface, const VkPhysicalDeviceFeatures& enabled_features,
                                      const std::vector<const char*>& extensions){
         return find_queue_family(device, surface).has_value() && is_physical_device_features_supported(device, enabled_features) &&
-               is_device_extensions_supported(device, extensions) && is_swapchain_adequate(device, surface);
+               is_device_extensions_supported(device, extensions) &&
+               (surface == VK_NULL_HANDLE || is_swapchain_adequate(device, surface));
     }
 
     uint32_t score_physical_device(VkPhysicalDevice device, VkSurfaceKHR surface, const VkPhysicalDeviceFeatures& enabled_features,
@@ -260,7 +297,8 @@ namespace g_app {
     }
 
     void VulkanRenderer::pick_physical_device(const VulkanRenderer::Config &config) {
-        std::vector<const char*> device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        std::vector<const char*> device_extensions = {};
+        if(!config.headless) device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
         for(auto& ext : config.enabled_device_extensions){
             device_extensions.push_back(ext);
         }
@@ -292,40 +330,203 @@ namespace g_app {
 
     void VulkanRenderer::init_device(const VulkanRenderer::Config &config) {
         auto queue_family = find_queue_family(self->physical_device, self->surface);
-        auto queue_count = (queue_family->count > MAX_QUEUE_COUNT) ? MAX_QUEUE_COUNT : queue_family->count;
+
+        // Family of each Queue, TRANSFER = 0, COMPUTE = 1, GRAPHICS = 2
+        std::vector<uint32_t> families(MAX_QUEUE_COUNT, queue_family->index);
+        if(config.dedicated_queues){
+            auto compute_family = find_dedicated_queue_family(self->physical_device, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+            // Compute families always support transfers, so fall back to one before the graphics family
+            auto transfer_family = find_dedicated_queue_family(self->physical_device, VK_QUEUE_TRANSFER_BIT,
+                                                               VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+            if(!transfer_family) transfer_family = compute_family;
+
+            if(compute_family)  families[static_cast<size_t>(Queue::COMPUTE)] = *compute_family;
+            if(transfer_family) families[static_cast<size_t>(Queue::TRANSFER)] = *transfer_family;
+        }
+
+        uint32_t family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(self->physical_device, &family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> family_properties(family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(self->physical_device, &family_count, family_properties.data());
+
+        // Hand out queue indices within each family, GRAPHICS first so it always gets the highest priority queue.
+        // Once a family runs out of queues the remaining Queue values share its last queue.
+        const Queue creation_order[] = {Queue::GRAPHICS, Queue::COMPUTE, Queue::TRANSFER};
+        std::vector<uint32_t> queue_indices(MAX_QUEUE_COUNT, 0);
+        std::map<uint32_t, uint32_t> queue_counts = {};
+        for(auto queue : creation_order){
+            auto family = families[static_cast<size_t>(queue)];
+            auto& count = queue_counts[family];
+            queue_indices[static_cast<size_t>(queue)] = std::min(count, family_properties[family].queueCount - 1);
+            count = std::min(count + 1, family_properties[family].queueCount);
+        }
 
         float priorities[] = {1.0f, 0.9f, 0.8f};
 
-        VkDeviceQueueCreateInfo queue_create_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
-        queue_create_info.queueFamilyIndex = queue_family->index;
-        queue_create_info.queueCount = queue_count;
-        queue_create_info.pQueuePriorities = priorities;
+        std::vector<VkDeviceQueueCreateInfo> queue_create_infos = {};
+        for(auto [family, count] : queue_counts){
+            VkDeviceQueueCreateInfo queue_create_info = {VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO};
+            queue_create_info.queueFamilyIndex = family;
+            queue_create_info.queueCount = count;
+            queue_create_info.pQueuePriorities = priorities;
+            queue_create_infos.push_back(queue_create_info);
+        }
 
         auto device_features = this->physical_device_features();
 
-        std::vector<const char*> device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        std::vector<const char*> device_extensions = {};
+        if(!config.headless) device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
         device_extensions.insert(device_extensions.end(), config.enabled_device_extensions.begin(), config.enabled_device_extensions.end());
 
         VkDeviceCreateInfo create_info = {VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO};
-        create_info.pQueueCreateInfos = &queue_create_info;
-        create_info.queueCreateInfoCount = 1;
+        create_info.pQueueCreateInfos = queue_create_infos.data();
+        create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
         create_info.pEnabledFeatures = &device_features;
         create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
         create_info.ppEnabledExtensionNames = device_extensions.data();
         create_info.enabledLayerCount = static_cast<uint32_t>(config.enabled_layers.size());
         create_info.ppEnabledLayerNames = config.enabled_layers.data();
 
+        VkPhysicalDeviceTimelineSemaphoreFeatures timeline_features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES};
+        if(config.timeline_semaphores){
+            VkPhysicalDeviceTimelineSemaphoreFeatures supported = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES};
+            if(config.api_version >= VK_API_VERSION_1_2 && this->physical_device_properties().apiVersion >= VK_API_VERSION_1_2){
+                VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+                features.pNext = &supported;
+                vkGetPhysicalDeviceFeatures2(self->physical_device, &features);
+            }
+
+            if(supported.timelineSemaphore){
+                timeline_features.timelineSemaphore = VK_TRUE;
+                create_info.pNext = &timeline_features;
+                self->timeline_semaphores = true;
+            } else {
+                spdlog::warn("Timeline semaphores aren't supported, falling back to fences.");
+            }
+        }
+
+        // On Vulkan 1.2 drawIndirectCount only exists in VkPhysicalDeviceVulkan12Features, which can't be chained
+        // next to the 1.2 feature structs it aggregates, so it takes over the timeline semaphore feature as well
+        VkPhysicalDeviceVulkan12Features vulkan12_features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+        bool vulkan_1_2 = config.api_version >= VK_API_VERSION_1_2 && this->physical_device_properties().apiVersion >= VK_API_VERSION_1_2;
+        if(config.draw_indirect_count){
+            if(vulkan_1_2){
+                VkPhysicalDeviceVulkan12Features supported = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+                VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+                features.pNext = &supported;
+                vkGetPhysicalDeviceFeatures2(self->physical_device, &features);
+                if(!supported.drawIndirectCount){
+                    throw std::runtime_error("Draw indirect count was enabled but isn't supported on this device!");
+                }
+
+                vulkan12_features.drawIndirectCount = VK_TRUE;
+                vulkan12_features.timelineSemaphore = (self->timeline_semaphores) ? VK_TRUE : VK_FALSE;
+                create_info.pNext = &vulkan12_features;
+            } else {
+                if(!is_device_extensions_supported(self->physical_device, {VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME})){
+                    throw std::runtime_error("Draw indirect count was enabled but isn't supported on this device!");
+                }
+                device_extensions.push_back(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+                create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+                create_info.ppEnabledExtensionNames = device_extensions.data();
+            }
+            self->draw_indirect_count = true;
+        }
+
+        VkPhysicalDeviceSynchronization2Features sync2_features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES};
+        bool vulkan_1_3 = config.api_version >= VK_API_VERSION_1_3 && this->physical_device_properties().apiVersion >= VK_API_VERSION_1_3;
+        if(config.synchronization2){
+            VkPhysicalDeviceSynchronization2Features supported = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES};
+            bool sync2_extension = !vulkan_1_3 && config.api_version >= VK_API_VERSION_1_1 &&
+                    is_device_extensions_supported(self->physical_device, {VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME});
+            if(vulkan_1_3 || sync2_extension){
+                VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+                features.pNext = &supported;
+                vkGetPhysicalDeviceFeatures2(self->physical_device, &features);
+            }
+
+            if(supported.synchronization2){
+                sync2_features.synchronization2 = VK_TRUE;
+                sync2_features.pNext = const_cast<void*>(create_info.pNext);
+                create_info.pNext = &sync2_features;
+                if(sync2_extension){
+                    device_extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+                    create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+                    create_info.ppEnabledExtensionNames = device_extensions.data();
+                }
+                self->synchronization2 = true;
+            } else {
+                spdlog::warn("Synchronization2 isn't supported, falling back to vkCmdPipelineBarrier and vkQueueSubmit.");
+            }
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeatures dynamic_rendering_features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES};
+        if(config.dynamic_rendering){
+            VkPhysicalDeviceDynamicRenderingFeatures supported = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES};
+            bool dynamic_rendering_extension = !vulkan_1_3 && config.api_version >= VK_API_VERSION_1_1 &&
+                    is_device_extensions_supported(self->physical_device, {VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME});
+            if(vulkan_1_3 || dynamic_rendering_extension){
+                VkPhysicalDeviceFeatures2 features = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2};
+                features.pNext = &supported;
+                vkGetPhysicalDeviceFeatures2(self->physical_device, &features);
+            }
+
+            if(!supported.dynamicRendering){
+                throw std::runtime_error("Dynamic rendering was enabled but isn't supported on this device!");
+            }
+            dynamic_rendering_features.dynamicRendering = VK_TRUE;
+            dynamic_rendering_features.pNext = const_cast<void*>(create_info.pNext);
+            create_info.pNext = &dynamic_rendering_features;
+            if(dynamic_rendering_extension){
+                device_extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+                create_info.enabledExtensionCount = static_cast<uint32_t>(device_extensions.size());
+                create_info.ppEnabledExtensionNames = device_extensions.data();
+            }
+            self->dynamic_rendering = true;
+        }
+
         VkResult result = VK_SUCCESS;
         if( (result = vkCreateDevice(self->physical_device, &create_info, nullptr, &self->device)) != VK_SUCCESS){
             throw std::runtime_error(std::format("Failed to create the logical device! result = {}", static_cast<uint32_t>(result)));
         }
 
-        self->queues.resize(queue_count);
-        for(size_t i = 0; i < queue_count; i++) {
-            vkGetDeviceQueue(self->device, queue_family->index, i, &self->queues[i]);
+        if(self->synchronization2){
+            self->cmd_pipeline_barrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2>(
+                    vkGetDeviceProcAddr(self->device, (vulkan_1_3) ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier2KHR"));
+            self->queue_submit2 = reinterpret_cast<PFN_vkQueueSubmit2>(
+                    vkGetDeviceProcAddr(self->device, (vulkan_1_3) ? "vkQueueSubmit2" : "vkQueueSubmit2KHR"));
         }
+        if(self->dynamic_rendering){
+            self->cmd_begin_rendering = reinterpret_cast<PFN_vkCmdBeginRendering>(
+                    vkGetDeviceProcAddr(self->device, (vulkan_1_3) ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+            self->cmd_end_rendering = reinterpret_cast<PFN_vkCmdEndRendering>(
+                    vkGetDeviceProcAddr(self->device, (vulkan_1_3) ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+        }
+
+        if(self->draw_indirect_count){
+            self->cmd_draw_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndirectCount>(
+                    vkGetDeviceProcAddr(self->device, (vulkan_1_2) ? "vkCmdDrawIndirectCount" : "vkCmdDrawIndirectCountKHR"));
+            self->cmd_draw_indexed_indirect_count = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCount>(
+                    vkGetDeviceProcAddr(self->device, (vulkan_1_2) ? "vkCmdDrawIndexedIndirectCount" : "vkCmdDrawIndexedIndirectCountKHR"));
+        }
+        self->multi_draw_indirect = device_features.multiDrawIndirect;
+        if(self->multi_draw_indirect){
+            VkPhysicalDeviceProperties properties = {};
+            vkGetPhysicalDeviceProperties(self->physical_device, &properties);
+            self->max_draw_indirect_count = properties.limits.maxDrawIndirectCount;
+        }
+
+        self->queues.resize(MAX_QUEUE_COUNT);
+        for(size_t i = 0; i < MAX_QUEUE_COUNT; i++) {
+            vkGetDeviceQueue(self->device, families[i], queue_indices[i], &self->queues[i]);
+        }
+        self->queue_families = families;
+        for(auto [family, count] : queue_counts) self->unique_queue_families.push_back(family);
 
         self->queue_family_info = queue_family.value();
+        spdlog::info("queue families: graphics = {}, compute = {}, transfer = {}",
+                     families[static_cast<size_t>(Queue::GRAPHICS)], families[static_cast<size_t>(Queue::COMPUTE)],
+                     families[static_cast<size_t>(Queue::TRANSFER)]);
     }
 
     
@@ -348,14 +549,25 @@ namespace g_app {
         }
     }
 
-    void VulkanRenderer::init_command_pool() {
-        VkCommandPoolCreateInfo create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
-        create_info.queueFamilyIndex = self->queue_family_info.index;
-        create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    void VulkanRenderer::init_command_pools() {
+        self->command_pools.resize(MAX_QUEUE_COUNT, VK_NULL_HANDLE);
+        for(size_t i = 0; i < MAX_QUEUE_COUNT; i++){
+            // Queues of the same family share one pool
+            auto same_family = std::find(self->queue_families.begin(), self->queue_families.begin() + i, self->queue_families[i]);
+            if(same_family != self->queue_families.begin() + i){
+                self->command_pools[i] = self->command_pools[same_family - self->queue_families.begin()];
+                continue;
+            }
 
-        VkResult result = VK_SUCCESS;
-        if((result = vkCreateCommandPool(self->device, &create_info, nullptr, &self->command_pool)) != VK_SUCCESS){
-            throw std::runtime_error(std::format("Failed to create the command pool! result = {}", static_cast<uint32_t>(result)));
+            VkCommandPoolCreateInfo create_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+            create_info.queueFamilyIndex = self->queue_families[i];
+            create_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+
+            VkResult result = VK_SUCCESS;
+            if((result = vkCreateCommandPool(self->device, &create_info, nullptr, &self->command_pools[i])) != VK_SUCCESS){
+                throw std::runtime_error(std::format("Failed to create a command pool! queue family = {}, result = {}",
+                                                     self->queue_families[i], static_cast<uint32_t>(result)));
+            }
         }
     }
 
@@ -370,7 +582,8 @@ namespace g_app {
         color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         color_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        color_attachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Headless images are never presented, leave them ready to be read back instead
+        color_attachment.finalLayout = (self->headless) ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         color_ref.attachment = 0;
         color_ref.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
@@ -609,9 +822,46 @@ namespace g_app {
         create_depth_resources(self, selected_extent);
     }
 
-    void VulkanRenderer::init_framebuffers() {
-        auto details = get_swapchain_support_details(self->physical_device, self->surface);
+    void VulkanRenderer::init_headless_swapchain(const Config& config) {
+        auto& swapchain = self->swapchain;
+        swapchain.format = TARGET_SWAPCHAIN_FORMAT;
+        swapchain.extent = config.headless_extent;
+        swapchain.min_image_count = config.headless_image_count;
+        swapchain.images.resize(config.headless_image_count);
+        swapchain.allocations.resize(config.headless_image_count);
+
+        for(uint32_t i = 0; i < config.headless_image_count; i++){
+            VkImageCreateInfo image_info = {VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+            image_info.imageType = VK_IMAGE_TYPE_2D;
+            image_info.extent = {swapchain.extent.width, swapchain.extent.height, 1};
+            image_info.mipLevels = 1;
+            image_info.arrayLayers = 1;
+            image_info.format = swapchain.format;
+            image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            image_info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+            image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            VmaAllocationCreateInfo alloc_info = {};
+            alloc_info.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+
+            VkResult result = VK_SUCCESS;
+            if((result =
+                vmaCreateImage(self->allocator, &image_info, &alloc_info,
+                               &swapchain.images[i], &swapchain.allocations[i], nullptr))
+                != VK_SUCCESS)
+            {
+                throw std::runtime_error(
+                        std::format("Failed to create headless swapchain image {}! result = {}", i, static_cast<uint32_t>(result)));
+            }
+        }
+
+        create_image_views(self);
+        create_depth_resources(self, swapchain.extent);
+    }
 
+    void VulkanRenderer::init_framebuffers() {
         self->swapchain.framebuffers.resize(self->swapchain.images.size());
 
         for(uint32_t i = 0; i < self->swapchain.framebuffers.size(); i++){
@@ -640,15 +890,18 @@ namespace g_app {
     }
 
     void VulkanRenderer::init_sync_objects() {
-        self->image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        self->render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        self->in_flight_fences.resize(MAX_FRAMES_IN_FLIGHT);
+        self->queue_submissions.resize(self->queues.size());
+        self->image_available_semaphores.resize(self->frames_in_flight);
+        self->render_finished_semaphores.resize(self->frames_in_flight);
+        // Frames are tracked on the graphics timeline instead of fences when timeline semaphores are enabled
+        if(self->timeline_semaphores) self->frame_timeline_values.resize(self->frames_in_flight, 0);
+        else                          self->in_flight_fences.resize(self->frames_in_flight);
 
         VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
         VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
         fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for(uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i ++) {
+        for(uint32_t i = 0; i < self->frames_in_flight; i ++) {
             VkResult result = VK_SUCCESS;
             if ((result = vkCreateSemaphore(self->device, &semaphore_info, nullptr,
                                             &self->image_available_semaphores[i])) != VK_SUCCESS) {
@@ -662,19 +915,72 @@ namespace g_app {
                         std::format("Failed to create sync object, render finished semaphore! result = {}",
                                     static_cast<uint32_t>(result)));
             }
+            if (self->timeline_semaphores) continue;
             if ((result = vkCreateFence(self->device, &fence_info, nullptr, &self->in_flight_fences[i])) != VK_SUCCESS) {
                 throw std::runtime_error(
                         std::format("Failed to create sync object, in flight fence! result = {}",
                                     static_cast<uint32_t>(result)));
             }
         }
+
+        if(!self->timeline_semaphores) return;
+
+        VkSemaphoreTypeCreateInfo type_info = {VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+        VkSemaphoreCreateInfo timeline_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        timeline_info.pNext = &type_info;
+
+        self->queue_timelines.resize(self->queues.size());
+        for(auto& timeline : self->queue_timelines){
+            VkResult result = VK_SUCCESS;
+            if((result = vkCreateSemaphore(self->device, &timeline_info, nullptr, &timeline.semaphore)) != VK_SUCCESS){
+                throw std::runtime_error(
+                        std::format("Failed to create sync object, queue timeline semaphore! result = {}",
+                                    static_cast<uint32_t>(result)));
+            }
+        }
     }
 
     bool VulkanRenderer::acquire_next_swapchain_image() {
-        vkWaitForFences(self->device, 1, &self->in_flight_fences[self->current_frame], VK_TRUE, UINT64_MAX);
+        G_APP_TRACE_SCOPE("acquire_next_swapchain_image");
+        if(self->timeline_semaphores){
+            G_APP_TRACE_SCOPE("wait_frame_timeline");
+            wait_timeline_point({
+                self->queue_timelines[queue_index(Queue::GRAPHICS)].semaphore,
+                self->frame_timeline_values[self->current_frame]
+            });
+        } else {
+            G_APP_TRACE_SCOPE("wait_in_flight_fence");
+            vkWaitForFences(self->device, 1, &self->in_flight_fences[self->current_frame], VK_TRUE, UINT64_MAX);
+        }
+        // Objects released in earlier frames whose submissions have completed on every queue are no longer in use
+        retire_deletions();
+
+        if(self->headless){
+            self->current_image = (self->current_image + 1) % static_cast<uint32_t>(self->swapchain.images.size());
+
+            // There is no presentation engine to signal the image available semaphore, so signal it here
+            // to keep frame submissions identical to the windowed path.
+            VkSubmitInfo signal_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            signal_info.signalSemaphoreCount = 1;
+            signal_info.pSignalSemaphores = &self->image_available_semaphores[self->current_frame];
 
-        VkResult result = vkAcquireNextImageKHR(self->device, self->swapchain.swapchain, UINT64_MAX,
-                              self->image_available_semaphores[self->current_frame], VK_NULL_HANDLE, &self->current_image);
+            VkResult result = VK_SUCCESS;
+            if((result = vkQueueSubmit(get_queue(Queue::GRAPHICS), 1, &signal_info, VK_NULL_HANDLE)) != VK_SUCCESS){
+                throw std::runtime_error(std::format("Failed to acquire a headless image! result = {}", static_cast<uint32_t>(result)));
+            }
+
+            if(!self->timeline_semaphores) reset_fence(self->in_flight_fences[self->current_frame]);
+            return true;
+        }
+
+        VkResult result = VK_SUCCESS;
+        {
+            G_APP_TRACE_SCOPE("vkAcquireNextImageKHR");
+            result = vkAcquireNextImageKHR(self->device, self->swapchain.swapchain, UINT64_MAX,
+                                           self->image_available_semaphores[self->current_frame], VK_NULL_HANDLE, &self->current_image);
+        }
 
         if(result == VK_ERROR_OUT_OF_DATE_KHR){
             recreate_swapchain();
@@ -683,12 +989,12 @@ namespace g_app {
             throw std::runtime_error("Failed to acquire the next swapchain image!");
         }
 
-        vkResetFences(self->device, 1, &self->in_flight_fences[self->current_frame]);
+        if(!self->timeline_semaphores) reset_fence(self->in_flight_fences[self->current_frame]);
 
         return true;
     }
 
-    void VulkanRenderer::begin_default_render_pass(VkCommandBuffer cmd, float r, float g, float b, float a) {
+    void VulkanRenderer::begin_default_render_pass(VkCommandBuffer cmd, float r, float g, float b, float a, VkSubpassContents contents) {
        auto extent = self->swapchain.extent;
 
         VkRenderPassBeginInfo begin_info = {VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO};
@@ -705,7 +1011,71 @@ namespace g_app {
         begin_info.clearValueCount = 2;
         begin_info.pClearValues = clear_values;
 
-        vkCmdBeginRenderPass(cmd, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(cmd, &begin_info, contents);
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        VkRect2D scissor{{0, 0}, extent};
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+    }
+
+    void VulkanRenderer::begin_default_rendering(VkCommandBuffer cmd, float r, float g, float b, float a, VkRenderingFlags flags) {
+        auto extent = self->swapchain.extent;
+        auto depth_format = self->swapchain.depth_resources.format;
+        VkImageAspectFlags depth_aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+        if(depth_format == VK_FORMAT_D32_SFLOAT_S8_UINT || depth_format == VK_FORMAT_D24_UNORM_S8_UINT) depth_aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+        // Both images are cleared, so their previous contents are discarded. The image available semaphore is waited on
+        // at the colour attachment stage, which the colour transition chains onto.
+        VkImageMemoryBarrier barriers[2] = {{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER}, {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER}};
+        barriers[0].srcAccessMask = 0;
+        barriers[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[0].newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barriers[0].srcQueueFamilyIndex = barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[0].image = self->swapchain.images[current_image()];
+        barriers[0].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[1].dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[1].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        barriers[1].srcQueueFamilyIndex = barriers[1].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[1].image = self->swapchain.depth_resources.images[current_image()];
+        barriers[1].subresourceRange = {depth_aspect, 0, 1, 0, 1};
+
+        VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT |
+                                      VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        vkCmdPipelineBarrier(cmd, stages, stages, 0, 0, nullptr, 0, nullptr, 2, barriers);
+
+        VkRenderingAttachmentInfo color_attachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+        color_attachment.imageView = self->swapchain.image_views[current_image()];
+        color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.clearValue.color = {r, g, b, a};
+
+        VkRenderingAttachmentInfo depth_attachment = {VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO};
+        depth_attachment.imageView = self->swapchain.depth_resources.image_views[current_image()];
+        depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.clearValue.depthStencil = {1.0f, 0};
+
+        VkRenderingInfo rendering_info = {VK_STRUCTURE_TYPE_RENDERING_INFO};
+        rendering_info.flags = flags;
+        rendering_info.renderArea = {{0, 0}, extent};
+        rendering_info.layerCount = 1;
+        rendering_info.colorAttachmentCount = 1;
+        rendering_info.pColorAttachments = &color_attachment;
+        rendering_info.pDepthAttachment = &depth_attachment;
+
+        cmd_begin_rendering(cmd, rendering_info);
         VkViewport viewport{};
         viewport.x = 0.0f;
         viewport.y = 0.0f;
@@ -718,10 +1088,46 @@ namespace g_app {
         vkCmdSetScissor(cmd, 0, 1, &scissor);
     }
 
+    void VulkanRenderer::end_default_rendering(VkCommandBuffer cmd) {
+        cmd_end_rendering(cmd);
+
+        // Same final layout as the default render pass
+        VkImageMemoryBarrier barrier = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = (self->headless) ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.newLayout = (self->headless) ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        barrier.srcQueueFamilyIndex = barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = self->swapchain.images[current_image()];
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             (self->headless) ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+
     void VulkanRenderer::present() {
+        G_APP_TRACE_SCOPE("present");
         auto wait = current_render_finished_semaphore();
         auto current = current_image();
 
+        if(self->headless){
+            // Consume the render finished semaphore, the image simply stays in the offscreen ring
+            VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+            VkSubmitInfo wait_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            wait_info.waitSemaphoreCount = 1;
+            wait_info.pWaitSemaphores = &wait;
+            wait_info.pWaitDstStageMask = &wait_stage;
+
+            VkResult result = VK_SUCCESS;
+            if((result = vkQueueSubmit(get_queue(Queue::GRAPHICS), 1, &wait_info, VK_NULL_HANDLE)) != VK_SUCCESS){
+                throw std::runtime_error(std::format("Failed to present a headless image! result = {}", static_cast<uint32_t>(result)));
+            }
+
+            advance_frame();
+            return;
+        }
+
         VkPresentInfoKHR present_info = {VK_STRUCTURE_TYPE_PRESENT_INFO_KHR};
         present_info.waitSemaphoreCount = 1;
         present_info.pWaitSemaphores = &wait;
@@ -736,7 +1142,213 @@ namespace g_app {
             throw std::runtime_error("Failed to present a swapchain image!");
         }
 
-        self->current_frame = (self->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+        advance_frame();
+    }
+
+    void VulkanRenderer::advance_frame() {
+        // The slot is free again once everything submitted to the graphics queue during this frame has completed
+        if(self->timeline_semaphores){
+            self->frame_timeline_values[self->current_frame] = self->queue_timelines[queue_index(Queue::GRAPHICS)].value;
+        }
+        {
+            // Objects released this frame may be used by anything submitted so far, on any queue
+            std::lock_guard lock(self->deletion_mutex);
+            if(!self->frame_deletions.empty()){
+                DeletionBatch batch = {};
+                for(uint32_t i = 0; i < self->queues.size(); i++) batch.serials[i] = submitted_serial(i);
+                batch.destroys = std::move(self->frame_deletions);
+                self->frame_deletions.clear();
+                self->deletion_batches.push_back(std::move(batch));
+            }
+        }
+        self->current_frame = (self->current_frame + 1) % self->frames_in_flight;
+        self->frame_count++;
+
+        G_APP_TRACE_SCOPE("frame_pacing");
+        self->pacer.wait();
+    }
+
+    void VulkanRenderer::defer_destroy(std::function<void()>&& destroy) {
+        std::unique_lock lock(self->deletion_mutex);
+        if(self->queue_submissions.empty()){
+            lock.unlock();
+            destroy(); // Renderer isn't fully initialised, nothing can be in flight yet
+            return;
+        }
+        self->frame_deletions.push_back(std::move(destroy));
+    }
+
+    void VulkanRenderer::track_submission(Queue queue, const PooledFence& pooled_fence, const TrackedFence& tracked_fence) {
+        if(self->timeline_semaphores) return;
+
+        std::lock_guard lock(self->deletion_mutex);
+        auto& submissions = self->queue_submissions[queue_index(queue)];
+        // Keeps the list short when submissions are made without presenting frames
+        if(submissions.pending.size() >= MAX_PENDING_SUBMISSIONS) completed_serial(queue_index(queue));
+        submissions.pending.push_back({++submissions.submitted, pooled_fence, tracked_fence});
+    }
+
+    uint64_t VulkanRenderer::submitted_serial(uint32_t queue) const {
+        if(self->timeline_semaphores) return self->queue_timelines[queue].value;
+        return self->queue_submissions[queue].submitted;
+    }
+
+    uint64_t VulkanRenderer::completed_serial(uint32_t queue) {
+        if(self->timeline_semaphores) return timeline_value(self->queue_timelines[queue].semaphore);
+
+        // A fence signals once everything submitted to its queue before it has completed, so the oldest pending
+        // submission always finishes first
+        auto& submissions = self->queue_submissions[queue];
+        size_t retired = 0;
+        for(const auto& pending : submissions.pending){
+            bool signaled = (pending.tracked_fence.fence != VK_NULL_HANDLE) ? is_tracked_fence_signaled(pending.tracked_fence)
+                                                                             : is_pooled_fence_signaled(pending.pooled_fence);
+            if(!signaled) break;
+            submissions.completed = pending.serial;
+            retired++;
+        }
+        submissions.pending.erase(submissions.pending.begin(), submissions.pending.begin() + retired);
+        return submissions.completed;
+    }
+
+    void VulkanRenderer::retire_deletions(bool all) {
+        G_APP_TRACE_SCOPE("retire_deletions");
+        // Moved out first, a destructor may release more objects while these are destroyed
+        std::vector<DeletionBatch> retired = {};
+        {
+            std::lock_guard lock(self->deletion_mutex);
+            if(all){
+                // Only called once the device is idle
+                for(auto& submissions : self->queue_submissions){
+                    submissions.completed = submissions.submitted;
+                    submissions.pending.clear();
+                }
+                self->deletion_batches.push_back({{}, std::move(self->frame_deletions)});
+                self->frame_deletions.clear();
+            }
+
+            std::array<uint64_t, static_cast<size_t>(Queue::MAX)> completed = {};
+            for(uint32_t i = 0; i < self->queues.size(); i++) completed[i] = (all) ? UINT64_MAX : completed_serial(i);
+
+            while(!self->deletion_batches.empty()){
+                const auto& batch = self->deletion_batches.front();
+                bool reached = true;
+                for(uint32_t i = 0; i < self->queues.size(); i++) reached = reached && batch.serials[i] <= completed[i];
+                if(!reached) break; // Later batches have equal or higher serials
+
+                retired.push_back(std::move(self->deletion_batches.front()));
+                self->deletion_batches.pop_front();
+            }
+        }
+        for(auto& batch : retired){
+            for(auto& destroy : batch.destroys) destroy();
+        }
+    }
+
+    PooledFence VulkanRenderer::acquire_pooled_fence() {
+        for(uint32_t i = 0; i < self->fence_pool.size(); i++){
+            auto& entry = self->fence_pool[i];
+            if(entry.in_use){
+                if(vkGetFenceStatus(self->device, entry.fence) != VK_SUCCESS) continue;
+                vkResetFences(self->device, 1, &entry.fence);
+                entry.generation++;
+            }
+
+            entry.in_use = true;
+            return {i, entry.generation, entry.fence};
+        }
+
+        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        FencePoolEntry entry = {};
+
+        VkResult result = VK_SUCCESS;
+        if((result = vkCreateFence(self->device, &fence_info, nullptr, &entry.fence)) != VK_SUCCESS){
+            throw std::runtime_error(
+                    std::format("Failed to create a pooled fence! result = {}", static_cast<uint32_t>(result)));
+        }
+        entry.in_use = true;
+        self->fence_pool.push_back(entry);
+
+        return {static_cast<uint32_t>(self->fence_pool.size() - 1), entry.generation, entry.fence};
+    }
+
+    bool VulkanRenderer::is_pooled_fence_signaled(const PooledFence& fence) const {
+        const auto& entry = self->fence_pool[fence.index];
+        if(entry.generation != fence.generation) return true; // Recycled, so it signalled a long time ago
+
+        return vkGetFenceStatus(self->device, entry.fence) == VK_SUCCESS;
+    }
+
+    bool VulkanRenderer::wait_pooled_fence(const PooledFence& fence, uint64_t timeout) const {
+        const auto& entry = self->fence_pool[fence.index];
+        if(entry.generation != fence.generation) return true;
+
+        return vkWaitForFences(self->device, 1, &entry.fence, VK_TRUE, timeout) == VK_SUCCESS;
+    }
+
+    TrackedFence VulkanRenderer::track_fence(VkFence fence) {
+        std::lock_guard lock(self->fence_mutex);
+        auto [it, inserted] = self->fence_generations.try_emplace(fence, 0);
+        if(inserted) it->second = ++self->last_fence_generation;
+        return {fence, it->second};
+    }
+
+    void VulkanRenderer::reset_fence(VkFence fence) {
+        std::lock_guard lock(self->fence_mutex);
+        vkResetFences(self->device, 1, &fence);
+        auto it = self->fence_generations.find(fence);
+        if(it != self->fence_generations.end()) it->second = ++self->last_fence_generation;
+    }
+
+    bool VulkanRenderer::is_tracked_fence_signaled(const TrackedFence& fence) const {
+        std::lock_guard lock(self->fence_mutex);
+        // Reset or destroyed since, either needs the submission to have completed
+        auto it = self->fence_generations.find(fence.fence);
+        if(it == self->fence_generations.end() || it->second != fence.generation) return true;
+
+        return vkGetFenceStatus(self->device, fence.fence) == VK_SUCCESS;
+    }
+
+    bool VulkanRenderer::wait_tracked_fence(const TrackedFence& fence, uint64_t timeout) const {
+        {
+            std::lock_guard lock(self->fence_mutex);
+            auto it = self->fence_generations.find(fence.fence);
+            if(it == self->fence_generations.end() || it->second != fence.generation) return true;
+        }
+        // Not held while waiting, a reset can only follow the signal this waits for
+        return vkWaitForFences(self->device, 1, &fence.fence, VK_TRUE, timeout) == VK_SUCCESS;
+    }
+
+    TimelinePoint VulkanRenderer::next_timeline_point(Queue queue) {
+        assert(self->timeline_semaphores && "Timeline semaphores aren't enabled!");
+        auto& timeline = self->queue_timelines[queue_index(queue)];
+        return {timeline.semaphore, ++timeline.value};
+    }
+
+    TimelinePoint VulkanRenderer::queue_timeline_point(Queue queue) const {
+        assert(self->timeline_semaphores && "Timeline semaphores aren't enabled!");
+        const auto& timeline = self->queue_timelines[queue_index(queue)];
+        return {timeline.semaphore, timeline.value};
+    }
+
+    uint64_t VulkanRenderer::timeline_value(VkSemaphore semaphore) const {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(self->device, semaphore, &value);
+        return value;
+    }
+
+    bool VulkanRenderer::is_timeline_point_reached(const TimelinePoint& point) const {
+        return timeline_value(point.semaphore) >= point.value;
+    }
+
+    bool VulkanRenderer::wait_timeline_point(const TimelinePoint& point, uint64_t timeout) const {
+        if(point.value == 0) return true; // Timelines start at 0
+
+        VkSemaphoreWaitInfo wait_info = {VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &point.semaphore;
+        wait_info.pValues = &point.value;
+        return vkWaitSemaphores(self->device, &wait_info, timeout) == VK_SUCCESS;
     }
 
     ImGuiIO& VulkanRenderer::init_imgui() {
@@ -746,7 +1358,11 @@ namespace g_app {
         ImGui::CreateContext();
         ImGuiIO& io = ImGui::GetIO(); (void) io;
 
-        ImGui_ImplGlfw_InitForVulkan(self->window, true);
+        if(self->headless){
+            io.DisplaySize = {static_cast<float>(self->swapchain.extent.width), static_cast<float>(self->swapchain.extent.height)};
+        } else {
+            ImGui_ImplGlfw_InitForVulkan(self->window, true);
+        }
         ImGui_ImplVulkan_InitInfo init_info = {};
         init_info.Instance = self->instance;
         init_info.PhysicalDevice = self->physical_device;
@@ -782,6 +1398,7 @@ namespace g_app {
     }
 
     void VulkanRenderer::recreate_swapchain() {
+        G_APP_TRACE_SCOPE("recreate_swapchain");
         int width = 0, height = 0;
         glfwGetFramebufferSize(self->window, &width, &height);
         while (width == 0 || height == 0) {
@@ -795,5 +1412,6 @@ namespace g_app {
         init_swapchain(old_swapchain.swapchain);
         init_framebuffers();
         old_swapchain.destroy(self->device, self->allocator);
+        self->swapchain_generation++;
     }
 } // g_app
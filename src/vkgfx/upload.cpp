@@ -0,0 +1,516 @@
+//
+// Created by jandr on 16/10/2026.
+//
+
+/*
+ * This file is a part of the g_app open-source project.
+ *
+ *  repo: https://github.com/NongusStudios/g_app.git
+ *  license: MIT
+ *
+ *  Copyright (c) 2023 Nongus Studios
+ *  Permission is hereby granted, free of charge, to any person obtaining a copy
+ *  of this software and associated documentation files (the "Software"), to deal
+ *  in the Software without restriction, including without limitation the rights
+ *  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *  copies of the Software, and to permit persons to whom the Software is
+ *  furnished to do so, subject to the following conditions:
+ *
+ *  The above copyright notice and this permission notice shall be included in all
+ *  copies or substantial portions of the Software.
+ *
+ *  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *  SOFTWARE.
+ */
+
+#include "../include/vkgfx/upload.hpp"
+
+#include <stdexcept>
+#include <format>
+#include <cstring>
+#include <algorithm>
+
+namespace g_app {
+    static VkDeviceSize align_up(VkDeviceSize value, VkDeviceSize alignment){
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    static VkCommandPool create_upload_command_pool(VkDevice device, uint32_t queue_family){
+        VkCommandPoolCreateInfo pool_info = {VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        pool_info.queueFamilyIndex = queue_family;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        VkResult result = VK_SUCCESS;
+        if((result = vkCreateCommandPool(device, &pool_info, nullptr, &command_pool)) != VK_SUCCESS){
+            throw std::runtime_error(std::format("Failed to create an upload command pool! queue family = {}, result = {}",
+                                                 queue_family, static_cast<uint32_t>(result)));
+        }
+        return command_pool;
+    }
+
+    UploadState::UploadState(VkDevice device, VmaAllocator allocator, uint32_t transfer_family, uint32_t graphics_family,
+                             VkDeviceSize capacity):
+        device{device}, allocator{allocator}, transfer_family{transfer_family}, graphics_family{graphics_family}, capacity{capacity}
+    {
+        command_pool = create_upload_command_pool(device, transfer_family);
+        if(transfer_family != graphics_family){
+            try {
+                acquire_command_pool = create_upload_command_pool(device, graphics_family);
+            } catch(const std::runtime_error&) {
+                vkDestroyCommandPool(device, command_pool, nullptr);
+                throw;
+            }
+        }
+
+        VkResult result = VK_SUCCESS;
+
+        VkBufferCreateInfo create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        create_info.size = capacity;
+        create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+        alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+        VmaAllocationInfo allocation_info = {};
+        if((result = vmaCreateBuffer(allocator, &create_info, &alloc_info, &staging, &staging_allocation, &allocation_info)) != VK_SUCCESS){
+            vkDestroyCommandPool(device, command_pool, nullptr);
+            if(acquire_command_pool != VK_NULL_HANDLE) vkDestroyCommandPool(device, acquire_command_pool, nullptr);
+            throw std::runtime_error(std::format("Failed to create the upload staging ring! size = {}, result = {}",
+                                                 capacity, static_cast<uint32_t>(result)));
+        }
+        mapped = static_cast<uint8_t*>(allocation_info.pMappedData);
+    }
+
+    UploadState::~UploadState() {
+        // Only destroyed by the renderer after the device has gone idle
+        for(auto& batch : in_flight){
+            for(auto& buffer : batch.dedicated) vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+        }
+        for(auto& buffer : dedicated) vmaDestroyBuffer(allocator, buffer.buffer, buffer.allocation);
+        for(auto& batch : in_flight){
+            if(batch.semaphore != VK_NULL_HANDLE) vkDestroySemaphore(device, batch.semaphore, nullptr);
+        }
+        for(auto semaphore : free_semaphores) vkDestroySemaphore(device, semaphore, nullptr);
+
+        vmaDestroyBuffer(allocator, staging, staging_allocation);
+        vkDestroyCommandPool(device, command_pool, nullptr); // Frees every command buffer allocated from it
+        if(acquire_command_pool != VK_NULL_HANDLE) vkDestroyCommandPool(device, acquire_command_pool, nullptr);
+    }
+
+    UploadManager VulkanRenderer::uploads() const {
+        if(!self->upload_state){
+            try {
+                self->upload_state = std::make_shared<UploadState>(self->device, self->allocator,
+                                                                   queue_family_index(Queue::TRANSFER),
+                                                                   queue_family_index(Queue::GRAPHICS), self->upload_staging_size);
+            } catch(const std::runtime_error& e) {
+                spdlog::error(e.what());
+                std::exit(EXIT_FAILURE);
+            }
+        }
+        return {*this, self->upload_state};
+    }
+
+    UploadManager& UploadManager::upload_image(const Image& dst, const void* pixels, size_t texel_size,
+                                               VkImageAspectFlags aspect_mask, VkImageLayout final_layout,
+                                               VkPipelineStageFlags dst_stage, VkAccessFlags dst_access,
+                                               uint32_t mip_level, uint32_t base_layer, uint32_t layer_count){
+        VkExtent3D extent = dst.extent();
+        extent.width = std::max(extent.width >> mip_level, 1u);
+        extent.height = std::max(extent.height >> mip_level, 1u);
+        extent.depth = std::max(extent.depth >> mip_level, 1u);
+
+        VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * extent.depth * layer_count * texel_size;
+        // bufferOffset has to be a multiple of both the texel size and 4
+        auto staged = stage(pixels, size, texel_size * 4);
+
+        VkBufferImageCopy region = {};
+        region.bufferOffset = staged.offset;
+        region.imageSubresource.aspectMask = aspect_mask;
+        region.imageSubresource.mipLevel = mip_level;
+        region.imageSubresource.baseArrayLayer = base_layer;
+        region.imageSubresource.layerCount = layer_count;
+        region.imageOffset = {0, 0, 0};
+        region.imageExtent = extent;
+
+        m_state->image_copies.push_back({staged.buffer, dst.vk_image(), region, final_layout, dst_access, dst_stage,
+                                         &dst.resource_state()});
+        return *this;
+    }
+
+    SubmitTicket UploadManager::flush() {
+        if(!has_pending()) return last_ticket();
+
+        auto& state = *m_state;
+        retire_batches(false);
+
+        VkCommandBuffer cmdbuf = allocate_command_buffer(state.command_pool, state.free_cmdbufs);
+
+        VkCommandBufferBeginInfo begin_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        vkBeginCommandBuffer(cmdbuf, &begin_info);
+
+        // All layout transitions into TRANSFER_DST go out in a single barrier
+        std::vector<VkImageMemoryBarrier> image_barriers = {};
+        image_barriers.reserve(state.image_copies.size());
+        for(const auto& copy : state.image_copies){
+            VkImageMemoryBarrier b = {VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+            b.srcAccessMask = 0;
+            b.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            b.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            b.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            b.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            b.image = copy.dst;
+            b.subresourceRange = {copy.region.imageSubresource.aspectMask,
+                                  copy.region.imageSubresource.mipLevel, 1,
+                                  copy.region.imageSubresource.baseArrayLayer, copy.region.imageSubresource.layerCount};
+            image_barriers.push_back(b);
+        }
+        if(!image_barriers.empty()){
+            vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                                 0, nullptr, 0, nullptr,
+                                 static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+        }
+
+        // Coalesce buffer copies sharing a source and destination into one vkCmdCopyBuffer
+        std::stable_sort(state.buffer_copies.begin(), state.buffer_copies.end(),
+                         [](const UploadState::BufferCopy& a, const UploadState::BufferCopy& b){
+            return (a.src != b.src) ? a.src < b.src : a.dst < b.dst;
+        });
+        std::vector<VkBufferCopy> regions = {};
+        for(size_t i = 0; i < state.buffer_copies.size();){
+            size_t j = i;
+            regions.clear();
+            while(j < state.buffer_copies.size() &&
+                  state.buffer_copies[j].src == state.buffer_copies[i].src &&
+                  state.buffer_copies[j].dst == state.buffer_copies[i].dst){
+                regions.push_back(state.buffer_copies[j].region);
+                j++;
+            }
+            vkCmdCopyBuffer(cmdbuf, state.buffer_copies[i].src, state.buffer_copies[i].dst,
+                            static_cast<uint32_t>(regions.size()), regions.data());
+            i = j;
+        }
+
+        for(const auto& copy : state.image_copies){
+            vkCmdCopyBufferToImage(cmdbuf, copy.src, copy.dst, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+        }
+
+        bool ownership_transfer = state.transfer_family != state.graphics_family;
+
+        // Release everything to its consumers, again in one barrier. With a dedicated transfer family the barrier only
+        // releases ownership, the consumer stages are synchronised by the acquire on the graphics queue.
+        VkPipelineStageFlags dst_stages = 0;
+        for(size_t i = 0; i < state.image_copies.size(); i++){
+            auto& b = image_barriers[i];
+            b.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            b.dstAccessMask = (ownership_transfer) ? 0 : state.image_copies[i].dst_access;
+            b.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            b.newLayout = state.image_copies[i].final_layout;
+            if(ownership_transfer){
+                b.srcQueueFamilyIndex = state.transfer_family;
+                b.dstQueueFamilyIndex = state.graphics_family;
+            }
+            dst_stages |= state.image_copies[i].dst_stage;
+        }
+
+        VkMemoryBarrier memory_barrier = {VK_STRUCTURE_TYPE_MEMORY_BARRIER};
+        memory_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        memory_barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+        uint32_t memory_barrier_count = 0;
+        std::vector<VkBufferMemoryBarrier> buffer_barriers = {};
+        if(!state.buffer_copies.empty()){
+            dst_stages |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+            if(ownership_transfer){
+                // Ownership is per buffer, one barrier for each destination
+                for(const auto& copy : state.buffer_copies){
+                    if(std::any_of(buffer_barriers.begin(), buffer_barriers.end(),
+                                   [&](const VkBufferMemoryBarrier& b){ return b.buffer == copy.dst; })) continue;
+
+                    VkBufferMemoryBarrier b = {VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER};
+                    b.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                    b.dstAccessMask = 0;
+                    b.srcQueueFamilyIndex = state.transfer_family;
+                    b.dstQueueFamilyIndex = state.graphics_family;
+                    b.buffer = copy.dst;
+                    b.offset = 0;
+                    b.size = VK_WHOLE_SIZE;
+                    buffer_barriers.push_back(b);
+                }
+            } else {
+                memory_barrier_count = 1;
+            }
+        }
+
+        vkCmdPipelineBarrier(cmdbuf, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             (ownership_transfer) ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : dst_stages, 0,
+                             memory_barrier_count, &memory_barrier,
+                             static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+                             static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+
+        VkResult result = VK_SUCCESS;
+        if((result = vkEndCommandBuffer(cmdbuf)) != VK_SUCCESS){
+            spdlog::error("Failed to end recording upload commands! result = {}", static_cast<uint32_t>(result));
+            std::exit(EXIT_FAILURE);
+        }
+
+        UploadState::Batch batch = {};
+        batch.cmdbuf = cmdbuf;
+
+        // The batch is tracked by the last submission it makes, on the graphics queue when ownership is transferred.
+        // Cross-queue users wait on its timeline point, the ticket is backed by it when available.
+        Queue tracked_queue = (ownership_transfer) ? Queue::GRAPHICS : Queue::TRANSFER;
+        PooledFence fence = {};
+        TimelinePoint timeline = {};
+        if(m_renderer.has_timeline_semaphores()) timeline = m_renderer.next_timeline_point(tracked_queue);
+        else                                     fence = m_renderer.acquire_pooled_fence();
+
+        // Signalled by the transfer submission and waited on by the acquire, only used with a dedicated transfer family
+        TimelinePoint transfer_point = {};
+        if(ownership_transfer){
+            if(m_renderer.has_timeline_semaphores()){
+                transfer_point = m_renderer.next_timeline_point(Queue::TRANSFER);
+            } else {
+                batch.semaphore = acquire_semaphore();
+                transfer_point = {batch.semaphore, 0};
+            }
+        }
+        TimelinePoint transfer_signal = (ownership_transfer) ? transfer_point : timeline;
+
+        VkSubmitInfo submit_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &cmdbuf;
+
+        VkTimelineSemaphoreSubmitInfo timeline_info = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+        if(transfer_signal.semaphore != VK_NULL_HANDLE){
+            submit_info.signalSemaphoreCount = 1;
+            submit_info.pSignalSemaphores = &transfer_signal.semaphore;
+            if(m_renderer.has_timeline_semaphores()){
+                timeline_info.signalSemaphoreValueCount = 1;
+                timeline_info.pSignalSemaphoreValues = &transfer_signal.value;
+                submit_info.pNext = &timeline_info;
+            }
+        }
+
+        if((result = vkQueueSubmit(m_renderer.get_queue(Queue::TRANSFER), 1, &submit_info,
+                                   (ownership_transfer) ? VK_NULL_HANDLE : fence.fence)) != VK_SUCCESS){
+            spdlog::error("Failed to submit uploads! result = {}", static_cast<uint32_t>(result));
+            std::exit(EXIT_FAILURE);
+        }
+
+        if(ownership_transfer){
+            batch.acquire_cmdbuf = allocate_command_buffer(state.acquire_command_pool, state.free_acquire_cmdbufs);
+            vkBeginCommandBuffer(batch.acquire_cmdbuf, &begin_info);
+
+            // The acquire half of the ownership transfer, identical to the release apart from the access masks
+            for(size_t i = 0; i < image_barriers.size(); i++){
+                image_barriers[i].srcAccessMask = 0;
+                image_barriers[i].dstAccessMask = state.image_copies[i].dst_access;
+            }
+            for(auto& b : buffer_barriers){
+                b.srcAccessMask = 0;
+                b.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+            }
+            vkCmdPipelineBarrier(batch.acquire_cmdbuf, dst_stages, dst_stages, 0,
+                                 0, nullptr,
+                                 static_cast<uint32_t>(buffer_barriers.size()), buffer_barriers.data(),
+                                 static_cast<uint32_t>(image_barriers.size()), image_barriers.data());
+
+            if((result = vkEndCommandBuffer(batch.acquire_cmdbuf)) != VK_SUCCESS){
+                spdlog::error("Failed to end recording upload acquire commands! result = {}", static_cast<uint32_t>(result));
+                std::exit(EXIT_FAILURE);
+            }
+
+            uint64_t signal_value = timeline.value;
+            VkSubmitInfo acquire_info = {VK_STRUCTURE_TYPE_SUBMIT_INFO};
+            acquire_info.commandBufferCount = 1;
+            acquire_info.pCommandBuffers = &batch.acquire_cmdbuf;
+            acquire_info.waitSemaphoreCount = 1;
+            acquire_info.pWaitSemaphores = &transfer_point.semaphore;
+            acquire_info.pWaitDstStageMask = &dst_stages;
+
+            VkTimelineSemaphoreSubmitInfo acquire_timeline_info = {VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+            if(m_renderer.has_timeline_semaphores()){
+                acquire_info.signalSemaphoreCount = 1;
+                acquire_info.pSignalSemaphores = &timeline.semaphore;
+                acquire_timeline_info.waitSemaphoreValueCount = 1;
+                acquire_timeline_info.pWaitSemaphoreValues = &transfer_point.value;
+                acquire_timeline_info.signalSemaphoreValueCount = 1;
+                acquire_timeline_info.pSignalSemaphoreValues = &signal_value;
+                acquire_info.pNext = &acquire_timeline_info;
+            }
+
+            if((result = vkQueueSubmit(m_renderer.get_queue(Queue::GRAPHICS), 1, &acquire_info, fence.fence)) != VK_SUCCESS){
+                spdlog::error("Failed to submit upload acquire commands! result = {}", static_cast<uint32_t>(result));
+                std::exit(EXIT_FAILURE);
+            }
+        }
+
+        // With an ownership transfer the acquire waits on the copies, so its fence covers the transfer submission as well
+        m_renderer.track_submission(Queue::TRANSFER, fence);
+        if(ownership_transfer) m_renderer.track_submission(Queue::GRAPHICS, fence);
+
+        batch.fence = fence;
+        batch.timeline = timeline;
+        batch.ring_end = state.head;
+        batch.dedicated = std::move(state.dedicated);
+        state.in_flight.push_back(std::move(batch));
+
+        // The release barrier leaves each image visible to dst_stage in final_layout, from this submission on
+        for(const auto& copy : state.image_copies){
+            *copy.state = {copy.final_layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                           copy.dst_stage, copy.dst_access};
+        }
+
+        state.dedicated.clear();
+        state.buffer_copies.clear();
+        state.image_copies.clear();
+        state.last_fence = fence;
+        state.last_timeline = timeline;
+
+        return last_ticket();
+    }
+
+    SubmitTicket UploadManager::last_ticket() const {
+        if(m_state->in_flight.empty()) return {};
+        if(m_state->last_timeline.semaphore != VK_NULL_HANDLE) return {m_renderer, m_state->last_timeline};
+        return {m_renderer, m_state->last_fence};
+    }
+
+    UploadManager::Staged UploadManager::stage(const void* data, VkDeviceSize size, VkDeviceSize alignment) {
+        auto& state = *m_state;
+        if(size > state.capacity) return stage_dedicated(data, size);
+
+        while(true){
+            // The capacity needn't be a multiple of the alignment (e.g. 3 byte texels), so align the physical offset.
+            // An allocation never straddles the end of the ring, skip ahead to the start of the next lap instead.
+            uint64_t lap = state.head - state.head % state.capacity;
+            VkDeviceSize physical = align_up(state.head % state.capacity, alignment);
+            if(physical + size > state.capacity){
+                lap += state.capacity;
+                physical = 0;
+            }
+            uint64_t offset = lap + physical;
+
+            if(offset + size - state.tail <= state.capacity){
+                stream_copy(state.mapped + physical, data, size);
+                vmaFlushAllocation(state.allocator, state.staging_allocation, physical, size); // No-op on coherent memory
+                state.head = offset + size;
+                return {state.staging, physical};
+            }
+
+            if(!state.in_flight.empty()){
+                retire_batches(true);
+            } else if(has_pending()){
+                // The ring is full of copies that haven't been submitted yet
+                flush();
+            } else {
+                // Nothing references the ring anymore
+                state.tail = state.head = 0;
+            }
+        }
+    }
+
+    UploadManager::Staged UploadManager::stage_dedicated(const void* data, VkDeviceSize size) {
+        VkBufferCreateInfo create_info = {VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+        create_info.size = size;
+        create_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        create_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        VmaAllocationCreateInfo alloc_info = {};
+        alloc_info.usage = VMA_MEMORY_USAGE_AUTO;
+        alloc_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT | VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
+
+        UploadState::DedicatedBuffer buffer = {};
+        VmaAllocationInfo allocation_info = {};
+        VkResult result = VK_SUCCESS;
+        if((result = vmaCreateBuffer(m_state->allocator, &create_info, &alloc_info,
+                                     &buffer.buffer, &buffer.allocation, &allocation_info)) != VK_SUCCESS){
+            spdlog::error("Failed to create a dedicated staging buffer! size = {}, result = {}", size, static_cast<uint32_t>(result));
+            std::exit(EXIT_FAILURE);
+        }
+
+        stream_copy(allocation_info.pMappedData, data, size);
+        vmaFlushAllocation(m_state->allocator, buffer.allocation, 0, size);
+
+        m_state->dedicated.push_back(buffer);
+        return {buffer.buffer, 0};
+    }
+
+    void UploadManager::retire_batches(bool wait_oldest) {
+        auto& state = *m_state;
+        auto is_retired = [&](const UploadState::Batch& batch, bool wait){
+            if(batch.timeline.semaphore != VK_NULL_HANDLE){
+                return (wait) ? m_renderer.wait_timeline_point(batch.timeline) : m_renderer.is_timeline_point_reached(batch.timeline);
+            }
+            return (wait) ? m_renderer.wait_pooled_fence(batch.fence) : m_renderer.is_pooled_fence_signaled(batch.fence);
+        };
+
+        if(wait_oldest && !state.in_flight.empty()){
+            is_retired(state.in_flight.front(), true);
+        }
+
+        while(!state.in_flight.empty() && is_retired(state.in_flight.front(), false)){
+            auto& batch = state.in_flight.front();
+            vkResetCommandBuffer(batch.cmdbuf, 0);
+            state.free_cmdbufs.push_back(batch.cmdbuf);
+            if(batch.acquire_cmdbuf != VK_NULL_HANDLE){
+                vkResetCommandBuffer(batch.acquire_cmdbuf, 0);
+                state.free_acquire_cmdbufs.push_back(batch.acquire_cmdbuf);
+            }
+            if(batch.semaphore != VK_NULL_HANDLE) state.free_semaphores.push_back(batch.semaphore);
+            for(auto& buffer : batch.dedicated) vmaDestroyBuffer(state.allocator, buffer.buffer, buffer.allocation);
+
+            state.tail = batch.ring_end;
+            state.in_flight.pop_front();
+        }
+    }
+
+    VkCommandBuffer UploadManager::allocate_command_buffer(VkCommandPool pool, std::vector<VkCommandBuffer>& free_list) {
+        if(!free_list.empty()){
+            auto cmdbuf = free_list.back();
+            free_list.pop_back();
+            return cmdbuf;
+        }
+
+        VkCommandBufferAllocateInfo alloc_info = {VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        alloc_info.commandPool = pool;
+        alloc_info.commandBufferCount = 1;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+
+        VkCommandBuffer cmdbuf = VK_NULL_HANDLE;
+        VkResult result = VK_SUCCESS;
+        if((result = vkAllocateCommandBuffers(m_state->device, &alloc_info, &cmdbuf)) != VK_SUCCESS){
+            spdlog::error("Failed to allocate an upload command buffer! result = {}", static_cast<uint32_t>(result));
+            std::exit(EXIT_FAILURE);
+        }
+        return cmdbuf;
+    }
+
+    VkSemaphore UploadManager::acquire_semaphore() {
+        auto& state = *m_state;
+        if(!state.free_semaphores.empty()){
+            auto semaphore = state.free_semaphores.back();
+            state.free_semaphores.pop_back();
+            return semaphore;
+        }
+
+        VkSemaphoreCreateInfo create_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        VkResult result = VK_SUCCESS;
+        if((result = vkCreateSemaphore(state.device, &create_info, nullptr, &semaphore)) != VK_SUCCESS){
+            spdlog::error("Failed to create an upload semaphore! result = {}", static_cast<uint32_t>(result));
+            std::exit(EXIT_FAILURE);
+        }
+        return semaphore;
+    }
+}